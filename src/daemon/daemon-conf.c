@@ -94,6 +94,9 @@ static const pa_daemon_conf default_conf = {
 #endif
     .no_cpu_limit = TRUE,
     .disable_shm = FALSE,
+    .enable_memfd = FALSE,
+    .memfd_hugetlb = FALSE,
+    .disable_srbchannel = FALSE,
     .lock_memory = FALSE,
     .deferred_volume = TRUE,
     .default_n_fragments = 4,
@@ -576,6 +579,10 @@ int pa_daemon_conf_load(pa_daemon_conf *c, const char *filename) {
         { "cpu-limit",                  pa_config_parse_not_bool, &c->no_cpu_limit, NULL },
         { "disable-shm",                pa_config_parse_bool,     &c->disable_shm, NULL },
         { "enable-shm",                 pa_config_parse_not_bool, &c->disable_shm, NULL },
+        { "enable-memfd",               pa_config_parse_bool,     &c->enable_memfd, NULL },
+        { "memfd-hugetlb",              pa_config_parse_bool,     &c->memfd_hugetlb, NULL },
+        { "disable-srbchannel",         pa_config_parse_bool,     &c->disable_srbchannel, NULL },
+        { "enable-srbchannel",          pa_config_parse_not_bool, &c->disable_srbchannel, NULL },
         { "flat-volumes",               pa_config_parse_bool,     &c->flat_volumes, NULL },
         { "lock-memory",                pa_config_parse_bool,     &c->lock_memory, NULL },
         { "enable-deferred-volume",     pa_config_parse_bool,     &c->deferred_volume, NULL },
@@ -780,6 +787,9 @@ char *pa_daemon_conf_dump(pa_daemon_conf *c) {
 #endif
     pa_strbuf_printf(s, "cpu-limit = %s\n", pa_yes_no(!c->no_cpu_limit));
     pa_strbuf_printf(s, "enable-shm = %s\n", pa_yes_no(!c->disable_shm));
+    pa_strbuf_printf(s, "enable-memfd = %s\n", pa_yes_no(c->enable_memfd));
+    pa_strbuf_printf(s, "memfd-hugetlb = %s\n", pa_yes_no(c->memfd_hugetlb));
+    pa_strbuf_printf(s, "enable-srbchannel = %s\n", pa_yes_no(!c->disable_srbchannel));
     pa_strbuf_printf(s, "flat-volumes = %s\n", pa_yes_no(c->flat_volumes));
     pa_strbuf_printf(s, "lock-memory = %s\n", pa_yes_no(c->lock_memory));
     pa_strbuf_printf(s, "exit-idle-time = %i\n", c->exit_idle_time);
@@ -68,6 +68,9 @@ typedef struct pa_daemon_conf {
         system_instance,
         no_cpu_limit,
         disable_shm,
+        enable_memfd,
+        memfd_hugetlb,
+        disable_srbchannel,
         disable_remixing,
         disable_lfe_remixing,
         load_default_script_file,
@@ -1005,9 +1005,12 @@ int main(int argc, char *argv[]) {
 
     pa_memtrap_install();
 
+    if (pa_log_async_start() < 0)
+        pa_log_warn("Failed to start the logger thread, IO threads will log synchronously.");
+
     pa_assert_se(mainloop = pa_mainloop_new());
 
-    if (!(c = pa_core_new(pa_mainloop_get_api(mainloop), !conf->disable_shm, conf->shm_size))) {
+    if (!(c = pa_core_new(pa_mainloop_get_api(mainloop), !conf->disable_shm, conf->enable_memfd, conf->memfd_hugetlb, conf->shm_size))) {
         pa_log(_("pa_core_new() failed."));
         goto finish;
     }
@@ -1026,6 +1029,7 @@ int main(int argc, char *argv[]) {
     c->realtime_scheduling = !!conf->realtime_scheduling;
     c->disable_remixing = !!conf->disable_remixing;
     c->disable_lfe_remixing = !!conf->disable_lfe_remixing;
+    c->disable_srbchannel = !!conf->disable_srbchannel;
     c->deferred_volume = !!conf->deferred_volume;
     c->running_as_daemon = !!conf->daemonize;
     c->disallow_exit = conf->disallow_exit;
@@ -1169,6 +1173,8 @@ finish:
         pa_log_info(_("Daemon terminated."));
     }
 
+    pa_log_async_stop();
+
     if (!conf->no_cpu_limit)
         pa_cpu_limit_done();
 
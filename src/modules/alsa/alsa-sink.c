@@ -463,9 +463,12 @@ static size_t check_left_to_play(struct userdata *u, size_t n_bytes, pa_bool_t o
         PA_DEBUG_TRAP;
 #endif
 
-        if (!u->first && !u->after_rewind)
+        if (!u->first && !u->after_rewind) {
+            pa_io_stats_xrun(&u->sink->io_stats);
+
             if (pa_log_ratelimit(PA_LOG_INFO))
                 pa_log_info("Underrun!");
+        }
     }
 
 #ifdef DEBUG_TIMING
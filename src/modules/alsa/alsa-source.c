@@ -438,6 +438,8 @@ static size_t check_left_to_record(struct userdata *u, size_t n_bytes, pa_bool_t
         PA_DEBUG_TRAP;
 #endif
 
+        pa_io_stats_xrun(&u->source->io_stats);
+
         if (pa_log_ratelimit(PA_LOG_INFO))
             pa_log_info("Overrun!");
     }
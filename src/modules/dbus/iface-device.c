@@ -28,6 +28,7 @@
 #include <pulsecore/protocol-dbus.h>
 
 #include "iface-device-port.h"
+#include "iface-iostats.h"
 
 #include "iface-device.h"
 
@@ -95,6 +96,7 @@ struct pa_dbusiface_device {
     uint32_t next_port_index;
     pa_device_port *active_port;
     pa_proplist *proplist;
+    pa_dbusiface_iostats *iostats;
 
     pa_dbus_protocol *dbus_protocol;
     pa_subscription *subscription;
@@ -1217,6 +1219,7 @@ pa_dbusiface_device *pa_dbusiface_device_new_sink(pa_dbusiface_core *core, pa_si
 
     pa_assert_se(pa_dbus_protocol_add_interface(d->dbus_protocol, d->path, &device_interface_info, d) >= 0);
     pa_assert_se(pa_dbus_protocol_add_interface(d->dbus_protocol, d->path, &sink_interface_info, d) >= 0);
+    d->iostats = pa_dbusiface_iostats_new(sink->core, d->path, &sink->io_stats);
 
     return d;
 }
@@ -1251,6 +1254,7 @@ pa_dbusiface_device *pa_dbusiface_device_new_source(pa_dbusiface_core *core, pa_
 
     pa_assert_se(pa_dbus_protocol_add_interface(d->dbus_protocol, d->path, &device_interface_info, d) >= 0);
     pa_assert_se(pa_dbus_protocol_add_interface(d->dbus_protocol, d->path, &source_interface_info, d) >= 0);
+    d->iostats = pa_dbusiface_iostats_new(source->core, d->path, &source->io_stats);
 
     return d;
 }
@@ -1266,6 +1270,7 @@ static void port_free_cb(void *p, void *userdata) {
 void pa_dbusiface_device_free(pa_dbusiface_device *d) {
     pa_assert(d);
 
+    pa_dbusiface_iostats_free(d->iostats);
     pa_assert_se(pa_dbus_protocol_remove_interface(d->dbus_protocol, d->path, device_interface_info.name) >= 0);
 
     if (d->type == PA_DEVICE_TYPE_SINK) {
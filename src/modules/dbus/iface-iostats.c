@@ -0,0 +1,252 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus/dbus.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/dbus-util.h>
+#include <pulsecore/protocol-dbus.h>
+
+#include "iface-iostats.h"
+
+static void handle_get_render_time(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void handle_get_render_time_max(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void handle_get_latency(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void handle_get_latency_max(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void handle_get_xruns(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void handle_get_rewinds(DBusConnection *conn, DBusMessage *msg, void *userdata);
+static void handle_get_rewind_bytes(DBusConnection *conn, DBusMessage *msg, void *userdata);
+
+static void handle_get_all(DBusConnection *conn, DBusMessage *msg, void *userdata);
+
+struct pa_dbusiface_iostats {
+    char *path;
+    pa_io_stats *stats;
+    pa_dbus_protocol *dbus_protocol;
+};
+
+enum property_handler_index {
+    PROPERTY_HANDLER_RENDER_TIME,
+    PROPERTY_HANDLER_RENDER_TIME_MAX,
+    PROPERTY_HANDLER_LATENCY,
+    PROPERTY_HANDLER_LATENCY_MAX,
+    PROPERTY_HANDLER_XRUNS,
+    PROPERTY_HANDLER_REWINDS,
+    PROPERTY_HANDLER_REWIND_BYTES,
+    PROPERTY_HANDLER_MAX
+};
+
+static pa_dbus_property_handler property_handlers[PROPERTY_HANDLER_MAX] = {
+    [PROPERTY_HANDLER_RENDER_TIME]     = { .property_name = "RenderTime",    .type = "au", .get_cb = handle_get_render_time,     .set_cb = NULL },
+    [PROPERTY_HANDLER_RENDER_TIME_MAX] = { .property_name = "RenderTimeMax", .type = "t",  .get_cb = handle_get_render_time_max, .set_cb = NULL },
+    [PROPERTY_HANDLER_LATENCY]         = { .property_name = "Latency",       .type = "au", .get_cb = handle_get_latency,         .set_cb = NULL },
+    [PROPERTY_HANDLER_LATENCY_MAX]     = { .property_name = "LatencyMax",    .type = "t",  .get_cb = handle_get_latency_max,     .set_cb = NULL },
+    [PROPERTY_HANDLER_XRUNS]           = { .property_name = "Xruns",         .type = "u",  .get_cb = handle_get_xruns,           .set_cb = NULL },
+    [PROPERTY_HANDLER_REWINDS]         = { .property_name = "Rewinds",       .type = "u",  .get_cb = handle_get_rewinds,         .set_cb = NULL },
+    [PROPERTY_HANDLER_REWIND_BYTES]    = { .property_name = "RewindBytes",   .type = "t",  .get_cb = handle_get_rewind_bytes,    .set_cb = NULL }
+};
+
+static pa_dbus_interface_info iostats_interface_info = {
+    .name = PA_DBUSIFACE_IOSTATS_INTERFACE,
+    .method_handlers = NULL,
+    .n_method_handlers = 0,
+    .property_handlers = property_handlers,
+    .n_property_handlers = PROPERTY_HANDLER_MAX,
+    .get_all_properties_cb = handle_get_all,
+    .signals = NULL,
+    .n_signals = 0
+};
+
+/* Copies the buckets out of the histogram, which the IO thread may be
+ * updating meanwhile. */
+static void get_buckets(pa_histogram *h, dbus_uint32_t buckets[PA_HISTOGRAM_BUCKETS]) {
+    unsigned i;
+
+    for (i = 0; i < PA_HISTOGRAM_BUCKETS; i++)
+        buckets[i] = (dbus_uint32_t) pa_atomic_load(&h->buckets[i]);
+}
+
+static void handle_get_render_time(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint32_t buckets[PA_HISTOGRAM_BUCKETS];
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    get_buckets(&i->stats->render_time, buckets);
+
+    pa_dbus_send_basic_array_variant_reply(conn, msg, DBUS_TYPE_UINT32, buckets, PA_HISTOGRAM_BUCKETS);
+}
+
+static void handle_get_render_time_max(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint64_t render_time_max;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    render_time_max = (dbus_uint64_t) pa_atomic_load(&i->stats->render_time.max_usec);
+
+    pa_dbus_send_basic_variant_reply(conn, msg, DBUS_TYPE_UINT64, &render_time_max);
+}
+
+static void handle_get_latency(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint32_t buckets[PA_HISTOGRAM_BUCKETS];
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    get_buckets(&i->stats->latency, buckets);
+
+    pa_dbus_send_basic_array_variant_reply(conn, msg, DBUS_TYPE_UINT32, buckets, PA_HISTOGRAM_BUCKETS);
+}
+
+static void handle_get_latency_max(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint64_t latency_max;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    latency_max = (dbus_uint64_t) pa_atomic_load(&i->stats->latency.max_usec);
+
+    pa_dbus_send_basic_variant_reply(conn, msg, DBUS_TYPE_UINT64, &latency_max);
+}
+
+static void handle_get_xruns(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint32_t xruns;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    xruns = (dbus_uint32_t) pa_atomic_load(&i->stats->n_xruns);
+
+    pa_dbus_send_basic_variant_reply(conn, msg, DBUS_TYPE_UINT32, &xruns);
+}
+
+static void handle_get_rewinds(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint32_t rewinds;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    rewinds = (dbus_uint32_t) pa_atomic_load(&i->stats->n_rewinds);
+
+    pa_dbus_send_basic_variant_reply(conn, msg, DBUS_TYPE_UINT32, &rewinds);
+}
+
+static void handle_get_rewind_bytes(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint64_t rewind_bytes;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    rewind_bytes = (dbus_uint64_t) i->stats->rewind_bytes;
+
+    pa_dbus_send_basic_variant_reply(conn, msg, DBUS_TYPE_UINT64, &rewind_bytes);
+}
+
+static void handle_get_all(DBusConnection *conn, DBusMessage *msg, void *userdata) {
+    pa_dbusiface_iostats *i = userdata;
+    dbus_uint32_t render_time[PA_HISTOGRAM_BUCKETS];
+    dbus_uint64_t render_time_max;
+    dbus_uint32_t latency[PA_HISTOGRAM_BUCKETS];
+    dbus_uint64_t latency_max;
+    dbus_uint32_t xruns;
+    dbus_uint32_t rewinds;
+    dbus_uint64_t rewind_bytes;
+    DBusMessage *reply = NULL;
+    DBusMessageIter msg_iter;
+    DBusMessageIter dict_iter;
+
+    pa_assert(conn);
+    pa_assert(msg);
+    pa_assert(i);
+
+    get_buckets(&i->stats->render_time, render_time);
+    render_time_max = (dbus_uint64_t) pa_atomic_load(&i->stats->render_time.max_usec);
+    get_buckets(&i->stats->latency, latency);
+    latency_max = (dbus_uint64_t) pa_atomic_load(&i->stats->latency.max_usec);
+    xruns = (dbus_uint32_t) pa_atomic_load(&i->stats->n_xruns);
+    rewinds = (dbus_uint32_t) pa_atomic_load(&i->stats->n_rewinds);
+    rewind_bytes = (dbus_uint64_t) i->stats->rewind_bytes;
+
+    pa_assert_se((reply = dbus_message_new_method_return(msg)));
+
+    dbus_message_iter_init_append(reply, &msg_iter);
+    pa_assert_se(dbus_message_iter_open_container(&msg_iter, DBUS_TYPE_ARRAY, "{sv}", &dict_iter));
+
+    pa_dbus_append_basic_array_variant_dict_entry(&dict_iter, property_handlers[PROPERTY_HANDLER_RENDER_TIME].property_name, DBUS_TYPE_UINT32, render_time, PA_HISTOGRAM_BUCKETS);
+    pa_dbus_append_basic_variant_dict_entry(&dict_iter, property_handlers[PROPERTY_HANDLER_RENDER_TIME_MAX].property_name, DBUS_TYPE_UINT64, &render_time_max);
+    pa_dbus_append_basic_array_variant_dict_entry(&dict_iter, property_handlers[PROPERTY_HANDLER_LATENCY].property_name, DBUS_TYPE_UINT32, latency, PA_HISTOGRAM_BUCKETS);
+    pa_dbus_append_basic_variant_dict_entry(&dict_iter, property_handlers[PROPERTY_HANDLER_LATENCY_MAX].property_name, DBUS_TYPE_UINT64, &latency_max);
+    pa_dbus_append_basic_variant_dict_entry(&dict_iter, property_handlers[PROPERTY_HANDLER_XRUNS].property_name, DBUS_TYPE_UINT32, &xruns);
+    pa_dbus_append_basic_variant_dict_entry(&dict_iter, property_handlers[PROPERTY_HANDLER_REWINDS].property_name, DBUS_TYPE_UINT32, &rewinds);
+    pa_dbus_append_basic_variant_dict_entry(&dict_iter, property_handlers[PROPERTY_HANDLER_REWIND_BYTES].property_name, DBUS_TYPE_UINT64, &rewind_bytes);
+
+    pa_assert_se(dbus_message_iter_close_container(&msg_iter, &dict_iter));
+
+    pa_assert_se(dbus_connection_send(conn, reply, NULL));
+
+    dbus_message_unref(reply);
+}
+
+pa_dbusiface_iostats *pa_dbusiface_iostats_new(pa_core *core, const char *path, pa_io_stats *stats) {
+    pa_dbusiface_iostats *i;
+
+    pa_assert(core);
+    pa_assert(path);
+    pa_assert(stats);
+
+    i = pa_xnew(pa_dbusiface_iostats, 1);
+    i->path = pa_xstrdup(path);
+    i->stats = stats;
+    i->dbus_protocol = pa_dbus_protocol_get(core);
+
+    pa_assert_se(pa_dbus_protocol_add_interface(i->dbus_protocol, i->path, &iostats_interface_info, i) >= 0);
+
+    return i;
+}
+
+void pa_dbusiface_iostats_free(pa_dbusiface_iostats *i) {
+    pa_assert(i);
+
+    pa_assert_se(pa_dbus_protocol_remove_interface(i->dbus_protocol, i->path, iostats_interface_info.name) >= 0);
+
+    pa_xfree(i->path);
+
+    pa_dbus_protocol_unref(i->dbus_protocol);
+
+    pa_xfree(i);
+}
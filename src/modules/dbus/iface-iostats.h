@@ -0,0 +1,43 @@
+#ifndef foodbusifaceiostatshfoo
+#define foodbusifaceiostatshfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* This object implements the D-Bus interface org.PulseAudio.Core1.IOStats.
+ * It lives on the object path of a device or stream and exposes the
+ * statistics that the device or stream collects in its IO thread. The
+ * owner of the path must keep the device or stream referenced for as
+ * long as this object exists.
+ */
+
+#include <pulsecore/core.h>
+#include <pulsecore/iostats.h>
+#include <pulsecore/protocol-dbus.h>
+
+#include "iface-core.h"
+
+#define PA_DBUSIFACE_IOSTATS_INTERFACE PA_DBUS_CORE_INTERFACE ".IOStats"
+
+typedef struct pa_dbusiface_iostats pa_dbusiface_iostats;
+
+pa_dbusiface_iostats *pa_dbusiface_iostats_new(pa_core *core, const char *path, pa_io_stats *stats);
+void pa_dbusiface_iostats_free(pa_dbusiface_iostats *i);
+
+#endif
@@ -28,6 +28,7 @@
 #include <pulsecore/dbus-util.h>
 #include <pulsecore/protocol-dbus.h>
 
+#include "iface-iostats.h"
 #include "iface-stream.h"
 
 #define PLAYBACK_OBJECT_NAME "playback_stream"
@@ -57,6 +58,7 @@ struct pa_dbusiface_stream {
     pa_proplist *proplist;
 
     pa_bool_t has_volume;
+    pa_dbusiface_iostats *iostats;
 
     pa_dbus_protocol *dbus_protocol;
     pa_subscription *subscription;
@@ -871,6 +873,7 @@ pa_dbusiface_stream *pa_dbusiface_stream_new_playback(pa_dbusiface_core *core, p
                                          s);
 
     pa_assert_se(pa_dbus_protocol_add_interface(s->dbus_protocol, s->path, &stream_interface_info, s) >= 0);
+    s->iostats = pa_dbusiface_iostats_new(sink_input->core, s->path, &sink_input->io_stats);
 
     return s;
 }
@@ -900,6 +903,7 @@ pa_dbusiface_stream *pa_dbusiface_stream_new_record(pa_dbusiface_core *core, pa_
                                          s);
 
     pa_assert_se(pa_dbus_protocol_add_interface(s->dbus_protocol, s->path, &stream_interface_info, s) >= 0);
+    s->iostats = pa_dbusiface_iostats_new(source_output->core, s->path, &source_output->io_stats);
 
     return s;
 }
@@ -907,6 +911,7 @@ pa_dbusiface_stream *pa_dbusiface_stream_new_record(pa_dbusiface_core *core, pa_
 void pa_dbusiface_stream_free(pa_dbusiface_stream *s) {
     pa_assert(s);
 
+    pa_dbusiface_iostats_free(s->iostats);
     pa_assert_se(pa_dbus_protocol_remove_interface(s->dbus_protocol, s->path, stream_interface_info.name) >= 0);
 
     if (s->type == STREAM_TYPE_PLAYBACK) {
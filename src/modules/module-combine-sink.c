@@ -519,8 +519,10 @@ static void sink_input_attach_cb(pa_sink_input *i) {
     c = pa_sink_get_requested_latency_within_thread(i->sink);
     pa_atomic_store(&o->requested_latency, (int) (c == (pa_usec_t) -1 ? 0 : c));
 
+    pa_asyncmsgq_post_batch_begin(o->outq);
     pa_asyncmsgq_post(o->outq, PA_MSGOBJECT(o->userdata->sink), SINK_MESSAGE_UPDATE_MAX_REQUEST, NULL, 0, NULL, NULL);
     pa_asyncmsgq_post(o->outq, PA_MSGOBJECT(o->userdata->sink), SINK_MESSAGE_UPDATE_REQUESTED_LATENCY, NULL, 0, NULL, NULL);
+    pa_asyncmsgq_post_batch_end(o->outq);
 }
 
 /* Called from I/O thread context */
@@ -1582,12 +1582,12 @@ static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t
         goto fail;
     }
 
-    /* Starting with protocol version 13 the MSB of the version tag
-    reflects if shm is enabled for this connection or not. We don't
+    /* Starting with protocol version 13 the upper bits of the version
+    tag reflect if shm is enabled for this connection or not. We don't
     support SHM here at all, so we just ignore this. */
 
     if (u->version >= 13)
-        u->version &= 0x7FFFFFFFU;
+        u->version &= PA_PROTOCOL_VERSION_MASK;
 
     pa_log_debug("Protocol version: remote %u, local %u", u->version, PA_PROTOCOL_VERSION);
 
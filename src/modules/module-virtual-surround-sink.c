@@ -40,6 +40,7 @@
 #include <pulsecore/ltdl-helper.h>
 #include <pulsecore/sound-file.h>
 #include <pulsecore/resampler.h>
+#include <pulsecore/convolver.h>
 
 #include <math.h>
 
@@ -87,8 +88,7 @@ struct userdata {
     unsigned hrir_samples;
     float *hrir_data;
 
-    float *input_buffer;
-    int input_buffer_offset;
+    pa_convolver *convolver;
 };
 
 static const char* const valid_modargs[] = {
@@ -220,9 +220,7 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
     unsigned n;
     pa_memchunk tchunk;
 
-    unsigned j, k, l;
-    float sum_right, sum_left;
-    float current_sample;
+    unsigned l;
 
     pa_sink_input_assert_ref(i);
     pa_assert(chunk);
@@ -255,29 +253,11 @@ static int sink_input_pop_cb(pa_sink_input *i, size_t nbytes, pa_memchunk *chunk
     src = (float*) ((uint8_t*) pa_memblock_acquire(tchunk.memblock) + tchunk.index);
     dst = (float*) pa_memblock_acquire(chunk->memblock);
 
-    for (l = 0; l < n; l++) {
-        memcpy(((char*) u->input_buffer) + u->input_buffer_offset * u->sink_fs, ((char *) src) + l * u->sink_fs, u->sink_fs);
+    /* fold the input with the impulse response */
+    pa_convolver_run(u->convolver, src, dst, n);
 
-        sum_right = 0;
-        sum_left = 0;
-
-        /* fold the input buffer with the impulse response */
-        for (j = 0; j < u->hrir_samples; j++) {
-            for (k = 0; k < u->channels; k++) {
-                current_sample = u->input_buffer[((u->input_buffer_offset + j) % u->hrir_samples) * u->channels + k];
-
-                sum_left += current_sample * u->hrir_data[j * u->hrir_channels + u->mapping_left[k]];
-                sum_right += current_sample * u->hrir_data[j * u->hrir_channels + u->mapping_right[k]];
-            }
-        }
-
-        dst[2 * l] = PA_CLAMP_UNLIKELY(sum_left, -1.0f, 1.0f);
-        dst[2 * l + 1] = PA_CLAMP_UNLIKELY(sum_right, -1.0f, 1.0f);
-
-        u->input_buffer_offset--;
-        if (u->input_buffer_offset < 0)
-            u->input_buffer_offset += u->hrir_samples;
-    }
+    for (l = 0; l < 2 * n; l++)
+        dst[l] = PA_CLAMP_UNLIKELY(dst[l], -1.0f, 1.0f);
 
     pa_memblock_release(tchunk.memblock);
     pa_memblock_release(chunk->memblock);
@@ -306,8 +286,7 @@ static void sink_input_process_rewind_cb(pa_sink_input *i, size_t nbytes) {
             pa_memblockq_seek(u->memblockq, - (int64_t) amount, PA_SEEK_RELATIVE, TRUE);
 
             /* Reset the input buffer */
-            memset(u->input_buffer, 0, u->hrir_samples * u->sink_fs);
-            u->input_buffer_offset = 0;
+            pa_convolver_reset(u->convolver);
         }
     }
 
@@ -779,8 +758,12 @@ int pa__init(pa_module*m) {
         }
     }
 
-    u->input_buffer = pa_xmalloc0(u->hrir_samples * u->sink_fs);
-    u->input_buffer_offset = 0;
+    u->convolver = pa_convolver_new(u->channels, 2, u->hrir_samples, 0);
+
+    for (i = 0; i < u->channels; i++) {
+        pa_convolver_set_filter(u->convolver, i, 0, u->hrir_data + u->mapping_left[i], u->hrir_samples, u->hrir_channels);
+        pa_convolver_set_filter(u->convolver, i, 1, u->hrir_data + u->mapping_right[i], u->hrir_samples, u->hrir_channels);
+    }
 
     pa_sink_put(u->sink);
     pa_sink_input_put(u->sink_input);
@@ -838,8 +821,8 @@ void pa__done(pa_module*m) {
     if (u->hrir_data)
         pa_xfree(u->hrir_data);
 
-    if (u->input_buffer)
-        pa_xfree(u->input_buffer);
+    if (u->convolver)
+        pa_convolver_free(u->convolver);
 
     if (u->mapping_left)
         pa_xfree(u->mapping_left);
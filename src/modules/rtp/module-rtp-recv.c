@@ -560,7 +560,9 @@ static struct session *session_new(struct userdata *u, const pa_sdp_info *sdp_in
     if (s->intended_latency < s->sink_latency*2)
         s->intended_latency = s->sink_latency*2;
 
-    s->memblockq = pa_memblockq_new(
+    /* Packets are written at the index their timestamp says, which
+     * means lots of seeking in a queue of many small blocks */
+    s->memblockq = pa_memblockq_new_ring(
             "module-rtp-recv memblockq",
             0,
             MEMBLOCKQ_MAXLENGTH,
@@ -55,6 +55,8 @@
 #include <pulsecore/core-error.h>
 #include <pulsecore/i18n.h>
 #include <pulsecore/native-common.h>
+#include <pulsecore/shm.h>
+#include <pulsecore/srbchannel.h>
 #include <pulsecore/pdispatch.h>
 #include <pulsecore/pstream.h>
 #include <pulsecore/hashmap.h>
@@ -72,6 +74,7 @@
 #include "context.h"
 
 void pa_command_extension(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
+static void command_enable_srbchannel(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 
 static const pa_pdispatch_cb_t command_table[PA_COMMAND_MAX] = {
     [PA_COMMAND_REQUEST] = pa_command_request,
@@ -90,7 +93,8 @@ static const pa_pdispatch_cb_t command_table[PA_COMMAND_MAX] = {
     [PA_COMMAND_RECORD_STREAM_EVENT] = pa_command_stream_event,
     [PA_COMMAND_CLIENT_EVENT] = pa_command_client_event,
     [PA_COMMAND_PLAYBACK_BUFFER_ATTR_CHANGED] = pa_command_stream_buffer_attr,
-    [PA_COMMAND_RECORD_BUFFER_ATTR_CHANGED] = pa_command_stream_buffer_attr
+    [PA_COMMAND_RECORD_BUFFER_ATTR_CHANGED] = pa_command_stream_buffer_attr,
+    [PA_COMMAND_ENABLE_SRBCHANNEL] = command_enable_srbchannel
 };
 static void context_free(pa_context *c);
 
@@ -172,7 +176,10 @@ pa_context *pa_context_new_with_proplist(pa_mainloop_api *mainloop, const char *
 #endif
     pa_client_conf_env(c->conf);
 
-    if (!(c->mempool = pa_mempool_new(!c->conf->disable_shm, c->conf->shm_size))) {
+    if (!c->conf->disable_shm && c->conf->enable_memfd)
+        c->mempool = pa_mempool_new_memfd(c->conf->shm_size, FALSE);
+
+    if (!c->mempool && !(c->mempool = pa_mempool_new(!c->conf->disable_shm, c->conf->shm_size))) {
 
         if (!c->conf->disable_shm)
             c->mempool = pa_mempool_new(FALSE, c->conf->shm_size);
@@ -425,7 +432,7 @@ static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t
     switch(c->state) {
         case PA_CONTEXT_AUTHORIZING: {
             pa_tagstruct *reply;
-            pa_bool_t shm_on_remote = FALSE;
+            pa_bool_t shm_on_remote = FALSE, memfd_on_remote = FALSE;
 
             if (pa_tagstruct_getu32(t, &c->version) < 0 ||
                 !pa_tagstruct_eof(t)) {
@@ -443,8 +450,12 @@ static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t
                tag reflects if shm is available for this connection or
                not. */
             if (c->version >= 13) {
-                shm_on_remote = !!(c->version & 0x80000000U);
-                c->version &= 0x7FFFFFFFU;
+                shm_on_remote = !!(c->version & PA_PROTOCOL_FLAG_SHM);
+                memfd_on_remote = !!(c->version & PA_PROTOCOL_FLAG_MEMFD);
+                c->version &= PA_PROTOCOL_VERSION_MASK;
+
+                if (c->version < 28)
+                    memfd_on_remote = FALSE;
             }
 
             pa_log_debug("Protocol version: remote %u, local %u", c->version, PA_PROTOCOL_VERSION);
@@ -470,6 +481,16 @@ static void setup_complete_callback(pa_pdispatch *pd, uint32_t command, uint32_t
             pa_log_debug("Negotiated SHM: %s", pa_yes_no(c->do_shm));
             pa_pstream_enable_shm(c->pstream, c->do_shm);
 
+            /* Our pool can only be shared if the server takes its memfd */
+            if (c->do_shm && memfd_on_remote)
+                pa_pstream_enable_memfd(c->pstream);
+
+            pa_log_debug("Memfd possible: %s", pa_yes_no(c->do_shm && memfd_on_remote));
+
+            /* Since version 30 releases and revokes of blocks are batched */
+            if (c->do_shm && c->version >= 30)
+                pa_pstream_enable_block_id_arrays(c->pstream);
+
             reply = pa_tagstruct_command(c, PA_COMMAND_SET_CLIENT_NAME, &tag);
 
             if (c->version >= 13) {
@@ -536,8 +557,18 @@ static void setup_context(pa_context *c, pa_iochannel *io) {
     pa_log_debug("SHM possible: %s", pa_yes_no(c->do_shm));
 
     /* Starting with protocol version 13 we use the MSB of the version
-     * tag for informing the other side if we could do SHM or not */
-    pa_tagstruct_putu32(t, PA_PROTOCOL_VERSION | (c->do_shm ? 0x80000000U : 0));
+     * tag for informing the other side if we could do SHM or not,
+     * since version 28 the next bit if we can receive memfds and since
+     * version 29 the one after if we take a srbchannel */
+    pa_tagstruct_putu32(t, PA_PROTOCOL_VERSION |
+                        (c->do_shm ? PA_PROTOCOL_FLAG_SHM : 0) |
+#ifdef HAVE_MEMFD
+                        (c->do_shm ? PA_PROTOCOL_FLAG_MEMFD : 0) |
+#endif
+#ifdef HAVE_SRBCHANNEL
+                        (c->do_shm && !c->conf->disable_srbchannel ? PA_PROTOCOL_FLAG_SRBCHANNEL : 0) |
+#endif
+                        0);
     pa_tagstruct_put_arbitrary(t, c->conf->cookie, sizeof(c->conf->cookie));
 
 #ifdef HAVE_CREDS
@@ -1406,6 +1437,45 @@ finish:
         pa_proplist_free(pl);
 }
 
+/* The server hands us a shared ringbuffer, which the pstream switches
+ * to when the server does */
+static void command_enable_srbchannel(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    pa_context *c = userdata;
+#ifdef HAVE_SRBCHANNEL
+    int fds[PA_SRBCHANNEL_FDS_MAX];
+    pa_srbchannel *srb;
+    unsigned i, n;
+#endif
+
+    pa_assert(pd);
+    pa_assert(command == PA_COMMAND_ENABLE_SRBCHANNEL);
+    pa_assert(t);
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+
+#ifdef HAVE_SRBCHANNEL
+    n = pa_pstream_take_fds(c->pstream, fds, PA_SRBCHANNEL_FDS_MAX);
+
+    if (c->version < 29 || c->conf->disable_srbchannel || !pa_tagstruct_eof(t) || n != PA_SRBCHANNEL_FDS_MAX) {
+        for (i = 0; i < n; i++)
+            pa_close(fds[i]);
+
+        pa_context_fail(c, PA_ERR_PROTOCOL);
+        return;
+    }
+
+    if (!(srb = pa_srbchannel_new_from_fds(c->mainloop, fds))) {
+        pa_context_fail(c, PA_ERR_PROTOCOL);
+        return;
+    }
+
+    pa_log_debug("Switching to srbchannel.");
+    pa_pstream_set_srbchannel(c->pstream, srb);
+#else
+    pa_context_fail(c, PA_ERR_PROTOCOL);
+#endif
+}
+
 pa_time_event* pa_context_rttime_new(pa_context *c, pa_usec_t usec, pa_time_event_cb_t cb, void *userdata) {
     struct timeval tv;
 
@@ -79,6 +79,106 @@ pa_operation* pa_context_stat(pa_context *c, pa_stat_info_cb_t cb, void *userdat
     return pa_context_send_simple_command(c, PA_COMMAND_STAT, context_stat_callback, (pa_operation_cb_t) cb, userdata);
 }
 
+static int get_io_stats_histogram(pa_tagstruct *t, pa_io_stats_histogram *h) {
+    unsigned i;
+
+    for (i = 0; i < PA_IO_STATS_HISTOGRAM_BUCKETS; i++)
+        if (pa_tagstruct_getu32(t, &h->buckets[i]) < 0)
+            return -1;
+
+    return pa_tagstruct_get_usec(t, &h->max);
+}
+
+static void context_get_io_stats_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    pa_operation *o = userdata;
+    int eol = 1;
+
+    pa_assert(pd);
+    pa_assert(o);
+    pa_assert(PA_REFCNT_VALUE(o) >= 1);
+
+    if (!o->context)
+        goto finish;
+
+    if (command != PA_COMMAND_REPLY) {
+        if (pa_context_handle_error(o->context, command, t, FALSE) < 0)
+            goto finish;
+
+        eol = -1;
+    } else {
+
+        while (!pa_tagstruct_eof(t)) {
+            pa_io_stats_info i;
+
+            pa_zero(i);
+
+            if (pa_tagstruct_getu32(t, &i.index) < 0 ||
+                get_io_stats_histogram(t, &i.render_time) < 0 ||
+                get_io_stats_histogram(t, &i.latency) < 0 ||
+                pa_tagstruct_getu32(t, &i.n_xruns) < 0 ||
+                pa_tagstruct_getu32(t, &i.n_rewinds) < 0 ||
+                pa_tagstruct_getu64(t, &i.rewind_bytes) < 0) {
+
+                pa_context_fail(o->context, PA_ERR_PROTOCOL);
+                goto finish;
+            }
+
+            if (o->callback) {
+                pa_io_stats_info_cb_t cb = (pa_io_stats_info_cb_t) o->callback;
+                cb(o->context, &i, 0, o->userdata);
+            }
+        }
+    }
+
+    if (o->callback) {
+        pa_io_stats_info_cb_t cb = (pa_io_stats_info_cb_t) o->callback;
+        cb(o->context, NULL, eol, o->userdata);
+    }
+
+finish:
+    pa_operation_done(o);
+    pa_operation_unref(o);
+}
+
+static pa_operation* get_io_stats(pa_context *c, uint32_t command, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata) {
+    pa_tagstruct *t;
+    pa_operation *o;
+    uint32_t tag;
+
+    pa_assert(c);
+    pa_assert(PA_REFCNT_VALUE(c) >= 1);
+    pa_assert(cb);
+
+    PA_CHECK_VALIDITY_RETURN_NULL(c, !pa_detect_fork(), PA_ERR_FORKED);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->state == PA_CONTEXT_READY, PA_ERR_BADSTATE);
+    PA_CHECK_VALIDITY_RETURN_NULL(c, c->version >= 31, PA_ERR_NOTSUPPORTED);
+
+    o = pa_operation_new(c, NULL, (pa_operation_cb_t) cb, userdata);
+
+    t = pa_tagstruct_command(c, command, &tag);
+    pa_tagstruct_putu32(t, idx);
+    pa_pstream_send_tagstruct(c->pstream, t);
+    pa_pdispatch_register_reply(c->pdispatch, tag, DEFAULT_TIMEOUT, context_get_io_stats_callback, pa_operation_ref(o), (pa_free_cb_t) pa_operation_unref);
+
+    return o;
+}
+
+pa_operation* pa_context_get_sink_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata) {
+    return get_io_stats(c, PA_COMMAND_GET_SINK_IO_STATS, idx, cb, userdata);
+}
+
+pa_operation* pa_context_get_source_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata) {
+    return get_io_stats(c, PA_COMMAND_GET_SOURCE_IO_STATS, idx, cb, userdata);
+}
+
+pa_operation* pa_context_get_sink_input_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata) {
+    return get_io_stats(c, PA_COMMAND_GET_SINK_INPUT_IO_STATS, idx, cb, userdata);
+}
+
+pa_operation* pa_context_get_source_output_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata) {
+    return get_io_stats(c, PA_COMMAND_GET_SOURCE_OUTPUT_IO_STATS, idx, cb, userdata);
+}
+
 /*** Server Info ***/
 
 static void context_get_server_info_callback(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
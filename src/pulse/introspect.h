@@ -631,6 +631,45 @@ typedef void (*pa_stat_info_cb_t) (pa_context *c, const pa_stat_info *i, void *u
 /** Get daemon memory block statistics */
 pa_operation* pa_context_stat(pa_context *c, pa_stat_info_cb_t cb, void *userdata);
 
+/** Number of buckets in a pa_io_stats_histogram. \since 3.0 */
+#define PA_IO_STATS_HISTOGRAM_BUCKETS 24
+
+/** A histogram of durations. Bucket 0 counts durations below 2 usec,
+ * bucket i > 0 those from 2^i to below 2^(i+1) usec, and the last
+ * bucket everything longer. \since 3.0 */
+typedef struct pa_io_stats_histogram {
+    uint32_t buckets[PA_IO_STATS_HISTOGRAM_BUCKETS]; /**< Number of samples per bucket */
+    pa_usec_t max;                                   /**< The longest duration seen */
+} pa_io_stats_histogram;
+
+/** IO statistics of a sink, source, sink input or source output,
+ * collected since it was created. Please note that this structure
+ * can be extended as part of evolutionary API updates at any time in
+ * any new release. \since 3.0 */
+typedef struct pa_io_stats_info {
+    uint32_t index;                      /**< Index of the sink, source, sink input or source output */
+    pa_io_stats_histogram render_time;   /**< How long rendering resp. posting one chunk of audio took */
+    pa_io_stats_histogram latency;       /**< The latency, sampled whenever it was queried */
+    uint32_t n_xruns;                    /**< Number of underruns (playback) resp. overruns (capture) */
+    uint32_t n_rewinds;                  /**< Number of rewinds */
+    uint64_t rewind_bytes;               /**< Total number of bytes rewound */
+} pa_io_stats_info;
+
+/** Callback prototype for pa_context_get_sink_io_stats() and friends \since 3.0 */
+typedef void (*pa_io_stats_info_cb_t) (pa_context *c, const pa_io_stats_info *i, int eol, void *userdata);
+
+/** Get IO statistics of the sink with the given index, or of all sinks if idx is PA_INVALID_INDEX. \since 3.0 */
+pa_operation* pa_context_get_sink_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata);
+
+/** Get IO statistics of the source with the given index, or of all sources if idx is PA_INVALID_INDEX. \since 3.0 */
+pa_operation* pa_context_get_source_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata);
+
+/** Get IO statistics of the sink input with the given index, or of all sink inputs if idx is PA_INVALID_INDEX. \since 3.0 */
+pa_operation* pa_context_get_sink_input_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata);
+
+/** Get IO statistics of the source output with the given index, or of all source outputs if idx is PA_INVALID_INDEX. \since 3.0 */
+pa_operation* pa_context_get_source_output_io_stats(pa_context *c, uint32_t idx, pa_io_stats_info_cb_t cb, void *userdata);
+
 /** @} */
 
 /** @{ \name Cached Samples */
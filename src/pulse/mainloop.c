@@ -34,6 +34,10 @@
 #include <pulsecore/pipe.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #include <pulse/rtclock.h>
 #include <pulse/timeval.h>
 #include <pulse/xmalloc.h>
@@ -41,6 +45,7 @@
 #include <pulsecore/poll.h>
 #include <pulsecore/core-rtclock.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/hashmap.h>
 #include <pulsecore/i18n.h>
 #include <pulsecore/llist.h>
 #include <pulsecore/log.h>
@@ -59,6 +64,12 @@ struct pa_io_event {
     pa_io_event_flags_t events;
     struct pollfd *pollfd;
 
+#ifdef HAVE_SYS_EPOLL_H
+    /* The fd registered with epoll: fd itself, or a duplicate of it if
+     * another io event already registered fd. -1 if not registered. */
+    int epoll_fd;
+#endif
+
     pa_io_event_cb_t callback;
     void *userdata;
     pa_io_event_destroy_cb_t destroy_callback;
@@ -72,8 +83,15 @@ struct pa_time_event {
 
     pa_bool_t enabled:1;
     pa_bool_t use_rtclock:1;
+    pa_bool_t dispatch_pending:1;
     pa_usec_t time;
 
+    /* Position in mainloop->time_heap while enabled */
+    unsigned heap_index;
+
+    /* Next due event while dispatching */
+    pa_time_event *dispatch_next;
+
     pa_time_event_cb_t callback;
     void *userdata;
     pa_time_event_destroy_cb_t destroy_callback;
@@ -106,8 +124,25 @@ struct pa_mainloop {
     struct pollfd *pollfds;
     unsigned max_pollfds, n_pollfds;
 
+#ifdef HAVE_SYS_EPOLL_H
+    /* As long as epoll_fd is valid io events are registered with it as
+     * they come and go, and only the ready ones are looked at after
+     * polling. pollfds then only contains the epoll fd, for a custom
+     * poll function. If an fd can't be added to epoll we fall back to
+     * polling everything for good. */
+    int epoll_fd;
+    pa_hashmap *epoll_io_events;
+    struct epoll_event *epoll_events;
+    unsigned max_epoll_events;
+    pa_bool_t polled_epoll:1;
+#endif
+
     pa_usec_t prepared_timeout;
-    pa_time_event *cached_next_time_event;
+
+    /* The enabled time events, a binary min-heap ordered by time with
+     * n_enabled_time_events entries */
+    pa_time_event **time_heap;
+    unsigned max_time_heap;
 
     pa_mainloop_api api;
 
@@ -147,6 +182,118 @@ static pa_io_event_flags_t map_flags_from_libc(short flags) {
         (flags & POLLHUP ? PA_IO_EVENT_HANGUP : 0);
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static uint32_t map_flags_to_epoll(pa_io_event_flags_t flags) {
+    return
+        (flags & PA_IO_EVENT_INPUT ? EPOLLIN : 0) |
+        (flags & PA_IO_EVENT_OUTPUT ? EPOLLOUT : 0) |
+        (flags & PA_IO_EVENT_ERROR ? EPOLLERR : 0) |
+        (flags & PA_IO_EVENT_HANGUP ? EPOLLHUP : 0);
+}
+
+static pa_io_event_flags_t map_flags_from_epoll(uint32_t flags) {
+    return
+        (flags & EPOLLIN ? PA_IO_EVENT_INPUT : 0) |
+        (flags & EPOLLOUT ? PA_IO_EVENT_OUTPUT : 0) |
+        (flags & EPOLLERR ? PA_IO_EVENT_ERROR : 0) |
+        (flags & EPOLLHUP ? PA_IO_EVENT_HANGUP : 0);
+}
+
+static void epoll_unregister(pa_mainloop *m, pa_io_event *e) {
+    pa_assert(m);
+    pa_assert(e);
+
+    if (e->epoll_fd < 0)
+        return;
+
+    pa_assert_se(pa_hashmap_remove(m->epoll_io_events, PA_INT_TO_PTR(e->epoll_fd)) == e);
+
+    if (m->epoll_fd >= 0)
+        epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, e->epoll_fd, NULL);
+
+    if (e->epoll_fd != e->fd)
+        pa_close(e->epoll_fd);
+
+    e->epoll_fd = -1;
+}
+
+/* Goes back to polling all io events */
+static void epoll_disable(pa_mainloop *m) {
+    pa_io_event *e;
+
+    pa_assert(m);
+    pa_assert(m->epoll_fd >= 0);
+
+    pa_close(m->epoll_fd);
+    m->epoll_fd = -1;
+
+    PA_LLIST_FOREACH(e, m->io_events)
+        epoll_unregister(m, e);
+
+    m->rebuild_pollfds = TRUE;
+}
+
+static void epoll_register(pa_mainloop *m, pa_io_event *e) {
+    struct epoll_event ev;
+    int fd;
+
+    pa_assert(m);
+    pa_assert(e);
+    pa_assert(e->epoll_fd < 0);
+
+    if (m->epoll_fd < 0)
+        return;
+
+    pa_zero(ev);
+    ev.events = map_flags_to_epoll(e->events);
+
+    /* epoll takes each fd only once, another io event on the same fd
+     * gets a duplicate of it */
+    if (!pa_hashmap_get(m->epoll_io_events, PA_INT_TO_PTR(e->fd))) {
+        ev.data.fd = e->fd;
+
+        if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, e->fd, &ev) >= 0) {
+            e->epoll_fd = e->fd;
+            goto finish;
+        }
+
+        if (errno != EEXIST)
+            goto fail;
+    }
+
+    if ((fd = fcntl(e->fd, F_DUPFD_CLOEXEC, 3)) < 0)
+        goto fail;
+
+    ev.data.fd = fd;
+
+    if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        pa_close(fd);
+        goto fail;
+    }
+
+    e->epoll_fd = fd;
+
+finish:
+    /* Only if an fd was closed before its io event was freed */
+    if (pa_hashmap_put(m->epoll_io_events, PA_INT_TO_PTR(e->epoll_fd), e) < 0) {
+        if (e->epoll_fd != e->fd)
+            pa_close(e->epoll_fd);
+
+        e->epoll_fd = -1;
+        errno = EEXIST;
+        goto fail;
+    }
+
+    return;
+
+fail:
+    /* Regular files for example can't be used with epoll, but poll()
+     * is fine with them */
+    pa_log_debug("Cannot add fd %i to epoll, falling back to poll(): %s", e->fd, pa_cstrerror(errno));
+    epoll_disable(m);
+}
+#endif
+
 /* IO events */
 static pa_io_event* mainloop_io_new(
         pa_mainloop_api *a,
@@ -175,6 +322,10 @@ static pa_io_event* mainloop_io_new(
     e->callback = callback;
     e->userdata = userdata;
 
+#ifdef HAVE_SYS_EPOLL_H
+    e->epoll_fd = -1;
+#endif
+
 #ifdef OS_IS_WIN32
     {
         fd_set xset;
@@ -197,6 +348,11 @@ static pa_io_event* mainloop_io_new(
     m->rebuild_pollfds = TRUE;
     m->n_io_events ++;
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (!e->dead)
+        epoll_register(m, e);
+#endif
+
     pa_mainloop_wakeup(m);
 
     return e;
@@ -211,6 +367,21 @@ static void mainloop_io_enable(pa_io_event *e, pa_io_event_flags_t events) {
 
     e->events = events;
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (e->epoll_fd >= 0) {
+        struct epoll_event ev;
+
+        pa_zero(ev);
+        ev.events = map_flags_to_epoll(events);
+        ev.data.fd = e->epoll_fd;
+
+        if (epoll_ctl(e->mainloop->epoll_fd, EPOLL_CTL_MOD, e->epoll_fd, &ev) < 0) {
+            pa_log_debug("Cannot modify fd %i in epoll, falling back to poll(): %s", e->fd, pa_cstrerror(errno));
+            epoll_disable(e->mainloop);
+        }
+    }
+#endif
+
     if (e->pollfd)
         e->pollfd->events = map_flags_to_libc(events);
     else
@@ -226,6 +397,12 @@ static void mainloop_io_free(pa_io_event *e) {
     e->dead = TRUE;
     e->mainloop->io_events_please_scan ++;
 
+#ifdef HAVE_SYS_EPOLL_H
+    /* With epoll the io event has to be freed before its fd is
+     * closed, as it always should be */
+    epoll_unregister(e->mainloop, e);
+#endif
+
     e->mainloop->n_io_events --;
     e->mainloop->rebuild_pollfds = TRUE;
 
@@ -307,6 +484,82 @@ static void mainloop_defer_set_destroy(pa_defer_event *e, pa_defer_event_destroy
 }
 
 /* Time events */
+static void time_heap_set(pa_mainloop *m, unsigned i, pa_time_event *e) {
+    m->time_heap[i] = e;
+    e->heap_index = i;
+}
+
+static void time_heap_up(pa_mainloop *m, unsigned i) {
+    pa_time_event *e = m->time_heap[i];
+
+    while (i > 0) {
+        unsigned parent = (i - 1) / 2;
+
+        if (m->time_heap[parent]->time <= e->time)
+            break;
+
+        time_heap_set(m, i, m->time_heap[parent]);
+        i = parent;
+    }
+
+    time_heap_set(m, i, e);
+}
+
+static void time_heap_down(pa_mainloop *m, unsigned i) {
+    pa_time_event *e = m->time_heap[i];
+
+    for (;;) {
+        unsigned child = 2 * i + 1;
+
+        if (child >= m->n_enabled_time_events)
+            break;
+
+        if (child + 1 < m->n_enabled_time_events &&
+            m->time_heap[child + 1]->time < m->time_heap[child]->time)
+            child++;
+
+        if (e->time <= m->time_heap[child]->time)
+            break;
+
+        time_heap_set(m, i, m->time_heap[child]);
+        i = child;
+    }
+
+    time_heap_set(m, i, e);
+}
+
+/* Call after the time of an enabled event changed */
+static void time_heap_update(pa_mainloop *m, pa_time_event *e) {
+    time_heap_up(m, e->heap_index);
+    time_heap_down(m, e->heap_index);
+}
+
+static void time_heap_insert(pa_mainloop *m, pa_time_event *e) {
+    if (m->n_enabled_time_events >= m->max_time_heap) {
+        m->max_time_heap = PA_MAX(m->max_time_heap * 2, 16U);
+        m->time_heap = pa_xrealloc(m->time_heap, sizeof(pa_time_event*) * m->max_time_heap);
+    }
+
+    time_heap_set(m, m->n_enabled_time_events++, e);
+    time_heap_up(m, e->heap_index);
+}
+
+static void time_heap_remove(pa_mainloop *m, pa_time_event *e) {
+    pa_time_event *last;
+    unsigned i = e->heap_index;
+
+    pa_assert(m->n_enabled_time_events > 0);
+    pa_assert(i < m->n_enabled_time_events);
+    pa_assert(m->time_heap[i] == e);
+
+    last = m->time_heap[--m->n_enabled_time_events];
+
+    if (last != e) {
+        time_heap_set(m, i, last);
+        time_heap_update(m, last);
+    }
+}
+
 static pa_usec_t make_rt(const struct timeval *tv, pa_bool_t *use_rtclock) {
     struct timeval ttv;
 
@@ -353,14 +606,7 @@ static pa_time_event* mainloop_time_new(
         e->time = t;
         e->use_rtclock = use_rtclock;
 
-        m->n_enabled_time_events++;
-
-        if (m->cached_next_time_event) {
-            pa_assert(m->cached_next_time_event->enabled);
-
-            if (t < m->cached_next_time_event->time)
-                m->cached_next_time_event = e;
-        }
+        time_heap_insert(m, e);
     }
 
     e->callback = callback;
@@ -385,25 +631,26 @@ static void mainloop_time_restart(pa_time_event *e, const struct timeval *tv) {
     t = make_rt(tv, &use_rtclock);
 
     valid = (t != PA_USEC_INVALID);
-    if (e->enabled && !valid) {
-        pa_assert(e->mainloop->n_enabled_time_events > 0);
-        e->mainloop->n_enabled_time_events--;
-    } else if (!e->enabled && valid)
-        e->mainloop->n_enabled_time_events++;
+    e->dispatch_pending = FALSE;
 
-    if ((e->enabled = valid)) {
-        e->time = t;
-        e->use_rtclock = use_rtclock;
-        pa_mainloop_wakeup(e->mainloop);
+    if (!valid) {
+        if (e->enabled)
+            time_heap_remove(e->mainloop, e);
+
+        e->enabled = FALSE;
+        return;
     }
 
-    if (e->mainloop->cached_next_time_event && e->enabled) {
-        pa_assert(e->mainloop->cached_next_time_event->enabled);
+    e->time = t;
+    e->use_rtclock = use_rtclock;
+
+    if (e->enabled)
+        time_heap_update(e->mainloop, e);
+    else
+        time_heap_insert(e->mainloop, e);
 
-        if (t < e->mainloop->cached_next_time_event->time)
-            e->mainloop->cached_next_time_event = e;
-    } else if (e->mainloop->cached_next_time_event == e)
-        e->mainloop->cached_next_time_event = NULL;
+    e->enabled = TRUE;
+    pa_mainloop_wakeup(e->mainloop);
 }
 
 static void mainloop_time_free(pa_time_event *e) {
@@ -411,17 +658,14 @@ static void mainloop_time_free(pa_time_event *e) {
     pa_assert(!e->dead);
 
     e->dead = TRUE;
+    e->dispatch_pending = FALSE;
     e->mainloop->time_events_please_scan ++;
 
     if (e->enabled) {
-        pa_assert(e->mainloop->n_enabled_time_events > 0);
-        e->mainloop->n_enabled_time_events--;
+        time_heap_remove(e->mainloop, e);
         e->enabled = FALSE;
     }
 
-    if (e->mainloop->cached_next_time_event == e)
-        e->mainloop->cached_next_time_event = NULL;
-
     /* no wakeup needed here. Think about it! */
 }
 
@@ -484,6 +728,26 @@ pa_mainloop *pa_mainloop_new(void) {
 
     m->rebuild_pollfds = TRUE;
 
+#ifdef HAVE_SYS_EPOLL_H
+    if ((m->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) >= 0) {
+        struct epoll_event ev;
+
+        pa_zero(ev);
+        ev.events = EPOLLIN;
+        ev.data.fd = m->wakeup_pipe[0];
+
+        if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, m->wakeup_pipe[0], &ev) < 0) {
+            pa_close(m->epoll_fd);
+            m->epoll_fd = -1;
+        }
+    }
+
+    if (m->epoll_fd < 0)
+        pa_log_debug("epoll not available, using poll().");
+
+    m->epoll_io_events = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+#endif
+
     m->api = vtable;
     m->api.userdata = m;
 
@@ -510,6 +774,10 @@ static void cleanup_io_events(pa_mainloop *m, pa_bool_t force) {
                 m->io_events_please_scan--;
             }
 
+#ifdef HAVE_SYS_EPOLL_H
+            epoll_unregister(m, e);
+#endif
+
             if (e->destroy_callback)
                 e->destroy_callback(&m->api, e, e->userdata);
 
@@ -539,8 +807,7 @@ static void cleanup_time_events(pa_mainloop *m, pa_bool_t force) {
             }
 
             if (!e->dead && e->enabled) {
-                pa_assert(m->n_enabled_time_events > 0);
-                m->n_enabled_time_events--;
+                time_heap_remove(m, e);
                 e->enabled = FALSE;
             }
 
@@ -595,6 +862,15 @@ void pa_mainloop_free(pa_mainloop *m) {
     cleanup_time_events(m, TRUE);
 
     pa_xfree(m->pollfds);
+    pa_xfree(m->time_heap);
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (m->epoll_fd >= 0)
+        pa_close(m->epoll_fd);
+
+    pa_hashmap_free(m->epoll_io_events, NULL, NULL);
+    pa_xfree(m->epoll_events);
+#endif
 
     pa_close_pipe(m->wakeup_pipe);
 
@@ -619,6 +895,30 @@ static void rebuild_pollfds(pa_mainloop *m) {
     struct pollfd *p;
     unsigned l;
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (m->epoll_fd >= 0) {
+        l = m->n_io_events + 1;
+        if (m->max_epoll_events < l) {
+            l *= 2;
+            m->epoll_events = pa_xrealloc(m->epoll_events, sizeof(struct epoll_event)*l);
+            m->max_epoll_events = l;
+        }
+
+        if (!m->pollfds) {
+            m->pollfds = pa_xnew(struct pollfd, 1);
+            m->max_pollfds = 1;
+        }
+
+        m->pollfds[0].fd = m->epoll_fd;
+        m->pollfds[0].events = POLLIN;
+        m->pollfds[0].revents = 0;
+        m->n_pollfds = 1;
+
+        m->rebuild_pollfds = FALSE;
+        return;
+    }
+#endif
+
     l = m->n_io_events + 1;
     if (m->max_pollfds < l) {
         l *= 2;
@@ -683,6 +983,35 @@ static unsigned dispatch_pollfds(pa_mainloop *m) {
     return r;
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static unsigned dispatch_epoll(pa_mainloop *m) {
+    unsigned r = 0;
+    int k;
+
+    pa_assert(m->poll_func_ret > 0);
+
+    for (k = 0; k < m->poll_func_ret; k++) {
+        pa_io_event *e;
+
+        if (m->quit)
+            break;
+
+        /* Events freed by an earlier callback are gone from the
+         * hashmap already */
+        if (!(e = pa_hashmap_get(m->epoll_io_events, PA_INT_TO_PTR(m->epoll_events[k].data.fd))))
+            continue;
+
+        pa_assert(!e->dead);
+        pa_assert(e->callback);
+
+        e->callback(&m->api, e, e->fd, map_flags_from_epoll(m->epoll_events[k].events), e->userdata);
+        r++;
+    }
+
+    return r;
+}
+#endif
+
 static unsigned dispatch_defer(pa_mainloop *m) {
     pa_defer_event *e;
     unsigned r = 0;
@@ -707,28 +1036,12 @@ static unsigned dispatch_defer(pa_mainloop *m) {
 }
 
 static pa_time_event* find_next_time_event(pa_mainloop *m) {
-    pa_time_event *t, *n = NULL;
     pa_assert(m);
 
-    if (m->cached_next_time_event)
-        return m->cached_next_time_event;
-
-    PA_LLIST_FOREACH(t, m->time_events) {
-
-        if (t->dead || !t->enabled)
-            continue;
-
-        if (!n || t->time < n->time) {
-            n = t;
-
-            /* Shortcut for time == 0 */
-            if (n->time == 0)
-                break;
-        }
-    }
+    if (m->n_enabled_time_events <= 0)
+        return NULL;
 
-    m->cached_next_time_event = n;
-    return n;
+    return m->time_heap[0];
 }
 
 static pa_usec_t calc_next_timeout(pa_mainloop *m) {
@@ -752,7 +1065,7 @@ static pa_usec_t calc_next_timeout(pa_mainloop *m) {
 }
 
 static unsigned dispatch_timeout(pa_mainloop *m) {
-    pa_time_event *e;
+    pa_time_event *e, *due = NULL, **tail = &due;
     pa_usec_t now;
     unsigned r = 0;
     pa_assert(m);
@@ -762,25 +1075,43 @@ static unsigned dispatch_timeout(pa_mainloop *m) {
 
     now = pa_rtclock_now();
 
-    PA_LLIST_FOREACH(e, m->time_events) {
+    /* Take all due events off the heap first, so that an event which
+     * is restarted for the past by its callback waits for the next
+     * iteration without holding up the others */
+    while ((e = find_next_time_event(m)) && e->time <= now) {
+        pa_assert(!e->dead);
 
-        if (m->quit)
-            break;
+        /* Disable time event */
+        mainloop_time_restart(e, NULL);
 
-        if (e->dead || !e->enabled)
-            continue;
+        e->dispatch_pending = TRUE;
+        e->dispatch_next = NULL;
+        *tail = e;
+        tail = &e->dispatch_next;
+    }
 
-        if (e->time <= now) {
-            struct timeval tv;
-            pa_assert(e->callback);
+    while ((e = due)) {
+        struct timeval tv;
+
+        due = e->dispatch_next;
 
-            /* Disable time event */
-            mainloop_time_restart(e, NULL);
+        /* Freed or restarted by one of the callbacks before */
+        if (!e->dispatch_pending)
+            continue;
 
-            e->callback(&m->api, e, pa_timeval_rtstore(&tv, e->time, e->use_rtclock), e->userdata);
+        e->dispatch_pending = FALSE;
 
-            r++;
+        if (m->quit) {
+            /* Leave it for the next iteration */
+            time_heap_insert(m, e);
+            e->enabled = TRUE;
+            continue;
         }
+
+        pa_assert(e->callback);
+        e->callback(&m->api, e, pa_timeval_rtstore(&tv, e->time, e->use_rtclock), e->userdata);
+
+        r++;
     }
 
     return r;
@@ -869,6 +1200,15 @@ int pa_mainloop_poll(pa_mainloop *m) {
     else {
         pa_assert(!m->rebuild_pollfds);
 
+#ifdef HAVE_SYS_EPOLL_H
+        m->polled_epoll = m->epoll_fd >= 0;
+
+        if (m->polled_epoll && !m->poll_func)
+            m->poll_func_ret = epoll_wait(
+                    m->epoll_fd, m->epoll_events, (int) m->max_epoll_events,
+                    usec_to_timeout(m->prepared_timeout));
+        else
+#endif
         if (m->poll_func)
             m->poll_func_ret = m->poll_func(
                     m->pollfds, m->n_pollfds,
@@ -895,6 +1235,19 @@ int pa_mainloop_poll(pa_mainloop *m) {
             else
                 pa_log("poll(): %s", pa_cstrerror(errno));
         }
+
+#ifdef HAVE_SYS_EPOLL_H
+        /* The custom poll function only told us that the epoll fd is
+         * readable, now find out what is ready */
+        if (m->polled_epoll && m->poll_func && m->poll_func_ret > 0) {
+            if ((m->poll_func_ret = epoll_wait(m->epoll_fd, m->epoll_events, (int) m->max_epoll_events, 0)) < 0) {
+                if (errno == EINTR)
+                    m->poll_func_ret = 0;
+                else
+                    pa_log("epoll_wait(): %s", pa_cstrerror(errno));
+            }
+        }
+#endif
     }
 
     m->state = m->poll_func_ret < 0 ? STATE_PASSIVE : STATE_POLLED;
@@ -923,8 +1276,14 @@ int pa_mainloop_dispatch(pa_mainloop *m) {
         if (m->quit)
             goto quit;
 
-        if (m->poll_func_ret > 0)
-            dispatched += dispatch_pollfds(m);
+        if (m->poll_func_ret > 0) {
+#ifdef HAVE_SYS_EPOLL_H
+            if (m->polled_epoll)
+                dispatched += dispatch_epoll(m);
+            else
+#endif
+                dispatched += dispatch_pollfds(m);
+        }
     }
 
     if (m->quit)
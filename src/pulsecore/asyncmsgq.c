@@ -25,19 +25,25 @@
 
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
 
 #include <pulse/xmalloc.h>
 
+#include <pulse/rtclock.h>
+
 #include <pulsecore/macro.h>
 #include <pulsecore/log.h>
 #include <pulsecore/semaphore.h>
 #include <pulsecore/macro.h>
 #include <pulsecore/mutex.h>
 #include <pulsecore/flist.h>
+#include <pulsecore/thread.h>
 
 #include "asyncmsgq.h"
 
-PA_STATIC_FLIST_DECLARE(asyncmsgq, 0, pa_xfree);
+/* The default size of a pa_asyncq */
+#define ASYNCMSGQ_SLOTS_DEFAULT 256
+
 PA_STATIC_FLIST_DECLARE(semaphores, 0, (void(*)(void*)) pa_semaphore_free);
 
 struct asyncmsgq_item {
@@ -57,21 +63,65 @@ struct pa_asyncmsgq {
     pa_mutex *mutex; /* only for the writer side */
 
     struct asyncmsgq_item *current;
+
+    /* Items of posted messages, the free ones are in free_slots. Only
+     * if more are queued locally than fit in the asyncq the items are
+     * allocated on the heap. */
+    struct asyncmsgq_item *slots;
+    unsigned n_slots;
+    pa_flist *free_slots;
+
+    /* The thread that is posting a batch, holding the mutex */
+    pa_atomic_ptr_t batch_thread;
+
+    pa_asyncmsgq_stat stat;
 };
 
 pa_asyncmsgq *pa_asyncmsgq_new(unsigned size) {
     pa_asyncmsgq *a;
+    unsigned i;
 
-    a = pa_xnew(pa_asyncmsgq, 1);
+    a = pa_xnew0(pa_asyncmsgq, 1);
 
     PA_REFCNT_INIT(a);
     pa_assert_se(a->asyncq = pa_asyncq_new(size));
     pa_assert_se(a->mutex = pa_mutex_new(FALSE, TRUE));
     a->current = NULL;
 
+    a->n_slots = size > 0 ? size : ASYNCMSGQ_SLOTS_DEFAULT;
+    a->slots = pa_xnew(struct asyncmsgq_item, a->n_slots);
+    a->free_slots = pa_flist_new_with_name(a->n_slots, "asyncmsgq slots");
+
+    for (i = 0; i < a->n_slots; i++)
+        pa_assert_se(pa_flist_push(a->free_slots, &a->slots[i]) == 0);
+
     return a;
 }
 
+static struct asyncmsgq_item *item_new(pa_asyncmsgq *a) {
+    struct asyncmsgq_item *i;
+
+    if ((i = pa_flist_pop(a->free_slots)))
+        return i;
+
+    return pa_xnew(struct asyncmsgq_item, 1);
+}
+
+static void item_free(pa_asyncmsgq *a, struct asyncmsgq_item *i) {
+    if (i >= a->slots && i < a->slots + a->n_slots)
+        pa_assert_se(pa_flist_push(a->free_slots, i) == 0);
+    else
+        pa_xfree(i);
+}
+
+static void update_max(pa_atomic_t *max, int value) {
+    int old;
+
+    while ((old = pa_atomic_load(max)) < value)
+        if (pa_atomic_cmpxchg(max, old, value))
+            break;
+}
+
 static void asyncmsgq_free(pa_asyncmsgq *a) {
     struct asyncmsgq_item *i;
     pa_assert(a);
@@ -89,12 +139,21 @@ static void asyncmsgq_free(pa_asyncmsgq *a) {
         if (i->free_cb)
             i->free_cb(i->userdata);
 
-        if (pa_flist_push(PA_STATIC_FLIST_GET(asyncmsgq), i) < 0)
-            pa_xfree(i);
+        item_free(a, i);
     }
 
+    if (pa_atomic_load(&a->stat.n_sent) > 0 || pa_atomic_load(&a->stat.n_posted) > 0)
+        pa_log_debug("Message queue: %i posted, %i sent, up to %i queued, sends took %i usec on average and %i usec at most.",
+                     pa_atomic_load(&a->stat.n_posted),
+                     pa_atomic_load(&a->stat.n_sent),
+                     pa_atomic_load(&a->stat.n_queued_max),
+                     pa_atomic_load(&a->stat.send_usec_avg),
+                     pa_atomic_load(&a->stat.send_usec_max));
+
     pa_asyncq_free(a->asyncq, NULL);
     pa_mutex_free(a->mutex);
+    pa_flist_free(a->free_slots, NULL);
+    pa_xfree(a->slots);
     pa_xfree(a);
 }
 
@@ -114,10 +173,10 @@ void pa_asyncmsgq_unref(pa_asyncmsgq* q) {
 
 void pa_asyncmsgq_post(pa_asyncmsgq *a, pa_msgobject *object, int code, const void *userdata, int64_t offset, const pa_memchunk *chunk, pa_free_cb_t free_cb) {
     struct asyncmsgq_item *i;
+    pa_bool_t batch;
     pa_assert(PA_REFCNT_VALUE(a) > 0);
 
-    if (!(i = pa_flist_pop(PA_STATIC_FLIST_GET(asyncmsgq))))
-        i = pa_xnew(struct asyncmsgq_item, 1);
+    i = item_new(a);
 
     i->code = code;
     i->object = object ? pa_msgobject_ref(object) : NULL;
@@ -132,15 +191,49 @@ void pa_asyncmsgq_post(pa_asyncmsgq *a, pa_msgobject *object, int code, const vo
         pa_memchunk_reset(&i->memchunk);
     i->semaphore = NULL;
 
+    pa_atomic_inc(&a->stat.n_posted);
+    update_max(&a->stat.n_queued_max, pa_atomic_inc(&a->stat.n_queued) + 1);
+
+    /* Only our own thread can be in a batch that we see as ours */
+    batch = pa_atomic_ptr_load(&a->batch_thread) == pa_thread_self();
+
     /* This mutex makes the queue multiple-writer safe. This lock is only used on the writing side */
-    pa_mutex_lock(a->mutex);
+    if (!batch)
+        pa_mutex_lock(a->mutex);
+
     pa_asyncq_post(a->asyncq, i);
+
+    if (!batch)
+        pa_mutex_unlock(a->mutex);
+}
+
+void pa_asyncmsgq_post_batch_begin(pa_asyncmsgq *a) {
+    pa_assert(PA_REFCNT_VALUE(a) > 0);
+
+    pa_mutex_lock(a->mutex);
+
+    pa_assert(!pa_atomic_ptr_load(&a->batch_thread));
+    pa_atomic_ptr_store(&a->batch_thread, pa_thread_self());
+
+    pa_asyncq_batch_begin(a->asyncq);
+}
+
+void pa_asyncmsgq_post_batch_end(pa_asyncmsgq *a) {
+    pa_assert(PA_REFCNT_VALUE(a) > 0);
+    pa_assert(pa_atomic_ptr_load(&a->batch_thread) == pa_thread_self());
+
+    pa_asyncq_batch_end(a->asyncq);
+
+    pa_atomic_ptr_store(&a->batch_thread, NULL);
     pa_mutex_unlock(a->mutex);
 }
 
 int pa_asyncmsgq_send(pa_asyncmsgq *a, pa_msgobject *object, int code, const void *userdata, int64_t offset, const pa_memchunk *chunk) {
     struct asyncmsgq_item i;
+    pa_usec_t start;
+    int usec;
     pa_assert(PA_REFCNT_VALUE(a) > 0);
+    pa_assert(pa_atomic_ptr_load(&a->batch_thread) != pa_thread_self());
 
     i.code = code;
     i.object = object;
@@ -159,6 +252,9 @@ int pa_asyncmsgq_send(pa_asyncmsgq *a, pa_msgobject *object, int code, const voi
 
     pa_assert_se(i.semaphore);
 
+    start = pa_rtclock_now();
+    update_max(&a->stat.n_queued_max, pa_atomic_inc(&a->stat.n_queued) + 1);
+
     /* This mutex makes the queue multiple-writer safe. This lock is only used on the writing side */
     pa_mutex_lock(a->mutex);
     pa_assert_se(pa_asyncq_push(a->asyncq, &i, TRUE) == 0);
@@ -166,6 +262,13 @@ int pa_asyncmsgq_send(pa_asyncmsgq *a, pa_msgobject *object, int code, const voi
 
     pa_semaphore_wait(i.semaphore);
 
+    /* A moving average over about the last 16 sends, concurrent
+     * senders may lose an update */
+    usec = (int) PA_MIN(pa_rtclock_now() - start, (pa_usec_t) INT_MAX);
+    pa_atomic_inc(&a->stat.n_sent);
+    pa_atomic_store(&a->stat.send_usec_avg, pa_atomic_load(&a->stat.send_usec_avg) + (usec - pa_atomic_load(&a->stat.send_usec_avg)) / 16);
+    update_max(&a->stat.send_usec_max, usec);
+
     if (pa_flist_push(PA_STATIC_FLIST_GET(semaphores), i.semaphore) < 0)
         pa_semaphore_free(i.semaphore);
 
@@ -181,6 +284,8 @@ int pa_asyncmsgq_get(pa_asyncmsgq *a, pa_msgobject **object, int *code, void **u
         return -1;
     }
 
+    pa_atomic_dec(&a->stat.n_queued);
+
 /*     pa_log("success"); */
 
     if (code)
@@ -226,8 +331,7 @@ void pa_asyncmsgq_done(pa_asyncmsgq *a, int ret) {
         if (a->current->memchunk.memblock)
             pa_memblock_unref(a->current->memchunk.memblock);
 
-        if (pa_flist_push(PA_STATIC_FLIST_GET(asyncmsgq), a->current) < 0)
-            pa_xfree(a->current);
+        item_free(a, a->current);
     }
 
     a->current = NULL;
@@ -355,3 +459,9 @@ pa_bool_t pa_asyncmsgq_dispatching(pa_asyncmsgq *a) {
 
     return !!a->current;
 }
+
+const pa_asyncmsgq_stat* pa_asyncmsgq_get_stat(pa_asyncmsgq *a) {
+    pa_assert(PA_REFCNT_VALUE(a) > 0);
+
+    return &a->stat;
+}
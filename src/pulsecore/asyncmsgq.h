@@ -25,6 +25,7 @@
 #include <sys/types.h>
 
 #include <pulsecore/asyncq.h>
+#include <pulsecore/atomic.h>
 #include <pulsecore/memchunk.h>
 #include <pulsecore/msgobject.h>
 
@@ -44,13 +45,34 @@
  *
  * There are two functions for submitting messages: _post and
  * _send. The former just enqueues the message asynchronously, the
- * latter waits for completion, synchronously. */
+ * latter waits for completion, synchronously. Several posts can be
+ * batched, so that they take the lock once and wake up the reader
+ * once.
+ *
+ * Messages are kept in slots that are allocated with the queue, one
+ * for each entry of the underlying pa_asyncq. */
 
 enum {
     PA_MESSAGE_SHUTDOWN = -1/* A generic message to inform the handler of this queue to quit */
 };
 
 typedef struct pa_asyncmsgq pa_asyncmsgq;
+typedef struct pa_asyncmsgq_stat pa_asyncmsgq_stat;
+
+/* Like pa_mempool_stat, updates to this structure are not locked and
+ * the values are for statistical purposes only */
+struct pa_asyncmsgq_stat {
+    pa_atomic_t n_posted;
+    pa_atomic_t n_sent;
+
+    /* Messages not picked up by the reader yet */
+    pa_atomic_t n_queued;
+    pa_atomic_t n_queued_max;
+
+    /* How long a send took until the reader was done with it */
+    pa_atomic_t send_usec_avg;
+    pa_atomic_t send_usec_max;
+};
 
 pa_asyncmsgq* pa_asyncmsgq_new(unsigned size);
 pa_asyncmsgq* pa_asyncmsgq_ref(pa_asyncmsgq *q);
@@ -60,6 +82,13 @@ void pa_asyncmsgq_unref(pa_asyncmsgq* q);
 void pa_asyncmsgq_post(pa_asyncmsgq *q, pa_msgobject *object, int code, const void *userdata, int64_t offset, const pa_memchunk *memchunk, pa_free_cb_t userdata_free_cb);
 int pa_asyncmsgq_send(pa_asyncmsgq *q, pa_msgobject *object, int code, const void *userdata, int64_t offset, const pa_memchunk *memchunk);
 
+/* Everything posted by the calling thread between these two calls is
+ * passed on with a single lock and a single wakeup of the reader. Other
+ * writers block until the batch ends, and the calling thread may not
+ * send in between. */
+void pa_asyncmsgq_post_batch_begin(pa_asyncmsgq *q);
+void pa_asyncmsgq_post_batch_end(pa_asyncmsgq *q);
+
 int pa_asyncmsgq_get(pa_asyncmsgq *q, pa_msgobject **object, int *code, void **userdata, int64_t *offset, pa_memchunk *memchunk, pa_bool_t wait);
 int pa_asyncmsgq_dispatch(pa_msgobject *object, int code, void *userdata, int64_t offset, pa_memchunk *memchunk);
 void pa_asyncmsgq_done(pa_asyncmsgq *q, int ret);
@@ -80,4 +109,6 @@ void pa_asyncmsgq_write_after_poll(pa_asyncmsgq *a);
 
 pa_bool_t pa_asyncmsgq_dispatching(pa_asyncmsgq *a);
 
+const pa_asyncmsgq_stat* pa_asyncmsgq_get_stat(pa_asyncmsgq *a);
+
 #endif
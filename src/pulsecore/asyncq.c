@@ -66,6 +66,9 @@ struct pa_asyncq {
     PA_LLIST_HEAD(struct localq, localq);
     struct localq *last_localq;
     pa_bool_t waiting_for_post;
+
+    /* Only touched by the writing side */
+    pa_bool_t batching, batch_pending;
 };
 
 PA_STATIC_FLIST_DECLARE(localq, 0, pa_xfree);
@@ -91,6 +94,7 @@ pa_asyncq *pa_asyncq_new(unsigned size) {
     PA_LLIST_HEAD_INIT(struct localq, l->localq);
     l->last_localq = NULL;
     l->waiting_for_post = FALSE;
+    l->batching = l->batch_pending = FALSE;
 
     if (!(l->read_fdsem = pa_fdsem_new())) {
         pa_xfree(l);
@@ -132,6 +136,11 @@ void pa_asyncq_free(pa_asyncq *l, pa_free_cb_t free_cb) {
     pa_xfree(l);
 }
 
+static void notify_reader(pa_asyncq *l) {
+    l->batch_pending = FALSE;
+    pa_fdsem_post(l->write_fdsem);
+}
+
 static int push(pa_asyncq*l, void *p, pa_bool_t wait_op) {
     unsigned idx;
     pa_atomic_ptr_t *cells;
@@ -146,6 +155,11 @@ static int push(pa_asyncq*l, void *p, pa_bool_t wait_op) {
 
     if (!pa_atomic_ptr_cmpxchg(&cells[idx], NULL, p)) {
 
+        /* The reader might not know yet that there is something to
+         * make room by */
+        if (l->batch_pending)
+            notify_reader(l);
+
         if (!wait_op)
             return -1;
 
@@ -159,7 +173,10 @@ static int push(pa_asyncq*l, void *p, pa_bool_t wait_op) {
     _Y;
     l->write_idx++;
 
-    pa_fdsem_post(l->write_fdsem);
+    if (l->batching)
+        l->batch_pending = TRUE;
+    else
+        notify_reader(l);
 
     return 0;
 }
@@ -291,6 +308,23 @@ void pa_asyncq_read_after_poll(pa_asyncq *l) {
     pa_fdsem_after_poll(l->write_fdsem);
 }
 
+void pa_asyncq_batch_begin(pa_asyncq *l) {
+    pa_assert(l);
+    pa_assert(!l->batching);
+
+    l->batching = TRUE;
+}
+
+void pa_asyncq_batch_end(pa_asyncq *l) {
+    pa_assert(l);
+    pa_assert(l->batching);
+
+    l->batching = FALSE;
+
+    if (l->batch_pending)
+        notify_reader(l);
+}
+
 int pa_asyncq_write_fd(pa_asyncq *q) {
     pa_assert(q);
 
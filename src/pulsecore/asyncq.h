@@ -58,6 +58,12 @@ int pa_asyncq_read_fd(pa_asyncq *q);
 int pa_asyncq_read_before_poll(pa_asyncq *a);
 void pa_asyncq_read_after_poll(pa_asyncq *a);
 
+/* Pushes and posts between these two calls don't wake up the reader
+ * each, pa_asyncq_batch_end() does so once for all of them, or a push
+ * or post that finds the queue full. For the writing side. */
+void pa_asyncq_batch_begin(pa_asyncq *q);
+void pa_asyncq_batch_end(pa_asyncq *q);
+
 /* For the writing side */
 int pa_asyncq_write_fd(pa_asyncq *q);
 void pa_asyncq_write_before_poll(pa_asyncq *a);
@@ -149,7 +149,7 @@ static const struct command commands[] = {
     { "list-clients",            pa_cli_command_clients,            "List loaded clients",          1 },
     { "list-sink-inputs",        pa_cli_command_sink_inputs,        "List sink inputs",             1 },
     { "list-source-outputs",     pa_cli_command_source_outputs,     "List source outputs",          1 },
-    { "stat",                    pa_cli_command_stat,               "Show memory block statistics", 1 },
+    { "stat",                    pa_cli_command_stat,               "Show memory block and message queue statistics", 1 },
     { "info",                    pa_cli_command_info,               "Show comprehensive status",    1 },
     { "ls",                      pa_cli_command_info,               NULL,                           1 },
     { "list",                    pa_cli_command_info,               NULL,                           1 },
@@ -340,14 +340,34 @@ static int pa_cli_command_source_outputs(pa_core *c, pa_tokenizer *t, pa_strbuf
     return 0;
 }
 
+static void append_asyncmsgq_stat(pa_strbuf *buf, const char *type, const char *name, pa_asyncmsgq *q) {
+    const pa_asyncmsgq_stat *qstat;
+
+    if (!q)
+        return;
+
+    qstat = pa_asyncmsgq_get_stat(q);
+
+    pa_strbuf_printf(buf,
+                     "Message queue of %s %s: %u posted, %u sent, %u/%u queued/maximum, sends took %u usec on average and %u usec at most.\n",
+                     type, name,
+                     (unsigned) pa_atomic_load(&qstat->n_posted),
+                     (unsigned) pa_atomic_load(&qstat->n_sent),
+                     (unsigned) pa_atomic_load(&qstat->n_queued),
+                     (unsigned) pa_atomic_load(&qstat->n_queued_max),
+                     (unsigned) pa_atomic_load(&qstat->send_usec_avg),
+                     (unsigned) pa_atomic_load(&qstat->send_usec_max));
+}
+
 static int pa_cli_command_stat(pa_core *c, pa_tokenizer *t, pa_strbuf *buf, pa_bool_t *fail) {
     char ss[PA_SAMPLE_SPEC_SNPRINT_MAX];
     char cm[PA_CHANNEL_MAP_SNPRINT_MAX];
     char bytes[PA_BYTES_SNPRINT_MAX];
     const pa_mempool_stat *mstat;
     unsigned k;
-    pa_sink *def_sink;
-    pa_source *def_source;
+    uint32_t idx;
+    pa_sink *def_sink, *sink;
+    pa_source *def_source, *source;
 
     static const char* const type_table[PA_MEMBLOCK_TYPE_MAX] = {
         [PA_MEMBLOCK_POOL] = "POOL",
@@ -404,6 +424,28 @@ static int pa_cli_command_stat(pa_core *c, pa_tokenizer *t, pa_strbuf *buf, pa_b
                          (unsigned) pa_atomic_load(&mstat->n_allocated_by_type[k]),
                          (unsigned) pa_atomic_load(&mstat->n_accumulated_by_type[k]));
 
+    for (k = 0; k < PA_MEMPOOL_CLASSES_MAX; k++)
+        pa_strbuf_printf(buf,
+                         "Memory pool slots of size %s: %u/%u allocated/total, %u accumulated, %u times full.\n",
+                         pa_bytes_snprint(bytes, sizeof(bytes), (unsigned) mstat->slot_size_by_class[k]),
+                         (unsigned) pa_atomic_load(&mstat->n_allocated_by_class[k]),
+                         mstat->n_slots_by_class[k],
+                         (unsigned) pa_atomic_load(&mstat->n_accumulated_by_class[k]),
+                         (unsigned) pa_atomic_load(&mstat->n_full_by_class[k]));
+
+    pa_strbuf_printf(buf,
+                     "Thread cache hits/misses: %u/%u slots, %u/%u memory blocks.\n",
+                     (unsigned) pa_atomic_load(&mstat->n_slot_cache_hits),
+                     (unsigned) pa_atomic_load(&mstat->n_slot_cache_misses),
+                     (unsigned) pa_atomic_load(&mstat->n_block_cache_hits),
+                     (unsigned) pa_atomic_load(&mstat->n_block_cache_misses));
+
+    PA_IDXSET_FOREACH(sink, c->sinks, idx)
+        append_asyncmsgq_stat(buf, "sink", sink->name, sink->asyncmsgq);
+
+    PA_IDXSET_FOREACH(source, c->sources, idx)
+        append_asyncmsgq_stat(buf, "source", source->name, source->asyncmsgq);
+
     return 0;
 }
 
@@ -0,0 +1,444 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <math.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/macro.h>
+
+#include "convolver.h"
+
+/* Limits for the automatically chosen block size. Larger blocks need
+ * fewer partitions, but partially filled blocks cost more. */
+#define MIN_BLOCK_SIZE 64
+#define MAX_BLOCK_SIZE 512
+
+/* Spectra are kept as separate arrays of real and imaginary parts, with
+ * block_size + 1 bins for the real FFT of 2 * block_size samples. */
+
+struct pa_convolver {
+    unsigned n_inputs, n_outputs;
+    unsigned block_size, n_bins;
+    unsigned n_partitions;
+
+    /* Frames of the current block that have been received */
+    unsigned pos;
+
+    /* Filter spectra, n_partitions per input/output pair */
+    float *filter_re, *filter_im;
+    pa_bool_t *filter_set;
+
+    /* The last 2 * block_size input samples of each input */
+    float *window;
+
+    /* Spectra of the current, possibly partial, block of each input */
+    float *spectrum_re, *spectrum_im;
+
+    /* Spectra of the previous n_partitions - 1 complete blocks of each
+     * input, a ring with the newest at fdl_pos */
+    float *fdl_re, *fdl_im;
+    unsigned fdl_pos;
+
+    /* For each output the contribution of the previous blocks, which
+     * doesn't change while the current block fills up */
+    float *tail_re, *tail_im;
+
+    float *acc_re, *acc_im;
+    float *time;
+
+    /* Complex FFT of block_size points */
+    float *z_re, *z_im;
+    unsigned *bitrev;
+    float *twiddle_re, *twiddle_im;
+
+    /* Twiddles to split the complex FFT into the real one */
+    float *split_re, *split_im;
+};
+
+static void fft_complex(pa_convolver *c, float *re, float *im) {
+    unsigned m = c->block_size;
+    unsigned i, j, k, len;
+
+    for (i = 0; i < m; i++) {
+        j = c->bitrev[i];
+
+        if (i < j) {
+            float t;
+
+            t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (len = 2; len <= m; len <<= 1) {
+        unsigned half = len / 2, step = m / len;
+
+        for (i = 0; i < m; i += len)
+            for (k = 0; k < half; k++) {
+                float wr = c->twiddle_re[k * step], wi = c->twiddle_im[k * step];
+                unsigned a = i + k, b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+    }
+}
+
+/* Transforms 2 * block_size real samples by packing them into a complex
+ * FFT of half the size. The result is twice the DFT. */
+static void fft_real(pa_convolver *c, const float *x, float *out_re, float *out_im) {
+    unsigned m = c->block_size;
+    unsigned k;
+
+    for (k = 0; k < m; k++) {
+        c->z_re[k] = x[2 * k];
+        c->z_im[k] = x[2 * k + 1];
+    }
+
+    fft_complex(c, c->z_re, c->z_im);
+
+    for (k = 0; k <= m; k++) {
+        unsigned a = k % m, b = (m - k) % m;
+        float er = c->z_re[a] + c->z_re[b];
+        float ei = c->z_im[a] - c->z_im[b];
+        float or = c->z_im[a] + c->z_im[b];
+        float oi = c->z_re[b] - c->z_re[a];
+
+        out_re[k] = er + c->split_re[k] * or - c->split_im[k] * oi;
+        out_im[k] = ei + c->split_re[k] * oi + c->split_im[k] * or;
+    }
+}
+
+/* The inverse of fft_real(), without any normalization. For a spectrum
+ * of s times the DFT this gives 2 * block_size * s times the signal. */
+static void ifft_real(pa_convolver *c, const float *in_re, const float *in_im, float *x) {
+    unsigned m = c->block_size;
+    unsigned k;
+
+    for (k = 0; k < m; k++) {
+        float er = in_re[k] + in_re[m - k];
+        float ei = in_im[k] - in_im[m - k];
+        float dr = in_re[k] - in_re[m - k];
+        float di = in_im[k] + in_im[m - k];
+
+        /* multiply the odd part by the conjugate split twiddle */
+        float or = dr * c->split_re[k] + di * c->split_im[k];
+        float oi = di * c->split_re[k] - dr * c->split_im[k];
+
+        /* z = e + i * o, conjugated for the inverse transform */
+        c->z_re[k] = er - oi;
+        c->z_im[k] = -(ei + or);
+    }
+
+    fft_complex(c, c->z_re, c->z_im);
+
+    for (k = 0; k < m; k++) {
+        x[2 * k] = c->z_re[k];
+        x[2 * k + 1] = -c->z_im[k];
+    }
+}
+
+/* acc += a * b */
+static void spectrum_mac(unsigned n, float *acc_re, float *acc_im,
+                         const float *a_re, const float *a_im, const float *b_re, const float *b_im) {
+    unsigned k;
+
+    for (k = 0; k < n; k++) {
+        acc_re[k] += a_re[k] * b_re[k] - a_im[k] * b_im[k];
+        acc_im[k] += a_re[k] * b_im[k] + a_im[k] * b_re[k];
+    }
+}
+
+pa_convolver* pa_convolver_new(unsigned n_inputs, unsigned n_outputs, unsigned filter_length, unsigned block_size) {
+    pa_convolver *c;
+    unsigned i, bits, m, n_slots;
+
+    pa_assert(n_inputs > 0);
+    pa_assert(n_outputs > 0);
+    pa_assert(filter_length > 0);
+
+    if (block_size == 0) {
+        block_size = MIN_BLOCK_SIZE;
+
+        while (block_size < filter_length && block_size < MAX_BLOCK_SIZE)
+            block_size *= 2;
+    }
+
+    pa_assert(block_size >= 2);
+    pa_assert((block_size & (block_size - 1)) == 0);
+
+    c = pa_xnew0(pa_convolver, 1);
+    c->n_inputs = n_inputs;
+    c->n_outputs = n_outputs;
+    c->block_size = m = block_size;
+    c->n_bins = m + 1;
+    c->n_partitions = (filter_length + m - 1) / m;
+
+    c->filter_re = pa_xnew0(float, n_inputs * n_outputs * c->n_partitions * c->n_bins);
+    c->filter_im = pa_xnew0(float, n_inputs * n_outputs * c->n_partitions * c->n_bins);
+    c->filter_set = pa_xnew0(pa_bool_t, n_inputs * n_outputs);
+
+    c->window = pa_xnew0(float, n_inputs * 2 * m);
+    c->spectrum_re = pa_xnew(float, n_inputs * c->n_bins);
+    c->spectrum_im = pa_xnew(float, n_inputs * c->n_bins);
+
+    n_slots = PA_MAX(c->n_partitions - 1, 1U);
+    c->fdl_re = pa_xnew0(float, n_inputs * n_slots * c->n_bins);
+    c->fdl_im = pa_xnew0(float, n_inputs * n_slots * c->n_bins);
+
+    c->tail_re = pa_xnew0(float, n_outputs * c->n_bins);
+    c->tail_im = pa_xnew0(float, n_outputs * c->n_bins);
+
+    c->acc_re = pa_xnew(float, c->n_bins);
+    c->acc_im = pa_xnew(float, c->n_bins);
+    c->time = pa_xnew(float, 2 * m);
+
+    c->z_re = pa_xnew(float, m);
+    c->z_im = pa_xnew(float, m);
+
+    for (bits = 0; (1U << bits) < m; bits++)
+        ;
+
+    c->bitrev = pa_xnew(unsigned, m);
+    for (i = 0; i < m; i++) {
+        unsigned b, r = 0;
+
+        for (b = 0; b < bits; b++)
+            if (i & (1U << b))
+                r |= 1U << (bits - 1 - b);
+
+        c->bitrev[i] = r;
+    }
+
+    c->twiddle_re = pa_xnew(float, m / 2);
+    c->twiddle_im = pa_xnew(float, m / 2);
+    for (i = 0; i < m / 2; i++) {
+        c->twiddle_re[i] = (float) cos(2 * M_PI * i / m);
+        c->twiddle_im[i] = (float) -sin(2 * M_PI * i / m);
+    }
+
+    c->split_re = pa_xnew(float, m + 1);
+    c->split_im = pa_xnew(float, m + 1);
+    for (i = 0; i <= m; i++) {
+        c->split_re[i] = (float) cos(M_PI * i / m);
+        c->split_im[i] = (float) -sin(M_PI * i / m);
+    }
+
+    return c;
+}
+
+void pa_convolver_free(pa_convolver *c) {
+    pa_assert(c);
+
+    pa_xfree(c->filter_re);
+    pa_xfree(c->filter_im);
+    pa_xfree(c->filter_set);
+    pa_xfree(c->window);
+    pa_xfree(c->spectrum_re);
+    pa_xfree(c->spectrum_im);
+    pa_xfree(c->fdl_re);
+    pa_xfree(c->fdl_im);
+    pa_xfree(c->tail_re);
+    pa_xfree(c->tail_im);
+    pa_xfree(c->acc_re);
+    pa_xfree(c->acc_im);
+    pa_xfree(c->time);
+    pa_xfree(c->z_re);
+    pa_xfree(c->z_im);
+    pa_xfree(c->bitrev);
+    pa_xfree(c->twiddle_re);
+    pa_xfree(c->twiddle_im);
+    pa_xfree(c->split_re);
+    pa_xfree(c->split_im);
+    pa_xfree(c);
+}
+
+void pa_convolver_set_filter(pa_convolver *c, unsigned input, unsigned output, const float *taps, unsigned length, unsigned stride) {
+    unsigned m, p, k, base;
+    float scale;
+
+    pa_assert(c);
+    pa_assert(input < c->n_inputs);
+    pa_assert(output < c->n_outputs);
+    pa_assert(taps);
+    pa_assert(length <= c->n_partitions * c->block_size);
+    pa_assert(stride > 0);
+
+    m = c->block_size;
+    base = (input * c->n_outputs + output) * c->n_partitions;
+
+    /* Both the input spectra and the filter spectra come out of
+     * fft_real() doubled, and ifft_real() doesn't normalize */
+    scale = 1.0f / (8.0f * m);
+
+    for (p = 0; p < c->n_partitions; p++) {
+        float *re = c->filter_re + (base + p) * c->n_bins;
+        float *im = c->filter_im + (base + p) * c->n_bins;
+
+        /* Each partition is zero padded to the FFT size */
+        memset(c->time, 0, 2 * m * sizeof(float));
+        for (k = 0; k < m && p * m + k < length; k++)
+            c->time[k] = taps[(p * m + k) * stride];
+
+        fft_real(c, c->time, re, im);
+
+        for (k = 0; k < c->n_bins; k++) {
+            re[k] *= scale;
+            im[k] *= scale;
+        }
+    }
+
+    c->filter_set[input * c->n_outputs + output] = TRUE;
+}
+
+void pa_convolver_reset(pa_convolver *c) {
+    unsigned n_slots;
+
+    pa_assert(c);
+
+    n_slots = PA_MAX(c->n_partitions - 1, 1U);
+
+    memset(c->window, 0, c->n_inputs * 2 * c->block_size * sizeof(float));
+    memset(c->fdl_re, 0, c->n_inputs * n_slots * c->n_bins * sizeof(float));
+    memset(c->fdl_im, 0, c->n_inputs * n_slots * c->n_bins * sizeof(float));
+    memset(c->tail_re, 0, c->n_outputs * c->n_bins * sizeof(float));
+    memset(c->tail_im, 0, c->n_outputs * c->n_bins * sizeof(float));
+
+    c->pos = 0;
+    c->fdl_pos = 0;
+}
+
+/* The current block is complete. Remember its spectra and compute what the
+ * blocks so far contribute to the next one. */
+static void next_block(pa_convolver *c) {
+    unsigned i, o, p, m = c->block_size, n_slots = c->n_partitions - 1;
+
+    if (n_slots > 0) {
+        c->fdl_pos = (c->fdl_pos + 1) % n_slots;
+
+        for (i = 0; i < c->n_inputs; i++) {
+            memcpy(c->fdl_re + (i * n_slots + c->fdl_pos) * c->n_bins, c->spectrum_re + i * c->n_bins, c->n_bins * sizeof(float));
+            memcpy(c->fdl_im + (i * n_slots + c->fdl_pos) * c->n_bins, c->spectrum_im + i * c->n_bins, c->n_bins * sizeof(float));
+        }
+
+        for (o = 0; o < c->n_outputs; o++) {
+            float *tail_re = c->tail_re + o * c->n_bins, *tail_im = c->tail_im + o * c->n_bins;
+
+            memset(tail_re, 0, c->n_bins * sizeof(float));
+            memset(tail_im, 0, c->n_bins * sizeof(float));
+
+            for (i = 0; i < c->n_inputs; i++) {
+                unsigned base = (i * c->n_outputs + o) * c->n_partitions;
+
+                if (!c->filter_set[i * c->n_outputs + o])
+                    continue;
+
+                /* partition p applies to the block p blocks ago */
+                for (p = 1; p < c->n_partitions; p++) {
+                    unsigned slot = i * n_slots + (c->fdl_pos + n_slots + 1 - p) % n_slots;
+
+                    spectrum_mac(c->n_bins, tail_re, tail_im,
+                                 c->fdl_re + slot * c->n_bins, c->fdl_im + slot * c->n_bins,
+                                 c->filter_re + (base + p) * c->n_bins, c->filter_im + (base + p) * c->n_bins);
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < c->n_inputs; i++) {
+        float *w = c->window + i * 2 * m;
+
+        memcpy(w, w + m, m * sizeof(float));
+        memset(w + m, 0, m * sizeof(float));
+    }
+
+    c->pos = 0;
+}
+
+void pa_convolver_run(pa_convolver *c, const float *in, float *out, unsigned n_frames) {
+    unsigned m;
+
+    pa_assert(c);
+    pa_assert(in);
+    pa_assert(out);
+
+    m = c->block_size;
+
+    while (n_frames > 0) {
+        unsigned n = PA_MIN(n_frames, m - c->pos);
+        unsigned i, o, t;
+
+        /* Append to the current block. The rest of it is still zero,
+         * which doesn't affect the outputs we take from it. */
+        for (i = 0; i < c->n_inputs; i++) {
+            float *w = c->window + i * 2 * m + m + c->pos;
+
+            for (t = 0; t < n; t++)
+                w[t] = in[t * c->n_inputs + i];
+
+            fft_real(c, c->window + i * 2 * m, c->spectrum_re + i * c->n_bins, c->spectrum_im + i * c->n_bins);
+        }
+
+        for (o = 0; o < c->n_outputs; o++) {
+            memcpy(c->acc_re, c->tail_re + o * c->n_bins, c->n_bins * sizeof(float));
+            memcpy(c->acc_im, c->tail_im + o * c->n_bins, c->n_bins * sizeof(float));
+
+            for (i = 0; i < c->n_inputs; i++) {
+                unsigned base = (i * c->n_outputs + o) * c->n_partitions;
+
+                if (!c->filter_set[i * c->n_outputs + o])
+                    continue;
+
+                spectrum_mac(c->n_bins, c->acc_re, c->acc_im,
+                             c->spectrum_re + i * c->n_bins, c->spectrum_im + i * c->n_bins,
+                             c->filter_re + base * c->n_bins, c->filter_im + base * c->n_bins);
+            }
+
+            /* Overlap-save: only the second half is free of wrap around */
+            ifft_real(c, c->acc_re, c->acc_im, c->time);
+
+            for (t = 0; t < n; t++)
+                out[t * c->n_outputs + o] = c->time[m + c->pos + t];
+        }
+
+        in += n * c->n_inputs;
+        out += n * c->n_outputs;
+        n_frames -= n;
+        c->pos += n;
+
+        if (c->pos == m)
+            next_block(c);
+    }
+}
+
+unsigned pa_convolver_get_block_size(pa_convolver *c) {
+    pa_assert(c);
+
+    return c->block_size;
+}
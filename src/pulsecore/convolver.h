@@ -0,0 +1,52 @@
+#ifndef fooconvolverfoo
+#define fooconvolverfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Uniformly partitioned overlap-save FFT convolution of interleaved float
+ * samples. Every output channel is the sum of all input channels, each
+ * convolved with its own FIR filter. The filters are split into partitions
+ * of block_size taps, so the work per block grows with the filter length
+ * only through cheap spectrum multiplications. The output is not delayed:
+ * partially filled blocks are processed right away, and the full FFT work
+ * for a block is done once it is complete. */
+
+typedef struct pa_convolver pa_convolver;
+
+/* filter_length is the longest filter that will be set. A block_size of 0
+ * picks a suitable power of two, otherwise it has to be a power of two. */
+pa_convolver* pa_convolver_new(unsigned n_inputs, unsigned n_outputs, unsigned filter_length, unsigned block_size);
+void pa_convolver_free(pa_convolver *c);
+
+/* Sets the filter from input channel to output channel. The taps are read
+ * with the given stride so that interleaved impulse responses can be used
+ * directly. Filters that are never set are zero. */
+void pa_convolver_set_filter(pa_convolver *c, unsigned input, unsigned output, const float *taps, unsigned length, unsigned stride);
+
+/* Forgets all past input */
+void pa_convolver_reset(pa_convolver *c);
+
+/* Reads n_frames of n_inputs channels and writes n_frames of n_outputs
+ * channels */
+void pa_convolver_run(pa_convolver *c, const float *in, float *out, unsigned n_frames);
+
+unsigned pa_convolver_get_block_size(pa_convolver *c);
+
+#endif
@@ -63,14 +63,19 @@ static int core_process_msg(pa_msgobject *o, int code, void *userdata, int64_t o
 
 static void core_free(pa_object *o);
 
-pa_core* pa_core_new(pa_mainloop_api *m, pa_bool_t shared, size_t shm_size) {
+pa_core* pa_core_new(pa_mainloop_api *m, pa_bool_t shared, pa_bool_t memfd, pa_bool_t hugetlb, size_t shm_size) {
     pa_core* c;
-    pa_mempool *pool;
+    pa_mempool *pool = NULL;
     int j;
 
     pa_assert(m);
 
-    if (shared) {
+    if (shared && memfd) {
+        if (!(pool = pa_mempool_new_memfd(shm_size, hugetlb)))
+            pa_log_warn("failed to allocate memfd memory pool. Falling back to a POSIX shared memory pool.");
+    }
+
+    if (shared && !pool) {
         if (!(pool = pa_mempool_new(shared, shm_size))) {
             pa_log_warn("failed to allocate shared memory pool. Falling back to a normal memory pool.");
             shared = FALSE;
@@ -140,6 +145,7 @@ pa_core* pa_core_new(pa_mainloop_api *m, pa_bool_t shared, size_t shm_size) {
     c->realtime_priority = 5;
     c->disable_remixing = FALSE;
     c->disable_lfe_remixing = FALSE;
+    c->disable_srbchannel = FALSE;
     c->deferred_volume = TRUE;
     c->resample_method = PA_RESAMPLER_SPEEX_FLOAT_BASE + 3;
 
@@ -171,6 +171,7 @@ struct pa_core {
     pa_bool_t realtime_scheduling:1;
     pa_bool_t disable_remixing:1;
     pa_bool_t disable_lfe_remixing:1;
+    pa_bool_t disable_srbchannel:1;
     pa_bool_t deferred_volume:1;
 
     pa_resample_method_t resample_method;
@@ -191,7 +192,7 @@ enum {
     PA_CORE_MESSAGE_MAX
 };
 
-pa_core* pa_core_new(pa_mainloop_api *m, pa_bool_t shared, size_t shm_size);
+pa_core* pa_core_new(pa_mainloop_api *m, pa_bool_t shared, pa_bool_t memfd, pa_bool_t hugetlb, size_t shm_size);
 
 /* Check whether no one is connected to this core */
 void pa_core_check_idle(pa_core *c);
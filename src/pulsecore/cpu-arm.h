@@ -40,4 +40,9 @@ pa_bool_t pa_cpu_init_arm(pa_cpu_arm_flag_t *flags);
 /* some optimized functions */
 void pa_volume_func_init_arm(pa_cpu_arm_flag_t flags);
 
+#ifdef HAVE_NEON
+void pa_mix_func_init_neon(pa_cpu_arm_flag_t flags);
+void pa_sinc_func_init_neon(pa_cpu_arm_flag_t flags);
+#endif
+
 #endif /* foocpuarmhfoo */
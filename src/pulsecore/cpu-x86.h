@@ -37,7 +37,9 @@ typedef enum pa_cpu_x86_flag {
     PA_CPU_X86_SSE4_2    = (1 << 7),
     PA_CPU_X86_3DNOW     = (1 << 8),
     PA_CPU_X86_3DNOWEXT  = (1 << 9),
-    PA_CPU_X86_CMOV      = (1 << 10)
+    PA_CPU_X86_CMOV      = (1 << 10),
+    PA_CPU_X86_AVX       = (1 << 11),
+    PA_CPU_X86_AVX2      = (1 << 12)
 } pa_cpu_x86_flag_t;
 
 pa_bool_t pa_cpu_init_x86 (pa_cpu_x86_flag_t *flags);
@@ -69,4 +71,8 @@ void pa_remap_func_init_sse(pa_cpu_x86_flag_t flags);
 
 void pa_convert_func_init_sse (pa_cpu_x86_flag_t flags);
 
+void pa_mix_func_init_sse(pa_cpu_x86_flag_t flags);
+
+void pa_sinc_func_init_sse(pa_cpu_x86_flag_t flags);
+
 #endif /* foocpux86hfoo */
@@ -29,6 +29,7 @@
 #endif
 
 #include <pulsecore/socket.h>
+#include <pulsecore/macro.h>
 
 typedef struct pa_creds pa_creds;
 
@@ -41,6 +42,16 @@ struct pa_creds {
     uid_t uid;
 };
 
+#define PA_CMSG_ANCIL_DATA_MAX_FDS 3
+
+/* What may come along with data read from a unix socket */
+typedef struct pa_cmsg_ancil_data {
+    pa_creds creds;
+    pa_bool_t creds_valid;
+    unsigned n_fds;
+    int fds[PA_CMSG_ANCIL_DATA_MAX_FDS];
+} pa_cmsg_ancil_data;
+
 #else
 #undef HAVE_CREDS
 #endif
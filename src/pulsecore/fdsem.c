@@ -45,33 +45,97 @@
 #include <sys/eventfd.h>
 #endif
 
+#ifdef HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#endif
+
 #include "fdsem.h"
 
+/* The futex is the int inside pa_atomic_t, which is only guaranteed
+ * to be an int with the compiler builtins */
+#if defined(__linux__) && defined(HAVE_SYS_SYSCALL_H) && defined(HAVE_LINUX_FUTEX_H) && defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_ATOMIC_BUILTINS) && defined(SYS_futex)
+#define USE_FUTEX 1
+#endif
+
 struct pa_fdsem {
     int fds[2];
 #ifdef HAVE_SYS_EVENTFD_H
     int efd;
 #endif
 
+#ifdef USE_FUTEX
+    /* Only for semaphores that are private to this process. Threads
+     * in pa_fdsem_wait() sleep on the futex and are counted here,
+     * only those that poll the fd are counted in data->waiting. */
+    pa_bool_t use_futex;
+    pa_atomic_t futex_waiting;
+#endif
+
     pa_fdsem_data *data;
 };
 
+#ifdef USE_FUTEX
+/* Both may return early, the callers check the value again */
+static void futex_wait(pa_atomic_t *a, int value) {
+    syscall(SYS_futex, &a->value, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void futex_wake(pa_atomic_t *a) {
+    syscall(SYS_futex, &a->value, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+#endif
+
+static int create_fd(pa_fdsem *f) {
+
+#ifdef HAVE_SYS_EVENTFD_H
+    if ((f->efd = eventfd(0, EFD_CLOEXEC)) >= 0)
+        return 0;
+#endif
+
+    return pa_pipe_cloexec(f->fds);
+}
+
+/* Without a futex the fd is created right away. With one it is only
+ * created once somebody actually wants to poll, by the thread that
+ * does so. Until then nobody can be counted in data->waiting, so
+ * pa_fdsem_post() never touches the fd before it exists. */
+static int ensure_fd(pa_fdsem *f) {
+
+#ifdef HAVE_SYS_EVENTFD_H
+    if (f->efd >= 0)
+        return f->efd;
+#endif
+
+    if (f->fds[0] >= 0)
+        return f->fds[0];
+
+    if (create_fd(f) < 0) {
+        pa_log_error("Failed to create the fd of a semaphore: %s", pa_cstrerror(errno));
+        pa_assert_not_reached();
+    }
+
+    return ensure_fd(f);
+}
+
 pa_fdsem *pa_fdsem_new(void) {
     pa_fdsem *f;
 
     f = pa_xmalloc(PA_ALIGN(sizeof(pa_fdsem)) + PA_ALIGN(sizeof(pa_fdsem_data)));
 
+    f->fds[0] = f->fds[1] = -1;
 #ifdef HAVE_SYS_EVENTFD_H
-    if ((f->efd = eventfd(0, EFD_CLOEXEC)) >= 0)
-        f->fds[0] = f->fds[1] = -1;
-    else
+    f->efd = -1;
 #endif
-    {
-        if (pa_pipe_cloexec(f->fds) < 0) {
-            pa_xfree(f);
-            return NULL;
-        }
+
+#ifdef USE_FUTEX
+    f->use_futex = TRUE;
+    pa_atomic_store(&f->futex_waiting, 0);
+#else
+    if (create_fd(f) < 0) {
+        pa_xfree(f);
+        return NULL;
     }
+#endif
 
     f->data = (pa_fdsem_data*) ((uint8_t*) f + PA_ALIGN(sizeof(pa_fdsem)));
 
@@ -97,6 +161,12 @@ pa_fdsem *pa_fdsem_open_shm(pa_fdsem_data *data, int event_fd) {
     f->data = data;
 #endif
 
+#ifdef USE_FUTEX
+    /* The other side is another process, it can only wake us through
+     * the eventfd */
+    f->use_futex = FALSE;
+#endif
+
     return f;
 }
 
@@ -117,6 +187,11 @@ pa_fdsem *pa_fdsem_new_shm(pa_fdsem_data *data, int* event_fd) {
 
     f->fds[0] = f->fds[1] = -1;
     f->data = data;
+    *event_fd = f->efd;
+
+#ifdef USE_FUTEX
+    f->use_futex = FALSE;
+#endif
 
     pa_atomic_store(&f->data->waiting, 0);
     pa_atomic_store(&f->data->signalled, 0);
@@ -184,6 +259,11 @@ void pa_fdsem_post(pa_fdsem *f) {
 
     if (pa_atomic_cmpxchg(&f->data->signalled, 0, 1)) {
 
+#ifdef USE_FUTEX
+        if (f->use_futex && pa_atomic_load(&f->futex_waiting) > 0)
+            futex_wake(&f->data->signalled);
+#endif
+
         if (pa_atomic_load(&f->data->waiting)) {
             ssize_t r;
             char x = 'x';
@@ -230,6 +310,18 @@ void pa_fdsem_wait(pa_fdsem *f) {
     if (pa_atomic_cmpxchg(&f->data->signalled, 1, 0))
         return;
 
+#ifdef USE_FUTEX
+    if (f->use_futex) {
+        pa_atomic_inc(&f->futex_waiting);
+
+        while (!pa_atomic_cmpxchg(&f->data->signalled, 1, 0))
+            futex_wait(&f->data->signalled, 0);
+
+        pa_assert_se(pa_atomic_dec(&f->futex_waiting) >= 1);
+        return;
+    }
+#endif
+
     pa_atomic_inc(&f->data->waiting);
 
     while (!pa_atomic_cmpxchg(&f->data->signalled, 1, 0)) {
@@ -284,17 +376,15 @@ int pa_fdsem_try(pa_fdsem *f) {
 int pa_fdsem_get(pa_fdsem *f) {
     pa_assert(f);
 
-#ifdef HAVE_SYS_EVENTFD_H
-    if (f->efd >= 0)
-        return f->efd;
-#endif
-
-    return f->fds[0];
+    return ensure_fd(f);
 }
 
 int pa_fdsem_before_poll(pa_fdsem *f) {
     pa_assert(f);
 
+    /* Has to exist before we show up in data->waiting */
+    ensure_fd(f);
+
     flush(f);
 
     if (pa_atomic_cmpxchg(&f->data->signalled, 1, 0))
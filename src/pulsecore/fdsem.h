@@ -26,7 +26,10 @@
 
 /* A simple, asynchronous semaphore which uses fds for sleeping. In
  * the best case all functions are lock-free unless sleeping is
- * required.  */
+ * required. Where available, semaphores created with pa_fdsem_new()
+ * sleep in pa_fdsem_wait() on a futex instead, and create their fd
+ * only when pa_fdsem_get() or pa_fdsem_before_poll() is first called
+ * for polling it. That is to be done by the thread that polls. */
 
 typedef struct pa_fdsem pa_fdsem;
 
@@ -51,6 +51,14 @@ int pa_idxset_string_compare_func(const void *a, const void *b);
 typedef unsigned (*pa_hash_func_t)(const void *p);
 typedef int (*pa_compare_func_t)(const void *a, const void *b);
 
+/* Maps a hash value to one of 2^n_bits buckets. The hash is scrambled
+ * by a multiplication with the golden ratio first, so that hashes
+ * which only differ in their upper bits, like aligned pointers, don't
+ * end up in the same bucket. Used by pa_idxset and pa_hashmap. */
+static inline unsigned pa_idxset_hash_bucket(unsigned hash, unsigned n_bits) {
+    return (unsigned) (((uint32_t) hash * 0x9E3779B9U) >> (32 - n_bits));
+}
+
 typedef struct pa_idxset pa_idxset;
 
 /* Instantiate a new idxset with the specified hash and comparison functions */
@@ -250,6 +250,77 @@ ssize_t pa_iochannel_read(pa_iochannel*io, void*data, size_t l) {
     return r;
 }
 
+ssize_t pa_iochannel_writev(pa_iochannel*io, const struct iovec *iov, unsigned n_iov) {
+    ssize_t r;
+
+    pa_assert(io);
+    pa_assert(iov);
+    pa_assert(n_iov > 0);
+    pa_assert(io->ofd >= 0);
+
+#ifdef HAVE_SYS_UIO_H
+    for (;;) {
+
+        /* Like pa_write() we use send() semantics on sockets, so that
+         * we don't get SIGPIPE */
+        if (io->ofd_type == 0) {
+            struct msghdr mh;
+
+            pa_zero(mh);
+            mh.msg_iov = (struct iovec*) iov;
+            mh.msg_iovlen = n_iov;
+
+            if ((r = sendmsg(io->ofd, &mh, MSG_NOSIGNAL)) < 0 && errno == ENOTSOCK) {
+                io->ofd_type = 1;
+                continue;
+            }
+        } else
+            r = writev(io->ofd, iov, (int) n_iov);
+
+        if (r < 0 && errno == EINTR)
+            continue;
+
+        break;
+    }
+#else
+    r = pa_write(io->ofd, iov[0].iov_base, iov[0].iov_len, &io->ofd_type);
+#endif
+
+    if (r >= 0) {
+        io->writable = io->hungup = FALSE;
+        enable_events(io);
+    }
+
+    return r;
+}
+
+ssize_t pa_iochannel_readv(pa_iochannel*io, const struct iovec *iov, unsigned n_iov) {
+    ssize_t r;
+
+    pa_assert(io);
+    pa_assert(iov);
+    pa_assert(n_iov > 0);
+    pa_assert(io->ifd >= 0);
+
+#ifdef HAVE_SYS_UIO_H
+    for (;;) {
+        if ((r = readv(io->ifd, iov, (int) n_iov)) < 0 && errno == EINTR)
+            continue;
+
+        break;
+    }
+#else
+    r = pa_read(io->ifd, iov[0].iov_base, iov[0].iov_len, &io->ifd_type);
+#endif
+
+    if (r >= 0) {
+        io->readable = io->hungup = FALSE;
+        enable_events(io);
+    }
+
+    return r;
+}
+
 #ifdef HAVE_CREDS
 
 pa_bool_t pa_iochannel_creds_supported(pa_iochannel *io) {
@@ -288,10 +359,9 @@ int pa_iochannel_creds_enable(pa_iochannel *io) {
     return 0;
 }
 
-ssize_t pa_iochannel_write_with_creds(pa_iochannel*io, const void*data, size_t l, const pa_creds *ucred) {
+ssize_t pa_iochannel_writev_with_creds(pa_iochannel*io, const struct iovec *iov, unsigned n_iov, const pa_creds *ucred) {
     ssize_t r;
     struct msghdr mh;
-    struct iovec iov;
     union {
         struct cmsghdr hdr;
         uint8_t data[CMSG_SPACE(sizeof(struct ucred))];
@@ -299,14 +369,10 @@ ssize_t pa_iochannel_write_with_creds(pa_iochannel*io, const void*data, size_t l
     struct ucred *u;
 
     pa_assert(io);
-    pa_assert(data);
-    pa_assert(l);
+    pa_assert(iov);
+    pa_assert(n_iov > 0);
     pa_assert(io->ofd >= 0);
 
-    pa_zero(iov);
-    iov.iov_base = (void*) data;
-    iov.iov_len = l;
-
     pa_zero(cmsg);
     cmsg.hdr.cmsg_len = CMSG_LEN(sizeof(struct ucred));
     cmsg.hdr.cmsg_level = SOL_SOCKET;
@@ -324,8 +390,8 @@ ssize_t pa_iochannel_write_with_creds(pa_iochannel*io, const void*data, size_t l
     }
 
     pa_zero(mh);
-    mh.msg_iov = &iov;
-    mh.msg_iovlen = 1;
+    mh.msg_iov = (struct iovec*) iov;
+    mh.msg_iovlen = n_iov;
     mh.msg_control = &cmsg;
     mh.msg_controllen = sizeof(cmsg);
 
@@ -337,52 +403,104 @@ ssize_t pa_iochannel_write_with_creds(pa_iochannel*io, const void*data, size_t l
     return r;
 }
 
-ssize_t pa_iochannel_read_with_creds(pa_iochannel*io, void*data, size_t l, pa_creds *creds, pa_bool_t *creds_valid) {
+ssize_t pa_iochannel_writev_with_fds(pa_iochannel*io, const struct iovec *iov, unsigned n_iov, const int *fds, unsigned n_fds) {
     ssize_t r;
     struct msghdr mh;
-    struct iovec iov;
     union {
         struct cmsghdr hdr;
-        uint8_t data[CMSG_SPACE(sizeof(struct ucred))];
+        uint8_t data[CMSG_SPACE(sizeof(int) * PA_CMSG_ANCIL_DATA_MAX_FDS)];
     } cmsg;
 
     pa_assert(io);
-    pa_assert(data);
-    pa_assert(l);
-    pa_assert(io->ifd >= 0);
-    pa_assert(creds);
-    pa_assert(creds_valid);
+    pa_assert(iov);
+    pa_assert(n_iov > 0);
+    pa_assert(io->ofd >= 0);
+    pa_assert(fds);
+    pa_assert(n_fds > 0);
+    pa_assert(n_fds <= PA_CMSG_ANCIL_DATA_MAX_FDS);
 
-    pa_zero(iov);
-    iov.iov_base = data;
-    iov.iov_len = l;
+    pa_zero(cmsg);
+    cmsg.hdr.cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
+    cmsg.hdr.cmsg_level = SOL_SOCKET;
+    cmsg.hdr.cmsg_type = SCM_RIGHTS;
+
+    memcpy(CMSG_DATA(&cmsg.hdr), fds, sizeof(int) * n_fds);
+
+    pa_zero(mh);
+    mh.msg_iov = (struct iovec*) iov;
+    mh.msg_iovlen = n_iov;
+    mh.msg_control = &cmsg;
+    mh.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
+
+    if ((r = sendmsg(io->ofd, &mh, MSG_NOSIGNAL)) >= 0) {
+        io->writable = io->hungup = FALSE;
+        enable_events(io);
+    }
+
+    return r;
+}
+
+ssize_t pa_iochannel_readv_with_ancil_data(pa_iochannel*io, const struct iovec *iov, unsigned n_iov, pa_cmsg_ancil_data *ancil) {
+    ssize_t r;
+    struct msghdr mh;
+    union {
+        struct cmsghdr hdr;
+        uint8_t data[CMSG_SPACE(sizeof(struct ucred)) + CMSG_SPACE(sizeof(int) * PA_CMSG_ANCIL_DATA_MAX_FDS)];
+    } cmsg;
+
+    pa_assert(io);
+    pa_assert(iov);
+    pa_assert(n_iov > 0);
+    pa_assert(io->ifd >= 0);
+    pa_assert(ancil);
 
     pa_zero(cmsg);
     pa_zero(mh);
-    mh.msg_iov = &iov;
-    mh.msg_iovlen = 1;
+    mh.msg_iov = (struct iovec*) iov;
+    mh.msg_iovlen = n_iov;
     mh.msg_control = &cmsg;
     mh.msg_controllen = sizeof(cmsg);
 
-    if ((r = recvmsg(io->ifd, &mh, 0)) >= 0) {
+    if ((r = recvmsg(io->ifd, &mh, MSG_CMSG_CLOEXEC)) >= 0) {
         struct cmsghdr *cmh;
 
-        *creds_valid = FALSE;
+        ancil->creds_valid = FALSE;
+        ancil->n_fds = 0;
 
         for (cmh = CMSG_FIRSTHDR(&mh); cmh; cmh = CMSG_NXTHDR(&mh, cmh)) {
 
-            if (cmh->cmsg_level == SOL_SOCKET && cmh->cmsg_type == SCM_CREDENTIALS) {
+            if (cmh->cmsg_level != SOL_SOCKET)
+                continue;
+
+            if (cmh->cmsg_type == SCM_CREDENTIALS) {
                 struct ucred u;
                 pa_assert(cmh->cmsg_len == CMSG_LEN(sizeof(struct ucred)));
                 memcpy(&u, CMSG_DATA(cmh), sizeof(struct ucred));
 
-                creds->gid = u.gid;
-                creds->uid = u.uid;
-                *creds_valid = TRUE;
-                break;
+                ancil->creds.gid = u.gid;
+                ancil->creds.uid = u.uid;
+                ancil->creds_valid = TRUE;
+
+            } else if (cmh->cmsg_type == SCM_RIGHTS) {
+                unsigned i, n;
+                int fd;
+
+                n = (unsigned) ((cmh->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+
+                for (i = 0; i < n; i++) {
+                    memcpy(&fd, CMSG_DATA(cmh) + i * sizeof(int), sizeof(int));
+
+                    if (ancil->n_fds < PA_CMSG_ANCIL_DATA_MAX_FDS)
+                        ancil->fds[ancil->n_fds++] = fd;
+                    else
+                        pa_close(fd);
+                }
             }
         }
 
+        if (mh.msg_flags & MSG_CTRUNC)
+            pa_log_warn("Ancillary data was truncated.");
+
         io->readable = io->hungup = FALSE;
         enable_events(io);
     }
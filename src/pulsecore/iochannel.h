@@ -29,6 +29,15 @@
 
 #include <sys/types.h>
 
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#else
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
 #include <pulse/mainloop-api.h>
 #include <pulsecore/creds.h>
 #include <pulsecore/macro.h>
@@ -51,12 +60,22 @@ void pa_iochannel_free(pa_iochannel*io);
 ssize_t pa_iochannel_write(pa_iochannel*io, const void*data, size_t l);
 ssize_t pa_iochannel_read(pa_iochannel*io, void*data, size_t l);
 
+/* Scatter/gather versions of the above, with one syscall for all
+ * buffers. Where writev()/readv() are not available only the first
+ * buffer is transferred, which is just a short write resp. read. */
+ssize_t pa_iochannel_writev(pa_iochannel*io, const struct iovec *iov, unsigned n_iov);
+ssize_t pa_iochannel_readv(pa_iochannel*io, const struct iovec *iov, unsigned n_iov);
+
 #ifdef HAVE_CREDS
 pa_bool_t pa_iochannel_creds_supported(pa_iochannel *io);
 int pa_iochannel_creds_enable(pa_iochannel *io);
 
-ssize_t pa_iochannel_write_with_creds(pa_iochannel*io, const void*data, size_t l, const pa_creds *ucred);
-ssize_t pa_iochannel_read_with_creds(pa_iochannel*io, void*data, size_t l, pa_creds *ucred, pa_bool_t *creds_valid);
+ssize_t pa_iochannel_writev_with_creds(pa_iochannel*io, const struct iovec *iov, unsigned n_iov, const pa_creds *ucred);
+ssize_t pa_iochannel_writev_with_fds(pa_iochannel*io, const struct iovec *iov, unsigned n_iov, const int *fds, unsigned n_fds);
+
+/* File descriptors that are received are owned by the caller, those
+ * that don't fit into ancil are closed */
+ssize_t pa_iochannel_readv_with_ancil_data(pa_iochannel*io, const struct iovec *iov, unsigned n_iov, pa_cmsg_ancil_data *ancil);
 #endif
 
 pa_bool_t pa_iochannel_is_readable(pa_iochannel*io);
@@ -0,0 +1,75 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <limits.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/macro.h>
+
+#include "iostats.h"
+
+void pa_io_stats_init(pa_io_stats *s) {
+    unsigned i;
+
+    pa_assert(s);
+
+    for (i = 0; i < PA_HISTOGRAM_BUCKETS; i++) {
+        pa_atomic_store(&s->render_time.buckets[i], 0);
+        pa_atomic_store(&s->latency.buckets[i], 0);
+    }
+
+    pa_atomic_store(&s->render_time.max_usec, 0);
+    pa_atomic_store(&s->latency.max_usec, 0);
+
+    pa_atomic_store(&s->n_xruns, 0);
+    pa_atomic_store(&s->n_rewinds, 0);
+    s->rewind_bytes = 0;
+}
+
+void pa_histogram_add(pa_histogram *h, pa_usec_t usec) {
+    unsigned v;
+    int max;
+
+    pa_assert(h);
+
+    v = (unsigned) PA_MIN(usec, (pa_usec_t) INT_MAX);
+
+    pa_atomic_inc(&h->buckets[PA_MIN(pa_ulog2(v), PA_HISTOGRAM_BUCKETS - 1U)]);
+
+    while ((max = pa_atomic_load(&h->max_usec)) < (int) v)
+        if (pa_atomic_cmpxchg(&h->max_usec, max, (int) v))
+            break;
+}
+
+void pa_io_stats_xrun(pa_io_stats *s) {
+    pa_assert(s);
+
+    pa_atomic_inc(&s->n_xruns);
+}
+
+void pa_io_stats_rewind(pa_io_stats *s, size_t nbytes) {
+    pa_assert(s);
+
+    pa_atomic_inc(&s->n_rewinds);
+    s->rewind_bytes += nbytes;
+}
@@ -0,0 +1,69 @@
+#ifndef foopulsecoreiostatshfoo
+#define foopulsecoreiostatshfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <sys/types.h>
+#include <inttypes.h>
+
+#include <pulse/sample.h>
+
+#include <pulsecore/atomic.h>
+
+/* Statistics about how a sink, source or stream behaves over its
+ * lifetime. Updated from the IO thread without any locking, and read
+ * from anywhere. */
+
+/* Bucket 0 counts durations below 2 usec, bucket i > 0 those from 2^i
+ * to below 2^(i+1) usec, and the last one everything longer. Must be
+ * the same as PA_IO_STATS_HISTOGRAM_BUCKETS. */
+#define PA_HISTOGRAM_BUCKETS 24
+
+typedef struct pa_histogram {
+    pa_atomic_t buckets[PA_HISTOGRAM_BUCKETS];
+    pa_atomic_t max_usec;
+} pa_histogram;
+
+typedef struct pa_io_stats {
+    /* How long rendering resp. posting one chunk took */
+    pa_histogram render_time;
+
+    /* The latency whenever it was queried */
+    pa_histogram latency;
+
+    /* Underruns of sinks and sink inputs, overruns of sources and
+     * source outputs */
+    pa_atomic_t n_xruns;
+
+    pa_atomic_t n_rewinds;
+
+    /* Only written from the IO thread. A reader on a 32 bit machine
+     * might see a torn value, good enough for statistics. */
+    volatile uint64_t rewind_bytes;
+} pa_io_stats;
+
+void pa_io_stats_init(pa_io_stats *s);
+
+void pa_histogram_add(pa_histogram *h, pa_usec_t usec);
+
+void pa_io_stats_xrun(pa_io_stats *s);
+void pa_io_stats_rewind(pa_io_stats *s, size_t nbytes);
+
+#endif
@@ -46,9 +46,14 @@
 #include <pulse/timeval.h>
 
 #include <pulsecore/macro.h>
+#include <pulsecore/atomic.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/fdsem.h>
+#include <pulsecore/llist.h>
+#include <pulsecore/mutex.h>
 #include <pulsecore/once.h>
 #include <pulsecore/ratelimit.h>
+#include <pulsecore/refcnt.h>
 #include <pulsecore/thread.h>
 
 #include "log.h"
@@ -73,6 +78,59 @@ static pa_log_flags_t flags = 0, flags_override = 0;
 static pa_bool_t no_rate_limit = FALSE;
 static int log_fd = -1;
 
+/* Records a thread can queue before it has to drop messages */
+#define LOG_RING_RECORDS 128
+
+/* Longer messages are truncated when logged asynchronously */
+#define LOG_RECORD_TEXT_MAX 512
+
+/* A message, formatted by the thread that logged it. ready is 0 while
+ * the slot is free, 1 once it is filled and 2 while it is written out
+ * by the logger thread. */
+struct log_record {
+    pa_atomic_t ready;
+    pa_log_level_t level;
+    pa_usec_t time;
+    char location[128];
+    char text[LOG_RECORD_TEXT_MAX];
+};
+
+/* One for each thread that logs asynchronously. Referenced by the
+ * thread itself and by the logger thread, whichever lets go last
+ * frees it. */
+struct log_ring {
+    PA_REFCNT_DECLARE;
+    PA_LLIST_FIELDS(struct log_ring);
+
+    pa_atomic_t dead;
+    pa_atomic_t n_dropped;
+    char *thread_name;
+
+    /* The logger thread this ring was handed to. Once that one is
+     * stopped the ring is forgotten by all but the thread. */
+    int generation;
+
+    unsigned write_index; /* only used by the thread */
+    unsigned read_index;  /* only used by the logger thread */
+
+    struct log_record records[LOG_RING_RECORDS];
+};
+
+static void ring_thread_exit(void *p);
+
+PA_STATIC_TLS_DECLARE(log_ring, ring_thread_exit);
+
+/* Threads might still post the semaphore after the logger thread was
+ * stopped, so it and the mutex stay around once created */
+static pa_atomic_t async_running = PA_ATOMIC_INIT(0);
+static pa_atomic_t async_quit = PA_ATOMIC_INIT(0);
+static pa_atomic_t async_n_dropped = PA_ATOMIC_INIT(0);
+static pa_atomic_t async_generation = PA_ATOMIC_INIT(0);
+static pa_thread *async_thread = NULL;
+static pa_fdsem *async_fdsem = NULL;
+static pa_mutex *async_mutex = NULL;
+static PA_LLIST_HEAD(struct log_ring, async_rings) = NULL;
+
 #ifdef HAVE_SYSLOG_H
 static const int level_to_syslog[] = {
     [PA_LOG_ERROR] = LOG_ERR,
@@ -265,81 +323,51 @@ static void init_defaults(void) {
     } PA_ONCE_END;
 }
 
-void pa_log_levelv_meta(
-        pa_log_level_t level,
-        const char*file,
-        int line,
-        const char *func,
-        const char *format,
-        va_list ap) {
-
-    char *t, *n;
-    int saved_errno = errno;
-    char *bt = NULL;
-    pa_log_target_t _target;
-    pa_log_level_t _maximum_level;
-    unsigned _show_backtrace;
-    pa_log_flags_t _flags;
-
-    /* We don't use dynamic memory allocation here to minimize the hit
-     * in RT threads */
-    char text[16*1024], location[128], timestamp[32];
-
-    pa_assert(level < PA_LOG_LEVEL_MAX);
-    pa_assert(format);
-
-    init_defaults();
-
-    _target = target_override_set ? target_override : target;
-    _maximum_level = PA_MAX(maximum_level, maximum_level_override);
-    _show_backtrace = PA_MAX(show_backtrace, show_backtrace_override);
-    _flags = flags | flags_override;
-
-    if (PA_LIKELY(level > _maximum_level)) {
-        errno = saved_errno;
-        return;
-    }
-
-    pa_vsnprintf(text, sizeof(text), format, ap);
-
+static void format_location(char *location, size_t l, const char *file, int line, const char *func, pa_log_flags_t _flags) {
     if ((_flags & PA_LOG_PRINT_META) && file && line > 0 && func)
-        pa_snprintf(location, sizeof(location), "[%s][%s:%i %s()] ", pa_thread_get_name(pa_thread_self()), file, line, func);
+        pa_snprintf(location, l, "[%s][%s:%i %s()] ", pa_thread_get_name(pa_thread_self()), file, line, func);
     else if ((_flags & (PA_LOG_PRINT_META|PA_LOG_PRINT_FILE)) && file)
-        pa_snprintf(location, sizeof(location), "[%s] %s: ", pa_thread_get_name(pa_thread_self()), pa_path_get_filename(file));
+        pa_snprintf(location, l, "[%s] %s: ", pa_thread_get_name(pa_thread_self()), pa_path_get_filename(file));
     else
         location[0] = 0;
+}
 
-    if (_flags & PA_LOG_PRINT_TIME) {
-        static pa_usec_t start, last;
-        pa_usec_t u, a, r;
-
-        u = pa_rtclock_now();
+static void format_timestamp(char *timestamp, size_t l, pa_usec_t u) {
+    static pa_usec_t start, last;
+    pa_usec_t a, r;
 
-        PA_ONCE_BEGIN {
-            start = u;
-            last = u;
-        } PA_ONCE_END;
+    PA_ONCE_BEGIN {
+        start = u;
+        last = u;
+    } PA_ONCE_END;
 
-        r = u - last;
-        a = u - start;
+    /* Messages that were logged asynchronously might be older than
+     * the last one written */
+    r = u > last ? u - last : 0;
+    a = u > start ? u - start : 0;
 
-        /* This is not thread safe, but this is a debugging tool only
-         * anyway. */
-        last = u;
+    /* This is not thread safe, but this is a debugging tool only
+     * anyway. */
+    last = PA_MAX(u, last);
 
-        pa_snprintf(timestamp, sizeof(timestamp), "(%4llu.%03llu|%4llu.%03llu) ",
-                    (unsigned long long) (a / PA_USEC_PER_SEC),
-                    (unsigned long long) (((a / PA_USEC_PER_MSEC)) % 1000),
-                    (unsigned long long) (r / PA_USEC_PER_SEC),
-                    (unsigned long long) (((r / PA_USEC_PER_MSEC)) % 1000));
+    pa_snprintf(timestamp, l, "(%4llu.%03llu|%4llu.%03llu) ",
+                (unsigned long long) (a / PA_USEC_PER_SEC),
+                (unsigned long long) (((a / PA_USEC_PER_MSEC)) % 1000),
+                (unsigned long long) (r / PA_USEC_PER_SEC),
+                (unsigned long long) (((r / PA_USEC_PER_MSEC)) % 1000));
+}
 
-    } else
-        timestamp[0] = 0;
+/* Writes out a formatted message, text is modified */
+static void log_output(
+        pa_log_level_t level,
+        pa_log_target_t _target,
+        pa_log_flags_t _flags,
+        const char *timestamp,
+        const char *location,
+        char *text,
+        const char *bt) {
 
-#ifdef HAVE_EXECINFO_H
-    if (_show_backtrace > 0)
-        bt = get_backtrace(_show_backtrace);
-#endif
+    char *t, *n;
 
     if (!pa_utf8_valid(text))
         pa_logl(level, "Invalid UTF-8 string following below:");
@@ -417,7 +445,6 @@ void pa_log_levelv_meta(
                     pa_snprintf(metadata, sizeof(metadata), "\n%c %s %s", level_to_char[level], timestamp, location);
 
                     if ((write(log_fd, metadata, strlen(metadata)) < 0) || (write(log_fd, t, strlen(t)) < 0)) {
-                        saved_errno = errno;
                         pa_log_set_fd(-1);
                         fprintf(stderr, "%s\n", "Error writing logs to a file descriptor. Redirect log messages to console.");
                         fprintf(stderr, "%s %s\n", metadata, t);
@@ -432,6 +459,275 @@ void pa_log_levelv_meta(
                 break;
         }
     }
+}
+
+/* Called from the thread that logs, never blocks */
+static void ring_push(
+        struct log_ring *r,
+        pa_log_level_t level,
+        const char*file,
+        int line,
+        const char *func,
+        pa_log_flags_t _flags,
+        const char *format,
+        va_list ap) {
+
+    struct log_record *rec;
+
+    rec = &r->records[r->write_index];
+
+    if (pa_atomic_load(&rec->ready) != 0) {
+        pa_atomic_inc(&r->n_dropped);
+        pa_fdsem_post(async_fdsem);
+        return;
+    }
+
+    rec->level = level;
+    rec->time = pa_rtclock_now();
+    format_location(rec->location, sizeof(rec->location), file, line, func, _flags);
+    pa_vsnprintf(rec->text, sizeof(rec->text), format, ap);
+
+    /* Publishes the record, the atomic operation is a full barrier */
+    pa_atomic_inc(&rec->ready);
+
+    r->write_index = (r->write_index + 1) % LOG_RING_RECORDS;
+
+    pa_fdsem_post(async_fdsem);
+}
+
+static void ring_unref(struct log_ring *r) {
+    if (PA_REFCNT_DEC(r) > 0)
+        return;
+
+    pa_xfree(r->thread_name);
+    pa_xfree(r);
+}
+
+static void ring_thread_exit(void *p) {
+    struct log_ring *r = p;
+
+    pa_atomic_store(&r->dead, 1);
+    pa_fdsem_post(async_fdsem);
+
+    ring_unref(r);
+}
+
+/* Whether the current logger thread knows about this ring, it won't if
+ * the ring was enabled before the logger was restarted */
+static pa_bool_t ring_is_current(struct log_ring *r) {
+    return r->generation == pa_atomic_load(&async_generation);
+}
+
+/* Called from the logger thread with async_mutex held */
+static void ring_drain(struct log_ring *r) {
+    pa_log_target_t _target;
+    pa_log_flags_t _flags;
+    int n;
+
+    _target = target_override_set ? target_override : target;
+    _flags = flags | flags_override;
+
+    for (;;) {
+        struct log_record *rec;
+        char timestamp[32];
+
+        rec = &r->records[r->read_index];
+
+        if (!pa_atomic_cmpxchg(&rec->ready, 1, 2))
+            break;
+
+        if (_flags & PA_LOG_PRINT_TIME)
+            format_timestamp(timestamp, sizeof(timestamp), rec->time);
+        else
+            timestamp[0] = 0;
+
+        log_output(rec->level, _target, _flags, timestamp, rec->location, rec->text, NULL);
+
+        pa_atomic_sub(&rec->ready, 2);
+        r->read_index = (r->read_index + 1) % LOG_RING_RECORDS;
+    }
+
+    if ((n = pa_atomic_load(&r->n_dropped)) > 0) {
+        pa_atomic_sub(&r->n_dropped, n);
+        pa_atomic_add(&async_n_dropped, n);
+
+        pa_log_warn("Dropped %i log messages of thread %s, it logged faster than they could be written.", n, r->thread_name);
+    }
+}
+
+static void async_thread_func(void *userdata) {
+
+    for (;;) {
+        struct log_ring *r, *n;
+        pa_bool_t quit;
+
+        quit = !!pa_atomic_load(&async_quit);
+
+        pa_mutex_lock(async_mutex);
+
+        for (r = async_rings; r; r = n) {
+            pa_bool_t dead;
+
+            n = r->next;
+
+            /* Nothing is pushed anymore once the thread is gone */
+            dead = !!pa_atomic_load(&r->dead);
+
+            ring_drain(r);
+
+            if (dead || quit) {
+                PA_LLIST_REMOVE(struct log_ring, async_rings, r);
+                ring_unref(r);
+            }
+        }
+
+        pa_mutex_unlock(async_mutex);
+
+        if (quit)
+            break;
+
+        pa_fdsem_wait(async_fdsem);
+    }
+}
+
+int pa_log_async_start(void) {
+
+    if (pa_atomic_load(&async_running))
+        return 0;
+
+    if (!async_fdsem) {
+        if (!(async_fdsem = pa_fdsem_new()))
+            return -1;
+
+        async_mutex = pa_mutex_new(FALSE, FALSE);
+    }
+
+    pa_atomic_store(&async_quit, 0);
+    pa_atomic_inc(&async_generation);
+    pa_atomic_store(&async_running, 1);
+
+    if (!(async_thread = pa_thread_new("log", async_thread_func, NULL))) {
+        pa_atomic_store(&async_running, 0);
+        return -1;
+    }
+
+    return 0;
+}
+
+void pa_log_async_stop(void) {
+
+    if (!pa_atomic_load(&async_running))
+        return;
+
+    /* Threads that log from now on do so synchronously. The logger
+     * thread writes out what is left and lets go of all rings. */
+    pa_atomic_store(&async_running, 0);
+    pa_atomic_store(&async_quit, 1);
+    pa_fdsem_post(async_fdsem);
+
+    pa_thread_free(async_thread);
+    async_thread = NULL;
+}
+
+void pa_log_async_enable_thread(void) {
+    struct log_ring *r, *old;
+
+    if (!pa_atomic_load(&async_running))
+        return;
+
+    if ((old = PA_STATIC_TLS_GET(log_ring)) && ring_is_current(old))
+        return;
+
+    r = pa_xnew0(struct log_ring, 1);
+    r->thread_name = pa_xstrdup(pa_strnull(pa_thread_get_name(pa_thread_self())));
+
+    /* One for the thread, one for the logger thread */
+    PA_REFCNT_INIT(r);
+    PA_REFCNT_INC(r);
+
+    pa_mutex_lock(async_mutex);
+
+    /* The logger thread might have let go of all rings already */
+    if (!pa_atomic_load(&async_running)) {
+        pa_mutex_unlock(async_mutex);
+        pa_xfree(r->thread_name);
+        pa_xfree(r);
+        return;
+    }
+
+    r->generation = pa_atomic_load(&async_generation);
+    PA_LLIST_PREPEND(struct log_ring, async_rings, r);
+    pa_mutex_unlock(async_mutex);
+
+    PA_STATIC_TLS_SET(log_ring, r);
+
+    /* The previous logger thread let go of the old ring already */
+    if (old)
+        ring_unref(old);
+}
+
+unsigned pa_log_async_get_n_dropped(void) {
+    return (unsigned) pa_atomic_load(&async_n_dropped);
+}
+
+void pa_log_levelv_meta(
+        pa_log_level_t level,
+        const char*file,
+        int line,
+        const char *func,
+        const char *format,
+        va_list ap) {
+
+    int saved_errno = errno;
+    char *bt = NULL;
+    pa_log_target_t _target;
+    pa_log_level_t _maximum_level;
+    unsigned _show_backtrace;
+    pa_log_flags_t _flags;
+    struct log_ring *r;
+
+    /* We don't use dynamic memory allocation here to minimize the hit
+     * in RT threads */
+    char text[16*1024], location[128], timestamp[32];
+
+    pa_assert(level < PA_LOG_LEVEL_MAX);
+    pa_assert(format);
+
+    init_defaults();
+
+    _target = target_override_set ? target_override : target;
+    _maximum_level = PA_MAX(maximum_level, maximum_level_override);
+    _show_backtrace = PA_MAX(show_backtrace, show_backtrace_override);
+    _flags = flags | flags_override;
+
+    if (PA_LIKELY(level > _maximum_level)) {
+        errno = saved_errno;
+        return;
+    }
+
+    /* Threads that must not block hand the message to the logger
+     * thread, without a backtrace */
+    if (pa_atomic_load(&async_running) && (r = PA_STATIC_TLS_GET(log_ring)) && ring_is_current(r)) {
+        ring_push(r, level, file, line, func, _flags, format, ap);
+        errno = saved_errno;
+        return;
+    }
+
+    pa_vsnprintf(text, sizeof(text), format, ap);
+
+    format_location(location, sizeof(location), file, line, func, _flags);
+
+    if (_flags & PA_LOG_PRINT_TIME)
+        format_timestamp(timestamp, sizeof(timestamp), pa_rtclock_now());
+    else
+        timestamp[0] = 0;
+
+#ifdef HAVE_EXECINFO_H
+    if (_show_backtrace > 0)
+        bt = get_backtrace(_show_backtrace);
+#endif
+
+    log_output(level, _target, _flags, timestamp, location, text, bt);
 
     pa_xfree(bt);
     errno = saved_errno;
@@ -85,6 +85,21 @@ void pa_log_set_show_backtrace(unsigned nlevels);
 /* Skip the first backtrace frames */
 void pa_log_set_skip_backtrace(unsigned nlevels);
 
+/* Start resp. stop the logger thread. While it runs, threads that
+ * called pa_log_async_enable_thread() only queue their messages for
+ * it, in a ring of their own, and never block on the log target. If
+ * such a thread logs faster than the messages can be written, the
+ * excess is dropped and counted. */
+int pa_log_async_start(void);
+void pa_log_async_stop(void);
+
+/* Makes the calling thread log asynchronously, until it exits. Does
+ * nothing if the logger thread is not running. */
+void pa_log_async_enable_thread(void);
+
+/* Messages dropped since the logger thread was first started */
+unsigned pa_log_async_get_n_dropped(void);
+
 void pa_log_level_meta(
         pa_log_level_t level,
         const char*file,
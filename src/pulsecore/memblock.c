@@ -49,6 +49,7 @@
 #include <pulsecore/flist.h>
 #include <pulsecore/core-util.h>
 #include <pulsecore/memtrap.h>
+#include <pulsecore/thread.h>
 
 #include "memblock.h"
 
@@ -59,6 +60,20 @@
 #define PA_MEMPOOL_SLOTS_MAX 1024
 #define PA_MEMPOOL_SLOT_SIZE (64*1024)
 
+/* PA_MEMPOOL_SLOT_SIZE is the largest of the PA_MEMPOOL_CLASSES_MAX slot
+ * sizes, each smaller class has half the slot size of the next one.
+ * Three quarters of the pool are used for slots of the largest class,
+ * the rest is split evenly between the smaller ones. */
+
+/* Every thread keeps up to this many free slots of each size class of
+ * up to PA_MEMPOOL_CACHE_POOLS pools, and this many unused memblock
+ * structures, so that most allocations don't touch the shared free
+ * lists. The caches are refilled and drained by half their size at
+ * once. */
+#define PA_MEMPOOL_CACHE_POOLS 4
+#define PA_MEMPOOL_CACHE_SLOTS 32
+#define PA_MEMBLOCK_CACHE_SIZE 32
+
 #define PA_MEMEXPORT_SLOTS_MAX 128
 
 #define PA_MEMIMPORT_SLOTS_MAX 160
@@ -139,21 +154,56 @@ struct pa_memexport {
     PA_LLIST_FIELDS(pa_memexport);
 };
 
+/* The slots of one size, a contiguous range of the pool memory */
+struct mempool_class {
+    size_t block_size;
+    unsigned n_blocks;
+    size_t offset;
+
+    pa_atomic_t n_init;
+
+    /* A list of free slots that may be reused */
+    pa_flist *free_slots;
+
+    /* How many free slots a thread may keep, at most
+     * PA_MEMPOOL_CACHE_SLOTS. Small classes of small pools aren't
+     * cached, since the slots could then be stuck in other threads. */
+    unsigned cache_size;
+};
+
+/* The free slots one thread keeps for one pool */
+struct mempool_cache {
+    /* NULL if this entry is unused */
+    pa_mempool *pool;
+
+    unsigned n_slots[PA_MEMPOOL_CLASSES_MAX];
+    struct mempool_slot *slots[PA_MEMPOOL_CLASSES_MAX][PA_MEMPOOL_CACHE_SLOTS];
+
+    PA_LLIST_FIELDS(struct mempool_cache);
+};
+
+struct thread_cache {
+    struct mempool_cache pools[PA_MEMPOOL_CACHE_POOLS];
+
+    unsigned n_blocks;
+    pa_memblock *blocks[PA_MEMBLOCK_CACHE_SIZE];
+};
+
 struct pa_mempool {
     pa_semaphore *semaphore;
     pa_mutex *mutex;
 
     pa_shm memory;
-    size_t block_size;
-    unsigned n_blocks;
 
-    pa_atomic_t n_init;
+    /* Ordered by block size, the last one is the largest */
+    struct mempool_class classes[PA_MEMPOOL_CLASSES_MAX];
 
     PA_LLIST_HEAD(pa_memimport, imports);
     PA_LLIST_HEAD(pa_memexport, exports);
 
-    /* A list of free slots that may be reused */
-    pa_flist *free_slots;
+    /* The thread caches holding slots of this pool, protected by
+     * caches_mutex */
+    PA_LLIST_HEAD(struct mempool_cache, caches);
 
     pa_mempool_stat stat;
 };
@@ -162,6 +212,138 @@ static void segment_detach(pa_memimport_segment *seg);
 
 PA_STATIC_FLIST_DECLARE(unused_memblocks, 0, pa_xfree);
 
+static void thread_cache_free(void *userdata);
+
+PA_STATIC_TLS_DECLARE(thread_cache, thread_cache_free);
+
+/* Protects the association of thread caches and pools, which is only
+ * changed when a thread first uses a pool, when it exits and when a
+ * pool is freed */
+static pa_static_mutex caches_mutex = PA_STATIC_MUTEX_INIT;
+
+/* No lock necessary */
+static struct thread_cache* thread_cache_get(void) {
+    struct thread_cache *t;
+
+    if (PA_LIKELY(t = PA_STATIC_TLS_GET(thread_cache)))
+        return t;
+
+    t = pa_xnew0(struct thread_cache, 1);
+    PA_STATIC_TLS_SET(thread_cache, t);
+
+    return t;
+}
+
+/* Returns NULL if this thread already caches for too many pools */
+static struct mempool_cache* mempool_cache_get(pa_mempool *p) {
+    struct thread_cache *t;
+    struct mempool_cache *c = NULL;
+    pa_mutex *m;
+    unsigned i;
+
+    t = thread_cache_get();
+
+    for (i = 0; i < PA_MEMPOOL_CACHE_POOLS; i++) {
+        if (PA_LIKELY(t->pools[i].pool == p))
+            return &t->pools[i];
+
+        if (!c && !t->pools[i].pool)
+            c = &t->pools[i];
+    }
+
+    if (!c)
+        return NULL;
+
+    m = pa_static_mutex_get(&caches_mutex, FALSE, FALSE);
+    pa_mutex_lock(m);
+    c->pool = p;
+    PA_LLIST_PREPEND(struct mempool_cache, p->caches, c);
+    pa_mutex_unlock(m);
+
+    return c;
+}
+
+/* Moves all but n slots of a class back to the shared free list */
+static void mempool_cache_drain(struct mempool_cache *c, unsigned class, unsigned n) {
+    while (c->n_slots[class] > n)
+        while (pa_flist_push(c->pool->classes[class].free_slots, c->slots[class][--c->n_slots[class]]) < 0)
+            ;
+}
+
+/* Should be called with caches_mutex held */
+static void mempool_cache_release(struct mempool_cache *c) {
+    unsigned i;
+
+    for (i = 0; i < PA_MEMPOOL_CLASSES_MAX; i++)
+        mempool_cache_drain(c, i, 0);
+
+    PA_LLIST_REMOVE(struct mempool_cache, c->pool->caches, c);
+    c->pool = NULL;
+}
+
+/* Called when a thread exits */
+static void thread_cache_free(void *userdata) {
+    struct thread_cache *t = userdata;
+    pa_mutex *m;
+    unsigned i;
+
+    m = pa_static_mutex_get(&caches_mutex, FALSE, FALSE);
+    pa_mutex_lock(m);
+
+    for (i = 0; i < PA_MEMPOOL_CACHE_POOLS; i++)
+        if (t->pools[i].pool)
+            mempool_cache_release(&t->pools[i]);
+
+    pa_mutex_unlock(m);
+
+    while (t->n_blocks > 0) {
+        pa_memblock *b = t->blocks[--t->n_blocks];
+
+        if (pa_flist_push(PA_STATIC_FLIST_GET(unused_memblocks), b) < 0)
+            pa_xfree(b);
+    }
+
+    pa_xfree(t);
+}
+
+/* No lock necessary. Returns an uninitialized memblock structure. */
+static pa_memblock* memblock_struct_new(pa_mempool *p) {
+    struct thread_cache *t = thread_cache_get();
+    pa_memblock *b;
+
+    if (PA_LIKELY(t->n_blocks > 0)) {
+        pa_atomic_inc(&p->stat.n_block_cache_hits);
+        return t->blocks[--t->n_blocks];
+    }
+
+    pa_atomic_inc(&p->stat.n_block_cache_misses);
+
+    while (t->n_blocks < PA_MEMBLOCK_CACHE_SIZE / 2 &&
+           (b = pa_flist_pop(PA_STATIC_FLIST_GET(unused_memblocks))))
+        t->blocks[t->n_blocks++] = b;
+
+    if (t->n_blocks > 0)
+        return t->blocks[--t->n_blocks];
+
+    return pa_xnew(pa_memblock, 1);
+}
+
+/* No lock necessary */
+static void memblock_struct_free(pa_memblock *b) {
+    struct thread_cache *t = thread_cache_get();
+
+    if (PA_UNLIKELY(t->n_blocks >= PA_MEMBLOCK_CACHE_SIZE)) {
+        while (t->n_blocks > PA_MEMBLOCK_CACHE_SIZE / 2) {
+            pa_memblock *k = t->blocks[--t->n_blocks];
+
+            if (pa_flist_push(PA_STATIC_FLIST_GET(unused_memblocks), k) < 0)
+                pa_xfree(k);
+        }
+    }
+
+    t->blocks[t->n_blocks++] = b;
+}
+
 /* No lock necessary */
 static void stat_add(pa_memblock*b) {
     pa_assert(b);
@@ -245,32 +427,100 @@ static pa_memblock *memblock_new_appended(pa_mempool *p, size_t length) {
     return b;
 }
 
+static inline struct mempool_class* mempool_largest_class(pa_mempool *p) {
+    return &p->classes[PA_MEMPOOL_CLASSES_MAX - 1];
+}
+
 /* No lock necessary */
-static struct mempool_slot* mempool_allocate_slot(pa_mempool *p) {
+static struct mempool_slot* mempool_class_allocate_slot(pa_mempool *p, unsigned class, struct mempool_cache *cache) {
+    struct mempool_class *c = &p->classes[class];
     struct mempool_slot *slot;
+    int idx;
+
+    if (cache && c->cache_size > 0) {
+        if (PA_LIKELY(cache->n_slots[class] > 0)) {
+            pa_atomic_inc(&p->stat.n_slot_cache_hits);
+            return cache->slots[class][--cache->n_slots[class]];
+        }
+
+        pa_atomic_inc(&p->stat.n_slot_cache_misses);
+
+        while (cache->n_slots[class] < c->cache_size / 2 && (slot = pa_flist_pop(c->free_slots)))
+            cache->slots[class][cache->n_slots[class]++] = slot;
+
+        if (cache->n_slots[class] > 0)
+            return cache->slots[class][--cache->n_slots[class]];
+
+    } else if ((slot = pa_flist_pop(c->free_slots)))
+        return slot;
+
+    /* The free list was empty, we have to allocate a new entry */
+
+    if ((unsigned) (idx = pa_atomic_inc(&c->n_init)) >= c->n_blocks) {
+        pa_atomic_dec(&c->n_init);
+        return NULL;
+    }
+
+    return (struct mempool_slot*) ((uint8_t*) p->memory.ptr + c->offset + (c->block_size * (size_t) idx));
+}
+
+/* No lock necessary */
+static void mempool_free_slot(pa_mempool *p, unsigned class, struct mempool_slot *slot) {
+    struct mempool_class *c = &p->classes[class];
+    struct mempool_cache *cache;
+
+    if (c->cache_size > 0 && (cache = mempool_cache_get(p))) {
+        if (PA_UNLIKELY(cache->n_slots[class] >= c->cache_size))
+            mempool_cache_drain(cache, class, c->cache_size / 2);
+
+        cache->slots[class][cache->n_slots[class]++] = slot;
+        return;
+    }
+
+    /* The free list dimensions should easily allow all slots
+     * to fit in, hence try harder if pushing this slot into
+     * the free list fails */
+    while (pa_flist_push(c->free_slots, slot) < 0)
+        ;
+}
+
+/* No lock necessary. Returns a slot of at least size bytes, preferably
+ * from the smallest class that fits. */
+static struct mempool_slot* mempool_allocate_slot(pa_mempool *p, size_t size) {
+    struct mempool_slot *slot = NULL;
+    struct mempool_cache *cache;
+    unsigned i;
+
     pa_assert(p);
+    pa_assert(size <= mempool_largest_class(p)->block_size);
 
-    if (!(slot = pa_flist_pop(p->free_slots))) {
-        int idx;
+    cache = mempool_cache_get(p);
 
-        /* The free list was empty, we have to allocate a new entry */
+    for (i = 0; i < PA_MEMPOOL_CLASSES_MAX; i++) {
+        struct mempool_class *c = &p->classes[i];
 
-        if ((unsigned) (idx = pa_atomic_inc(&p->n_init)) >= p->n_blocks)
-            pa_atomic_dec(&p->n_init);
-        else
-            slot = (struct mempool_slot*) ((uint8_t*) p->memory.ptr + (p->block_size * (size_t) idx));
+        if (c->block_size < size)
+            continue;
 
-        if (!slot) {
-            if (pa_log_ratelimit(PA_LOG_DEBUG))
-                pa_log_debug("Pool full");
-            pa_atomic_inc(&p->stat.n_pool_full);
-            return NULL;
+        if ((slot = mempool_class_allocate_slot(p, i, cache))) {
+            pa_atomic_inc(&p->stat.n_allocated_by_class[i]);
+            pa_atomic_inc(&p->stat.n_accumulated_by_class[i]);
+            break;
         }
+
+        pa_atomic_inc(&p->stat.n_full_by_class[i]);
+    }
+
+    if (!slot) {
+        if (pa_log_ratelimit(PA_LOG_DEBUG))
+            pa_log_debug("Pool full");
+        pa_atomic_inc(&p->stat.n_pool_full);
+        return NULL;
     }
 
 /* #ifdef HAVE_VALGRIND_MEMCHECK_H */
 /*     if (PA_UNLIKELY(pa_in_valgrind())) { */
-/*         VALGRIND_MALLOCLIKE_BLOCK(slot, p->block_size, 0, 0); */
+/*         VALGRIND_MALLOCLIKE_BLOCK(slot, size, 0, 0); */
 /*     } */
 /* #endif */
 
@@ -283,23 +533,34 @@ static inline void* mempool_slot_data(struct mempool_slot *slot) {
 }
 
 /* No lock necessary */
-static unsigned mempool_slot_idx(pa_mempool *p, void *ptr) {
+static unsigned mempool_class_by_ptr(pa_mempool *p, void *ptr) {
+    size_t offset;
+    unsigned i;
+
     pa_assert(p);
 
     pa_assert((uint8_t*) ptr >= (uint8_t*) p->memory.ptr);
     pa_assert((uint8_t*) ptr < (uint8_t*) p->memory.ptr + p->memory.size);
 
-    return (unsigned) ((size_t) ((uint8_t*) ptr - (uint8_t*) p->memory.ptr) / p->block_size);
+    offset = (size_t) ((uint8_t*) ptr - (uint8_t*) p->memory.ptr);
+
+    for (i = PA_MEMPOOL_CLASSES_MAX - 1; i > 0; i--)
+        if (offset >= p->classes[i].offset)
+            break;
+
+    return i;
 }
 
 /* No lock necessary */
-static struct mempool_slot* mempool_slot_by_ptr(pa_mempool *p, void *ptr) {
-    unsigned idx;
+static struct mempool_slot* mempool_slot_by_ptr(pa_mempool *p, void *ptr, struct mempool_class **c) {
+    size_t idx;
 
-    if ((idx = mempool_slot_idx(p, ptr)) == (unsigned) -1)
-        return NULL;
+    *c = &p->classes[mempool_class_by_ptr(p, ptr)];
+
+    idx = ((size_t) ((uint8_t*) ptr - (uint8_t*) p->memory.ptr) - (*c)->offset) / (*c)->block_size;
+    pa_assert(idx < (*c)->n_blocks);
 
-    return (struct mempool_slot*) ((uint8_t*) p->memory.ptr + (idx * p->block_size));
+    return (struct mempool_slot*) ((uint8_t*) p->memory.ptr + (*c)->offset + (idx * (*c)->block_size));
 }
 
 /* No lock necessary */
@@ -323,28 +584,27 @@ pa_memblock *pa_memblock_new_pool(pa_mempool *p, size_t length) {
     if (length == (size_t) -1)
         length = pa_mempool_block_size_max(p);
 
-    if (p->block_size >= PA_ALIGN(sizeof(pa_memblock)) + length) {
+    if (mempool_largest_class(p)->block_size >= PA_ALIGN(sizeof(pa_memblock)) + length) {
 
-        if (!(slot = mempool_allocate_slot(p)))
+        if (!(slot = mempool_allocate_slot(p, PA_ALIGN(sizeof(pa_memblock)) + length)))
             return NULL;
 
         b = mempool_slot_data(slot);
         b->type = PA_MEMBLOCK_POOL;
         pa_atomic_ptr_store(&b->data, (uint8_t*) b + PA_ALIGN(sizeof(pa_memblock)));
 
-    } else if (p->block_size >= length) {
+    } else if (mempool_largest_class(p)->block_size >= length) {
 
-        if (!(slot = mempool_allocate_slot(p)))
+        if (!(slot = mempool_allocate_slot(p, length)))
             return NULL;
 
-        if (!(b = pa_flist_pop(PA_STATIC_FLIST_GET(unused_memblocks))))
-            b = pa_xnew(pa_memblock, 1);
+        b = memblock_struct_new(p);
 
         b->type = PA_MEMBLOCK_POOL_EXTERNAL;
         pa_atomic_ptr_store(&b->data, mempool_slot_data(slot));
 
     } else {
-        pa_log_debug("Memory block too large for pool: %lu > %lu", (unsigned long) length, (unsigned long) p->block_size);
+        pa_log_debug("Memory block too large for pool: %lu > %lu", (unsigned long) length, (unsigned long) mempool_largest_class(p)->block_size);
         pa_atomic_inc(&p->stat.n_too_large_for_pool);
         return NULL;
     }
@@ -369,8 +629,7 @@ pa_memblock *pa_memblock_new_fixed(pa_mempool *p, void *d, size_t length, pa_boo
     pa_assert(length != (size_t) -1);
     pa_assert(length);
 
-    if (!(b = pa_flist_pop(PA_STATIC_FLIST_GET(unused_memblocks))))
-        b = pa_xnew(pa_memblock, 1);
+    b = memblock_struct_new(p);
 
     PA_REFCNT_INIT(b);
     b->pool = p;
@@ -396,8 +655,7 @@ pa_memblock *pa_memblock_new_user(pa_mempool *p, void *d, size_t length, pa_free
     pa_assert(length != (size_t) -1);
     pa_assert(free_cb);
 
-    if (!(b = pa_flist_pop(PA_STATIC_FLIST_GET(unused_memblocks))))
-        b = pa_xnew(pa_memblock, 1);
+    b = memblock_struct_new(p);
 
     PA_REFCNT_INIT(b);
     b->pool = p;
@@ -511,9 +769,7 @@ static void memblock_free(pa_memblock *b) {
             /* Fall through */
 
         case PA_MEMBLOCK_FIXED:
-            if (pa_flist_push(PA_STATIC_FLIST_GET(unused_memblocks), b) < 0)
-                pa_xfree(b);
-
+            memblock_struct_free(b);
             break;
 
         case PA_MEMBLOCK_APPENDED:
@@ -537,15 +793,14 @@ static void memblock_free(pa_memblock *b) {
             pa_assert_se(pa_hashmap_remove(import->blocks, PA_UINT32_TO_PTR(b->per_type.imported.id)));
 
             pa_assert(segment->n_blocks >= 1);
-            if (-- segment->n_blocks <= 0)
+            if (-- segment->n_blocks <= 0 && !segment->memory.memfd)
                 segment_detach(segment);
 
             pa_mutex_unlock(import->mutex);
 
             import->release_cb(import, b->per_type.imported.id, import->userdata);
 
-            if (pa_flist_push(PA_STATIC_FLIST_GET(unused_memblocks), b) < 0)
-                pa_xfree(b);
+            memblock_struct_free(b);
 
             break;
         }
@@ -553,27 +808,25 @@ static void memblock_free(pa_memblock *b) {
         case PA_MEMBLOCK_POOL_EXTERNAL:
         case PA_MEMBLOCK_POOL: {
             struct mempool_slot *slot;
+            struct mempool_class *c;
             pa_bool_t call_free;
 
-            pa_assert_se(slot = mempool_slot_by_ptr(b->pool, pa_atomic_ptr_load(&b->data)));
+            pa_assert_se(slot = mempool_slot_by_ptr(b->pool, pa_atomic_ptr_load(&b->data), &c));
 
             call_free = b->type == PA_MEMBLOCK_POOL_EXTERNAL;
 
 /* #ifdef HAVE_VALGRIND_MEMCHECK_H */
 /*             if (PA_UNLIKELY(pa_in_valgrind())) { */
-/*                 VALGRIND_FREELIKE_BLOCK(slot, b->pool->block_size); */
+/*                 VALGRIND_FREELIKE_BLOCK(slot, c->block_size); */
 /*             } */
 /* #endif */
 
-            /* The free list dimensions should easily allow all slots
-             * to fit in, hence try harder if pushing this slot into
-             * the free list fails */
-            while (pa_flist_push(b->pool->free_slots, slot) < 0)
-                ;
+            pa_atomic_dec(&b->pool->stat.n_allocated_by_class[c - b->pool->classes]);
+
+            mempool_free_slot(b->pool, (unsigned) (c - b->pool->classes), slot);
 
             if (call_free)
-                if (pa_flist_push(PA_STATIC_FLIST_GET(unused_memblocks), b) < 0)
-                    pa_xfree(b);
+                memblock_struct_free(b);
 
             break;
         }
@@ -619,10 +872,10 @@ static void memblock_make_local(pa_memblock *b) {
 
     pa_atomic_dec(&b->pool->stat.n_allocated_by_type[b->type]);
 
-    if (b->length <= b->pool->block_size) {
+    if (b->length <= mempool_largest_class(b->pool)->block_size) {
         struct mempool_slot *slot;
 
-        if ((slot = mempool_allocate_slot(b->pool))) {
+        if ((slot = mempool_allocate_slot(b->pool, b->length))) {
             void *new_data;
             /* We can move it into a local pool, perfect! */
 
@@ -699,58 +952,103 @@ static void memblock_replace_import(pa_memblock *b) {
     memblock_make_local(b);
 
     pa_assert(segment->n_blocks >= 1);
-    if (-- segment->n_blocks <= 0)
+    if (-- segment->n_blocks <= 0 && !segment->memory.memfd)
         segment_detach(segment);
 
     pa_mutex_unlock(import->mutex);
 }
 
-pa_mempool* pa_mempool_new(pa_bool_t shared, size_t size) {
+static pa_mempool* mempool_new(pa_bool_t shared, pa_bool_t memfd, pa_bool_t hugetlb, size_t size) {
     pa_mempool *p;
     char t1[PA_BYTES_SNPRINT_MAX], t2[PA_BYTES_SNPRINT_MAX];
+    size_t block_size, total = 0;
+    unsigned i;
 
     p = pa_xnew(pa_mempool, 1);
+    memset(&p->stat, 0, sizeof(p->stat));
 
-    p->block_size = PA_PAGE_ALIGN(PA_MEMPOOL_SLOT_SIZE);
-    if (p->block_size < PA_PAGE_SIZE)
-        p->block_size = PA_PAGE_SIZE;
+    block_size = PA_PAGE_ALIGN(PA_MEMPOOL_SLOT_SIZE);
+    if (block_size < PA_PAGE_SIZE)
+        block_size = PA_PAGE_SIZE;
 
     if (size <= 0)
-        p->n_blocks = PA_MEMPOOL_SLOTS_MAX;
-    else {
-        p->n_blocks = (unsigned) (size / p->block_size);
+        size = PA_MEMPOOL_SLOTS_MAX * block_size;
+
+    for (i = PA_MEMPOOL_CLASSES_MAX; i > 0; i--) {
+        struct mempool_class *c = &p->classes[i - 1];
+
+        c->block_size = block_size;
+
+        if (i == PA_MEMPOOL_CLASSES_MAX)
+            c->n_blocks = (unsigned) (size / 4 * 3 / c->block_size);
+        else
+            c->n_blocks = (unsigned) (size / 4 / (PA_MEMPOOL_CLASSES_MAX - 1) / c->block_size);
+
+        if (c->n_blocks < 2)
+            c->n_blocks = 2;
 
-        if (p->n_blocks < 2)
-            p->n_blocks = 2;
+        block_size /= 2;
     }
 
-    if (pa_shm_create_rw(&p->memory, p->n_blocks * p->block_size, shared, 0700) < 0) {
+    /* Every class starts on a page boundary */
+    for (i = 0; i < PA_MEMPOOL_CLASSES_MAX; i++) {
+        struct mempool_class *c = &p->classes[i];
+
+        c->offset = total;
+        total += PA_PAGE_ALIGN(c->n_blocks * c->block_size);
+    }
+
+    if (memfd) {
+        if (pa_shm_create_memfd(&p->memory, total, hugetlb) < 0) {
+            pa_xfree(p);
+            return NULL;
+        }
+    } else if (pa_shm_create_rw(&p->memory, total, shared, 0700) < 0) {
         pa_xfree(p);
         return NULL;
     }
 
-    pa_log_debug("Using %s memory pool with %u slots of size %s each, total size is %s, maximum usable slot size is %lu",
-                 p->memory.shared ? "shared" : "private",
-                 p->n_blocks,
-                 pa_bytes_snprint(t1, sizeof(t1), (unsigned) p->block_size),
-                 pa_bytes_snprint(t2, sizeof(t2), (unsigned) (p->n_blocks * p->block_size)),
+    pa_log_debug("Using %s memory pool, total size is %s, maximum usable slot size is %lu",
+                 p->memory.memfd ? (p->memory.hugetlb ? "memfd huge page" : "memfd") : p->memory.shared ? "shared" : "private",
+                 pa_bytes_snprint(t1, sizeof(t1), (unsigned) total),
                  (unsigned long) pa_mempool_block_size_max(p));
 
-    memset(&p->stat, 0, sizeof(p->stat));
-    pa_atomic_store(&p->n_init, 0);
+    for (i = 0; i < PA_MEMPOOL_CLASSES_MAX; i++) {
+        struct mempool_class *c = &p->classes[i];
+
+        pa_log_debug("Size class %u: %u slots of size %s each", i, c->n_blocks,
+                     pa_bytes_snprint(t2, sizeof(t2), (unsigned) c->block_size));
+
+        pa_atomic_store(&c->n_init, 0);
+        c->free_slots = pa_flist_new(c->n_blocks);
+        c->cache_size = PA_MIN((unsigned) PA_MEMPOOL_CACHE_SLOTS, c->n_blocks / 8);
+
+        p->stat.slot_size_by_class[i] = c->block_size;
+        p->stat.n_slots_by_class[i] = c->n_blocks;
+    }
 
     PA_LLIST_HEAD_INIT(pa_memimport, p->imports);
     PA_LLIST_HEAD_INIT(pa_memexport, p->exports);
+    PA_LLIST_HEAD_INIT(struct mempool_cache, p->caches);
 
     p->mutex = pa_mutex_new(TRUE, TRUE);
     p->semaphore = pa_semaphore_new(0);
 
-    p->free_slots = pa_flist_new(p->n_blocks);
-
     return p;
 }
 
+pa_mempool* pa_mempool_new(pa_bool_t shared, size_t size) {
+    return mempool_new(shared, FALSE, FALSE, size);
+}
+
+pa_mempool* pa_mempool_new_memfd(size_t size, pa_bool_t hugetlb) {
+    return mempool_new(TRUE, TRUE, hugetlb, size);
+}
+
 void pa_mempool_free(pa_mempool *p) {
+    pa_mutex *m;
+    unsigned c;
+
     pa_assert(p);
 
     pa_mutex_lock(p->mutex);
@@ -763,7 +1061,16 @@ void pa_mempool_free(pa_mempool *p) {
 
     pa_mutex_unlock(p->mutex);
 
-    pa_flist_free(p->free_slots, NULL);
+    /* Take back the slots the threads still keep. Afterwards no thread
+     * cache refers to this pool anymore, so a new pool that happens to
+     * get the same address doesn't find stale slots. */
+    m = pa_static_mutex_get(&caches_mutex, FALSE, FALSE);
+    pa_mutex_lock(m);
+
+    while (p->caches)
+        mempool_cache_release(p->caches);
+
+    pa_mutex_unlock(m);
 
     if (pa_atomic_load(&p->stat.n_allocated) > 0) {
 
@@ -775,32 +1082,36 @@ void pa_mempool_free(pa_mempool *p) {
 
         /* Let's try to find at least one of those leaked memory blocks */
 
-        list = pa_flist_new(p->n_blocks);
+        for (c = 0; c < PA_MEMPOOL_CLASSES_MAX; c++) {
+            struct mempool_class *class = &p->classes[c];
 
-        for (i = 0; i < (unsigned) pa_atomic_load(&p->n_init); i++) {
-            struct mempool_slot *slot;
-            pa_memblock *b, *k;
+            list = pa_flist_new(class->n_blocks);
 
-            slot = (struct mempool_slot*) ((uint8_t*) p->memory.ptr + (p->block_size * (size_t) i));
-            b = mempool_slot_data(slot);
+            for (i = 0; i < (unsigned) pa_atomic_load(&class->n_init); i++) {
+                struct mempool_slot *slot;
+                pa_memblock *b, *k;
 
-            while ((k = pa_flist_pop(p->free_slots))) {
-                while (pa_flist_push(list, k) < 0)
-                    ;
+                slot = (struct mempool_slot*) ((uint8_t*) p->memory.ptr + class->offset + (class->block_size * (size_t) i));
+                b = mempool_slot_data(slot);
 
-                if (b == k)
-                    break;
-            }
+                while ((k = pa_flist_pop(class->free_slots))) {
+                    while (pa_flist_push(list, k) < 0)
+                        ;
 
-            if (!k)
-                pa_log("REF: Leaked memory block %p", b);
+                    if (b == k)
+                        break;
+                }
 
-            while ((k = pa_flist_pop(list)))
-                while (pa_flist_push(p->free_slots, k) < 0)
-                    ;
-        }
+                if (!k)
+                    pa_log("REF: Leaked memory block %p", b);
 
-        pa_flist_free(list, NULL);
+                while ((k = pa_flist_pop(list)))
+                    while (pa_flist_push(class->free_slots, k) < 0)
+                        ;
+            }
+
+            pa_flist_free(list, NULL);
+        }
 
 #endif
 
@@ -809,6 +1120,9 @@ void pa_mempool_free(pa_mempool *p) {
 /*         PA_DEBUG_TRAP; */
     }
 
+    for (c = 0; c < PA_MEMPOOL_CLASSES_MAX; c++)
+        pa_flist_free(p->classes[c].free_slots, NULL);
+
     pa_shm_free(&p->memory);
 
     pa_mutex_free(p->mutex);
@@ -828,30 +1142,39 @@ const pa_mempool_stat* pa_mempool_get_stat(pa_mempool *p) {
 size_t pa_mempool_block_size_max(pa_mempool *p) {
     pa_assert(p);
 
-    return p->block_size - PA_ALIGN(sizeof(pa_memblock));
+    return mempool_largest_class(p)->block_size - PA_ALIGN(sizeof(pa_memblock));
 }
 
 /* No lock necessary */
 void pa_mempool_vacuum(pa_mempool *p) {
     struct mempool_slot *slot;
     pa_flist *list;
+    unsigned i;
 
     pa_assert(p);
 
-    list = pa_flist_new(p->n_blocks);
+    for (i = 0; i < PA_MEMPOOL_CLASSES_MAX; i++) {
+        struct mempool_class *c = &p->classes[i];
 
-    while ((slot = pa_flist_pop(p->free_slots)))
-        while (pa_flist_push(list, slot) < 0)
-            ;
+        /* Slots smaller than a page can't be given back */
+        if (c->block_size < PA_PAGE_SIZE)
+            continue;
 
-    while ((slot = pa_flist_pop(list))) {
-        pa_shm_punch(&p->memory, (size_t) ((uint8_t*) slot - (uint8_t*) p->memory.ptr), p->block_size);
+        list = pa_flist_new(c->n_blocks);
 
-        while (pa_flist_push(p->free_slots, slot))
-            ;
-    }
+        while ((slot = pa_flist_pop(c->free_slots)))
+            while (pa_flist_push(list, slot) < 0)
+                ;
+
+        while ((slot = pa_flist_pop(list))) {
+            pa_shm_punch(&p->memory, (size_t) ((uint8_t*) slot - (uint8_t*) p->memory.ptr), c->block_size);
 
-    pa_flist_free(list, NULL);
+            while (pa_flist_push(c->free_slots, slot))
+                ;
+        }
+
+        pa_flist_free(list, NULL);
+    }
 }
 
 /* No lock necessary */
@@ -873,6 +1196,20 @@ pa_bool_t pa_mempool_is_shared(pa_mempool *p) {
     return !!p->memory.shared;
 }
 
+/* No lock necessary */
+pa_bool_t pa_mempool_is_memfd_backed(pa_mempool *p) {
+    pa_assert(p);
+
+    return !!p->memory.memfd;
+}
+
+/* No lock necessary */
+int pa_mempool_get_memfd_fd(pa_mempool *p) {
+    pa_assert(p);
+
+    return p->memory.memfd ? p->memory.fd : -1;
+}
+
 /* For receiving blocks from other nodes */
 pa_memimport* pa_memimport_new(pa_mempool *p, pa_memimport_release_cb_t cb, void *userdata) {
     pa_memimport *i;
@@ -918,6 +1255,43 @@ static pa_memimport_segment* segment_attach(pa_memimport *i, uint32_t shm_id) {
     return seg;
 }
 
+/* Self-locked. Always takes ownership of the fd. */
+int pa_memimport_attach_memfd(pa_memimport *i, uint32_t shm_id, int memfd_fd) {
+    pa_memimport_segment *seg;
+    int ret = -1;
+
+    pa_assert(i);
+    pa_assert(memfd_fd >= 0);
+
+    pa_mutex_lock(i->mutex);
+
+    if (pa_hashmap_get(i->segments, PA_UINT32_TO_PTR(shm_id)) ||
+        pa_hashmap_size(i->segments) >= PA_MEMIMPORT_SEGMENTS_MAX) {
+        pa_close(memfd_fd);
+        goto finish;
+    }
+
+    seg = pa_xnew0(pa_memimport_segment, 1);
+
+    if (pa_shm_attach_memfd(&seg->memory, shm_id, memfd_fd, FALSE) < 0) {
+        pa_xfree(seg);
+        goto finish;
+    }
+
+    /* The segment is sealed, so there's no need for a memtrap. It stays
+     * attached until the import is freed, since it can't be attached
+     * again later. */
+    seg->import = i;
+
+    pa_hashmap_put(i->segments, PA_UINT32_TO_PTR(seg->memory.id), seg);
+    ret = 0;
+
+finish:
+    pa_mutex_unlock(i->mutex);
+
+    return ret;
+}
+
 /* Should be called locked */
 static void segment_detach(pa_memimport_segment *seg) {
     pa_assert(seg);
@@ -935,6 +1309,7 @@ static void segment_detach(pa_memimport_segment *seg) {
 void pa_memimport_free(pa_memimport *i) {
     pa_memexport *e;
     pa_memblock *b;
+    pa_memimport_segment *seg;
 
     pa_assert(i);
 
@@ -943,7 +1318,11 @@ void pa_memimport_free(pa_memimport *i) {
     while ((b = pa_hashmap_first(i->blocks)))
         memblock_replace_import(b);
 
-    pa_assert(pa_hashmap_size(i->segments) == 0);
+    /* Only the memfd segments are left now */
+    while ((seg = pa_hashmap_first(i->segments))) {
+        pa_assert(seg->memory.memfd);
+        segment_detach(seg);
+    }
 
     pa_mutex_unlock(i->mutex);
 
@@ -989,8 +1368,7 @@ pa_memblock* pa_memimport_get(pa_memimport *i, uint32_t block_id, uint32_t shm_i
     if (offset+size > seg->memory.size)
         goto finish;
 
-    if (!(b = pa_flist_pop(PA_STATIC_FLIST_GET(unused_memblocks))))
-        b = pa_xnew(pa_memblock, 1);
+    b = memblock_struct_new(i->pool);
 
     PA_REFCNT_INIT(b);
     b->pool = i->pool;
@@ -1176,6 +1554,10 @@ int pa_memexport_put(pa_memexport *e, pa_memblock *b, uint32_t *block_id, uint32
     pa_assert(size);
     pa_assert(b->pool == e->pool);
 
+    /* We can't pass on the memfd of a segment we imported ourselves */
+    if (b->type == PA_MEMBLOCK_IMPORTED && b->per_type.imported.segment->memory.memfd)
+        return -1;
+
     if (!(b = memblock_shared_copy(e->pool, b)))
         return -1;
 
@@ -52,6 +52,10 @@ typedef struct pa_memimport_segment pa_memimport_segment;
 typedef struct pa_memimport pa_memimport;
 typedef struct pa_memexport pa_memexport;
 
+/* The pool is divided into slots of this many sizes, doubling from
+ * 2 KiB to 64 KiB */
+#define PA_MEMPOOL_CLASSES_MAX 6
+
 typedef void (*pa_memimport_release_cb_t)(pa_memimport *i, uint32_t block_id, void *userdata);
 typedef void (*pa_memexport_revoke_cb_t)(pa_memexport *e, uint32_t block_id, void *userdata);
 
@@ -74,6 +78,23 @@ struct pa_mempool_stat {
 
     pa_atomic_t n_allocated_by_type[PA_MEMBLOCK_TYPE_MAX];
     pa_atomic_t n_accumulated_by_type[PA_MEMBLOCK_TYPE_MAX];
+
+    /* Slots of each size class of the pool, smallest first. A class is
+     * full when a request had to be served from a larger class, or
+     * failed for the largest one. */
+    size_t slot_size_by_class[PA_MEMPOOL_CLASSES_MAX];
+    unsigned n_slots_by_class[PA_MEMPOOL_CLASSES_MAX];
+    pa_atomic_t n_allocated_by_class[PA_MEMPOOL_CLASSES_MAX];
+    pa_atomic_t n_accumulated_by_class[PA_MEMPOOL_CLASSES_MAX];
+    pa_atomic_t n_full_by_class[PA_MEMPOOL_CLASSES_MAX];
+
+    /* How often the per-thread caches of free slots and of memblock
+     * structures could serve a request without touching the shared
+     * free lists */
+    pa_atomic_t n_slot_cache_hits;
+    pa_atomic_t n_slot_cache_misses;
+    pa_atomic_t n_block_cache_hits;
+    pa_atomic_t n_block_cache_misses;
 };
 
 /* Allocate a new memory block of type PA_MEMBLOCK_MEMPOOL or PA_MEMBLOCK_APPENDED, depending on the size */
@@ -116,17 +137,27 @@ pa_memblock *pa_memblock_will_need(pa_memblock *b);
 
 /* The memory block manager */
 pa_mempool* pa_mempool_new(pa_bool_t shared, size_t size);
+/* A shared pool in a sealed memfd, which other processes map from the
+ * file descriptor instead of by name. Huge pages are tried first if
+ * hugetlb is TRUE. */
+pa_mempool* pa_mempool_new_memfd(size_t size, pa_bool_t hugetlb);
 void pa_mempool_free(pa_mempool *p);
 const pa_mempool_stat* pa_mempool_get_stat(pa_mempool *p);
 void pa_mempool_vacuum(pa_mempool *p);
 int pa_mempool_get_shm_id(pa_mempool *p, uint32_t *id);
 pa_bool_t pa_mempool_is_shared(pa_mempool *p);
+pa_bool_t pa_mempool_is_memfd_backed(pa_mempool *p);
+/* The fd to pass to the importing processes, which stays owned by the pool, or -1 */
+int pa_mempool_get_memfd_fd(pa_mempool *p);
 size_t pa_mempool_block_size_max(pa_mempool *p);
 
 /* For receiving blocks from other nodes */
 pa_memimport* pa_memimport_new(pa_mempool *p, pa_memimport_release_cb_t cb, void *userdata);
 void pa_memimport_free(pa_memimport *i);
 pa_memblock* pa_memimport_get(pa_memimport *i, uint32_t block_id, uint32_t shm_id, size_t offset, size_t size);
+/* Makes the memfd segment shm_id of the other side available for
+ * pa_memimport_get(). Always takes ownership of the fd. */
+int pa_memimport_attach_memfd(pa_memimport *i, uint32_t shm_id, int memfd_fd);
 int pa_memimport_process_revoke(pa_memimport *i, uint32_t block_id);
 
 /* For sending blocks to other nodes */
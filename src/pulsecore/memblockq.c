@@ -38,6 +38,12 @@
 
 /* #define MEMBLOCKQ_DEBUG */
 
+/* Queues created with pa_memblockq_new_ring() keep their blocks in a
+ * growable array, ordered by index and used as a ring, and don't use
+ * next/prev. Blocks are found by binary search, and appending at the
+ * end as well as dropping from the front is O(1). */
+#define RING_SIZE_MIN 16U
+
 struct list_item {
     struct list_item *next, *prev;
     int64_t index;
@@ -50,6 +56,9 @@ struct pa_memblockq {
     struct list_item *blocks, *blocks_tail;
     struct list_item *current_read, *current_write;
     unsigned n_blocks;
+    struct list_item *ring;
+    unsigned ring_size, ring_head, ring_read;
+    pa_bool_t use_ring;
     size_t maxlength, tlength, base, prebuf, minreq, maxrewind;
     int64_t read_index, write_index;
     pa_bool_t in_prebuf;
@@ -60,7 +69,9 @@ struct pa_memblockq {
     pa_sample_spec sample_spec;
 };
 
-pa_memblockq* pa_memblockq_new(
+#define RING(bq, k) (&(bq)->ring[((bq)->ring_head + (k)) & ((bq)->ring_size - 1)])
+
+static pa_memblockq* memblockq_new(
         const char *name,
         int64_t idx,
         size_t maxlength,
@@ -69,7 +80,8 @@ pa_memblockq* pa_memblockq_new(
         size_t prebuf,
         size_t minreq,
         size_t maxrewind,
-        pa_memchunk *silence) {
+        pa_memchunk *silence,
+        pa_bool_t use_ring) {
 
     pa_memblockq* bq;
 
@@ -82,6 +94,10 @@ pa_memblockq* pa_memblockq_new(
     bq->current_read = bq->current_write = NULL;
     bq->n_blocks = 0;
 
+    bq->use_ring = use_ring;
+    bq->ring = NULL;
+    bq->ring_size = bq->ring_head = bq->ring_read = 0;
+
     bq->sample_spec = *sample_spec;
     bq->base = pa_frame_size(sample_spec);
     bq->read_index = bq->write_index = idx;
@@ -113,6 +129,34 @@ pa_memblockq* pa_memblockq_new(
     return bq;
 }
 
+pa_memblockq* pa_memblockq_new(
+        const char *name,
+        int64_t idx,
+        size_t maxlength,
+        size_t tlength,
+        const pa_sample_spec *sample_spec,
+        size_t prebuf,
+        size_t minreq,
+        size_t maxrewind,
+        pa_memchunk *silence) {
+
+    return memblockq_new(name, idx, maxlength, tlength, sample_spec, prebuf, minreq, maxrewind, silence, FALSE);
+}
+
+pa_memblockq* pa_memblockq_new_ring(
+        const char *name,
+        int64_t idx,
+        size_t maxlength,
+        size_t tlength,
+        const pa_sample_spec *sample_spec,
+        size_t prebuf,
+        size_t minreq,
+        size_t maxrewind,
+        pa_memchunk *silence) {
+
+    return memblockq_new(name, idx, maxlength, tlength, sample_spec, prebuf, minreq, maxrewind, silence, TRUE);
+}
+
 void pa_memblockq_free(pa_memblockq* bq) {
     pa_assert(bq);
 
@@ -124,13 +168,152 @@ void pa_memblockq_free(pa_memblockq* bq) {
     if (bq->mcalign)
         pa_mcalign_free(bq->mcalign);
 
+    pa_xfree(bq->ring);
     pa_xfree(bq->name);
     pa_xfree(bq);
 }
 
+static inline int64_t block_end(struct list_item *q) {
+    return q->index + (int64_t) q->chunk.length;
+}
+
+static inline pa_bool_t ring_is_first_after(pa_memblockq *bq, unsigned k, int64_t idx) {
+    return k <= bq->n_blocks &&
+        (k >= bq->n_blocks || block_end(RING(bq, k)) > idx) &&
+        (k <= 0 || block_end(RING(bq, k - 1)) <= idx);
+}
+
+/* Returns the position of the first block in the ring that ends after
+ * idx, or n_blocks if there is none. *hint and the block after it are
+ * checked first, and *hint is updated, which makes sequential lookups
+ * O(1). */
+static unsigned ring_find(pa_memblockq *bq, int64_t idx, unsigned *hint) {
+    unsigned l, r;
+
+    pa_assert(bq);
+    pa_assert(hint);
+
+    if (ring_is_first_after(bq, *hint, idx))
+        return *hint;
+
+    if (ring_is_first_after(bq, *hint + 1, idx))
+        return ++*hint;
+
+    l = 0;
+    r = bq->n_blocks;
+
+    while (l < r) {
+        unsigned m = l + (r - l) / 2;
+
+        if (block_end(RING(bq, m)) > idx)
+            r = m;
+        else
+            l = m + 1;
+    }
+
+    return *hint = l;
+}
+
+static void ring_grow(pa_memblockq *bq) {
+    struct list_item *ring;
+    unsigned k, size;
+
+    pa_assert(bq);
+
+    size = PA_MAX(bq->ring_size * 2, RING_SIZE_MIN);
+    ring = pa_xnew(struct list_item, size);
+
+    for (k = 0; k < bq->n_blocks; k++)
+        ring[k] = *RING(bq, k);
+
+    pa_xfree(bq->ring);
+    bq->ring = ring;
+    bq->ring_size = size;
+    bq->ring_head = 0;
+}
+
+/* Inserts a copy of *item at position k, moving whichever side of the
+ * ring is shorter */
+static void ring_insert(pa_memblockq *bq, unsigned k, const struct list_item *item) {
+    unsigned j;
+
+    pa_assert(bq);
+    pa_assert(k <= bq->n_blocks);
+
+    if (bq->n_blocks >= bq->ring_size)
+        ring_grow(bq);
+
+    if (k < bq->n_blocks - k) {
+        bq->ring_head = (bq->ring_head - 1) & (bq->ring_size - 1);
+
+        for (j = 0; j < k; j++)
+            *RING(bq, j) = *RING(bq, j + 1);
+    } else
+        for (j = bq->n_blocks; j > k; j--)
+            *RING(bq, j) = *RING(bq, j - 1);
+
+    *RING(bq, k) = *item;
+    bq->n_blocks++;
+}
+
+/* Unreferences and removes m blocks starting at position k */
+static void ring_remove(pa_memblockq *bq, unsigned k, unsigned m) {
+    unsigned j;
+
+    pa_assert(bq);
+    pa_assert(k + m <= bq->n_blocks);
+
+    if (m <= 0)
+        return;
+
+    for (j = k; j < k + m; j++)
+        pa_memblock_unref(RING(bq, j)->chunk.memblock);
+
+    if (k < bq->n_blocks - k - m) {
+        for (j = k; j > 0; j--)
+            *RING(bq, j - 1 + m) = *RING(bq, j - 1);
+
+        bq->ring_head = (bq->ring_head + m) & (bq->ring_size - 1);
+    } else
+        for (j = k; j + m < bq->n_blocks; j++)
+            *RING(bq, j) = *RING(bq, j + m);
+
+    bq->n_blocks -= m;
+}
+
+static struct list_item *last_block(pa_memblockq *bq) {
+    pa_assert(bq);
+
+    if (!bq->use_ring)
+        return bq->blocks_tail;
+
+    return bq->n_blocks > 0 ? RING(bq, bq->n_blocks - 1) : NULL;
+}
+
+static struct list_item *next_block(pa_memblockq *bq, struct list_item *q) {
+    unsigned k;
+
+    pa_assert(bq);
+    pa_assert(q);
+
+    if (!bq->use_ring)
+        return q->next;
+
+    k = ((unsigned) (q - bq->ring) - bq->ring_head) & (bq->ring_size - 1);
+
+    return k + 1 < bq->n_blocks ? RING(bq, k + 1) : NULL;
+}
+
 static void fix_current_read(pa_memblockq *bq) {
     pa_assert(bq);
 
+    if (bq->use_ring) {
+        unsigned k = ring_find(bq, bq->read_index, &bq->ring_read);
+
+        bq->current_read = k < bq->n_blocks ? RING(bq, k) : NULL;
+        return;
+    }
+
     if (PA_UNLIKELY(!bq->blocks)) {
         bq->current_read = NULL;
         return;
@@ -224,11 +407,22 @@ static void drop_backlog(pa_memblockq *bq) {
 
     boundary = bq->read_index - (int64_t) bq->maxrewind;
 
+    if (bq->use_ring) {
+        unsigned m;
+
+        for (m = 0; m < bq->n_blocks && block_end(RING(bq, m)) <= boundary; m++)
+            ;
+
+        ring_remove(bq, 0, m);
+        return;
+    }
+
     while (bq->blocks && (bq->blocks->index + (int64_t) bq->blocks->chunk.length <= boundary))
         drop_block(bq, bq->blocks);
 }
 
 static pa_bool_t can_push(pa_memblockq *bq, size_t l) {
+    struct list_item *tail;
     int64_t end;
 
     pa_assert(bq);
@@ -242,7 +436,8 @@ static pa_bool_t can_push(pa_memblockq *bq, size_t l) {
             return TRUE;
     }
 
-    end = bq->blocks_tail ? bq->blocks_tail->index + (int64_t) bq->blocks_tail->chunk.length : bq->write_index;
+    tail = last_block(bq);
+    end = tail ? block_end(tail) : bq->write_index;
 
     /* Make sure that the list doesn't get too long */
     if (bq->write_index + (int64_t) l > end)
@@ -282,6 +477,80 @@ static void read_index_changed(pa_memblockq *bq, int64_t old_read_index) {
 #endif
 }
 
+/* pa_memblockq_push() for the ring, with the same effect on the
+ * blocks */
+static void ring_push(pa_memblockq *bq, const pa_memchunk *uchunk) {
+    struct list_item *q, n;
+    int64_t start, end;
+    unsigned k, m, hint;
+
+    start = bq->write_index;
+    end = start + (int64_t) uchunk->length;
+    n.chunk = *uchunk;
+
+    /* The write index usually points right behind the last block */
+    hint = bq->n_blocks;
+    k = ring_find(bq, start, &hint);
+
+    if (k < bq->n_blocks && (q = RING(bq, k))->index < start) {
+        /* The write index points into this block, so let's truncate
+         * it, after saving its end if that isn't overwritten */
+
+        if (block_end(q) > end) {
+            struct list_item p;
+            size_t d;
+
+            p = *q;
+            d = (size_t) (end - q->index);
+            p.index = end;
+            p.chunk.index += d;
+            p.chunk.length -= d;
+            pa_memblock_ref(p.chunk.memblock);
+
+            q->chunk.length = (size_t) (start - q->index);
+            ring_insert(bq, k + 1, &p);
+        } else
+            q->chunk.length = (size_t) (start - q->index);
+
+        k++;
+    }
+
+    /* Drop the blocks that are fully replaced by the new one */
+    for (m = 0; k + m < bq->n_blocks && block_end(RING(bq, k + m)) <= end; m++)
+        ;
+
+    ring_remove(bq, k, m);
+
+    /* Drop the beginning of a block that is overwritten at the end */
+    if (k < bq->n_blocks && (q = RING(bq, k))->index < end) {
+        size_t d;
+
+        d = (size_t) (end - q->index);
+        q->index += (int64_t) d;
+        q->chunk.index += d;
+        q->chunk.length -= d;
+    }
+
+    bq->write_index = end;
+
+    /* Try to merge memory blocks */
+    if (k > 0) {
+        q = RING(bq, k - 1);
+
+        if (q->chunk.memblock == n.chunk.memblock &&
+            q->chunk.index + q->chunk.length == n.chunk.index &&
+            block_end(q) == start) {
+
+            q->chunk.length += n.chunk.length;
+            return;
+        }
+    }
+
+    n.index = start;
+    pa_memblock_ref(n.chunk.memblock);
+    ring_insert(bq, k, &n);
+}
+
 int pa_memblockq_push(pa_memblockq* bq, const pa_memchunk *uchunk) {
     struct list_item *q, *n;
     pa_memchunk chunk;
@@ -300,6 +569,12 @@ int pa_memblockq_push(pa_memblockq* bq, const pa_memchunk *uchunk) {
         return -1;
 
     old = bq->write_index;
+
+    if (bq->use_ring) {
+        ring_push(bq, uchunk);
+        goto finish;
+    }
+
     chunk = *uchunk;
 
     fix_current_write(bq);
@@ -362,6 +637,7 @@ int pa_memblockq_push(pa_memblockq* bq, const pa_memchunk *uchunk) {
 
                 /* Drop it from the new entry */
                 p->index = q->index + (int64_t) d;
+                p->chunk.index += d;
                 p->chunk.length -= d;
 
                 /* Add it to the list */
@@ -590,7 +866,7 @@ int pa_memblockq_peek_fixed_size(pa_memblockq *bq, size_t block_size, pa_memchun
             tchunk.length -= (size_t) d;
 
             /* Go to next item for the next iteration */
-            item = item->next;
+            item = next_block(bq, item);
         }
 
         rchunk.length = tchunk.length = PA_MIN(tchunk.length, block_size - rchunk.index);
@@ -698,6 +974,7 @@ size_t pa_memblockq_missing(pa_memblockq *bq) {
 }
 
 void pa_memblockq_seek(pa_memblockq *bq, int64_t offset, pa_seek_mode_t seek, pa_bool_t account) {
+    struct list_item *tail;
     int64_t old;
     pa_assert(bq);
 
@@ -714,7 +991,8 @@ void pa_memblockq_seek(pa_memblockq *bq, int64_t offset, pa_seek_mode_t seek, pa
             bq->write_index = bq->read_index + offset;
             break;
         case PA_SEEK_RELATIVE_END:
-            bq->write_index = (bq->blocks_tail ? bq->blocks_tail->index + (int64_t) bq->blocks_tail->chunk.length : bq->read_index) + offset;
+            tail = last_block(bq);
+            bq->write_index = (tail ? block_end(tail) : bq->read_index) + offset;
             break;
         default:
             pa_assert_not_reached();
@@ -987,7 +1265,7 @@ void pa_memblockq_willneed(pa_memblockq *bq) {
 
     fix_current_read(bq);
 
-    for (q = bq->current_read; q; q = q->next)
+    for (q = bq->current_read; q; q = next_block(bq, q))
         pa_memchunk_will_need(&q->chunk);
 }
 
@@ -1007,12 +1285,15 @@ void pa_memblockq_set_silence(pa_memblockq *bq, pa_memchunk *silence) {
 pa_bool_t pa_memblockq_is_empty(pa_memblockq *bq) {
     pa_assert(bq);
 
-    return !bq->blocks;
+    return bq->n_blocks <= 0;
 }
 
 void pa_memblockq_silence(pa_memblockq *bq) {
     pa_assert(bq);
 
+    if (bq->use_ring)
+        ring_remove(bq, 0, bq->n_blocks);
+
     while (bq->blocks)
         drop_block(bq, bq->blocks);
 
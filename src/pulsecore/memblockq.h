@@ -77,6 +77,21 @@ pa_memblockq* pa_memblockq_new(
         size_t maxrewind,
         pa_memchunk *silence);
 
+/* Like pa_memblockq_new(), but the blocks are kept in a ring sorted by
+ * index instead of a linked list. Finding the block for an index after
+ * a seek or rewind is O(log n) instead of O(n), which is worth it for
+ * queues that are written with many seeks or hold lots of blocks. */
+pa_memblockq* pa_memblockq_new_ring(
+        const char *name,
+        int64_t idx,
+        size_t maxlength,
+        size_t tlength,
+        const pa_sample_spec *sample_spec,
+        size_t prebuf,
+        size_t minreq,
+        size_t maxrewind,
+        pa_memchunk *silence);
+
 void pa_memblockq_free(pa_memblockq*bq);
 
 /* Push a new memory chunk into the queue.  */
@@ -0,0 +1,165 @@
+/***
+  This file is part of PulseAudio.
+
+  Copyright 2004-2006 Lennart Poettering
+  Copyright 2009 Wim Taymans <wim.taymans@collabora.co.uk>
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "cpu-arm.h"
+
+#include "sample-util.h"
+
+#include <arm_neon.h>
+
+/* Number of samples that are accumulated for all streams before moving on.
+ * The accumulator for one tile has to stay in the L1 cache. */
+#define MIX_TILE 256
+
+/* Like in mix_sse.c, the volume index runs up to a multiple of the channel
+ * count that covers a whole loop iteration */
+static unsigned mix_period(unsigned channels, unsigned step) {
+    unsigned period = channels;
+
+    while (period < step)
+        period += channels;
+
+    return period;
+}
+
+static void accumulate_s16ne_neon(int32_t *acc, const int16_t *src, const int32_t *volumes, unsigned channel, unsigned period, unsigned n) {
+
+    for (; n >= 4; n -= 4) {
+        int32x4_t v = vmovl_s16(vld1_s16(src));
+        int32x4_t cv = vld1q_s32(volumes + channel);
+        int32x2_t lo, hi;
+
+        /* Multiplying the 32bit volume factor with the 16bit sample might
+         * result in an 48bit value, so do this in 64 bit and shift back */
+        lo = vshrn_n_s64(vmull_s32(vget_low_s32(v), vget_low_s32(cv)), 16);
+        hi = vshrn_n_s64(vmull_s32(vget_high_s32(v), vget_high_s32(cv)), 16);
+
+        vst1q_s32(acc, vaddq_s32(vld1q_s32(acc), vcombine_s32(lo, hi)));
+
+        src += 4;
+        acc += 4;
+
+        if ((channel += 4) >= period)
+            channel -= period;
+    }
+
+    for (; n > 0; n--) {
+        int32_t v, hi, lo;
+
+        hi = volumes[channel] >> 16;
+        lo = volumes[channel] & 0xFFFF;
+
+        v = *src++;
+        *acc++ += ((v * lo) >> 16) + (v * hi);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void accumulate_float32ne_neon(float *acc, const float *src, const float *volumes, unsigned channel, unsigned period, unsigned n) {
+
+    for (; n >= 4; n -= 4) {
+        float32x4_t v = vmulq_f32(vld1q_f32(src), vld1q_f32(volumes + channel));
+
+        vst1q_f32(acc, vaddq_f32(vld1q_f32(acc), v));
+
+        src += 4;
+        acc += 4;
+
+        if ((channel += 4) >= period)
+            channel -= period;
+    }
+
+    for (; n > 0; n--) {
+        *acc++ += *src++ * volumes[channel];
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void pa_mix_s16ne_neon(pa_mix_info streams[], unsigned nstreams, unsigned channels, int16_t *data, unsigned length) {
+    int32_t acc[MIX_TILE];
+    unsigned period, channel = 0;
+
+    period = mix_period(channels, 4);
+    length /= sizeof(int16_t);
+
+    while (length > 0) {
+        unsigned n = PA_MIN(length, (unsigned) MIX_TILE), i;
+
+        memset(acc, 0, n * sizeof(int32_t));
+
+        for (i = 0; i < nstreams; i++) {
+            accumulate_s16ne_neon(acc, streams[i].ptr, &streams[i].linear[0].i, channel, period, n);
+            streams[i].ptr = (int16_t*) streams[i].ptr + n;
+        }
+
+        for (i = 0; i + 4 <= n; i += 4)
+            vst1_s16(data + i, vqmovn_s32(vld1q_s32(acc + i)));
+        for (; i < n; i++)
+            data[i] = (int16_t) PA_CLAMP_UNLIKELY(acc[i], -0x8000, 0x7FFF);
+
+        data += n;
+        length -= n;
+        channel = (channel + n) % channels;
+    }
+}
+
+static void pa_mix_float32ne_neon(pa_mix_info streams[], unsigned nstreams, unsigned channels, float *data, unsigned length) {
+    unsigned period, channel = 0;
+
+    period = mix_period(channels, 4);
+    length /= sizeof(float);
+
+    while (length > 0) {
+        unsigned n = PA_MIN(length, (unsigned) MIX_TILE), i;
+
+        memset(data, 0, n * sizeof(float));
+
+        for (i = 0; i < nstreams; i++) {
+            accumulate_float32ne_neon(data, streams[i].ptr, &streams[i].linear[0].f, channel, period, n);
+            streams[i].ptr = (float*) streams[i].ptr + n;
+        }
+
+        data += n;
+        length -= n;
+        channel = (channel + n) % channels;
+    }
+}
+
+void pa_mix_func_init_neon(pa_cpu_arm_flag_t flags) {
+    pa_log_info("Initialising ARM NEON optimized mix functions.");
+
+    pa_set_mix_func(PA_SAMPLE_S16NE, (pa_do_mix_func_t) pa_mix_s16ne_neon);
+    pa_set_mix_func(PA_SAMPLE_FLOAT32NE, (pa_do_mix_func_t) pa_mix_float32ne_neon);
+}
@@ -0,0 +1,811 @@
+/***
+  This file is part of PulseAudio.
+
+  Copyright 2004-2006 Lennart Poettering
+  Copyright 2009 Wim Taymans <wim.taymans@collabora.co.uk>
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include <pulse/rtclock.h>
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/random.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/endianmacros.h>
+
+#include "cpu-x86.h"
+
+#include "sample-util.h"
+
+#if defined (__i386__) || defined (__amd64__)
+
+/* Number of samples that are accumulated for all streams before moving on.
+ * The accumulator for one tile has to stay in the L1 cache. */
+#define MIX_TILE 256
+
+typedef void (*accumulate_i32_func_t) (int32_t *acc, const void *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n);
+typedef void (*accumulate_i64_func_t) (int64_t *acc, const void *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n);
+typedef void (*accumulate_f32_func_t) (float *acc, const void *src, const float *volumes, pa_reg_x86 channel, unsigned period, unsigned n);
+
+/* The smallest multiple of the channel count that is at least as large as
+ * the number of samples processed per loop iteration. The volume index is
+ * kept below that, which allows us to wrap it with a single subtraction
+ * while reading the padded volumes of a whole iteration at once. */
+static unsigned mix_period(unsigned channels, unsigned step) {
+    unsigned period = channels;
+
+    while (period < step)
+        period += channels;
+
+    return period;
+}
+
+#define MIX_WRAP(inc, period) \
+      " add "#inc", %3                \n\t" /* channel += inc */            \
+      " cmp "#period", %3             \n\t"                                 \
+      " jb 3f                         \n\t"                                 \
+      " sub "#period", %3             \n\t" /* channel -= period */         \
+      "3:                             \n\t"
+
+/* Multiply 4 16 bit samples, zero extended to 32 bit, with 4 32 bit
+ * volumes. The 32 bit result is exact and ends up in v. */
+#define MIX_32x16(s,v)                     /* .. |   vh  |   vl  | */                   \
+      " pxor %%xmm5, %%xmm5          \n\t" /* .. |    0  |    0  | */                   \
+      " pcmpgtw "#s", %%xmm5         \n\t" /* .. |    0  | s(p0) | */                   \
+      " pand "#v", %%xmm5            \n\t" /* .. |    0  |  (vl) | */                   \
+      " movdqa "#s", %%xmm6          \n\t"                                              \
+      " pmulhuw "#v", "#s"           \n\t" /* .. |    0  | vl*p0 | */                   \
+      " psubd %%xmm5, "#s"           \n\t" /* .. |    0  | vl*p0 | + sign correct */    \
+      " psrld $16, "#v"              \n\t" /* .. |    0  |   vh  | */                   \
+      " pmaddwd %%xmm6, "#v"         \n\t" /* .. |    p0 * vh    | */                   \
+      " paddd "#s", "#v"             \n\t" /* .. |    p0 * v0    | */
+
+/* Arithmetic shift of 2 signed 64 bit values right by 16 bits */
+#define MIX_SRA64_16(s)                                                                 \
+      " pshufd $0xf5, "#s", %%xmm6   \n\t" /*  h1 |  h1 |  h0 |  h0 */                  \
+      " psrad $31, %%xmm6            \n\t" /* sign masks */                             \
+      " psrlq $16, "#s"              \n\t"                                              \
+      " psllq $48, %%xmm6            \n\t"                                              \
+      " por %%xmm6, "#s"             \n\t"
+
+/* Multiply 2 samples in the low halves of s with 2 volumes in the low halves
+ * of v and add the 64 bit results >> 16 to the accumulator at offs */
+#define MIX_32x32(s,v,offs)                                                             \
+      " pmuldq "#v", "#s"            \n\t" /*    p1 * v1  |    p0 * v0  */              \
+      MIX_SRA64_16(s)                                                                   \
+      " paddq "#offs"(%0), "#s"      \n\t"                                              \
+      " movdqa "#s", "#offs"(%0)     \n\t"
+
+static void accumulate_s16ne_sse2(int32_t *acc, const int16_t *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 8;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                             \n\t" /* do samples in groups of 8 */
+            " movdqu (%q4, %3, 4), %%xmm0   \n\t" /* |  v3h  |  v3l  ..  v0h  |  v0l  | */
+            " movdqu 16(%q4, %3, 4), %%xmm1 \n\t" /* |  v7h  |  v7l  ..  v4h  |  v4l  | */
+            " movdqu (%1), %%xmm2           \n\t" /* |   p7  ..  p0   | */
+            " pxor %%xmm4, %%xmm4           \n\t"
+            " movdqa %%xmm2, %%xmm3         \n\t"
+            " punpcklwd %%xmm4, %%xmm2      \n\t" /* |    0  |   p3  ..     0  |   p0  | */
+            " punpckhwd %%xmm4, %%xmm3      \n\t" /* |    0  |   p7  ..     0  |   p4  | */
+            MIX_32x16 (%%xmm2, %%xmm0)
+            MIX_32x16 (%%xmm3, %%xmm1)
+            " paddd (%0), %%xmm0            \n\t"
+            " paddd 16(%0), %%xmm1          \n\t"
+            " movdqa %%xmm0, (%0)           \n\t"
+            " movdqa %%xmm1, 16(%0)         \n\t"
+            " add $16, %1                   \n\t"
+            " add $32, %0                   \n\t"
+            MIX_WRAP ($8, %5)
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6"
+        );
+
+    for (n &= 7; n > 0; n--) {
+        int32_t v, hi, lo;
+
+        hi = volumes[channel] >> 16;
+        lo = volumes[channel] & 0xFFFF;
+
+        v = *src++;
+        *acc++ += ((v * lo) >> 16) + (v * hi);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void accumulate_float32ne_sse(float *acc, const float *src, const float *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 8;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                             \n\t" /* do samples in groups of 8 */
+            " movups (%q4, %3, 4), %%xmm0   \n\t" /* |   v3  ..   v0   | */
+            " movups 16(%q4, %3, 4), %%xmm1 \n\t" /* |   v7  ..   v4   | */
+            " movups (%1), %%xmm2           \n\t" /* |   p3  ..   p0   | */
+            " movups 16(%1), %%xmm3         \n\t" /* |   p7  ..   p4   | */
+            " mulps %%xmm2, %%xmm0          \n\t"
+            " mulps %%xmm3, %%xmm1          \n\t"
+            " movups (%0), %%xmm2           \n\t"
+            " movups 16(%0), %%xmm3         \n\t"
+            " addps %%xmm0, %%xmm2          \n\t"
+            " addps %%xmm1, %%xmm3          \n\t"
+            " movups %%xmm2, (%0)           \n\t"
+            " movups %%xmm3, 16(%0)         \n\t"
+            " add $32, %1                   \n\t"
+            " add $32, %0                   \n\t"
+            MIX_WRAP ($8, %5)
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3"
+        );
+
+    for (n &= 7; n > 0; n--) {
+        *acc++ += *src++ * volumes[channel];
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void accumulate_s32ne_sse4(int64_t *acc, const int32_t *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 4;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                             \n\t" /* do samples in groups of 4 */
+            " pmovzxdq (%q4, %3, 4), %%xmm0 \n\t" /* |    0  |   v1  |    0  |   v0  | */
+            " pmovzxdq 8(%q4, %3, 4), %%xmm1\n\t" /* |    0  |   v3  |    0  |   v2  | */
+            " pmovzxdq (%1), %%xmm2         \n\t" /* |    0  |   p1  |    0  |   p0  | */
+            " pmovzxdq 8(%1), %%xmm3        \n\t" /* |    0  |   p3  |    0  |   p2  | */
+            MIX_32x32 (%%xmm2, %%xmm0, 0)
+            MIX_32x32 (%%xmm3, %%xmm1, 16)
+            " add $16, %1                   \n\t"
+            " add $32, %0                   \n\t"
+            MIX_WRAP ($4, %5)
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6"
+        );
+
+    for (n &= 3; n > 0; n--) {
+        *acc++ += ((int64_t) *src++ * volumes[channel]) >> 16;
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void accumulate_s24_32ne_sse4(int64_t *acc, const uint32_t *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 4;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                             \n\t" /* do samples in groups of 4 */
+            " pmovzxdq (%q4, %3, 4), %%xmm0 \n\t" /* |    0  |   v1  |    0  |   v0  | */
+            " pmovzxdq 8(%q4, %3, 4), %%xmm1\n\t" /* |    0  |   v3  |    0  |   v2  | */
+            " pmovzxdq (%1), %%xmm2         \n\t" /* |    0  |   p1  |    0  |   p0  | */
+            " pmovzxdq 8(%1), %%xmm3        \n\t" /* |    0  |   p3  |    0  |   p2  | */
+            " pslld $8, %%xmm2              \n\t" /* sign extend 24 bit samples to 32 bit */
+            " pslld $8, %%xmm3              \n\t"
+            MIX_32x32 (%%xmm2, %%xmm0, 0)
+            MIX_32x32 (%%xmm3, %%xmm1, 16)
+            " add $16, %1                   \n\t"
+            " add $32, %0                   \n\t"
+            MIX_WRAP ($4, %5)
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6"
+        );
+
+    for (n &= 3; n > 0; n--) {
+        *acc++ += ((int64_t) (int32_t) (*src++ << 8) * volumes[channel]) >> 16;
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+/* Moves 3 byte samples 0 and 1 into the upper 24 bits of the 2 low dwords */
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24_shuffle_lo[16]) = {
+    0x80, 0, 1, 2, 0x80, 0x80, 0x80, 0x80, 0x80, 3, 4, 5, 0x80, 0x80, 0x80, 0x80
+};
+
+/* Same for samples 2 and 3 */
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24_shuffle_hi[16]) = {
+    0x80, 6, 7, 8, 0x80, 0x80, 0x80, 0x80, 0x80, 9, 10, 11, 0x80, 0x80, 0x80, 0x80
+};
+
+static void accumulate_s24ne_sse4(int64_t *acc, const uint8_t *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 4;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            " movdqa %6, %%xmm4             \n\t"
+            " movdqa %7, %%xmm5             \n\t"
+
+            "1:                             \n\t" /* do samples in groups of 4 */
+            " pmovzxdq (%q4, %3, 4), %%xmm0 \n\t" /* |    0  |   v1  |    0  |   v0  | */
+            " pmovzxdq 8(%q4, %3, 4), %%xmm1\n\t" /* |    0  |   v3  |    0  |   v2  | */
+            " movq (%1), %%xmm2             \n\t" /* read 12 bytes without overreading */
+            " movd 8(%1), %%xmm3            \n\t"
+            " punpcklqdq %%xmm3, %%xmm2     \n\t"
+            " movdqa %%xmm2, %%xmm3         \n\t"
+            " pshufb %%xmm4, %%xmm2         \n\t" /* |    0  | p1<<8 |    0  | p0<<8 | */
+            " pshufb %%xmm5, %%xmm3         \n\t" /* |    0  | p3<<8 |    0  | p2<<8 | */
+            MIX_32x32 (%%xmm2, %%xmm0, 0)
+            MIX_32x32 (%%xmm3, %%xmm1, 16)
+            " add $12, %1                   \n\t"
+            " add $32, %0                   \n\t"
+            MIX_WRAP ($4, %5)
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period),
+#else
+              "r" ((pa_reg_x86)period),
+#endif
+              "m" (*s24_shuffle_lo), "m" (*s24_shuffle_hi)
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6"
+        );
+
+    for (n &= 3; n > 0; n--) {
+        *acc++ += ((int64_t) (int32_t) (PA_READ24NE(src) << 8) * volumes[channel]) >> 16;
+        src += 3;
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+/* AVX2 variant of MIX_32x16 for 8 samples */
+#define MIX_32x16_AVX2(s,v)                                                             \
+      " vpxor %%ymm5, %%ymm5, %%ymm5        \n\t"                                       \
+      " vpcmpgtw "#s", %%ymm5, %%ymm5       \n\t" /* s(p) */                            \
+      " vpand "#v", %%ymm5, %%ymm5          \n\t" /* (vl) */                            \
+      " vpmulhuw "#v", "#s", %%ymm6         \n\t" /* vl*p */                            \
+      " vpsubd %%ymm5, %%ymm6, %%ymm6       \n\t" /* vl*p + sign correct */             \
+      " vpsrld $16, "#v", "#v"              \n\t" /* vh */                              \
+      " vpmaddwd "#s", "#v", "#v"           \n\t" /* p * vh */                          \
+      " vpaddd %%ymm6, "#v", "#v"           \n\t" /* p * v */
+
+/* AVX2 variant of MIX_32x32 for 4 samples */
+#define MIX_32x32_AVX2(s,v,offs)                                                        \
+      " vpmuldq "#v", "#s", "#s"            \n\t"                                       \
+      " vpshufd $0xf5, "#s", %%ymm6         \n\t"                                       \
+      " vpsrad $31, %%ymm6, %%ymm6          \n\t"                                       \
+      " vpsrlq $16, "#s", "#s"              \n\t"                                       \
+      " vpsllq $48, %%ymm6, %%ymm6          \n\t"                                       \
+      " vpor %%ymm6, "#s", "#s"             \n\t"                                       \
+      " vpaddq "#offs"(%0), "#s", "#s"      \n\t"                                       \
+      " vmovdqu "#s", "#offs"(%0)           \n\t"
+
+static void accumulate_s16ne_avx2(int32_t *acc, const int16_t *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 16;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                                  \n\t" /* do samples in groups of 16 */
+            " vmovdqu (%q4, %3, 4), %%ymm0       \n\t" /* v7 .. v0 */
+            " vmovdqu 32(%q4, %3, 4), %%ymm1     \n\t" /* v15 .. v8 */
+            " vpmovzxwd (%1), %%ymm2             \n\t" /* p7 .. p0, zero extended */
+            " vpmovzxwd 16(%1), %%ymm3           \n\t" /* p15 .. p8, zero extended */
+            MIX_32x16_AVX2 (%%ymm2, %%ymm0)
+            MIX_32x16_AVX2 (%%ymm3, %%ymm1)
+            " vpaddd (%0), %%ymm0, %%ymm0        \n\t"
+            " vpaddd 32(%0), %%ymm1, %%ymm1      \n\t"
+            " vmovdqu %%ymm0, (%0)               \n\t"
+            " vmovdqu %%ymm1, 32(%0)             \n\t"
+            " add $32, %1                        \n\t"
+            " add $64, %0                        \n\t"
+            MIX_WRAP ($16, %5)
+            " dec %2                             \n\t"
+            " jne 1b                             \n\t"
+            " vzeroupper                         \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6"
+        );
+
+    for (n &= 15; n > 0; n--) {
+        int32_t v, hi, lo;
+
+        hi = volumes[channel] >> 16;
+        lo = volumes[channel] & 0xFFFF;
+
+        v = *src++;
+        *acc++ += ((v * lo) >> 16) + (v * hi);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void accumulate_float32ne_avx(float *acc, const float *src, const float *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 16;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                                  \n\t" /* do samples in groups of 16 */
+            " vmovups (%q4, %3, 4), %%ymm0       \n\t" /* v7 .. v0 */
+            " vmovups 32(%q4, %3, 4), %%ymm1     \n\t" /* v15 .. v8 */
+            " vmulps (%1), %%ymm0, %%ymm0        \n\t"
+            " vmulps 32(%1), %%ymm1, %%ymm1      \n\t"
+            " vaddps (%0), %%ymm0, %%ymm0        \n\t"
+            " vaddps 32(%0), %%ymm1, %%ymm1      \n\t"
+            " vmovups %%ymm0, (%0)               \n\t"
+            " vmovups %%ymm1, 32(%0)             \n\t"
+            " add $64, %1                        \n\t"
+            " add $64, %0                        \n\t"
+            MIX_WRAP ($16, %5)
+            " dec %2                             \n\t"
+            " jne 1b                             \n\t"
+            " vzeroupper                         \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1"
+        );
+
+    for (n &= 15; n > 0; n--) {
+        *acc++ += *src++ * volumes[channel];
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void accumulate_s32ne_avx2(int64_t *acc, const int32_t *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 8;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                                  \n\t" /* do samples in groups of 8 */
+            " vpmovzxdq (%q4, %3, 4), %%ymm0     \n\t" /* v3 .. v0, zero extended */
+            " vpmovzxdq 16(%q4, %3, 4), %%ymm1   \n\t" /* v7 .. v4, zero extended */
+            " vpmovzxdq (%1), %%ymm2             \n\t" /* p3 .. p0, zero extended */
+            " vpmovzxdq 16(%1), %%ymm3           \n\t" /* p7 .. p4, zero extended */
+            MIX_32x32_AVX2 (%%ymm2, %%ymm0, 0)
+            MIX_32x32_AVX2 (%%ymm3, %%ymm1, 32)
+            " add $32, %1                        \n\t"
+            " add $64, %0                        \n\t"
+            MIX_WRAP ($8, %5)
+            " dec %2                             \n\t"
+            " jne 1b                             \n\t"
+            " vzeroupper                         \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6"
+        );
+
+    for (n &= 7; n > 0; n--) {
+        *acc++ += ((int64_t) *src++ * volumes[channel]) >> 16;
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void accumulate_s24_32ne_avx2(int64_t *acc, const uint32_t *src, const int32_t *volumes, pa_reg_x86 channel, unsigned period, unsigned n) {
+    pa_reg_x86 groups = n / 8;
+
+    if (groups > 0)
+        __asm__ __volatile__ (
+            "1:                                  \n\t" /* do samples in groups of 8 */
+            " vpmovzxdq (%q4, %3, 4), %%ymm0     \n\t" /* v3 .. v0, zero extended */
+            " vpmovzxdq 16(%q4, %3, 4), %%ymm1   \n\t" /* v7 .. v4, zero extended */
+            " vpmovzxdq (%1), %%ymm2             \n\t" /* p3 .. p0, zero extended */
+            " vpmovzxdq 16(%1), %%ymm3           \n\t" /* p7 .. p4, zero extended */
+            " vpslld $8, %%ymm2, %%ymm2          \n\t" /* sign extend 24 bit samples to 32 bit */
+            " vpslld $8, %%ymm3, %%ymm3          \n\t"
+            MIX_32x32_AVX2 (%%ymm2, %%ymm0, 0)
+            MIX_32x32_AVX2 (%%ymm3, %%ymm1, 32)
+            " add $32, %1                        \n\t"
+            " add $64, %0                        \n\t"
+            MIX_WRAP ($8, %5)
+            " dec %2                             \n\t"
+            " jne 1b                             \n\t"
+            " vzeroupper                         \n\t"
+
+            : "+r" (acc), "+r" (src), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6"
+        );
+
+    for (n &= 7; n > 0; n--) {
+        *acc++ += ((int64_t) (int32_t) (*src++ << 8) * volumes[channel]) >> 16;
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+/* The accumulate functions that are used by the mix functions below. They
+ * are picked in pa_mix_func_init_sse(), depending on the CPU flags. */
+static accumulate_i32_func_t accumulate_s16ne;
+static accumulate_f32_func_t accumulate_float32ne;
+static accumulate_i64_func_t accumulate_s32ne;
+static accumulate_i64_func_t accumulate_s24_32ne;
+static accumulate_i64_func_t accumulate_s24ne;
+static unsigned step_s16ne, step_float32ne, step_s32ne;
+
+/* Loop over the data in tiles, so that the accumulator stays in cache while
+ * all streams are added to it, then clamp the result into the destination.
+ * Each stream only has its data read once. */
+static void pa_mix_s16ne_sse(pa_mix_info streams[], unsigned nstreams, unsigned channels, int16_t *data, unsigned length) {
+    PA_DECLARE_ALIGNED (32, int32_t, acc[MIX_TILE]);
+    unsigned period, channel = 0;
+
+    period = mix_period(channels, step_s16ne);
+    length /= sizeof(int16_t);
+
+    while (length > 0) {
+        unsigned n = PA_MIN(length, (unsigned) MIX_TILE), i;
+
+        memset(acc, 0, n * sizeof(int32_t));
+
+        for (i = 0; i < nstreams; i++) {
+            accumulate_s16ne(acc, streams[i].ptr, &streams[i].linear[0].i, channel, period, n);
+            streams[i].ptr = (int16_t*) streams[i].ptr + n;
+        }
+
+        for (i = 0; i < n; i++)
+            data[i] = (int16_t) PA_CLAMP_UNLIKELY(acc[i], -0x8000, 0x7FFF);
+
+        data += n;
+        length -= n;
+        channel = (channel + n) % channels;
+    }
+}
+
+static void pa_mix_float32ne_sse(pa_mix_info streams[], unsigned nstreams, unsigned channels, float *data, unsigned length) {
+    unsigned period, channel = 0;
+
+    period = mix_period(channels, step_float32ne);
+    length /= sizeof(float);
+
+    /* Floats don't need clamping, so we accumulate right into the
+     * destination */
+    while (length > 0) {
+        unsigned n = PA_MIN(length, (unsigned) MIX_TILE), i;
+
+        memset(data, 0, n * sizeof(float));
+
+        for (i = 0; i < nstreams; i++) {
+            accumulate_float32ne(data, streams[i].ptr, &streams[i].linear[0].f, channel, period, n);
+            streams[i].ptr = (float*) streams[i].ptr + n;
+        }
+
+        data += n;
+        length -= n;
+        channel = (channel + n) % channels;
+    }
+}
+
+static void mix_i64_tiles(pa_mix_info streams[], unsigned nstreams, unsigned channels, unsigned length, size_t sample_size,
+                          accumulate_i64_func_t accumulate, int64_t *acc, unsigned *channel) {
+    unsigned i, period;
+
+    period = mix_period(channels, step_s32ne);
+
+    memset(acc, 0, length * sizeof(int64_t));
+
+    for (i = 0; i < nstreams; i++) {
+        accumulate(acc, streams[i].ptr, &streams[i].linear[0].i, *channel, period, length);
+        streams[i].ptr = (uint8_t*) streams[i].ptr + length * sample_size;
+    }
+
+    *channel = (*channel + length) % channels;
+}
+
+static void pa_mix_s32ne_sse(pa_mix_info streams[], unsigned nstreams, unsigned channels, int32_t *data, unsigned length) {
+    PA_DECLARE_ALIGNED (32, int64_t, acc[MIX_TILE]);
+    unsigned channel = 0;
+
+    length /= sizeof(int32_t);
+
+    while (length > 0) {
+        unsigned n = PA_MIN(length, (unsigned) MIX_TILE), i;
+
+        mix_i64_tiles(streams, nstreams, channels, n, sizeof(int32_t), accumulate_s32ne, acc, &channel);
+
+        for (i = 0; i < n; i++)
+            data[i] = (int32_t) PA_CLAMP_UNLIKELY(acc[i], -0x80000000LL, 0x7FFFFFFFLL);
+
+        data += n;
+        length -= n;
+    }
+}
+
+static void pa_mix_s24_32ne_sse(pa_mix_info streams[], unsigned nstreams, unsigned channels, uint32_t *data, unsigned length) {
+    PA_DECLARE_ALIGNED (32, int64_t, acc[MIX_TILE]);
+    unsigned channel = 0;
+
+    length /= sizeof(uint32_t);
+
+    while (length > 0) {
+        unsigned n = PA_MIN(length, (unsigned) MIX_TILE), i;
+
+        mix_i64_tiles(streams, nstreams, channels, n, sizeof(uint32_t), accumulate_s24_32ne, acc, &channel);
+
+        for (i = 0; i < n; i++)
+            data[i] = ((uint32_t) (int32_t) PA_CLAMP_UNLIKELY(acc[i], -0x80000000LL, 0x7FFFFFFFLL)) >> 8;
+
+        data += n;
+        length -= n;
+    }
+}
+
+static void pa_mix_s24ne_sse(pa_mix_info streams[], unsigned nstreams, unsigned channels, uint8_t *data, unsigned length) {
+    PA_DECLARE_ALIGNED (32, int64_t, acc[MIX_TILE]);
+    unsigned channel = 0;
+
+    length /= 3;
+
+    while (length > 0) {
+        unsigned n = PA_MIN(length, (unsigned) MIX_TILE), i;
+
+        mix_i64_tiles(streams, nstreams, channels, n, 3, accumulate_s24ne, acc, &channel);
+
+        for (i = 0; i < n; i++, data += 3)
+            PA_WRITE24NE(data, ((uint32_t) PA_CLAMP_UNLIKELY(acc[i], -0x80000000LL, 0x7FFFFFFFLL)) >> 8);
+
+        length -= n;
+    }
+}
+
+#undef RUN_TEST
+
+#ifdef RUN_TEST
+#define SAMPLES 1021
+#define STREAMS 5
+#define TIMES 300
+#define TIMES2 10
+
+static void run_test_format(pa_sample_format_t f, pa_do_mix_func_t ref, pa_do_mix_func_t func, unsigned channels) {
+    pa_sample_spec ss;
+    pa_mix_info streams[STREAMS];
+    uint8_t *in[STREAMS], *out, *out_ref;
+    size_t size;
+    unsigned i, c;
+    int j, k;
+    pa_usec_t start, stop;
+    pa_usec_t min = INT_MAX, max = 0;
+    double s1 = 0, s2 = 0;
+
+    ss.format = f;
+    ss.channels = (uint8_t) channels;
+    ss.rate = 44100;
+    size = pa_frame_align(SAMPLES * pa_sample_size(&ss), &ss);
+
+    out = pa_xmalloc(size);
+    out_ref = pa_xmalloc(size);
+
+    for (i = 0; i < STREAMS; i++) {
+        in[i] = pa_xmalloc(size);
+        pa_random(in[i], size);
+
+        if (f == PA_SAMPLE_FLOAT32NE) {
+            float *p = (float*) in[i];
+            unsigned s;
+
+            for (s = 0; s < size / sizeof(float); s++)
+                p[s] = 2.1f * (rand()/(float) RAND_MAX - 0.5f);
+        }
+
+        for (c = 0; c < channels; c++) {
+            if (f == PA_SAMPLE_FLOAT32NE)
+                streams[i].linear[c].f = (float) (rand()/(double) RAND_MAX * 2.0);
+            else
+                streams[i].linear[c].i = (int32_t) PA_CLAMP_VOLUME((pa_volume_t) (rand() >> 14));
+        }
+        for (; c < channels + PA_MIX_VOLUME_PADDING; c++)
+            streams[i].linear[c] = streams[i].linear[c - channels];
+    }
+
+    for (i = 0; i < STREAMS; i++)
+        streams[i].ptr = in[i];
+    ref(streams, STREAMS, channels, out_ref, (unsigned) size);
+
+    for (i = 0; i < STREAMS; i++)
+        streams[i].ptr = in[i];
+    func(streams, STREAMS, channels, out, (unsigned) size);
+
+    if (memcmp(out, out_ref, size) != 0)
+        pa_log_error("%s, %u channels: optimized mix differs from reference", pa_sample_format_to_string(f), channels);
+    else
+        pa_log_info("%s, %u channels: ok", pa_sample_format_to_string(f), channels);
+
+    for (k = 0; k < TIMES2; k++) {
+        start = pa_rtclock_now();
+        for (j = 0; j < TIMES; j++) {
+            for (i = 0; i < STREAMS; i++)
+                streams[i].ptr = in[i];
+            func(streams, STREAMS, channels, out, (unsigned) size);
+        }
+        stop = pa_rtclock_now();
+
+        if (min > (stop - start)) min = stop - start;
+        if (max < (stop - start)) max = stop - start;
+        s1 += stop - start;
+        s2 += (stop - start) * (stop - start);
+    }
+    pa_log_info("SSE: %llu usec (min = %llu, max = %llu, stddev = %g).", (long long unsigned int)s1,
+            (long long unsigned int)min, (long long unsigned int)max, sqrt(TIMES2 * s2 - s1 * s1) / TIMES2);
+
+    min = INT_MAX; max = 0;
+    s1 = s2 = 0;
+    for (k = 0; k < TIMES2; k++) {
+        start = pa_rtclock_now();
+        for (j = 0; j < TIMES; j++) {
+            for (i = 0; i < STREAMS; i++)
+                streams[i].ptr = in[i];
+            ref(streams, STREAMS, channels, out_ref, (unsigned) size);
+        }
+        stop = pa_rtclock_now();
+
+        if (min > (stop - start)) min = stop - start;
+        if (max < (stop - start)) max = stop - start;
+        s1 += stop - start;
+        s2 += (stop - start) * (stop - start);
+    }
+    pa_log_info("ref: %llu usec (min = %llu, max = %llu, stddev = %g).", (long long unsigned int)s1,
+            (long long unsigned int)min, (long long unsigned int)max, sqrt(TIMES2 * s2 - s1 * s1) / TIMES2);
+
+    for (i = 0; i < STREAMS; i++)
+        pa_xfree(in[i]);
+    pa_xfree(out);
+    pa_xfree(out_ref);
+}
+
+static void run_test(void) {
+    unsigned channels;
+
+    printf("checking SSE mix functions\n");
+
+    for (channels = 1; channels <= 8; channels++) {
+        run_test_format(PA_SAMPLE_S16NE, pa_get_mix_func(PA_SAMPLE_S16NE), (pa_do_mix_func_t) pa_mix_s16ne_sse, channels);
+        run_test_format(PA_SAMPLE_FLOAT32NE, pa_get_mix_func(PA_SAMPLE_FLOAT32NE), (pa_do_mix_func_t) pa_mix_float32ne_sse, channels);
+
+        if (!accumulate_s32ne)
+            continue;
+
+        run_test_format(PA_SAMPLE_S32NE, pa_get_mix_func(PA_SAMPLE_S32NE), (pa_do_mix_func_t) pa_mix_s32ne_sse, channels);
+        run_test_format(PA_SAMPLE_S24_32NE, pa_get_mix_func(PA_SAMPLE_S24_32NE), (pa_do_mix_func_t) pa_mix_s24_32ne_sse, channels);
+        run_test_format(PA_SAMPLE_S24NE, pa_get_mix_func(PA_SAMPLE_S24NE), (pa_do_mix_func_t) pa_mix_s24ne_sse, channels);
+    }
+}
+#endif
+#endif /* defined (__i386__) || defined (__amd64__) */
+
+void pa_mix_func_init_sse(pa_cpu_x86_flag_t flags) {
+#if defined (__i386__) || defined (__amd64__)
+
+    if (!(flags & PA_CPU_X86_SSE2))
+        return;
+
+    accumulate_s16ne = (accumulate_i32_func_t) accumulate_s16ne_sse2;
+    accumulate_float32ne = (accumulate_f32_func_t) accumulate_float32ne_sse;
+    step_s16ne = step_float32ne = 8;
+
+    if ((flags & PA_CPU_X86_SSE4_1) && (flags & PA_CPU_X86_SSSE3)) {
+        accumulate_s32ne = (accumulate_i64_func_t) accumulate_s32ne_sse4;
+        accumulate_s24_32ne = (accumulate_i64_func_t) accumulate_s24_32ne_sse4;
+        accumulate_s24ne = (accumulate_i64_func_t) accumulate_s24ne_sse4;
+        step_s32ne = 4;
+    }
+
+    if (flags & PA_CPU_X86_AVX) {
+        accumulate_float32ne = (accumulate_f32_func_t) accumulate_float32ne_avx;
+        step_float32ne = 16;
+    }
+
+    if ((flags & PA_CPU_X86_AVX2) && accumulate_s32ne) {
+        accumulate_s16ne = (accumulate_i32_func_t) accumulate_s16ne_avx2;
+        accumulate_s32ne = (accumulate_i64_func_t) accumulate_s32ne_avx2;
+        accumulate_s24_32ne = (accumulate_i64_func_t) accumulate_s24_32ne_avx2;
+        step_s16ne = 16;
+        step_s32ne = 8;
+    }
+
+#ifdef RUN_TEST
+    run_test();
+#endif
+
+    pa_log_info("Initialising %s optimized mix functions.",
+                (flags & PA_CPU_X86_AVX2) ? "AVX2" : (flags & PA_CPU_X86_SSE4_1) ? "SSE4.1" : "SSE2");
+
+    pa_set_mix_func(PA_SAMPLE_S16NE, (pa_do_mix_func_t) pa_mix_s16ne_sse);
+    pa_set_mix_func(PA_SAMPLE_FLOAT32NE, (pa_do_mix_func_t) pa_mix_float32ne_sse);
+
+    if (accumulate_s32ne) {
+        pa_set_mix_func(PA_SAMPLE_S32NE, (pa_do_mix_func_t) pa_mix_s32ne_sse);
+        pa_set_mix_func(PA_SAMPLE_S24_32NE, (pa_do_mix_func_t) pa_mix_s24_32ne_sse);
+        pa_set_mix_func(PA_SAMPLE_S24NE, (pa_do_mix_func_t) pa_mix_s24ne_sse);
+    }
+#endif /* defined (__i386__) || defined (__amd64__) */
+}
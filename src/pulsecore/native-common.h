@@ -28,6 +28,17 @@
 
 PA_C_DECL_BEGIN
 
+/* Starting with protocol version 13 the upper bits of the version
+ * exchanged with PA_COMMAND_AUTH are flags. The SHM flag says if SHM
+ * is possible, since version 28 the memfd flag says if the sender
+ * accepts memfd segments passed over the socket, and since version 29
+ * the srbchannel flag says if the client takes a shared ringbuffer
+ * with PA_COMMAND_ENABLE_SRBCHANNEL. */
+#define PA_PROTOCOL_FLAG_SHM 0x80000000U
+#define PA_PROTOCOL_FLAG_MEMFD 0x40000000U
+#define PA_PROTOCOL_FLAG_SRBCHANNEL 0x20000000U
+#define PA_PROTOCOL_VERSION_MASK 0x0000FFFFU
+
 enum {
     /* Generic commands */
     PA_COMMAND_ERROR,
@@ -176,6 +187,15 @@ enum {
     /* Supported since protocol v27 (3.0) */
     PA_COMMAND_SET_PORT_LATENCY_OFFSET,
 
+    /* Supported since protocol v29 */
+    PA_COMMAND_ENABLE_SRBCHANNEL,
+
+    /* Supported since protocol v31 */
+    PA_COMMAND_GET_SINK_IO_STATS,
+    PA_COMMAND_GET_SOURCE_IO_STATS,
+    PA_COMMAND_GET_SINK_INPUT_IO_STATS,
+    PA_COMMAND_GET_SOURCE_OUTPUT_IO_STATS,
+
     PA_COMMAND_MAX
 };
 
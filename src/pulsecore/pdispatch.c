@@ -190,6 +190,15 @@ static const char *command_names[PA_COMMAND_MAX] = {
     [PA_COMMAND_SET_SOURCE_OUTPUT_VOLUME] = "SET_SOURCE_OUTPUT_VOLUME",
     [PA_COMMAND_SET_SOURCE_OUTPUT_MUTE] = "SET_SOURCE_OUTPUT_MUTE",
 
+    /* Supported since protocol v29 */
+    [PA_COMMAND_ENABLE_SRBCHANNEL] = "ENABLE_SRBCHANNEL",
+
+    /* Supported since protocol v31 */
+    [PA_COMMAND_GET_SINK_IO_STATS] = "GET_SINK_IO_STATS",
+    [PA_COMMAND_GET_SOURCE_IO_STATS] = "GET_SOURCE_IO_STATS",
+    [PA_COMMAND_GET_SINK_INPUT_IO_STATS] = "GET_SINK_INPUT_IO_STATS",
+    [PA_COMMAND_GET_SOURCE_OUTPUT_IO_STATS] = "GET_SOURCE_OUTPUT_IO_STATS",
+
 };
 
 #endif
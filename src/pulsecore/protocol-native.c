@@ -32,12 +32,15 @@
 #include <pulse/rtclock.h>
 #include <pulse/timeval.h>
 #include <pulse/version.h>
+#include <pulse/introspect.h>
 #include <pulse/utf8.h>
 #include <pulse/util.h>
 #include <pulse/xmalloc.h>
 #include <pulse/internal.h>
 
 #include <pulsecore/native-common.h>
+#include <pulsecore/shm.h>
+#include <pulsecore/srbchannel.h>
 #include <pulsecore/packet.h>
 #include <pulsecore/client.h>
 #include <pulsecore/source-output.h>
@@ -173,6 +176,7 @@ struct pa_native_connection {
     pa_native_options *options;
     pa_bool_t authorized:1;
     pa_bool_t is_local:1;
+    pa_bool_t srbchannel_enabled:1;
     uint32_t version;
     pa_client *client;
     pa_pstream *pstream;
@@ -293,6 +297,7 @@ static void command_extension(pa_pdispatch *pd, uint32_t command, uint32_t tag,
 static void command_set_card_profile(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 static void command_set_sink_or_source_port(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 static void command_set_port_latency_offset(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
+static void command_get_io_stats(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata);
 
 static const pa_pdispatch_cb_t command_table[PA_COMMAND_MAX] = {
     [PA_COMMAND_ERROR] = NULL,
@@ -396,6 +401,11 @@ static const pa_pdispatch_cb_t command_table[PA_COMMAND_MAX] = {
 
     [PA_COMMAND_SET_PORT_LATENCY_OFFSET] = command_set_port_latency_offset,
 
+    [PA_COMMAND_GET_SINK_IO_STATS] = command_get_io_stats,
+    [PA_COMMAND_GET_SOURCE_IO_STATS] = command_get_io_stats,
+    [PA_COMMAND_GET_SINK_INPUT_IO_STATS] = command_get_io_stats,
+    [PA_COMMAND_GET_SOURCE_OUTPUT_IO_STATS] = command_get_io_stats,
+
     [PA_COMMAND_EXTENSION] = command_extension
 };
 
@@ -511,6 +521,7 @@ static int record_stream_process_msg(pa_msgobject *o, int code, void*userdata, i
 
             if (pa_memblockq_push_align(s->memblockq, chunk) < 0) {
 /*                 pa_log_warn("Failed to push data into output queue."); */
+                pa_io_stats_xrun(&s->source_output->io_stats);
                 return -1;
             }
 
@@ -1186,7 +1197,8 @@ static playback_stream* playback_stream_new(
 
     pa_sink_input_get_silence(sink_input, &silence);
     memblockq_name = pa_sprintf_malloc("native protocol playback stream memblockq [%u]", s->sink_input->index);
-    s->memblockq = pa_memblockq_new(
+    /* Clients may seek around in it a lot, so use the ring */
+    s->memblockq = pa_memblockq_new_ring(
             memblockq_name,
             start_index,
             s->buffer_attr.maxlength,
@@ -2532,11 +2544,40 @@ static void command_exit(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_ta
     pa_pstream_send_simple_ack(c->pstream, tag); /* nonsense */
 }
 
+/* Hands a shared ringbuffer to the client, through which all further
+ * frames go in both directions */
+static void setup_srbchannel(pa_native_connection *c) {
+#ifdef HAVE_SRBCHANNEL
+    pa_srbchannel *srb;
+    pa_tagstruct *t;
+    int fds[PA_SRBCHANNEL_FDS_MAX];
+
+    if (!(srb = pa_srbchannel_new(c->protocol->core->mainloop))) {
+        pa_log_debug("Failed to create srbchannel, continuing on the socket.");
+        return;
+    }
+
+    pa_srbchannel_get_fds(srb, fds);
+
+    t = pa_tagstruct_new(NULL, 0);
+    pa_tagstruct_putu32(t, PA_COMMAND_ENABLE_SRBCHANNEL);
+    pa_tagstruct_putu32(t, (uint32_t) -1); /* tag */
+
+    if (pa_pstream_send_tagstruct_with_fds(c->pstream, t, fds, PA_SRBCHANNEL_FDS_MAX) < 0) {
+        pa_srbchannel_free(srb);
+        return;
+    }
+
+    pa_pstream_set_srbchannel(c->pstream, srb);
+    c->srbchannel_enabled = TRUE;
+#endif
+}
+
 static void command_auth(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
     const void*cookie;
     pa_tagstruct *reply;
-    pa_bool_t shm_on_remote = FALSE, do_shm;
+    pa_bool_t shm_on_remote = FALSE, memfd_on_remote = FALSE, srbchannel_on_remote = FALSE, do_shm, do_srbchannel;
 
     pa_native_connection_assert_ref(c);
     pa_assert(t);
@@ -2558,8 +2599,16 @@ static void command_auth(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_ta
        reflects if shm is available for this pa_native_connection or
        not. */
     if (c->version >= 13) {
-        shm_on_remote = !!(c->version & 0x80000000U);
-        c->version &= 0x7FFFFFFFU;
+        shm_on_remote = !!(c->version & PA_PROTOCOL_FLAG_SHM);
+        memfd_on_remote = !!(c->version & PA_PROTOCOL_FLAG_MEMFD);
+        srbchannel_on_remote = !!(c->version & PA_PROTOCOL_FLAG_SRBCHANNEL);
+        c->version &= PA_PROTOCOL_VERSION_MASK;
+
+        if (c->version < 28)
+            memfd_on_remote = FALSE;
+
+        if (c->version < 29)
+            srbchannel_on_remote = FALSE;
     }
 
     pa_log_debug("Protocol version: remote %u, local %u", c->version, PA_PROTOCOL_VERSION);
@@ -2646,8 +2695,37 @@ static void command_auth(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_ta
     pa_log_debug("Negotiated SHM: %s", pa_yes_no(do_shm));
     pa_pstream_enable_shm(c->pstream, do_shm);
 
+    /* Our pool can only be shared with clients that take its memfd */
+    if (do_shm && memfd_on_remote)
+        pa_pstream_enable_memfd(c->pstream);
+
+    pa_log_debug("Memfd possible: %s", pa_yes_no(do_shm && memfd_on_remote));
+
+    /* Since version 30 releases and revokes of blocks are batched */
+    if (do_shm && c->version >= 30)
+        pa_pstream_enable_block_id_arrays(c->pstream);
+
+    /* The ringbuffer is passed like a memfd segment. It is set up only
+     * once, in case the client authenticates again. */
+    do_srbchannel =
+        do_shm && memfd_on_remote && srbchannel_on_remote &&
+        !c->protocol->core->disable_srbchannel &&
+        !c->srbchannel_enabled;
+
+#ifndef HAVE_SRBCHANNEL
+    do_srbchannel = FALSE;
+#endif
+
+    pa_log_debug("Enabling srbchannel: %s", pa_yes_no(do_srbchannel));
+
     reply = reply_new(tag);
-    pa_tagstruct_putu32(reply, PA_PROTOCOL_VERSION | (do_shm ? 0x80000000 : 0));
+    pa_tagstruct_putu32(reply, PA_PROTOCOL_VERSION |
+                        (do_shm ? PA_PROTOCOL_FLAG_SHM : 0) |
+#ifdef HAVE_MEMFD
+                        (do_shm && memfd_on_remote ? PA_PROTOCOL_FLAG_MEMFD : 0) |
+#endif
+                        (do_srbchannel ? PA_PROTOCOL_FLAG_SRBCHANNEL : 0)
+                        );
 
 #ifdef HAVE_CREDS
 {
@@ -2663,6 +2741,9 @@ static void command_auth(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_ta
 #else
     pa_pstream_send_tagstruct(c->pstream, reply);
 #endif
+
+    if (do_srbchannel)
+        setup_srbchannel(c);
 }
 
 static void command_set_client_name(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
@@ -3574,6 +3655,85 @@ static void command_get_info_list(pa_pdispatch *pd, uint32_t command, uint32_t t
     pa_pstream_send_tagstruct(c->pstream, reply);
 }
 
+static void histogram_fill_tagstruct(pa_tagstruct *t, pa_histogram *h) {
+    unsigned i;
+
+    pa_assert_cc(PA_HISTOGRAM_BUCKETS == PA_IO_STATS_HISTOGRAM_BUCKETS);
+
+    for (i = 0; i < PA_HISTOGRAM_BUCKETS; i++)
+        pa_tagstruct_putu32(t, (uint32_t) pa_atomic_load(&h->buckets[i]));
+
+    pa_tagstruct_put_usec(t, (pa_usec_t) pa_atomic_load(&h->max_usec));
+}
+
+static void io_stats_fill_tagstruct(pa_tagstruct *t, uint32_t idx, pa_io_stats *s) {
+    pa_tagstruct_putu32(t, idx);
+    histogram_fill_tagstruct(t, &s->render_time);
+    histogram_fill_tagstruct(t, &s->latency);
+    pa_tagstruct_putu32(t, (uint32_t) pa_atomic_load(&s->n_xruns));
+    pa_tagstruct_putu32(t, (uint32_t) pa_atomic_load(&s->n_rewinds));
+    pa_tagstruct_putu64(t, s->rewind_bytes);
+}
+
+static pa_io_stats *get_io_stats(uint32_t command, void *p) {
+    if (command == PA_COMMAND_GET_SINK_IO_STATS)
+        return &((pa_sink*) p)->io_stats;
+    else if (command == PA_COMMAND_GET_SOURCE_IO_STATS)
+        return &((pa_source*) p)->io_stats;
+    else if (command == PA_COMMAND_GET_SINK_INPUT_IO_STATS)
+        return &((pa_sink_input*) p)->io_stats;
+
+    pa_assert(command == PA_COMMAND_GET_SOURCE_OUTPUT_IO_STATS);
+    return &((pa_source_output*) p)->io_stats;
+}
+
+static void command_get_io_stats(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
+    pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
+    pa_idxset *i;
+    uint32_t idx;
+    pa_tagstruct *reply;
+    void *p;
+
+    pa_native_connection_assert_ref(c);
+    pa_assert(t);
+
+    if (pa_tagstruct_getu32(t, &idx) < 0 ||
+        !pa_tagstruct_eof(t)) {
+        protocol_error(c);
+        return;
+    }
+
+    CHECK_VALIDITY(c->pstream, c->authorized, tag, PA_ERR_ACCESS);
+
+    if (command == PA_COMMAND_GET_SINK_IO_STATS)
+        i = c->protocol->core->sinks;
+    else if (command == PA_COMMAND_GET_SOURCE_IO_STATS)
+        i = c->protocol->core->sources;
+    else if (command == PA_COMMAND_GET_SINK_INPUT_IO_STATS)
+        i = c->protocol->core->sink_inputs;
+    else {
+        pa_assert(command == PA_COMMAND_GET_SOURCE_OUTPUT_IO_STATS);
+        i = c->protocol->core->source_outputs;
+    }
+
+    if (idx != PA_INVALID_INDEX) {
+        if (!(p = pa_idxset_get_by_index(i, idx))) {
+            pa_pstream_send_error(c->pstream, tag, PA_ERR_NOENTITY);
+            return;
+        }
+
+        reply = reply_new(tag);
+        io_stats_fill_tagstruct(reply, idx, get_io_stats(command, p));
+    } else {
+        reply = reply_new(tag);
+
+        PA_IDXSET_FOREACH(p, i, idx)
+            io_stats_fill_tagstruct(reply, idx, get_io_stats(command, p));
+    }
+
+    pa_pstream_send_tagstruct(c->pstream, reply);
+}
+
 static void command_get_server_info(pa_pdispatch *pd, uint32_t command, uint32_t tag, pa_tagstruct *t, void *userdata) {
     pa_native_connection *c = PA_NATIVE_CONNECTION(userdata);
     pa_tagstruct *reply;
@@ -4988,6 +5148,7 @@ void pa_native_protocol_connect(pa_native_protocol *p, pa_iochannel *io, pa_nati
         c->auth_timeout_event = NULL;
 
     c->is_local = pa_iochannel_socket_is_local(io);
+    c->srbchannel_enabled = FALSE;
     c->version = 8;
 
     c->client = client;
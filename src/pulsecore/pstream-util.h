@@ -32,6 +32,11 @@ void pa_pstream_send_tagstruct_with_creds(pa_pstream *p, pa_tagstruct *t, const
 
 #define pa_pstream_send_tagstruct(p, t) pa_pstream_send_tagstruct_with_creds((p), (t), NULL)
 
+#ifdef HAVE_CREDS
+/* The tagstruct is freed, the fds are not */
+int pa_pstream_send_tagstruct_with_fds(pa_pstream *p, pa_tagstruct *t, const int *fds, unsigned n_fds);
+#endif
+
 void pa_pstream_send_error(pa_pstream *p, uint32_t tag, uint32_t error);
 void pa_pstream_send_simple_ack(pa_pstream *p, uint32_t tag);
 
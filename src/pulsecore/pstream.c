@@ -26,7 +26,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 
 #ifdef HAVE_NETINET_IN_H
 #include <netinet/in.h>
@@ -40,6 +43,10 @@
 #include <pulsecore/creds.h>
 #include <pulsecore/refcnt.h>
 #include <pulsecore/flist.h>
+#include <pulsecore/shm.h>
+#include <pulsecore/srbchannel.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/core-error.h>
 #include <pulsecore/macro.h>
 
 #include "pstream.h"
@@ -48,6 +55,11 @@
 #define PA_FLAG_SHMDATA    0x80000000LU
 #define PA_FLAG_SHMRELEASE 0x40000000LU
 #define PA_FLAG_SHMREVOKE  0xC0000000LU
+/* The sender continues on the srbchannel after this frame */
+#define PA_FLAG_SRBSWITCH  0x20000000LU
+/* Release and revoke frames with an array of block ids as payload,
+ * instead of a single one in OFFSET_HI */
+#define PA_FLAG_SHMIDARRAY 0x10000000LU
 #define PA_FLAG_SHMMASK    0xFF000000LU
 #define PA_FLAG_SEEKMASK   0x000000FFLU
 
@@ -79,6 +91,17 @@ typedef uint32_t pa_pstream_descriptor[PA_PSTREAM_DESCRIPTOR_MAX];
  */
 #define FRAME_SIZE_MAX_ALLOW (1024*1024*16)
 
+/* How many queued frames are gathered into a single write */
+#define WRITE_FRAMES_MAX 16
+
+/* The frames following the one currently read are read along into
+ * this buffer, so that a burst of small frames takes a single read */
+#define READ_BUFFER_SIZE (8*1024)
+
+/* Releases resp. revokes are collected until the next main loop
+ * iteration, or until this many came together */
+#define BLOCK_IDS_MAX 256
+
 PA_STATIC_FLIST_DECLARE(items, 0, pa_xfree);
 
 struct item_info {
@@ -86,7 +109,8 @@ struct item_info {
         PA_PSTREAM_ITEM_PACKET,
         PA_PSTREAM_ITEM_MEMBLOCK,
         PA_PSTREAM_ITEM_SHMRELEASE,
-        PA_PSTREAM_ITEM_SHMREVOKE
+        PA_PSTREAM_ITEM_SHMREVOKE,
+        PA_PSTREAM_ITEM_SRBSWITCH
     } type;
 
     /* packet info */
@@ -94,6 +118,10 @@ struct item_info {
 #ifdef HAVE_CREDS
     pa_bool_t with_creds;
     pa_creds creds;
+
+    /* Our own duplicates, closed when the item is freed */
+    int fds[PA_CMSG_ANCIL_DATA_MAX_FDS];
+    unsigned n_fds;
 #endif
 
     /* memblock info */
@@ -102,8 +130,32 @@ struct item_info {
     int64_t offset;
     pa_seek_mode_t seek_mode;
 
-    /* release/revoke info */
+    /* release/revoke info, either a single id or an array of them in
+     * network byte order */
     uint32_t block_id;
+    uint32_t *block_ids;
+    unsigned n_block_ids;
+};
+
+struct block_ids {
+    uint32_t *ids;
+    unsigned n;
+};
+
+/* A queued item that is prepared for writing */
+struct write_frame {
+    struct item_info *item;
+    pa_pstream_descriptor descriptor;
+    uint32_t shm_info[PA_PSTREAM_SHM_MAX];
+    void *data;
+    pa_memchunk memchunk;
+
+    /* Bytes written so far, including the descriptor */
+    size_t index;
+
+#ifdef HAVE_CREDS
+    pa_bool_t send_memfd;
+#endif
 };
 
 struct pa_pstream {
@@ -118,12 +170,10 @@ struct pa_pstream {
     pa_bool_t dead;
 
     struct {
-        pa_pstream_descriptor descriptor;
-        struct item_info* current;
-        uint32_t shm_info[PA_PSTREAM_SHM_MAX];
-        void *data;
-        size_t index;
-        pa_memchunk memchunk;
+        /* A ring of prepared frames, only the first one may have been
+         * written partially */
+        struct write_frame frames[WRITE_FRAMES_MAX];
+        unsigned first, n;
     } write;
 
     struct {
@@ -131,14 +181,33 @@ struct pa_pstream {
         pa_memblock *memblock;
         pa_packet *packet;
         uint32_t shm_info[PA_PSTREAM_SHM_MAX];
+        uint32_t block_ids[BLOCK_IDS_MAX];
         void *data;
         size_t index;
+
+        uint8_t buffer[READ_BUFFER_SIZE];
     } read;
 
     pa_bool_t use_shm;
     pa_memimport *import;
     pa_memexport *export;
 
+    /* Whether the other side accepts memfd segments, and whether it
+     * got the one of our pool already. The fd is passed along with
+     * the descriptor of the first frame referring to the segment. */
+    pa_bool_t use_memfd;
+    pa_bool_t memfd_sent;
+
+    /* Once switched, frames go through the shared ringbuffer instead
+     * of the socket, separately for each direction */
+    pa_srbchannel *srb;
+    pa_bool_t srb_read, srb_write;
+
+    /* Whether both sides understand block id arrays, and the ids
+     * waiting to be sent that way */
+    pa_bool_t use_block_id_arrays;
+    struct block_ids releases, revokes;
+
     pa_pstream_packet_cb_t receive_packet_callback;
     void *receive_packet_callback_userdata;
 
@@ -160,15 +229,28 @@ struct pa_pstream {
     pa_mempool *mempool;
 
 #ifdef HAVE_CREDS
-    pa_creds read_creds, write_creds;
-    pa_bool_t read_creds_valid, send_creds_now;
+    pa_creds read_creds;
+    pa_bool_t read_creds_valid;
+
+    /* The fds that came with the frame currently read */
+    int read_fds[PA_CMSG_ANCIL_DATA_MAX_FDS];
+    unsigned n_read_fds;
 #endif
 };
 
+/* How many reads from the srbchannel are done in one go before other
+ * events get their turn */
+#define SRB_READS_MAX 64
+
+#define WRITE_FRAME(p, k) (&(p)->write.frames[((p)->write.first + (k)) % WRITE_FRAMES_MAX])
+
 static int do_write(pa_pstream *p);
 static int do_read(pa_pstream *p);
+static void flush_block_ids(pa_pstream *p, struct block_ids *b);
 
 static void do_something(pa_pstream *p) {
+    int r;
+
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
@@ -176,17 +258,52 @@ static void do_something(pa_pstream *p) {
 
     p->mainloop->defer_enable(p->defer_event, 0);
 
-    if (!p->dead && pa_iochannel_is_readable(p->io)) {
+    /* Whatever was released or revoked since the last iteration goes
+     * out as one frame each */
+    if (!p->dead) {
+        flush_block_ids(p, &p->releases);
+        flush_block_ids(p, &p->revokes);
+    }
+
+    if (!p->dead && p->srb_read) {
+        /* Nothing is supposed to come through the socket anymore, if
+         * it becomes readable the other side went away */
+        if (pa_iochannel_is_readable(p->io) || pa_iochannel_is_hungup(p->io))
+            goto fail;
+    } else if (!p->dead && pa_iochannel_is_readable(p->io)) {
         if (do_read(p) < 0)
             goto fail;
     } else if (!p->dead && pa_iochannel_is_hungup(p->io))
         goto fail;
 
-    if (!p->dead && pa_iochannel_is_writable(p->io)) {
-        if (do_write(p) < 0)
+    /* Also right after the switch frame came through the socket. The
+     * ring has to be drained eventually since the writer only wakes
+     * us after writing, so we come back via the defer event if it
+     * still has data. */
+    if (!p->dead && p->srb_read) {
+        unsigned n = 0;
+
+        r = 0;
+
+        while (!p->dead && (r = do_read(p)) > 0)
+            if (++n >= SRB_READS_MAX) {
+                p->mainloop->defer_enable(p->defer_event, 1);
+                break;
+            }
+
+        if (r < 0)
             goto fail;
     }
 
+    if (!p->dead && (p->srb_write || pa_iochannel_is_writable(p->io))) {
+        /* The socket tells us when it takes more, the srbchannel is
+         * written until it is full or there's nothing left */
+        do {
+            if ((r = do_write(p)) < 0)
+                goto fail;
+        } while (r > 0 && !p->dead && p->srb_write);
+    }
+
     pa_pstream_unref(p);
     return;
 
@@ -220,6 +337,27 @@ static void defer_callback(pa_mainloop_api *m, pa_defer_event *e, void*userdata)
     do_something(p);
 }
 
+static pa_bool_t srb_callback(pa_srbchannel *srb, void *userdata) {
+    pa_pstream *p = userdata;
+    pa_bool_t alive;
+
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(p->srb == srb);
+
+    pa_pstream_ref(p);
+
+    do_something(p);
+
+    /* Check before we let go of p, the srbchannel is freed when the
+     * pstream is unlinked */
+    alive = p->srb == srb;
+
+    pa_pstream_unref(p);
+
+    return alive;
+}
+
 static void memimport_release_cb(pa_memimport *i, uint32_t block_id, void *userdata);
 
 pa_pstream *pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *pool) {
@@ -241,9 +379,7 @@ pa_pstream *pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *poo
 
     p->send_queue = pa_queue_new();
 
-    p->write.current = NULL;
-    p->write.index = 0;
-    pa_memchunk_reset(&p->write.memchunk);
+    p->write.first = p->write.n = 0;
     p->read.memblock = NULL;
     p->read.packet = NULL;
     p->read.index = 0;
@@ -264,8 +400,17 @@ pa_pstream *pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *poo
     p->mempool = pool;
 
     p->use_shm = FALSE;
+    p->use_memfd = FALSE;
+    p->memfd_sent = FALSE;
     p->export = NULL;
 
+    p->srb = NULL;
+    p->srb_read = p->srb_write = FALSE;
+
+    p->use_block_id_arrays = FALSE;
+    p->releases.ids = p->revokes.ids = NULL;
+    p->releases.n = p->revokes.n = 0;
+
     /* We do importing unconditionally */
     p->import = pa_memimport_new(p->mempool, memimport_release_cb, p);
 
@@ -273,8 +418,8 @@ pa_pstream *pa_pstream_new(pa_mainloop_api *m, pa_iochannel *io, pa_mempool *poo
     pa_iochannel_socket_set_sndbuf(io, pa_mempool_block_size_max(p->mempool));
 
 #ifdef HAVE_CREDS
-    p->send_creds_now = FALSE;
     p->read_creds_valid = FALSE;
+    p->n_read_fds = 0;
 #endif
     return p;
 }
@@ -289,12 +434,43 @@ static void item_free(void *item) {
     } else if (i->type == PA_PSTREAM_ITEM_PACKET) {
         pa_assert(i->packet);
         pa_packet_unref(i->packet);
+    } else if (i->type == PA_PSTREAM_ITEM_SHMRELEASE || i->type == PA_PSTREAM_ITEM_SHMREVOKE)
+        pa_xfree(i->block_ids);
+
+#ifdef HAVE_CREDS
+    {
+        unsigned k;
+
+        for (k = 0; k < i->n_fds; k++)
+            pa_close(i->fds[k]);
     }
+#endif
 
     if (pa_flist_push(PA_STATIC_FLIST_GET(items), i) < 0)
         pa_xfree(i);
 }
 
+/* Drops the first prepared frame */
+static void pop_write_frame(pa_pstream *p) {
+    struct write_frame *f;
+
+    pa_assert(p);
+    pa_assert(p->write.n > 0);
+
+    f = WRITE_FRAME(p, 0);
+
+    item_free(f->item);
+    f->item = NULL;
+
+    if (f->memchunk.memblock)
+        pa_memblock_unref(f->memchunk.memblock);
+
+    pa_memchunk_reset(&f->memchunk);
+
+    p->write.first = (p->write.first + 1) % WRITE_FRAMES_MAX;
+    p->write.n--;
+}
+
 static void pstream_free(pa_pstream *p) {
     pa_assert(p);
 
@@ -302,11 +478,11 @@ static void pstream_free(pa_pstream *p) {
 
     pa_queue_free(p->send_queue, item_free);
 
-    if (p->write.current)
-        item_free(p->write.current);
+    while (p->write.n > 0)
+        pop_write_frame(p);
 
-    if (p->write.memchunk.memblock)
-        pa_memblock_unref(p->write.memchunk.memblock);
+    pa_xfree(p->releases.ids);
+    pa_xfree(p->revokes.ids);
 
     if (p->read.memblock)
         pa_memblock_unref(p->read.memblock);
@@ -314,6 +490,15 @@ static void pstream_free(pa_pstream *p) {
     if (p->read.packet)
         pa_packet_unref(p->read.packet);
 
+#ifdef HAVE_CREDS
+    {
+        unsigned i;
+
+        for (i = 0; i < p->n_read_fds; i++)
+            pa_close(p->read_fds[i]);
+    }
+#endif
+
     pa_xfree(p);
 }
 
@@ -336,6 +521,7 @@ void pa_pstream_send_packet(pa_pstream*p, pa_packet *packet, const pa_creds *cre
 #ifdef HAVE_CREDS
     if ((i->with_creds = !!creds))
         i->creds = *creds;
+    i->n_fds = 0;
 #endif
 
     pa_queue_push(p->send_queue, i);
@@ -343,6 +529,66 @@ void pa_pstream_send_packet(pa_pstream*p, pa_packet *packet, const pa_creds *cre
     p->mainloop->defer_enable(p->defer_event, 1);
 }
 
+#ifdef HAVE_CREDS
+int pa_pstream_send_packet_with_fds(pa_pstream*p, pa_packet *packet, const int *fds, unsigned n_fds) {
+    struct item_info *i;
+    unsigned k;
+
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(packet);
+    pa_assert(fds);
+    pa_assert(n_fds > 0);
+    pa_assert(n_fds <= PA_CMSG_ANCIL_DATA_MAX_FDS);
+
+    if (p->dead)
+        return -1;
+
+    if (!(i = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
+        i = pa_xnew(struct item_info, 1);
+
+    i->type = PA_PSTREAM_ITEM_PACKET;
+    i->with_creds = FALSE;
+
+    for (i->n_fds = 0; i->n_fds < n_fds; i->n_fds++)
+        if ((i->fds[i->n_fds] = fcntl(fds[i->n_fds], F_DUPFD_CLOEXEC, 3)) < 0) {
+            pa_log("fcntl(F_DUPFD_CLOEXEC) failed: %s", pa_cstrerror(errno));
+
+            for (k = 0; k < i->n_fds; k++)
+                pa_close(i->fds[k]);
+
+            if (pa_flist_push(PA_STATIC_FLIST_GET(items), i) < 0)
+                pa_xfree(i);
+
+            return -1;
+        }
+
+    i->packet = pa_packet_ref(packet);
+
+    pa_queue_push(p->send_queue, i);
+
+    p->mainloop->defer_enable(p->defer_event, 1);
+
+    return 0;
+}
+
+unsigned pa_pstream_take_fds(pa_pstream *p, int *fds, unsigned n_max) {
+    unsigned n;
+
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(fds);
+
+    n = PA_MIN(p->n_read_fds, n_max);
+    memcpy(fds, p->read_fds, n * sizeof(int));
+
+    p->n_read_fds -= n;
+    memmove(p->read_fds, p->read_fds + n, p->n_read_fds * sizeof(int));
+
+    return n;
+}
+#endif
+
 void pa_pstream_send_memblock(pa_pstream*p, uint32_t channel, int64_t offset, pa_seek_mode_t seek_mode, const pa_memchunk *chunk) {
     size_t length, idx;
     size_t bsm;
@@ -378,6 +624,7 @@ void pa_pstream_send_memblock(pa_pstream*p, uint32_t channel, int64_t offset, pa
         i->seek_mode = seek_mode;
 #ifdef HAVE_CREDS
         i->with_creds = FALSE;
+        i->n_fds = 0;
 #endif
 
         pa_queue_push(p->send_queue, i);
@@ -389,6 +636,48 @@ void pa_pstream_send_memblock(pa_pstream*p, uint32_t channel, int64_t offset, pa
     p->mainloop->defer_enable(p->defer_event, 1);
 }
 
+/* Queues the collected ids as one frame */
+static void flush_block_ids(pa_pstream *p, struct block_ids *b) {
+    struct item_info *item;
+
+    pa_assert(p);
+    pa_assert(b);
+
+    if (b->n <= 0)
+        return;
+
+    if (!(item = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
+        item = pa_xnew(struct item_info, 1);
+    item->type = b == &p->revokes ? PA_PSTREAM_ITEM_SHMREVOKE : PA_PSTREAM_ITEM_SHMRELEASE;
+    item->block_ids = b->ids;
+    item->n_block_ids = b->n;
+#ifdef HAVE_CREDS
+    item->with_creds = FALSE;
+    item->n_fds = 0;
+#endif
+
+    b->ids = NULL;
+    b->n = 0;
+
+    pa_queue_push(p->send_queue, item);
+    p->mainloop->defer_enable(p->defer_event, 1);
+}
+
+static void add_block_id(pa_pstream *p, struct block_ids *b, uint32_t block_id) {
+    pa_assert(p);
+    pa_assert(b);
+
+    if (!b->ids)
+        b->ids = pa_xnew(uint32_t, BLOCK_IDS_MAX);
+
+    b->ids[b->n++] = htonl(block_id);
+
+    if (b->n >= BLOCK_IDS_MAX)
+        flush_block_ids(p, b);
+    else
+        p->mainloop->defer_enable(p->defer_event, 1);
+}
+
 void pa_pstream_send_release(pa_pstream *p, uint32_t block_id) {
     struct item_info *item;
     pa_assert(p);
@@ -399,12 +688,19 @@ void pa_pstream_send_release(pa_pstream *p, uint32_t block_id) {
 
 /*     pa_log("Releasing block %u", block_id); */
 
+    if (p->use_block_id_arrays) {
+        add_block_id(p, &p->releases, block_id);
+        return;
+    }
+
     if (!(item = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
         item = pa_xnew(struct item_info, 1);
     item->type = PA_PSTREAM_ITEM_SHMRELEASE;
     item->block_id = block_id;
+    item->block_ids = NULL;
 #ifdef HAVE_CREDS
     item->with_creds = FALSE;
+    item->n_fds = 0;
 #endif
 
     pa_queue_push(p->send_queue, item);
@@ -436,12 +732,19 @@ void pa_pstream_send_revoke(pa_pstream *p, uint32_t block_id) {
         return;
 /*     pa_log("Revoking block %u", block_id); */
 
+    if (p->use_block_id_arrays) {
+        add_block_id(p, &p->revokes, block_id);
+        return;
+    }
+
     if (!(item = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
         item = pa_xnew(struct item_info, 1);
     item->type = PA_PSTREAM_ITEM_SHMREVOKE;
     item->block_id = block_id;
+    item->block_ids = NULL;
 #ifdef HAVE_CREDS
     item->with_creds = FALSE;
+    item->n_fds = 0;
 #endif
 
     pa_queue_push(p->send_queue, item);
@@ -461,62 +764,86 @@ static void memexport_revoke_cb(pa_memexport *e, uint32_t block_id, void *userda
         pa_pstream_send_revoke(p, block_id);
 }
 
-static void prepare_next_write_item(pa_pstream *p) {
+static void prepare_write_frame(pa_pstream *p, struct write_frame *f, struct item_info *item) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(f);
+    pa_assert(item);
 
-    p->write.current = pa_queue_pop(p->send_queue);
+    f->item = item;
+    f->index = 0;
+    f->data = NULL;
+    pa_memchunk_reset(&f->memchunk);
+#ifdef HAVE_CREDS
+    f->send_memfd = FALSE;
+#endif
 
-    if (!p->write.current)
-        return;
+    f->descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = 0;
+    f->descriptor[PA_PSTREAM_DESCRIPTOR_CHANNEL] = htonl((uint32_t) -1);
+    f->descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = 0;
+    f->descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_LO] = 0;
+    f->descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = 0;
+
+    if (item->type == PA_PSTREAM_ITEM_PACKET) {
+
+        pa_assert(item->packet);
+        f->data = item->packet->data;
+        f->descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = htonl((uint32_t) item->packet->length);
 
-    p->write.index = 0;
-    p->write.data = NULL;
-    pa_memchunk_reset(&p->write.memchunk);
+    } else if (item->type == PA_PSTREAM_ITEM_SHMRELEASE || item->type == PA_PSTREAM_ITEM_SHMREVOKE) {
+        uint32_t flags;
 
-    p->write.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = 0;
-    p->write.descriptor[PA_PSTREAM_DESCRIPTOR_CHANNEL] = htonl((uint32_t) -1);
-    p->write.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = 0;
-    p->write.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_LO] = 0;
-    p->write.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = 0;
+        flags = item->type == PA_PSTREAM_ITEM_SHMRELEASE ? PA_FLAG_SHMRELEASE : PA_FLAG_SHMREVOKE;
 
-    if (p->write.current->type == PA_PSTREAM_ITEM_PACKET) {
+        if (item->block_ids) {
+            f->descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = htonl(flags | PA_FLAG_SHMIDARRAY);
+            f->descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = htonl((uint32_t) (item->n_block_ids * sizeof(uint32_t)));
+            f->data = item->block_ids;
+        } else {
+            f->descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = htonl(flags);
+            f->descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = htonl(item->block_id);
+        }
 
-        pa_assert(p->write.current->packet);
-        p->write.data = p->write.current->packet->data;
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = htonl((uint32_t) p->write.current->packet->length);
+    } else if (item->type == PA_PSTREAM_ITEM_SRBSWITCH) {
 
-    } else if (p->write.current->type == PA_PSTREAM_ITEM_SHMRELEASE) {
+        f->descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = htonl(PA_FLAG_SRBSWITCH);
 
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = htonl(PA_FLAG_SHMRELEASE);
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = htonl(p->write.current->block_id);
+#ifdef HAVE_CREDS
+        /* SHM frames can't bring the memfd of the pool along once
+         * they go through the ring, so it is passed with this frame */
+        if (p->use_memfd && !p->memfd_sent && pa_mempool_is_memfd_backed(p->mempool)) {
+            uint32_t pool_id;
 
-    } else if (p->write.current->type == PA_PSTREAM_ITEM_SHMREVOKE) {
+            pa_assert_se(pa_mempool_get_shm_id(p->mempool, &pool_id) >= 0);
 
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = htonl(PA_FLAG_SHMREVOKE);
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = htonl(p->write.current->block_id);
+            f->descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = htonl(pool_id);
+            f->send_memfd = p->memfd_sent = TRUE;
+        }
+#endif
 
     } else {
         uint32_t flags;
         pa_bool_t send_payload = TRUE;
 
-        pa_assert(p->write.current->type == PA_PSTREAM_ITEM_MEMBLOCK);
-        pa_assert(p->write.current->chunk.memblock);
+        pa_assert(item->type == PA_PSTREAM_ITEM_MEMBLOCK);
+        pa_assert(item->chunk.memblock);
 
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_CHANNEL] = htonl(p->write.current->channel);
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = htonl((uint32_t) (((uint64_t) p->write.current->offset) >> 32));
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_LO] = htonl((uint32_t) ((uint64_t) p->write.current->offset));
+        f->descriptor[PA_PSTREAM_DESCRIPTOR_CHANNEL] = htonl(item->channel);
+        f->descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI] = htonl((uint32_t) (((uint64_t) item->offset) >> 32));
+        f->descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_LO] = htonl((uint32_t) ((uint64_t) item->offset));
 
-        flags = (uint32_t) (p->write.current->seek_mode & PA_FLAG_SEEKMASK);
+        flags = (uint32_t) (item->seek_mode & PA_FLAG_SEEKMASK);
 
-        if (p->use_shm) {
+        /* Blocks of a memfd pool can only be shared if the other side
+         * takes the fd */
+        if (p->use_shm && (p->use_memfd || !pa_mempool_is_memfd_backed(p->mempool))) {
             uint32_t block_id, shm_id;
             size_t offset, length;
 
             pa_assert(p->export);
 
             if (pa_memexport_put(p->export,
-                                 p->write.current->chunk.memblock,
+                                 item->chunk.memblock,
                                  &block_id,
                                  &shm_id,
                                  &offset,
@@ -525,121 +852,219 @@ static void prepare_next_write_item(pa_pstream *p) {
                 flags |= PA_FLAG_SHMDATA;
                 send_payload = FALSE;
 
-                p->write.shm_info[PA_PSTREAM_SHM_BLOCKID] = htonl(block_id);
-                p->write.shm_info[PA_PSTREAM_SHM_SHMID] = htonl(shm_id);
-                p->write.shm_info[PA_PSTREAM_SHM_INDEX] = htonl((uint32_t) (offset + p->write.current->chunk.index));
-                p->write.shm_info[PA_PSTREAM_SHM_LENGTH] = htonl((uint32_t) p->write.current->chunk.length);
+                f->shm_info[PA_PSTREAM_SHM_BLOCKID] = htonl(block_id);
+                f->shm_info[PA_PSTREAM_SHM_SHMID] = htonl(shm_id);
+                f->shm_info[PA_PSTREAM_SHM_INDEX] = htonl((uint32_t) (offset + item->chunk.index));
+                f->shm_info[PA_PSTREAM_SHM_LENGTH] = htonl((uint32_t) item->chunk.length);
 
-                p->write.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = htonl(sizeof(p->write.shm_info));
-                p->write.data = p->write.shm_info;
+                f->descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = htonl(sizeof(f->shm_info));
+                f->data = f->shm_info;
+
+#ifdef HAVE_CREDS
+                if (p->use_memfd && !p->memfd_sent) {
+                    uint32_t pool_id;
+
+                    if (pa_mempool_get_shm_id(p->mempool, &pool_id) >= 0 && pool_id == shm_id)
+                        f->send_memfd = p->memfd_sent = TRUE;
+                }
+#endif
             }
 /*             else */
 /*                 pa_log_warn("Failed to export memory block."); */
         }
 
         if (send_payload) {
-            p->write.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = htonl((uint32_t) p->write.current->chunk.length);
-            p->write.memchunk = p->write.current->chunk;
-            pa_memblock_ref(p->write.memchunk.memblock);
-            p->write.data = NULL;
+            f->descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH] = htonl((uint32_t) item->chunk.length);
+            f->memchunk = item->chunk;
+            pa_memblock_ref(f->memchunk.memblock);
+            f->data = NULL;
         }
 
-        p->write.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = htonl(flags);
+        f->descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS] = htonl(flags);
     }
+}
+
+static size_t write_frame_size(struct write_frame *f) {
+    return PA_PSTREAM_DESCRIPTOR_SIZE + ntohl(f->descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH]);
+}
 
+/* The kernel attaches ancillary data to the first byte of a write, and
+ * the other side takes it as belonging to the last frame that starts
+ * in what it reads. Hence a frame with ancillary data starts a write
+ * of its own and nothing is written along after it. */
+static pa_bool_t write_frame_has_ancil(struct write_frame *f) {
 #ifdef HAVE_CREDS
-    if ((p->send_creds_now = p->write.current->with_creds))
-        p->write_creds = p->write.current->creds;
+    return f->index == 0 && (f->item->with_creds || f->item->n_fds > 0 || f->send_memfd);
+#else
+    return FALSE;
 #endif
 }
 
+static ssize_t srbchannel_writev(pa_srbchannel *srb, const struct iovec *iov, unsigned n_iov) {
+    size_t written = 0;
+    unsigned k;
+
+    for (k = 0; k < n_iov; k++) {
+        ssize_t r;
+
+        if ((r = pa_srbchannel_write(srb, iov[k].iov_base, iov[k].iov_len)) < 0)
+            return -1;
+
+        written += (size_t) r;
+
+        if ((size_t) r < iov[k].iov_len)
+            break;
+    }
+
+    return (ssize_t) written;
+}
+
 static int do_write(pa_pstream *p) {
-    void *d;
-    size_t l;
+    struct iovec iov[2*WRITE_FRAMES_MAX];
+    pa_memblock *release_memblocks[WRITE_FRAMES_MAX];
+    unsigned n_iov = 0, n_release = 0, k;
+    struct write_frame *f;
+    pa_bool_t finished = FALSE;
+    size_t done;
     ssize_t r;
-    pa_memblock *release_memblock = NULL;
 
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
-    if (!p->write.current)
-        prepare_next_write_item(p);
+    while (p->write.n < WRITE_FRAMES_MAX) {
+        struct item_info *item;
+
+        if (!(item = pa_queue_pop(p->send_queue)))
+            break;
 
-    if (!p->write.current)
+        prepare_write_frame(p, WRITE_FRAME(p, p->write.n), item);
+        p->write.n++;
+    }
+
+    if (p->write.n <= 0)
         return 0;
 
-    if (p->write.index < PA_PSTREAM_DESCRIPTOR_SIZE) {
-        d = (uint8_t*) p->write.descriptor + p->write.index;
-        l = PA_PSTREAM_DESCRIPTOR_SIZE - p->write.index;
-    } else {
-        pa_assert(p->write.data || p->write.memchunk.memblock);
+    /* Gather what is left of the prepared frames into one write */
+    for (k = 0; k < p->write.n; k++) {
+        size_t index;
 
-        if (p->write.data)
-            d = p->write.data;
-        else {
-            d = (uint8_t*) pa_memblock_acquire(p->write.memchunk.memblock) + p->write.memchunk.index;
-            release_memblock = p->write.memchunk.memblock;
+        f = WRITE_FRAME(p, k);
+
+        if (k > 0 && write_frame_has_ancil(f))
+            break;
+
+        index = f->index;
+
+        if (index < PA_PSTREAM_DESCRIPTOR_SIZE) {
+            iov[n_iov].iov_base = (uint8_t*) f->descriptor + index;
+            iov[n_iov].iov_len = PA_PSTREAM_DESCRIPTOR_SIZE - index;
+            n_iov++;
+
+            index = PA_PSTREAM_DESCRIPTOR_SIZE;
         }
 
-        d = (uint8_t*) d + p->write.index - PA_PSTREAM_DESCRIPTOR_SIZE;
-        l = ntohl(p->write.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH]) - (p->write.index - PA_PSTREAM_DESCRIPTOR_SIZE);
+        if (index < write_frame_size(f)) {
+            void *d;
+
+            pa_assert(f->data || f->memchunk.memblock);
+
+            if (f->data)
+                d = f->data;
+            else {
+                d = (uint8_t*) pa_memblock_acquire(f->memchunk.memblock) + f->memchunk.index;
+                release_memblocks[n_release++] = f->memchunk.memblock;
+            }
+
+            iov[n_iov].iov_base = (uint8_t*) d + index - PA_PSTREAM_DESCRIPTOR_SIZE;
+            iov[n_iov].iov_len = write_frame_size(f) - index;
+            n_iov++;
+        }
+
+        /* Whatever follows the switch frame goes through the
+         * srbchannel */
+        if (write_frame_has_ancil(f) || f->item->type == PA_PSTREAM_ITEM_SRBSWITCH)
+            break;
     }
 
-    pa_assert(l > 0);
+    pa_assert(n_iov > 0);
+
+    f = WRITE_FRAME(p, 0);
+
+    if (p->srb_write) {
 
 #ifdef HAVE_CREDS
-    if (p->send_creds_now) {
+        /* Credentials are only sent during authentication, which is
+         * over when the srbchannel is set up, so they are dropped */
+        if (f->index == 0 && (f->item->n_fds > 0 || f->send_memfd)) {
+            pa_log_warn("File descriptors can't be passed through the srbchannel.");
+            r = -1;
+        } else
+#endif
+            r = srbchannel_writev(p->srb, iov, n_iov);
 
-        if ((r = pa_iochannel_write_with_creds(p->io, d, l, &p->write_creds)) < 0)
-            goto fail;
+    } else
+
+#ifdef HAVE_CREDS
+    if (write_frame_has_ancil(f)) {
+
+        if (f->item->with_creds)
+            r = pa_iochannel_writev_with_creds(p->io, iov, n_iov, &f->item->creds);
+        else if (f->send_memfd) {
+            int fd = pa_mempool_get_memfd_fd(p->mempool);
+
+            pa_assert(fd >= 0);
+
+            r = pa_iochannel_writev_with_fds(p->io, iov, n_iov, &fd, 1);
+        } else
+            r = pa_iochannel_writev_with_fds(p->io, iov, n_iov, f->item->fds, f->item->n_fds);
 
-        p->send_creds_now = FALSE;
     } else
 #endif
 
-    if ((r = pa_iochannel_write(p->io, d, l)) < 0)
-        goto fail;
+        r = pa_iochannel_writev(p->io, iov, n_iov);
 
-    if (release_memblock)
-        pa_memblock_release(release_memblock);
+    for (k = 0; k < n_release; k++)
+        pa_memblock_release(release_memblocks[k]);
 
-    p->write.index += (size_t) r;
+    if (r < 0)
+        return -1;
 
-    if (p->write.index >= PA_PSTREAM_DESCRIPTOR_SIZE + ntohl(p->write.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH])) {
-        pa_assert(p->write.current);
-        item_free(p->write.current);
-        p->write.current = NULL;
+    for (done = (size_t) r; done > 0;) {
+        size_t n;
 
-        if (p->write.memchunk.memblock)
-            pa_memblock_unref(p->write.memchunk.memblock);
+        f = WRITE_FRAME(p, 0);
 
-        pa_memchunk_reset(&p->write.memchunk);
+        n = PA_MIN(done, write_frame_size(f) - f->index);
+        f->index += n;
+        done -= n;
 
-        if (p->drain_callback && !pa_pstream_is_pending(p))
-            p->drain_callback(p, p->drain_callback_userdata);
-    }
+        if (f->index < write_frame_size(f))
+            break;
 
-    return 0;
+        if (f->item->type == PA_PSTREAM_ITEM_SRBSWITCH)
+            p->srb_write = TRUE;
 
-fail:
+        pop_write_frame(p);
+        finished = TRUE;
+    }
 
-    if (release_memblock)
-        pa_memblock_release(release_memblock);
+    if (finished && p->drain_callback && !pa_pstream_is_pending(p))
+        p->drain_callback(p, p->drain_callback_userdata);
 
-    return -1;
+    return r > 0;
 }
 
-static int do_read(pa_pstream *p) {
+/* Returns where the next bytes of the frame currently read go and how
+ * many are expected there. A memblock is acquired for that, which has
+ * to be released with *release_memblock. */
+static void* read_target(pa_pstream *p, size_t *l, pa_memblock **release_memblock) {
     void *d;
-    size_t l;
-    ssize_t r;
-    pa_memblock *release_memblock = NULL;
-    pa_assert(p);
-    pa_assert(PA_REFCNT_VALUE(p) > 0);
+
+    *release_memblock = NULL;
 
     if (p->read.index < PA_PSTREAM_DESCRIPTOR_SIZE) {
         d = (uint8_t*) p->read.descriptor + p->read.index;
-        l = PA_PSTREAM_DESCRIPTOR_SIZE - p->read.index;
+        *l = PA_PSTREAM_DESCRIPTOR_SIZE - p->read.index;
     } else {
         pa_assert(p->read.data || p->read.memblock);
 
@@ -647,31 +1072,28 @@ static int do_read(pa_pstream *p) {
             d = p->read.data;
         else {
             d = pa_memblock_acquire(p->read.memblock);
-            release_memblock = p->read.memblock;
+            *release_memblock = p->read.memblock;
         }
 
         d = (uint8_t*) d + p->read.index - PA_PSTREAM_DESCRIPTOR_SIZE;
-        l = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH]) - (p->read.index - PA_PSTREAM_DESCRIPTOR_SIZE);
+        *l = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH]) - (p->read.index - PA_PSTREAM_DESCRIPTOR_SIZE);
     }
 
-#ifdef HAVE_CREDS
-    {
-        pa_bool_t b = 0;
+    pa_assert(*l > 0);
 
-        if ((r = pa_iochannel_read_with_creds(p->io, d, l, &p->read_creds, &b)) <= 0)
-            goto fail;
+    return d;
+}
 
-        p->read_creds_valid = p->read_creds_valid || b;
-    }
-#else
-    if ((r = pa_iochannel_read(p->io, d, l)) <= 0)
-        goto fail;
-#endif
+/* Processes r bytes that were stored at read_target(). Returns 1 when
+ * the frame is complete, 0 if more of it is expected and -1 on
+ * error. */
+static int handle_read(pa_pstream *p, size_t r) {
+    size_t l;
 
-    if (release_memblock)
-        pa_memblock_release(release_memblock);
+    pa_assert(p);
+    pa_assert(r > 0);
 
-    p->read.index += (size_t) r;
+    p->read.index += r;
 
     if (p->read.index == PA_PSTREAM_DESCRIPTOR_SIZE) {
         uint32_t flags, length, channel;
@@ -705,6 +1127,49 @@ static int do_read(pa_pstream *p) {
             pa_memimport_process_revoke(p->import, ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI]));
 
             goto frame_done;
+
+        } else if (flags == PA_FLAG_SRBSWITCH) {
+
+            /* This is the last frame that comes through the socket */
+
+            if (!p->srb || p->srb_read) {
+                pa_log_warn("Received unexpected srbchannel switch frame.");
+                return -1;
+            }
+
+#ifdef HAVE_CREDS
+            if (p->n_read_fds == 1) {
+                pa_assert(p->import);
+
+                if (pa_memimport_attach_memfd(p->import, ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_OFFSET_HI]), p->read_fds[0]) < 0)
+                    pa_log_warn("Failed to attach memfd segment.");
+
+                p->n_read_fds = 0;
+            }
+#endif
+
+            p->srb_read = TRUE;
+
+            goto frame_done;
+
+        } else if (flags == (PA_FLAG_SHMRELEASE|PA_FLAG_SHMIDARRAY) || flags == (PA_FLAG_SHMREVOKE|PA_FLAG_SHMIDARRAY)) {
+
+            /* This is a SHM memblock release or revoke frame for
+             * several blocks, their ids are the payload */
+
+            length = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH]);
+
+            if (!p->use_block_id_arrays ||
+                length <= 0 ||
+                length > sizeof(p->read.block_ids) ||
+                length % sizeof(uint32_t) != 0) {
+                pa_log_warn("Received invalid block id array frame.");
+                return -1;
+            }
+
+            p->read.data = p->read.block_ids;
+
+            return 0;
         }
 
         length = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH]);
@@ -765,7 +1230,7 @@ static int do_read(pa_pstream *p) {
         if (p->read.memblock && p->receive_memblock_callback) {
 
             /* Is this memblock data? Than pass it to the user */
-            l = (p->read.index - (size_t) r) < PA_PSTREAM_DESCRIPTOR_SIZE ? (size_t) (p->read.index - PA_PSTREAM_DESCRIPTOR_SIZE) : (size_t) r;
+            l = (p->read.index - r) < PA_PSTREAM_DESCRIPTOR_SIZE ? (size_t) (p->read.index - PA_PSTREAM_DESCRIPTOR_SIZE) : r;
 
             if (l > 0) {
                 pa_memchunk chunk;
@@ -815,6 +1280,23 @@ static int do_read(pa_pstream *p) {
 #endif
 
                 pa_packet_unref(p->read.packet);
+            } else if (ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS]) & PA_FLAG_SHMIDARRAY) {
+                uint32_t flags;
+                unsigned i, n;
+
+                flags = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_FLAGS]);
+                n = ntohl(p->read.descriptor[PA_PSTREAM_DESCRIPTOR_LENGTH]) / sizeof(uint32_t);
+
+                for (i = 0; i < n; i++) {
+                    if (flags == (PA_FLAG_SHMRELEASE|PA_FLAG_SHMIDARRAY)) {
+                        pa_assert(p->export);
+                        pa_memexport_process_release(p->export, ntohl(p->read.block_ids[i]));
+                    } else {
+                        pa_assert(p->import);
+                        pa_memimport_process_revoke(p->import, ntohl(p->read.block_ids[i]));
+                    }
+                }
+
             } else {
                 pa_memblock *b;
 
@@ -822,6 +1304,15 @@ static int do_read(pa_pstream *p) {
 
                 pa_assert(p->import);
 
+#ifdef HAVE_CREDS
+                if (p->n_read_fds == 1) {
+                    if (pa_memimport_attach_memfd(p->import, ntohl(p->read.shm_info[PA_PSTREAM_SHM_SHMID]), p->read_fds[0]) < 0)
+                        pa_log_warn("Failed to attach memfd segment.");
+
+                    p->n_read_fds = 0;
+                }
+#endif
+
                 if (!(b = pa_memimport_get(p->import,
                                           ntohl(p->read.shm_info[PA_PSTREAM_SHM_BLOCKID]),
                                           ntohl(p->read.shm_info[PA_PSTREAM_SHM_SHMID]),
@@ -869,17 +1360,165 @@ frame_done:
     p->read.index = 0;
     p->read.data = NULL;
 
+    return 1;
+}
+
+/* Called when a frame is complete. Credentials are kept for the
+ * other frames in the same read, fds are only handed to the frame
+ * they were sent with. */
+static void read_frame_done(pa_pstream *p, pa_bool_t more) {
+    pa_assert(p);
+
 #ifdef HAVE_CREDS
-    p->read_creds_valid = FALSE;
+    if (!more)
+        p->read_creds_valid = FALSE;
+
+    /* File descriptors are accepted along with SHM frames, the switch
+     * frame and packets whose handler takes them */
+    if (p->n_read_fds > 0) {
+        unsigned i;
+
+        pa_log_warn("Received file descriptors with a frame that doesn't use them.");
+
+        for (i = 0; i < p->n_read_fds; i++)
+            pa_close(p->read_fds[i]);
+
+        p->n_read_fds = 0;
+    }
+#endif
+}
+
+static int do_read(pa_pstream *p) {
+    struct iovec iov[2];
+    void *d;
+    size_t l, n, consumed;
+    ssize_t r;
+    int k, ret = -1;
+    pa_memblock *release_memblock;
+#ifdef HAVE_CREDS
+    pa_cmsg_ancil_data ancil;
 #endif
 
-    return 0;
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+
+    d = read_target(p, &l, &release_memblock);
+
+    if (p->srb_read) {
+
+        /* Reading from the ring costs no syscall, so it is read
+         * directly to where the data belongs, frame by frame */
+        r = pa_srbchannel_read(p->srb, d, l);
+
+        if (release_memblock)
+            pa_memblock_release(release_memblock);
+
+        if (r <= 0)
+            return r < 0 ? -1 : 0;
+
+        if ((k = handle_read(p, (size_t) r)) < 0)
+            return -1;
+
+        if (k > 0)
+            read_frame_done(p, FALSE);
+
+        return 1;
+    }
+
+    /* The data of the current frame goes directly to where it belongs,
+     * what follows into the read buffer */
+    iov[0].iov_base = d;
+    iov[0].iov_len = l;
+    iov[1].iov_base = p->read.buffer;
+    iov[1].iov_len = sizeof(p->read.buffer);
+
+#ifdef HAVE_CREDS
+    r = pa_iochannel_readv_with_ancil_data(p->io, iov, 2, &ancil);
 
-fail:
     if (release_memblock)
         pa_memblock_release(release_memblock);
 
-    return -1;
+    if (r <= 0)
+        return -1;
+
+    if (ancil.creds_valid) {
+        p->read_creds = ancil.creds;
+        p->read_creds_valid = TRUE;
+    }
+#else
+    r = pa_iochannel_readv(p->io, iov, 2);
+
+    if (release_memblock)
+        pa_memblock_release(release_memblock);
+
+    if (r <= 0)
+        return -1;
+#endif
+
+    n = PA_MIN((size_t) r, l);
+
+    for (consumed = 0;;) {
+
+#ifdef HAVE_CREDS
+        /* The kernel ends a read after the data that came with fds,
+         * and the sender starts and ends a write with the frame they
+         * belong to. So they belong to the frame the read ends in, and
+         * must not be seen by the ones before it. */
+        if (consumed + n >= (size_t) r && ancil.n_fds > 0) {
+            unsigned i;
+
+            for (i = 0; i < ancil.n_fds; i++) {
+                if (p->n_read_fds < PA_CMSG_ANCIL_DATA_MAX_FDS)
+                    p->read_fds[p->n_read_fds++] = ancil.fds[i];
+                else
+                    pa_close(ancil.fds[i]);
+            }
+
+            ancil.n_fds = 0;
+        }
+#endif
+
+        if ((k = handle_read(p, n)) < 0)
+            goto finish;
+
+        consumed += n;
+
+        /* A callback might have unlinked us */
+        if (p->dead) {
+            ret = 1;
+            goto finish;
+        }
+
+        if (k > 0)
+            read_frame_done(p, consumed < (size_t) r);
+
+        if (consumed >= (size_t) r)
+            break;
+
+        if (p->srb_read) {
+            pa_log_warn("Received data after the srbchannel switch frame.");
+            goto finish;
+        }
+
+        d = read_target(p, &n, &release_memblock);
+        n = PA_MIN(n, (size_t) r - consumed);
+
+        memcpy(d, p->read.buffer + (consumed - l), n);
+
+        if (release_memblock)
+            pa_memblock_release(release_memblock);
+    }
+
+    ret = 1;
+
+finish:
+#ifdef HAVE_CREDS
+    /* Left over only if we bailed out early */
+    for (k = 0; k < (int) ancil.n_fds; k++)
+        pa_close(ancil.fds[k]);
+#endif
+
+    return ret;
 }
 
 void pa_pstream_set_die_callback(pa_pstream *p, pa_pstream_notify_cb_t cb, void *userdata) {
@@ -939,7 +1578,7 @@ pa_bool_t pa_pstream_is_pending(pa_pstream *p) {
     if (p->dead)
         b = FALSE;
     else
-        b = p->write.current || !pa_queue_isempty(p->send_queue);
+        b = p->write.n > 0 || !pa_queue_isempty(p->send_queue) || p->releases.n > 0 || p->revokes.n > 0;
 
     return b;
 }
@@ -988,6 +1627,11 @@ void pa_pstream_unlink(pa_pstream *p) {
         p->defer_event = NULL;
     }
 
+    if (p->srb) {
+        pa_srbchannel_free(p->srb);
+        p->srb = NULL;
+    }
+
     p->die_callback = NULL;
     p->drain_callback = NULL;
     p->receive_packet_callback = NULL;
@@ -1014,9 +1658,56 @@ void pa_pstream_enable_shm(pa_pstream *p, pa_bool_t enable) {
     }
 }
 
+void pa_pstream_enable_memfd(pa_pstream *p) {
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(p->use_shm);
+
+#ifdef HAVE_MEMFD
+    p->use_memfd = TRUE;
+#endif
+}
+
+void pa_pstream_enable_block_id_arrays(pa_pstream *p) {
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(p->use_shm);
+
+    p->use_block_id_arrays = TRUE;
+}
+
 pa_bool_t pa_pstream_get_shm(pa_pstream *p) {
     pa_assert(p);
     pa_assert(PA_REFCNT_VALUE(p) > 0);
 
     return p->use_shm;
 }
+
+void pa_pstream_set_srbchannel(pa_pstream *p, pa_srbchannel *srb) {
+    struct item_info *item;
+
+    pa_assert(p);
+    pa_assert(PA_REFCNT_VALUE(p) > 0);
+    pa_assert(srb);
+    pa_assert(!p->srb);
+
+    if (p->dead) {
+        pa_srbchannel_free(srb);
+        return;
+    }
+
+    p->srb = srb;
+    pa_srbchannel_set_callback(srb, srb_callback, p);
+
+    /* Everything queued so far still goes through the socket */
+    if (!(item = pa_flist_pop(PA_STATIC_FLIST_GET(items))))
+        item = pa_xnew(struct item_info, 1);
+    item->type = PA_PSTREAM_ITEM_SRBSWITCH;
+#ifdef HAVE_CREDS
+    item->with_creds = FALSE;
+    item->n_fds = 0;
+#endif
+
+    pa_queue_push(p->send_queue, item);
+    p->mainloop->defer_enable(p->defer_event, 1);
+}
@@ -33,6 +33,7 @@
 #include <pulsecore/iochannel.h>
 #include <pulsecore/memchunk.h>
 #include <pulsecore/creds.h>
+#include <pulsecore/srbchannel.h>
 #include <pulsecore/macro.h>
 
 typedef struct pa_pstream pa_pstream;
@@ -54,6 +55,17 @@ void pa_pstream_send_memblock(pa_pstream*p, uint32_t channel, int64_t offset, pa
 void pa_pstream_send_release(pa_pstream *p, uint32_t block_id);
 void pa_pstream_send_revoke(pa_pstream *p, uint32_t block_id);
 
+#ifdef HAVE_CREDS
+/* The fds are duplicated and passed along with the packet. Can't be
+ * used once the srbchannel is set up. */
+int pa_pstream_send_packet_with_fds(pa_pstream*p, pa_packet *packet, const int *fds, unsigned n_fds);
+
+/* Takes the fds that came with the packet, only valid from within the
+ * receive packet callback. Returns how many were taken, the caller owns
+ * them. Those not taken are closed after the callback. */
+unsigned pa_pstream_take_fds(pa_pstream *p, int *fds, unsigned n_max);
+#endif
+
 void pa_pstream_set_receive_packet_callback(pa_pstream *p, pa_pstream_packet_cb_t cb, void *userdata);
 void pa_pstream_set_receive_memblock_callback(pa_pstream *p, pa_pstream_memblock_cb_t cb, void *userdata);
 void pa_pstream_set_drain_callback(pa_pstream *p, pa_pstream_notify_cb_t cb, void *userdata);
@@ -64,6 +76,16 @@ void pa_pstream_set_revoke_callback(pa_pstream *p, pa_pstream_block_id_cb_t cb,
 pa_bool_t pa_pstream_is_pending(pa_pstream *p);
 
 void pa_pstream_enable_shm(pa_pstream *p, pa_bool_t enable);
+/* The other side can map our memfd pool, SHM has to be enabled already */
+void pa_pstream_enable_memfd(pa_pstream *p);
+/* The other side takes releases and revokes of several blocks in one
+ * frame, SHM has to be enabled already */
+void pa_pstream_enable_block_id_arrays(pa_pstream *p);
 pa_bool_t pa_pstream_get_shm(pa_pstream *p);
 
+/* Continue on the shared ringbuffer srb once everything queued so far
+ * has been sent, and read from it once the other side does the
+ * same. Takes ownership of srb. */
+void pa_pstream_set_srbchannel(pa_pstream *p, pa_srbchannel *srb);
+
 #endif
@@ -159,6 +159,67 @@ static void remap_channels_matrix_c(pa_remap_t *m, void *dst, const void *src, u
     }
 }
 
+static void remap_arrange_c(pa_remap_t *m, void *dst, const void *src, unsigned n) {
+    unsigned oc, n_ic, n_oc;
+
+    n_ic = m->i_ss->channels;
+    n_oc = m->o_ss->channels;
+
+    switch (*m->format) {
+        case PA_SAMPLE_FLOAT32NE:
+        {
+            float *d = (float *) dst;
+            const float *s = (const float *) src;
+
+            for (; n > 0; n--, s += n_ic, d += n_oc)
+                for (oc = 0; oc < n_oc; oc++)
+                    d[oc] = m->arrange[oc] >= 0 ? s[m->arrange[oc]] : 0.0f;
+            break;
+        }
+        case PA_SAMPLE_S16NE:
+        {
+            int16_t *d = (int16_t *) dst;
+            const int16_t *s = (const int16_t *) src;
+
+            for (; n > 0; n--, s += n_ic, d += n_oc)
+                for (oc = 0; oc < n_oc; oc++)
+                    d[oc] = m->arrange[oc] >= 0 ? s[m->arrange[oc]] : 0;
+            break;
+        }
+        default:
+            pa_assert_not_reached();
+    }
+}
+
+pa_bool_t pa_setup_remap_arrange(pa_remap_t *m) {
+    unsigned oc, ic;
+    unsigned n_oc, n_ic;
+
+    n_oc = m->o_ss->channels;
+    n_ic = m->i_ss->channels;
+
+    /* every output channel has to take exactly one input channel at full
+     * volume, or none at all. Note that both matrix versions agree on
+     * which entries are <= 0 and >= 1.0 */
+    for (oc = 0; oc < n_oc; oc++) {
+        m->arrange[oc] = -1;
+
+        for (ic = 0; ic < n_ic; ic++) {
+            float vol = m->map_table_f[oc][ic];
+
+            if (vol <= 0.0)
+                continue;
+
+            if (vol < 1.0 || m->arrange[oc] >= 0)
+                return FALSE;
+
+            m->arrange[oc] = (int8_t) ic;
+        }
+    }
+
+    return TRUE;
+}
+
 /* set the function that will execute the remapping based on the matrices */
 static void init_remap_c(pa_remap_t *m) {
     unsigned n_oc, n_ic;
@@ -171,6 +232,9 @@ static void init_remap_c(pa_remap_t *m) {
             m->map_table_f[0][0] >= 1.0 && m->map_table_f[1][0] >= 1.0) {
         m->do_remap = (pa_do_remap_func_t) remap_mono_to_stereo_c;
         pa_log_info("Using mono to stereo remapping");
+    } else if (pa_setup_remap_arrange(m)) {
+        m->do_remap = (pa_do_remap_func_t) remap_arrange_c;
+        pa_log_info("Using channel arrange remapping");
     } else {
         m->do_remap = (pa_do_remap_func_t) remap_channels_matrix_c;
         pa_log_info("Using generic matrix remapping");
@@ -24,6 +24,7 @@
 ***/
 
 #include <pulse/sample.h>
+#include <pulsecore/macro.h>
 
 typedef struct pa_remap pa_remap_t;
 
@@ -35,10 +36,17 @@ struct pa_remap {
     float map_table_f[PA_CHANNELS_MAX][PA_CHANNELS_MAX];
     int32_t map_table_i[PA_CHANNELS_MAX][PA_CHANNELS_MAX];
     pa_do_remap_func_t do_remap;
+    /* input channel copied to each output channel, -1 for silence. Only
+     * valid if pa_setup_remap_arrange() returned TRUE. */
+    int8_t arrange[PA_CHANNELS_MAX];
 };
 
 void pa_init_remap (pa_remap_t *m);
 
+/* check if the matrix just copies (and possibly reorders or duplicates)
+ * input channels, and set up m->arrange if so */
+pa_bool_t pa_setup_remap_arrange(pa_remap_t *m);
+
 /* custom installation of init functions */
 typedef void (*pa_init_remap_func_t) (pa_remap_t *m);
 
@@ -24,6 +24,8 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include <pulse/sample.h>
 #include <pulsecore/log.h>
 #include <pulsecore/macro.h>
@@ -129,6 +131,585 @@ static void remap_mono_to_stereo_sse2(pa_remap_t *m, void *dst, const void *src,
     }
 }
 
+static unsigned remap_flags = 0;
+
+/* Number of leading frames for which reading 'width' bytes from the start of
+ * each frame stays within the buffer of n frames */
+static unsigned frames_within(unsigned n, unsigned fs, unsigned width) {
+    if (n * fs < width)
+        return 0;
+
+    return (n * fs - width) / fs + 1;
+}
+
+/* Saturate the matrix entries the same way remap_channels_matrix_c() treats
+ * them */
+static float clamp_vol_f(float vol) {
+    return vol <= 0.0f ? 0.0f : (vol >= 1.0f ? 1.0f : vol);
+}
+
+static int32_t clamp_vol_i(int32_t vol) {
+    return vol <= 0 ? 0 : (vol >= 0x10000 ? 0x10000 : vol);
+}
+
+/* The vector kernels leave a few frames at the end, so that they never read
+ * or write past the buffers. These are done one frame at a time here, with
+ * the same results as remap_channels_matrix_c(). */
+static void remap_frames_c(pa_remap_t *m, void *dst, const void *src, unsigned n) {
+    unsigned oc, ic, n_ic, n_oc;
+
+    n_ic = m->i_ss->channels;
+    n_oc = m->o_ss->channels;
+
+    switch (*m->format) {
+        case PA_SAMPLE_FLOAT32NE:
+        {
+            float *d = (float *) dst;
+            const float *s = (const float *) src;
+
+            for (; n > 0; n--, s += n_ic, d += n_oc)
+                for (oc = 0; oc < n_oc; oc++) {
+                    float sum = 0.0f;
+
+                    for (ic = 0; ic < n_ic; ic++) {
+                        float vol = m->map_table_f[oc][ic];
+
+                        if (vol <= 0.0f)
+                            continue;
+
+                        sum += vol >= 1.0f ? s[ic] : s[ic] * vol;
+                    }
+
+                    d[oc] = sum;
+                }
+            break;
+        }
+        case PA_SAMPLE_S16NE:
+        {
+            int16_t *d = (int16_t *) dst;
+            const int16_t *s = (const int16_t *) src;
+
+            for (; n > 0; n--, s += n_ic, d += n_oc)
+                for (oc = 0; oc < n_oc; oc++) {
+                    int16_t sum = 0;
+
+                    for (ic = 0; ic < n_ic; ic++) {
+                        int32_t vol = m->map_table_i[oc][ic];
+
+                        if (vol <= 0)
+                            continue;
+
+                        sum += vol >= 0x10000 ? s[ic] : (int16_t) (((int32_t) s[ic] * vol) >> 16);
+                    }
+
+                    d[oc] = sum;
+                }
+            break;
+        }
+        default:
+            pa_assert_not_reached();
+    }
+}
+
+static void remap_arrange_frames_c(pa_remap_t *m, void *dst, const void *src, unsigned n) {
+    unsigned oc, n_ic, n_oc;
+
+    n_ic = m->i_ss->channels;
+    n_oc = m->o_ss->channels;
+
+    switch (*m->format) {
+        case PA_SAMPLE_FLOAT32NE:
+        {
+            float *d = (float *) dst;
+            const float *s = (const float *) src;
+
+            for (; n > 0; n--, s += n_ic, d += n_oc)
+                for (oc = 0; oc < n_oc; oc++)
+                    d[oc] = m->arrange[oc] >= 0 ? s[m->arrange[oc]] : 0.0f;
+            break;
+        }
+        case PA_SAMPLE_S16NE:
+        {
+            int16_t *d = (int16_t *) dst;
+            const int16_t *s = (const int16_t *) src;
+
+            for (; n > 0; n--, s += n_ic, d += n_oc)
+                for (oc = 0; oc < n_oc; oc++)
+                    d[oc] = m->arrange[oc] >= 0 ? s[m->arrange[oc]] : 0;
+            break;
+        }
+        default:
+            pa_assert_not_reached();
+    }
+}
+
+static void remap_stereo_to_mono_sse2(pa_remap_t *m, void *dst, const void *src, unsigned n) {
+    pa_reg_x86 blocks;
+
+    switch (*m->format) {
+        case PA_SAMPLE_FLOAT32NE:
+        {
+            float vol[2];
+
+            vol[0] = clamp_vol_f(m->map_table_f[0][0]);
+            vol[1] = clamp_vol_f(m->map_table_f[0][1]);
+
+            if ((blocks = n / 4) > 0) {
+                __asm__ __volatile__ (
+                    " movss (%3), %%xmm6            \n\t"
+                    " shufps $0, %%xmm6, %%xmm6     \n\t" /* | vl | vl | vl | vl | */
+                    " movss 4(%3), %%xmm7           \n\t"
+                    " shufps $0, %%xmm7, %%xmm7     \n\t" /* | vr | vr | vr | vr | */
+
+                    "1:                             \n\t" /* do 4 frames at a time */
+                    " movups (%1), %%xmm0           \n\t" /* | r1 | l1 | r0 | l0 | */
+                    " movups 16(%1), %%xmm1         \n\t" /* | r3 | l3 | r2 | l2 | */
+                    " movaps %%xmm0, %%xmm2         \n\t"
+                    " shufps $0x88, %%xmm1, %%xmm0  \n\t" /* | l3 | l2 | l1 | l0 | */
+                    " shufps $0xdd, %%xmm1, %%xmm2  \n\t" /* | r3 | r2 | r1 | r0 | */
+                    " mulps %%xmm6, %%xmm0          \n\t"
+                    " mulps %%xmm7, %%xmm2          \n\t"
+                    " xorps %%xmm3, %%xmm3          \n\t" /* add in the same order as the C version */
+                    " addps %%xmm0, %%xmm3          \n\t"
+                    " addps %%xmm2, %%xmm3          \n\t"
+                    " movups %%xmm3, (%0)           \n\t"
+                    " add $32, %1                   \n\t"
+                    " add $16, %0                   \n\t"
+                    " dec %2                        \n\t"
+                    " jne 1b                        \n\t"
+                    : "+r" (dst), "+r" (src), "+r" (blocks)
+                    : "r" (vol)
+                    : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6", "xmm7"
+                );
+            }
+
+            remap_frames_c(m, dst, src, n & 3);
+            break;
+        }
+        case PA_SAMPLE_S16NE:
+        {
+            int16_t vol[4][8];
+            unsigned ic, i;
+
+            /* Multiply with pmulhw, which is signed. Volumes of 0x8000 and up
+             * are split into vol - 0x10000 and adding in the sample itself,
+             * which gives the same result as ((s * vol) >> 16). */
+            for (ic = 0; ic < 2; ic++) {
+                int32_t v = clamp_vol_i(m->map_table_i[0][ic]);
+
+                for (i = 0; i < 8; i++) {
+                    vol[ic * 2][i] = (int16_t) (v & 0xFFFF);
+                    vol[ic * 2 + 1][i] = v >= 0x8000 ? -1 : 0;
+                }
+            }
+
+            if ((blocks = n / 8) > 0) {
+                __asm__ __volatile__ (
+                    " movdqu (%3), %%xmm4           \n\t"
+                    " movdqu 16(%3), %%xmm5         \n\t"
+                    " movdqu 32(%3), %%xmm6         \n\t"
+                    " movdqu 48(%3), %%xmm7         \n\t"
+
+                    "1:                             \n\t" /* do 8 frames at a time */
+                    " movdqu (%1), %%xmm0           \n\t" /* | r3 | l3 | .. | r0 | l0 | */
+                    " movdqu 16(%1), %%xmm1         \n\t" /* | r7 | l7 | .. | r4 | l4 | */
+                    " movdqa %%xmm0, %%xmm2         \n\t"
+                    " movdqa %%xmm1, %%xmm3         \n\t"
+                    " pslld $16, %%xmm0             \n\t"
+                    " pslld $16, %%xmm1             \n\t"
+                    " psrad $16, %%xmm0             \n\t"
+                    " psrad $16, %%xmm1             \n\t"
+                    " psrad $16, %%xmm2             \n\t"
+                    " psrad $16, %%xmm3             \n\t"
+                    " packssdw %%xmm1, %%xmm0       \n\t" /* | l7 | .. | l0 | */
+                    " packssdw %%xmm3, %%xmm2       \n\t" /* | r7 | .. | r0 | */
+                    " movdqa %%xmm0, %%xmm1         \n\t"
+                    " movdqa %%xmm2, %%xmm3         \n\t"
+                    " pmulhw %%xmm4, %%xmm0         \n\t"
+                    " pand %%xmm5, %%xmm1           \n\t"
+                    " pmulhw %%xmm6, %%xmm2         \n\t"
+                    " pand %%xmm7, %%xmm3           \n\t"
+                    " paddw %%xmm1, %%xmm0          \n\t"
+                    " paddw %%xmm3, %%xmm2          \n\t"
+                    " paddw %%xmm2, %%xmm0          \n\t"
+                    " movdqu %%xmm0, (%0)           \n\t"
+                    " add $32, %1                   \n\t"
+                    " add $16, %0                   \n\t"
+                    " dec %2                        \n\t"
+                    " jne 1b                        \n\t"
+                    : "+r" (dst), "+r" (src), "+r" (blocks)
+                    : "r" (vol)
+                    : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7"
+                );
+            }
+
+            remap_frames_c(m, dst, src, n & 7);
+            break;
+        }
+        default:
+            pa_assert_not_reached();
+    }
+}
+
+/* Copy and reorder channels with one shuffle per frame. Every frame is
+ * loaded and stored as a whole vector, so the vector part stops short of the
+ * end of the buffers. */
+static void remap_arrange_ssse3(pa_remap_t *m, void *dst, const void *src, unsigned n) {
+    unsigned ss, in_fs, out_fs, oc, i;
+    pa_reg_x86 frames;
+
+    ss = (unsigned) pa_sample_size_of_format(*m->format);
+    in_fs = ss * m->i_ss->channels;
+    out_fs = ss * m->o_ss->channels;
+
+    if (in_fs <= 16 && out_fs <= 16) {
+        uint8_t mask[16];
+
+        memset(mask, 0x80, sizeof(mask));
+        for (oc = 0; oc < m->o_ss->channels; oc++)
+            if (m->arrange[oc] >= 0)
+                for (i = 0; i < ss; i++)
+                    mask[oc * ss + i] = (uint8_t) (m->arrange[oc] * ss + i);
+
+        frames = PA_MIN(frames_within(n, in_fs, 16), frames_within(n, out_fs, 16));
+
+        if (frames > 0) {
+            n -= (unsigned) frames;
+
+            __asm__ __volatile__ (
+                " movdqu (%3), %%xmm1           \n\t"
+
+                "1:                             \n\t"
+                " movdqu (%1), %%xmm0           \n\t"
+                " pshufb %%xmm1, %%xmm0         \n\t"
+                " movdqu %%xmm0, (%0)           \n\t"
+                " add %4, %1                    \n\t"
+                " add %5, %0                    \n\t"
+                " dec %2                        \n\t"
+                " jne 1b                        \n\t"
+                : "+r" (dst), "+r" (src), "+r" (frames)
+                : "r" (mask), "rm" ((pa_reg_x86) in_fs), "rm" ((pa_reg_x86) out_fs)
+                : "cc", "memory", "xmm0", "xmm1"
+            );
+        }
+    } else if (*m->format == PA_SAMPLE_FLOAT32NE && in_fs <= 32 && out_fs <= 32 &&
+               (remap_flags & PA_CPU_X86_AVX2)) {
+        int32_t perm[2][8];
+
+        for (oc = 0; oc < 8; oc++) {
+            pa_bool_t copy = oc < m->o_ss->channels && m->arrange[oc] >= 0;
+
+            perm[0][oc] = copy ? m->arrange[oc] : 0;
+            perm[1][oc] = copy ? -1 : 0;
+        }
+
+        frames = PA_MIN(frames_within(n, in_fs, 32), frames_within(n, out_fs, 32));
+
+        if (frames > 0) {
+            n -= (unsigned) frames;
+
+            __asm__ __volatile__ (
+                " vmovdqu (%3), %%ymm1          \n\t" /* permutation */
+                " vmovdqu 32(%3), %%ymm2        \n\t" /* silence mask */
+
+                "1:                             \n\t"
+                " vpermps (%1), %%ymm1, %%ymm0  \n\t"
+                " vandps %%ymm2, %%ymm0, %%ymm0 \n\t"
+                " vmovups %%ymm0, (%0)          \n\t"
+                " add %4, %1                    \n\t"
+                " add %5, %0                    \n\t"
+                " dec %2                        \n\t"
+                " jne 1b                        \n\t"
+                " vzeroupper                    \n\t"
+                : "+r" (dst), "+r" (src), "+r" (frames)
+                : "r" (perm), "rm" ((pa_reg_x86) in_fs), "rm" ((pa_reg_x86) out_fs)
+                : "cc", "memory", "xmm0", "xmm1", "xmm2"
+            );
+        }
+    }
+
+    remap_arrange_frames_c(m, dst, src, n);
+}
+
+/* Down mix of up to 8 channels to stereo. Each input frame is loaded as a
+ * whole vector, multiplied with both matrix rows, and the products of 4
+ * frames are summed horizontally into 4 output frames. The float version
+ * adds in a different order than the C version, so the results may differ in
+ * the last bit. The s16 version rounds every product like the C version and
+ * is exact. */
+static void remap_to_stereo_avx2(pa_remap_t *m, void *dst, const void *src, unsigned n) {
+    unsigned in_fs, ic;
+    pa_reg_x86 blocks;
+
+    switch (*m->format) {
+        case PA_SAMPLE_FLOAT32NE:
+        {
+            float vol[2][8];
+
+            memset(vol, 0, sizeof(vol));
+            for (ic = 0; ic < m->i_ss->channels; ic++) {
+                vol[0][ic] = clamp_vol_f(m->map_table_f[0][ic]);
+                vol[1][ic] = clamp_vol_f(m->map_table_f[1][ic]);
+            }
+
+            in_fs = m->i_ss->channels * sizeof(float);
+            blocks = frames_within(n, in_fs, 32) / 4;
+
+            if (blocks > 0) {
+                n -= (unsigned) blocks * 4;
+
+                __asm__ __volatile__ (
+                    " vmovups (%4), %%ymm6                       \n\t" /* left row */
+                    " vmovups 32(%4), %%ymm7                     \n\t" /* right row */
+
+                    "1:                                          \n\t" /* do 4 frames at a time */
+                    " vmovups (%1), %%ymm0                       \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vmovups (%1), %%ymm2                       \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vmulps %%ymm7, %%ymm0, %%ymm1              \n\t"
+                    " vmulps %%ymm6, %%ymm0, %%ymm0              \n\t"
+                    " vmulps %%ymm7, %%ymm2, %%ymm3              \n\t"
+                    " vmulps %%ymm6, %%ymm2, %%ymm2              \n\t"
+                    " vhaddps %%ymm1, %%ymm0, %%ymm0             \n\t"
+                    " vhaddps %%ymm3, %%ymm2, %%ymm2             \n\t"
+                    " vhaddps %%ymm2, %%ymm0, %%ymm0             \n\t" /* | r1 | l1 | r0 | l0 | x 2 */
+
+                    " vmovups (%1), %%ymm2                       \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vmovups (%1), %%ymm4                       \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vmulps %%ymm7, %%ymm2, %%ymm3              \n\t"
+                    " vmulps %%ymm6, %%ymm2, %%ymm2              \n\t"
+                    " vmulps %%ymm7, %%ymm4, %%ymm5              \n\t"
+                    " vmulps %%ymm6, %%ymm4, %%ymm4              \n\t"
+                    " vhaddps %%ymm3, %%ymm2, %%ymm2             \n\t"
+                    " vhaddps %%ymm5, %%ymm4, %%ymm4             \n\t"
+                    " vhaddps %%ymm4, %%ymm2, %%ymm2             \n\t" /* | r3 | l3 | r2 | l2 | x 2 */
+
+                    " vperm2f128 $0x20, %%ymm2, %%ymm0, %%ymm1   \n\t"
+                    " vperm2f128 $0x31, %%ymm2, %%ymm0, %%ymm0   \n\t"
+                    " vaddps %%ymm1, %%ymm0, %%ymm0              \n\t" /* | r3 | l3 | .. | r0 | l0 | */
+                    " vmovups %%ymm0, (%0)                       \n\t"
+                    " add $32, %0                                \n\t"
+                    " dec %2                                     \n\t"
+                    " jne 1b                                     \n\t"
+                    " vzeroupper                                 \n\t"
+                    : "+r" (dst), "+r" (src), "+r" (blocks)
+                    : "rm" ((pa_reg_x86) in_fs), "r" (vol)
+                    : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7"
+                );
+            }
+            break;
+        }
+        case PA_SAMPLE_S16NE:
+        {
+            int32_t vol[2][8];
+
+            memset(vol, 0, sizeof(vol));
+            for (ic = 0; ic < m->i_ss->channels; ic++) {
+                vol[0][ic] = clamp_vol_i(m->map_table_i[0][ic]);
+                vol[1][ic] = clamp_vol_i(m->map_table_i[1][ic]);
+            }
+
+            in_fs = m->i_ss->channels * sizeof(int16_t);
+            blocks = frames_within(n, in_fs, 16) / 4;
+
+            if (blocks > 0) {
+                n -= (unsigned) blocks * 4;
+
+                __asm__ __volatile__ (
+                    " vmovdqu (%4), %%ymm6                       \n\t" /* left row */
+                    " vmovdqu 32(%4), %%ymm7                     \n\t" /* right row */
+
+                    "1:                                          \n\t" /* do 4 frames at a time */
+                    " vpmovsxwd (%1), %%ymm0                     \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vpmovsxwd (%1), %%ymm2                     \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vpmulld %%ymm7, %%ymm0, %%ymm1             \n\t"
+                    " vpmulld %%ymm6, %%ymm0, %%ymm0             \n\t"
+                    " vpmulld %%ymm7, %%ymm2, %%ymm3             \n\t"
+                    " vpmulld %%ymm6, %%ymm2, %%ymm2             \n\t"
+                    " vpsrad $16, %%ymm0, %%ymm0                 \n\t"
+                    " vpsrad $16, %%ymm1, %%ymm1                 \n\t"
+                    " vpsrad $16, %%ymm2, %%ymm2                 \n\t"
+                    " vpsrad $16, %%ymm3, %%ymm3                 \n\t"
+                    " vphaddd %%ymm1, %%ymm0, %%ymm0             \n\t"
+                    " vphaddd %%ymm3, %%ymm2, %%ymm2             \n\t"
+                    " vphaddd %%ymm2, %%ymm0, %%ymm0             \n\t" /* | r1 | l1 | r0 | l0 | x 2 */
+
+                    " vpmovsxwd (%1), %%ymm2                     \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vpmovsxwd (%1), %%ymm4                     \n\t"
+                    " add %3, %1                                 \n\t"
+                    " vpmulld %%ymm7, %%ymm2, %%ymm3             \n\t"
+                    " vpmulld %%ymm6, %%ymm2, %%ymm2             \n\t"
+                    " vpmulld %%ymm7, %%ymm4, %%ymm5             \n\t"
+                    " vpmulld %%ymm6, %%ymm4, %%ymm4             \n\t"
+                    " vpsrad $16, %%ymm2, %%ymm2                 \n\t"
+                    " vpsrad $16, %%ymm3, %%ymm3                 \n\t"
+                    " vpsrad $16, %%ymm4, %%ymm4                 \n\t"
+                    " vpsrad $16, %%ymm5, %%ymm5                 \n\t"
+                    " vphaddd %%ymm3, %%ymm2, %%ymm2             \n\t"
+                    " vphaddd %%ymm5, %%ymm4, %%ymm4             \n\t"
+                    " vphaddd %%ymm4, %%ymm2, %%ymm2             \n\t" /* | r3 | l3 | r2 | l2 | x 2 */
+
+                    " vperm2i128 $0x20, %%ymm2, %%ymm0, %%ymm1   \n\t"
+                    " vperm2i128 $0x31, %%ymm2, %%ymm0, %%ymm0   \n\t"
+                    " vpaddd %%ymm1, %%ymm0, %%ymm0              \n\t" /* | r3 | l3 | .. | r0 | l0 | */
+                    " vpslld $16, %%ymm0, %%ymm0                 \n\t" /* wrap around like the */
+                    " vpsrad $16, %%ymm0, %%ymm0                 \n\t" /* 16 bit sum in C */
+                    " vpackssdw %%ymm0, %%ymm0, %%ymm0           \n\t"
+                    " vpermq $0x08, %%ymm0, %%ymm0               \n\t"
+                    " vmovdqu %%xmm0, (%0)                       \n\t"
+                    " add $16, %0                                \n\t"
+                    " dec %2                                     \n\t"
+                    " jne 1b                                     \n\t"
+                    " vzeroupper                                 \n\t"
+                    : "+r" (dst), "+r" (src), "+r" (blocks)
+                    : "rm" ((pa_reg_x86) in_fs), "r" (vol)
+                    : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7"
+                );
+            }
+            break;
+        }
+        default:
+            pa_assert_not_reached();
+    }
+
+    remap_frames_c(m, dst, src, n);
+}
+
+/* One input channel that contributes to the output, with its volume for all
+ * (up to 8) output channels */
+typedef struct remap_column {
+    union {
+        float f[8];
+        int32_t i[8];
+    } vol;
+    pa_reg_x86 offset; /* of the input channel in a frame, in bytes */
+    uint8_t padding[32 - sizeof(pa_reg_x86)];
+} remap_column;
+
+/* Generic matrix for up to 8 output channels. For every frame the input
+ * channels that are used at all are broadcast, multiplied with their column
+ * of the matrix and summed up, so that zero columns cost nothing. This adds
+ * in the same order as the C version. */
+static void remap_channels_matrix_avx2(pa_remap_t *m, void *dst, const void *src, unsigned n) {
+    remap_column columns[PA_CHANNELS_MAX];
+    unsigned oc, ic, n_ic, n_oc, n_columns = 0, ss, out_width;
+    pa_reg_x86 frames, c, offset;
+
+    n_ic = m->i_ss->channels;
+    n_oc = m->o_ss->channels;
+    ss = (unsigned) pa_sample_size_of_format(*m->format);
+
+    for (ic = 0; ic < n_ic; ic++) {
+        remap_column *col = &columns[n_columns];
+        pa_bool_t used = FALSE;
+
+        memset(col, 0, sizeof(*col));
+        col->offset = ic * ss;
+
+        for (oc = 0; oc < n_oc; oc++) {
+            if (*m->format == PA_SAMPLE_FLOAT32NE)
+                col->vol.f[oc] = clamp_vol_f(m->map_table_f[oc][ic]);
+            else
+                col->vol.i[oc] = clamp_vol_i(m->map_table_i[oc][ic]);
+
+            if (col->vol.i[oc] != 0)
+                used = TRUE;
+        }
+
+        if (used)
+            n_columns++;
+    }
+
+    if (n_columns == 0) {
+        memset(dst, 0, n * n_oc * ss);
+        return;
+    }
+
+    /* each frame is stored as a full vector of 8 samples */
+    out_width = (*m->format == PA_SAMPLE_FLOAT32NE) ? 32 : 16;
+    frames = frames_within(n, n_oc * ss, out_width);
+
+    if (frames > 0) {
+        n -= (unsigned) frames;
+
+        switch (*m->format) {
+            case PA_SAMPLE_FLOAT32NE:
+                __asm__ __volatile__ (
+                    "1:                                 \n\t"
+                    " vxorps %%ymm0, %%ymm0, %%ymm0     \n\t"
+                    " mov %5, %3                        \n\t"
+
+                    "2:                                 \n\t" /* for all used input channels */
+                    " mov 32(%3), %4                    \n\t"
+                    " vbroadcastss (%1,%4), %%ymm1      \n\t"
+                    " vmulps (%3), %%ymm1, %%ymm1       \n\t"
+                    " vaddps %%ymm1, %%ymm0, %%ymm0     \n\t"
+                    " add $64, %3                       \n\t"
+                    " cmp %6, %3                        \n\t"
+                    " jb 2b                             \n\t"
+
+                    " vmovups %%ymm0, (%0)              \n\t"
+                    " add %7, %1                        \n\t"
+                    " add %8, %0                        \n\t"
+                    " dec %2                            \n\t"
+                    " jne 1b                            \n\t"
+                    " vzeroupper                        \n\t"
+                    : "+r" (dst), "+r" (src), "+r" (frames), "=&r" (c), "=&r" (offset)
+                    : "rm" ((pa_reg_x86) columns), "rm" ((pa_reg_x86) (columns + n_columns)),
+                      "rm" ((pa_reg_x86) (n_ic * ss)), "rm" ((pa_reg_x86) (n_oc * ss))
+                    : "cc", "memory", "xmm0", "xmm1"
+                );
+                break;
+
+            case PA_SAMPLE_S16NE:
+                __asm__ __volatile__ (
+                    "1:                                 \n\t"
+                    " vpxor %%ymm0, %%ymm0, %%ymm0      \n\t"
+                    " mov %5, %3                        \n\t"
+
+                    "2:                                 \n\t" /* for all used input channels */
+                    " mov 32(%3), %4                    \n\t"
+                    " movswl (%1,%4), %k4               \n\t"
+                    " vmovd %k4, %%xmm1                 \n\t"
+                    " vpbroadcastd %%xmm1, %%ymm1       \n\t"
+                    " vpmulld (%3), %%ymm1, %%ymm1      \n\t"
+                    " vpsrad $16, %%ymm1, %%ymm1        \n\t"
+                    " vpaddd %%ymm1, %%ymm0, %%ymm0     \n\t"
+                    " add $64, %3                       \n\t"
+                    " cmp %6, %3                        \n\t"
+                    " jb 2b                             \n\t"
+
+                    " vpslld $16, %%ymm0, %%ymm0        \n\t" /* wrap around like the */
+                    " vpsrad $16, %%ymm0, %%ymm0        \n\t" /* 16 bit sum in C */
+                    " vpackssdw %%ymm0, %%ymm0, %%ymm0  \n\t"
+                    " vpermq $0x08, %%ymm0, %%ymm0      \n\t"
+                    " vmovdqu %%xmm0, (%0)              \n\t"
+                    " add %7, %1                        \n\t"
+                    " add %8, %0                        \n\t"
+                    " dec %2                            \n\t"
+                    " jne 1b                            \n\t"
+                    " vzeroupper                        \n\t"
+                    : "+r" (dst), "+r" (src), "+r" (frames), "=&r" (c), "=&r" (offset)
+                    : "rm" ((pa_reg_x86) columns), "rm" ((pa_reg_x86) (columns + n_columns)),
+                      "rm" ((pa_reg_x86) (n_ic * ss)), "rm" ((pa_reg_x86) (n_oc * ss))
+                    : "cc", "memory", "xmm0", "xmm1"
+                );
+                break;
+
+            default:
+                pa_assert_not_reached();
+        }
+    }
+
+    remap_frames_c(m, dst, src, n);
+}
+
 /* set the function that will execute the remapping based on the matrices */
 static void init_remap_sse2(pa_remap_t *m) {
     unsigned n_oc, n_ic;
@@ -141,6 +722,20 @@ static void init_remap_sse2(pa_remap_t *m) {
             m->map_table_f[0][0] >= 1.0 && m->map_table_f[1][0] >= 1.0) {
         m->do_remap = (pa_do_remap_func_t) remap_mono_to_stereo_sse2;
         pa_log_info("Using SSE mono to stereo remapping");
+    } else if (n_ic == 2 && n_oc == 1) {
+        m->do_remap = (pa_do_remap_func_t) remap_stereo_to_mono_sse2;
+        pa_log_info("Using SSE stereo to mono remapping");
+    } else if (pa_setup_remap_arrange(m)) {
+        if (remap_flags & PA_CPU_X86_SSSE3) {
+            m->do_remap = (pa_do_remap_func_t) remap_arrange_ssse3;
+            pa_log_info("Using SSSE3 channel arrange remapping");
+        }
+    } else if ((remap_flags & PA_CPU_X86_AVX2) && n_oc == 2 && n_ic <= 8) {
+        m->do_remap = (pa_do_remap_func_t) remap_to_stereo_avx2;
+        pa_log_info("Using AVX2 down mix to stereo remapping");
+    } else if ((remap_flags & PA_CPU_X86_AVX2) && n_oc <= 8) {
+        m->do_remap = (pa_do_remap_func_t) remap_channels_matrix_avx2;
+        pa_log_info("Using AVX2 generic matrix remapping");
     }
 }
 #endif /* defined (__i386__) || defined (__amd64__) */
@@ -149,6 +744,7 @@ void pa_remap_func_init_sse(pa_cpu_x86_flag_t flags) {
 #if defined (__i386__) || defined (__amd64__)
 
     if (flags & PA_CPU_X86_SSE2) {
+        remap_flags = flags;
         pa_log_info("Initialising SSE2 optimized remappers.");
         pa_set_init_remap_func ((pa_init_remap_func_t) init_remap_sse2);
     }
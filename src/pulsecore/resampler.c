@@ -39,7 +39,9 @@
 #include <pulsecore/macro.h>
 #include <pulsecore/strbuf.h>
 #include <pulsecore/remap.h>
+#include <pulsecore/sinc.h>
 #include <pulsecore/core-util.h>
+#include <pulsecore/sample-util.h>
 #include "ffmpeg/avcodec.h"
 
 #include "resampler.h"
@@ -47,6 +49,11 @@
 /* Number of samples of extra space we allow the resamplers to return */
 #define EXTRA_FRAMES 128
 
+/* Number of frames the fused pipeline pushes through all stages at once.
+ * Together with EXTRA_FRAMES this sizes the scratch buffers, which should
+ * stay in the cache. */
+#define FUSED_BLOCK_FRAMES 256
+
 struct pa_resampler {
     pa_resample_method_t method;
     pa_resample_flags_t flags;
@@ -66,6 +73,15 @@ struct pa_resampler {
     unsigned from_work_format_buf_samples;
     pa_bool_t remap_buf_contains_leftover_data;
 
+    /* Scratch buffers for the fused pipeline, used alternately by
+     * consecutive stages. Only allocated if the fused pipeline is
+     * used at all. */
+    pa_memchunk fused_buf[2];
+    unsigned fused_buf_frames;
+
+    /* Handed out for silent input when there is no rate conversion */
+    pa_silence_cache silence_cache;
+
     pa_sample_format_t work_format;
 
     pa_convert_func_t to_work_format_func;
@@ -109,6 +125,10 @@ struct pa_resampler {
         struct AVResampleContext *state;
         pa_memchunk buf[PA_CHANNELS_MAX];
     } ffmpeg;
+
+    struct { /* data specific to the built-in sinc resampler */
+        pa_sinc_resampler *state;
+    } sinc;
 };
 
 static int copy_init(pa_resampler *r);
@@ -118,11 +138,13 @@ static int speex_init(pa_resampler*r);
 #endif
 static int ffmpeg_init(pa_resampler*r);
 static int peaks_init(pa_resampler*r);
+static int sinc_init(pa_resampler*r);
 #ifdef HAVE_LIBSAMPLERATE
 static int libsamplerate_init(pa_resampler*r);
 #endif
 
 static void calc_map_table(pa_resampler *r);
+static void fused_init(pa_resampler *r);
 
 static int (* const init_table[])(pa_resampler*r) = {
 #ifdef HAVE_LIBSAMPLERATE
@@ -190,6 +212,10 @@ static int (* const init_table[])(pa_resampler*r) = {
     [PA_RESAMPLER_AUTO]                    = NULL,
     [PA_RESAMPLER_COPY]                    = copy_init,
     [PA_RESAMPLER_PEAKS]                   = peaks_init,
+    [PA_RESAMPLER_SINC_BASE+0]             = sinc_init,
+    [PA_RESAMPLER_SINC_BASE+1]             = sinc_init,
+    [PA_RESAMPLER_SINC_BASE+2]             = sinc_init,
+    [PA_RESAMPLER_SINC_BASE+3]             = sinc_init,
 };
 
 pa_resampler* pa_resampler_new(
@@ -246,6 +272,8 @@ pa_resampler* pa_resampler_new(
     r->method = method;
     r->flags = flags;
 
+    pa_silence_cache_init(&r->silence_cache);
+
     /* Fill sample specs */
     r->i_ss = *a;
     r->o_ss = *b;
@@ -327,6 +355,8 @@ pa_resampler* pa_resampler_new(
     if (init_table[method](r) < 0)
         goto fail;
 
+    fused_init(r);
+
     return r;
 
 fail:
@@ -349,6 +379,12 @@ void pa_resampler_free(pa_resampler *r) {
         pa_memblock_unref(r->resample_buf.memblock);
     if (r->from_work_format_buf.memblock)
         pa_memblock_unref(r->from_work_format_buf.memblock);
+    if (r->fused_buf[0].memblock)
+        pa_memblock_unref(r->fused_buf[0].memblock);
+    if (r->fused_buf[1].memblock)
+        pa_memblock_unref(r->fused_buf[1].memblock);
+
+    pa_silence_cache_done(&r->silence_cache);
 
     pa_xfree(r);
 }
@@ -508,7 +544,11 @@ static const char * const resample_methods[] = {
     "ffmpeg",
     "auto",
     "copy",
-    "peaks"
+    "peaks",
+    "sinc-0",
+    "sinc-1",
+    "sinc-2",
+    "sinc-3"
 };
 
 const char *pa_resample_method_to_string(pa_resample_method_t m) {
@@ -554,6 +594,9 @@ pa_resample_method_t pa_parse_resample_method(const char *string) {
     if (pa_streq(string, "speex-float"))
         return PA_RESAMPLER_SPEEX_FLOAT_BASE + 3;
 
+    if (pa_streq(string, "sinc"))
+        return PA_RESAMPLER_SINC_BASE + 2;
+
     return PA_RESAMPLER_INVALID;
 }
 
@@ -1272,6 +1315,216 @@ static pa_memchunk *convert_from_work_format(pa_resampler *r, pa_memchunk *input
     return &r->from_work_format_buf;
 }
 
+static unsigned fused_stages(pa_resampler *r) {
+    unsigned n = 0;
+
+    pa_assert(r);
+
+    if (r->to_work_format_func)
+        n++;
+    if (r->map_required)
+        n++;
+    if (r->impl_resample)
+        n++;
+    if (r->from_work_format_func)
+        n++;
+
+    return n;
+}
+
+static void fused_init(pa_resampler *r) {
+    size_t length;
+    unsigned k;
+
+    pa_assert(r);
+
+    /* libsamplerate and ffmpeg may not consume all of their input and
+     * hand the rest back via save_leftover(), which only the staged
+     * pipeline knows how to feed in again. With less than two stages
+     * there is nothing to fuse. */
+    if (r->method <= PA_RESAMPLER_SRC_LINEAR || r->method == PA_RESAMPLER_FFMPEG)
+        return;
+
+    if (fused_stages(r) < 2)
+        return;
+
+    r->fused_buf_frames = FUSED_BLOCK_FRAMES + EXTRA_FRAMES;
+    length = r->fused_buf_frames * r->w_sz * PA_MAX(r->i_ss.channels, r->o_ss.channels);
+
+    for (k = 0; k < 2; k++) {
+        r->fused_buf[k].memblock = pa_memblock_new_malloced(r->mempool, pa_xmalloc(length), length);
+        r->fused_buf[k].index = 0;
+        r->fused_buf[k].length = length;
+    }
+}
+
+/* Returns where the next stage of the fused pipeline should write to:
+ * the output block if it is the last stage, otherwise the scratch buffer
+ * that the previous stage did not write to. */
+static void *fused_target(pa_resampler *r, pa_bool_t last, void *scratch[2], unsigned *k, const pa_memchunk *out, void *out_ptr, size_t out_index, pa_memchunk *target) {
+    void *p;
+
+    if (last) {
+        *target = *out;
+        target->index = out_index;
+        return (uint8_t*) out_ptr + out_index;
+    }
+
+    *target = r->fused_buf[*k];
+    p = scratch[*k];
+
+    *k ^= 1;
+
+    return p;
+}
+
+static void run_fused(pa_resampler *r, const pa_memchunk *in, pa_memchunk *out) {
+    unsigned in_n_frames, out_n_frames, block_frames, i, n, stages;
+    size_t out_index = 0;
+    void *in_ptr, *out_ptr, *scratch[2];
+
+    pa_assert(r);
+    pa_assert(in);
+    pa_assert(out);
+
+    /* Instead of running every stage over the whole input and bouncing
+     * it through a memblock per stage, push small blocks of frames
+     * through all stages. Intermediate results stay in the two scratch
+     * buffers and only the last stage writes into a newly allocated
+     * block. */
+
+    stages = fused_stages(r);
+    in_n_frames = (unsigned) (in->length / r->i_fz);
+
+    if (r->impl_resample) {
+        out_n_frames = ((in_n_frames * r->o_ss.rate) / r->i_ss.rate) + EXTRA_FRAMES;
+
+        /* The resampler output has to fit into a scratch buffer, too */
+        block_frames = (unsigned) (((uint64_t) (r->fused_buf_frames - EXTRA_FRAMES) * r->i_ss.rate) / r->o_ss.rate);
+        block_frames = PA_CLAMP(block_frames, 1U, r->fused_buf_frames);
+    } else {
+        out_n_frames = in_n_frames;
+        block_frames = r->fused_buf_frames;
+    }
+
+    out->memblock = pa_memblock_new(r->mempool, out_n_frames * r->o_fz);
+    out->index = 0;
+    out->length = out_n_frames * r->o_fz;
+
+    in_ptr = (uint8_t*) pa_memblock_acquire(in->memblock) + in->index;
+    out_ptr = pa_memblock_acquire(out->memblock);
+    scratch[0] = pa_memblock_acquire(r->fused_buf[0].memblock);
+    scratch[1] = pa_memblock_acquire(r->fused_buf[1].memblock);
+
+    for (i = 0; i < in_n_frames; i += n) {
+        pa_memchunk chunk, target;
+        unsigned stage = 0, k = 0, n_frames;
+        void *src, *dst;
+
+        n = PA_MIN(block_frames, in_n_frames - i);
+        n_frames = n;
+
+        chunk.memblock = in->memblock;
+        chunk.index = in->index + i * r->i_fz;
+        chunk.length = n * r->i_fz;
+        src = (uint8_t*) in_ptr + i * r->i_fz;
+
+        if (r->to_work_format_func) {
+            dst = fused_target(r, ++stage == stages, scratch, &k, out, out_ptr, out_index, &target);
+            r->to_work_format_func(n * r->i_ss.channels, src, dst);
+            chunk = target;
+            src = dst;
+        }
+
+        if (r->map_required) {
+            pa_assert(r->remap.do_remap);
+
+            dst = fused_target(r, ++stage == stages, scratch, &k, out, out_ptr, out_index, &target);
+            r->remap.do_remap(&r->remap, dst, src, n);
+            chunk = target;
+            src = dst;
+        }
+
+        if (r->impl_resample) {
+            pa_bool_t last = ++stage == stages;
+
+            if (last)
+                n_frames = (unsigned) ((out->length - out_index) / r->o_fz);
+            else
+                n_frames = r->fused_buf_frames;
+
+            dst = fused_target(r, last, scratch, &k, out, out_ptr, out_index, &target);
+            r->impl_resample(r, &chunk, n, &target, &n_frames);
+            src = dst;
+        }
+
+        if (r->from_work_format_func) {
+            dst = fused_target(r, TRUE, scratch, &k, out, out_ptr, out_index, &target);
+            r->from_work_format_func(n_frames * r->o_ss.channels, src, dst);
+        }
+
+        out_index += n_frames * r->o_fz;
+    }
+
+    pa_memblock_release(in->memblock);
+    pa_memblock_release(out->memblock);
+    pa_memblock_release(r->fused_buf[0].memblock);
+    pa_memblock_release(r->fused_buf[1].memblock);
+
+    if (out_index > 0)
+        out->length = out_index;
+    else {
+        pa_memblock_unref(out->memblock);
+        pa_memchunk_reset(out);
+    }
+}
+
+static pa_bool_t run_silence(pa_resampler *r, const pa_memchunk *in, pa_memchunk *out) {
+    size_t length;
+
+    pa_assert(r);
+    pa_assert(in);
+    pa_assert(out);
+
+    /* Without rate conversion there is no filter history that could
+     * still ring, so silent input gives silent output and we can hand
+     * out a shared silence block instead of converting anything */
+
+    if (r->impl_resample)
+        return FALSE;
+
+    length = (in->length / r->i_fz) * r->o_fz;
+    pa_silence_memchunk_get(&r->silence_cache, r->mempool, out, &r->o_ss, length);
+
+    if (out->length == length)
+        return TRUE;
+
+    /* Longer than the cached block */
+    pa_memblock_unref(out->memblock);
+    pa_memchunk_reset(out);
+
+    return FALSE;
+}
+
+static void mark_silence(pa_resampler *r, pa_memchunk *c) {
+    void *d;
+
+    pa_assert(r);
+    pa_assert(c);
+
+    /* Silent input was resampled. Once the history of the filter has
+     * run empty the output is silence again, and we flag it so that
+     * volume and mixing can skip it. The block is always one we
+     * allocated for this output. */
+
+    d = pa_memblock_acquire(c->memblock);
+
+    if (pa_memory_is_silence((uint8_t*) d + c->index, c->length, &r->o_ss))
+        pa_memblock_set_is_silence(c->memblock, TRUE);
+
+    pa_memblock_release(c->memblock);
+}
+
 void pa_resampler_run(pa_resampler *r, const pa_memchunk *in, pa_memchunk *out) {
     pa_memchunk *buf;
 
@@ -1282,21 +1535,31 @@ void pa_resampler_run(pa_resampler *r, const pa_memchunk *in, pa_memchunk *out)
     pa_assert(in->memblock);
     pa_assert(in->length % r->i_fz == 0);
 
-    buf = (pa_memchunk*) in;
-    buf = convert_to_work_format(r, buf);
-    buf = remap_channels(r, buf);
-    buf = resample(r, buf);
+    if (pa_memblock_is_silence(in->memblock) && run_silence(r, in, out))
+        return;
 
-    if (buf->length) {
-        buf = convert_from_work_format(r, buf);
-        *out = *buf;
+    if (r->fused_buf[0].memblock)
+        run_fused(r, in, out);
+    else {
+        buf = (pa_memchunk*) in;
+        buf = convert_to_work_format(r, buf);
+        buf = remap_channels(r, buf);
+        buf = resample(r, buf);
 
-        if (buf == in)
-            pa_memblock_ref(buf->memblock);
-        else
-            pa_memchunk_reset(buf);
-    } else
-        pa_memchunk_reset(out);
+        if (buf->length) {
+            buf = convert_from_work_format(r, buf);
+            *out = *buf;
+
+            if (buf == in)
+                pa_memblock_ref(buf->memblock);
+            else
+                pa_memchunk_reset(buf);
+        } else
+            pa_memchunk_reset(out);
+    }
+
+    if (out->memblock && out->memblock != in->memblock && pa_memblock_is_silence(in->memblock))
+        mark_silence(r, out);
 }
 
 static void save_leftover(pa_resampler *r, void *buf, size_t len) {
@@ -1600,7 +1863,7 @@ static void peaks_resample(pa_resampler *r, const pa_memchunk *input, unsigned i
                 o_index++, r->peaks.o_counter++;
             }
         } else if (r->work_format == PA_SAMPLE_S16NE) {
-            int16_t *s = (int16_t*) src + r->i_ss.channels * i;
+            int16_t *s = (int16_t*) src + r->o_ss.channels * i;
             int16_t *d = (int16_t*) dst + r->o_ss.channels * o_index;
 
             for (; i < i_end && i < in_n_frames; i++)
@@ -1619,7 +1882,7 @@ static void peaks_resample(pa_resampler *r, const pa_memchunk *input, unsigned i
                 o_index++, r->peaks.o_counter++;
             }
         } else {
-            float *s = (float*) src + r->i_ss.channels * i;
+            float *s = (float*) src + r->o_ss.channels * i;
             float *d = (float*) dst + r->o_ss.channels * o_index;
 
             for (; i < i_end && i < in_n_frames; i++)
@@ -1786,6 +2049,66 @@ static int ffmpeg_init(pa_resampler *r) {
     return 0;
 }
 
+/*** built-in polyphase sinc implementation ***/
+
+static void sinc_resample(pa_resampler *r, const pa_memchunk *input, unsigned in_n_frames, pa_memchunk *output, unsigned *out_n_frames) {
+    float *in, *out;
+
+    pa_assert(r);
+    pa_assert(input);
+    pa_assert(output);
+    pa_assert(out_n_frames);
+
+    in = (float*) ((uint8_t*) pa_memblock_acquire(input->memblock) + input->index);
+    out = (float*) ((uint8_t*) pa_memblock_acquire(output->memblock) + output->index);
+
+    *out_n_frames = pa_sinc_resampler_run(r->sinc.state, in, in_n_frames, out, *out_n_frames);
+
+    pa_memblock_release(input->memblock);
+    pa_memblock_release(output->memblock);
+}
+
+static void sinc_update_rates(pa_resampler *r) {
+    pa_assert(r);
+
+    pa_sinc_resampler_set_rates(r->sinc.state, r->i_ss.rate, r->o_ss.rate);
+}
+
+static void sinc_reset(pa_resampler *r) {
+    pa_assert(r);
+
+    pa_sinc_resampler_reset(r->sinc.state);
+}
+
+static void sinc_free(pa_resampler *r) {
+    pa_assert(r);
+
+    if (!r->sinc.state)
+        return;
+
+    pa_sinc_resampler_free(r->sinc.state);
+}
+
+static int sinc_init(pa_resampler *r) {
+    unsigned q;
+
+    pa_assert(r);
+    pa_assert(r->work_format == PA_SAMPLE_FLOAT32NE);
+
+    r->impl_free = sinc_free;
+    r->impl_update_rates = sinc_update_rates;
+    r->impl_reset = sinc_reset;
+    r->impl_resample = sinc_resample;
+
+    q = r->method - PA_RESAMPLER_SINC_BASE;
+
+    pa_log_info("Choosing sinc quality setting %u.", q);
+
+    r->sinc.state = pa_sinc_resampler_new(r->o_ss.channels, r->i_ss.rate, r->o_ss.rate, q);
+
+    return 0;
+}
+
 /*** copy (noop) implementation ***/
 
 static int copy_init(pa_resampler *r) {
@@ -45,6 +45,8 @@ typedef enum pa_resample_method {
     PA_RESAMPLER_AUTO, /* automatic select based on sample format */
     PA_RESAMPLER_COPY,
     PA_RESAMPLER_PEAKS,
+    PA_RESAMPLER_SINC_BASE,
+    PA_RESAMPLER_SINC_MAX = PA_RESAMPLER_SINC_BASE + 3,
     PA_RESAMPLER_MAX
 } pa_resample_method_t;
 
@@ -29,6 +29,12 @@
 #include <string.h>
 #include <errno.h>
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#define USE_EPOLL 1
+#endif
+
 #include <pulse/xmalloc.h>
 #include <pulse/timeval.h>
 
@@ -46,6 +52,11 @@
 
 /* #define DEBUG_TIMING */
 
+#ifdef USE_EPOLL
+/* epoll_event.data of the timerfd, the items' pollfds use their index */
+#define EPOLL_TIMER_INDEX ((uint32_t) -1)
+#endif
+
 struct pa_rtpoll {
     struct pollfd *pollfd, *pollfd2;
     unsigned n_pollfd_alloc, n_pollfd_used;
@@ -53,6 +64,20 @@ struct pa_rtpoll {
     struct timeval next_elapse;
     pa_bool_t timer_enabled:1;
 
+#ifdef USE_EPOLL
+    /* While timer_fd is valid, the pollfds of the items are mirrored
+     * into an epoll set, which only needs to be told about the entries
+     * that changed since the last run. The timer is a timerfd in the
+     * same set, armed with absolute deadlines. epoll_registered is what
+     * the set knows about each pollfd, fd is -1 if not registered. */
+    int epoll_fd, timer_fd;
+    struct pollfd *epoll_registered;
+    struct epoll_event *epoll_events;
+    unsigned n_epoll_alloc;
+    struct timeval timer_armed;
+    pa_bool_t epoll_rebuild_needed:1;
+#endif
+
     pa_bool_t scan_for_dead:1;
     pa_bool_t running:1;
     pa_bool_t rebuild_needed:1;
@@ -95,6 +120,14 @@ pa_rtpoll *pa_rtpoll_new(void) {
     p->pollfd = pa_xnew(struct pollfd, p->n_pollfd_alloc);
     p->pollfd2 = pa_xnew(struct pollfd, p->n_pollfd_alloc);
 
+#ifdef USE_EPOLL
+    p->epoll_fd = -1;
+    p->epoll_rebuild_needed = TRUE;
+
+    if ((p->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) < 0)
+        pa_log_debug("timerfd_create() failed, using ppoll(): %s", pa_cstrerror(errno));
+#endif
+
 #ifdef DEBUG_TIMING
     p->timestamp = pa_rtclock_now();
 #endif
@@ -145,8 +178,181 @@ static void rtpoll_rebuild(pa_rtpoll *p) {
 
     if (ra)
         p->pollfd2 = pa_xrealloc(p->pollfd2, p->n_pollfd_alloc * sizeof(struct pollfd));
+
+#ifdef USE_EPOLL
+    /* The pollfds moved, start over with a fresh epoll set */
+    p->epoll_rebuild_needed = TRUE;
+#endif
+}
+
+#ifdef USE_EPOLL
+static void epoll_disable(pa_rtpoll *p) {
+    pa_assert(p);
+
+    if (p->epoll_fd >= 0)
+        pa_close(p->epoll_fd);
+
+    if (p->timer_fd >= 0)
+        pa_close(p->timer_fd);
+
+    p->epoll_fd = p->timer_fd = -1;
+
+    pa_xfree(p->epoll_registered);
+    pa_xfree(p->epoll_events);
+    p->epoll_registered = NULL;
+    p->epoll_events = NULL;
+    p->n_epoll_alloc = 0;
+}
+
+/* Creates a new epoll set with just the timerfd in it. Closing the old
+ * set gets rid of whatever was registered in it, even fds that were
+ * closed and whose numbers are reused already. */
+static int epoll_rebuild(pa_rtpoll *p) {
+    struct epoll_event ev;
+    unsigned k;
+
+    pa_assert(p);
+    pa_assert(p->timer_fd >= 0);
+
+    if (p->epoll_fd >= 0)
+        pa_close(p->epoll_fd);
+
+    if ((p->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        return -1;
+
+    pa_zero(ev);
+    ev.events = EPOLLIN;
+    ev.data.u32 = EPOLL_TIMER_INDEX;
+
+    if (epoll_ctl(p->epoll_fd, EPOLL_CTL_ADD, p->timer_fd, &ev) < 0)
+        return -1;
+
+    if (p->n_epoll_alloc < p->n_pollfd_used + 1) {
+        p->n_epoll_alloc = (p->n_pollfd_used + 1) * 2;
+        p->epoll_registered = pa_xrealloc(p->epoll_registered, p->n_epoll_alloc * sizeof(struct pollfd));
+        p->epoll_events = pa_xrealloc(p->epoll_events, p->n_epoll_alloc * sizeof(struct epoll_event));
+    }
+
+    for (k = 0; k < p->n_pollfd_used; k++)
+        p->epoll_registered[k].fd = -1;
+
+    p->epoll_rebuild_needed = FALSE;
+    return 0;
 }
 
+/* Items change their pollfds as they like, so they are compared with
+ * what epoll knows every time. epoll flags have the values of the poll
+ * flags, so they are passed on as they are. */
+static int epoll_sync(pa_rtpoll *p) {
+    unsigned k;
+
+    pa_assert(p);
+
+    if (p->epoll_rebuild_needed && epoll_rebuild(p) < 0)
+        return -1;
+
+    for (k = 0; k < p->n_pollfd_used; k++) {
+        struct pollfd *f = &p->pollfd[k], *r = &p->epoll_registered[k];
+        struct epoll_event ev;
+
+        f->revents = 0;
+
+        if (f->fd == r->fd && f->events == r->events)
+            continue;
+
+        pa_zero(ev);
+        ev.events = (uint32_t) f->events;
+        ev.data.u32 = k;
+
+        if (f->fd >= 0 && f->fd == r->fd) {
+            if (epoll_ctl(p->epoll_fd, EPOLL_CTL_MOD, f->fd, &ev) < 0)
+                return -1;
+
+            r->events = f->events;
+            continue;
+        }
+
+        /* Fails if the old fd was closed already, which removed it */
+        if (r->fd >= 0)
+            epoll_ctl(p->epoll_fd, EPOLL_CTL_DEL, r->fd, NULL);
+
+        r->fd = -1;
+
+        if (f->fd < 0)
+            continue;
+
+        /* Fails for fds that epoll doesn't support, or that are used
+         * twice */
+        if (epoll_ctl(p->epoll_fd, EPOLL_CTL_ADD, f->fd, &ev) < 0)
+            return -1;
+
+        *r = *f;
+    }
+
+    return 0;
+}
+
+/* Returns the epoll_wait() timeout */
+static int epoll_arm_timer(pa_rtpoll *p, pa_bool_t wait_op) {
+    struct timeval deadline;
+
+    pa_assert(p);
+
+    pa_zero(deadline);
+
+    if (wait_op && !p->quit && p->timer_enabled)
+        deadline = p->next_elapse;
+
+    if (pa_timeval_cmp(&deadline, &p->timer_armed) != 0) {
+        struct itimerspec its;
+
+        /* A zero deadline disarms */
+        pa_zero(its);
+        its.it_value.tv_sec = deadline.tv_sec;
+        its.it_value.tv_nsec = deadline.tv_usec * 1000;
+
+        pa_assert_se(timerfd_settime(p->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == 0);
+        p->timer_armed = deadline;
+    }
+
+    if (!wait_op || p->quit)
+        return 0;
+
+    if (p->timer_enabled && deadline.tv_sec == 0 && deadline.tv_usec == 0)
+        return 0;
+
+    return -1;
+}
+
+/* Like poll(), returns the number of pollfds with revents set */
+static int epoll_poll(pa_rtpoll *p, pa_bool_t wait_op) {
+    int r, k, n = 0;
+
+    pa_assert(p);
+
+    r = epoll_wait(p->epoll_fd, p->epoll_events, (int) p->n_pollfd_used + 1, epoll_arm_timer(p, wait_op));
+
+    for (k = 0; k < r; k++) {
+        uint32_t index = p->epoll_events[k].data.u32;
+
+        if (index == EPOLL_TIMER_INDEX) {
+            uint64_t expirations;
+
+            /* Expired timers are disarmed */
+            pa_read(p->timer_fd, &expirations, sizeof(expirations), NULL);
+            pa_zero(p->timer_armed);
+            continue;
+        }
+
+        pa_assert(index < p->n_pollfd_used);
+        p->pollfd[index].revents = (short) p->epoll_events[k].events;
+        n++;
+    }
+
+    return r < 0 ? r : n;
+}
+#endif
+
 static void rtpoll_item_destroy(pa_rtpoll_item *i) {
     pa_rtpoll *p;
 
@@ -173,6 +379,10 @@ void pa_rtpoll_free(pa_rtpoll *p) {
     pa_xfree(p->pollfd);
     pa_xfree(p->pollfd2);
 
+#ifdef USE_EPOLL
+    epoll_disable(p);
+#endif
+
     pa_xfree(p);
 }
 
@@ -305,7 +515,19 @@ int pa_rtpoll_run(pa_rtpoll *p, pa_bool_t wait_op) {
     }
 #endif
 
+#ifdef USE_EPOLL
+    if (p->timer_fd >= 0 && epoll_sync(p) < 0) {
+        pa_log_debug("Cannot use epoll, falling back to ppoll(): %s", pa_cstrerror(errno));
+        epoll_disable(p);
+    }
+#endif
+
     /* OK, now let's sleep */
+#ifdef USE_EPOLL
+    if (p->timer_fd >= 0)
+        r = epoll_poll(p, wait_op);
+    else
+#endif
 #ifdef HAVE_PPOLL
     {
         struct timespec ts;
@@ -543,30 +765,44 @@ static void asyncmsgq_read_after(pa_rtpoll_item *i) {
     pa_asyncmsgq_read_after_poll(i->userdata);
 }
 
+/* Dispatches what was queued since the last wakeup, but no more than
+ * this per call, so that the thread still gets to do its other work */
+#define ASYNCMSGQ_READ_BATCH_MAX 32
+
 static int asyncmsgq_read_work(pa_rtpoll_item *i) {
-    pa_msgobject *object;
-    int code;
-    void *data;
-    pa_memchunk chunk;
-    int64_t offset;
+    pa_asyncmsgq *q;
+    unsigned n;
 
     pa_assert(i);
 
-    if (pa_asyncmsgq_get(i->userdata, &object, &code, &data, &offset, &chunk, 0) == 0) {
+    q = i->userdata;
+
+    for (n = 0; n < ASYNCMSGQ_READ_BATCH_MAX; n++) {
+        pa_msgobject *object;
+        int code;
+        void *data;
+        pa_memchunk chunk;
+        int64_t offset;
         int ret;
 
+        if (pa_asyncmsgq_get(q, &object, &code, &data, &offset, &chunk, 0) < 0)
+            break;
+
         if (!object && code == PA_MESSAGE_SHUTDOWN) {
-            pa_asyncmsgq_done(i->userdata, 0);
+            pa_asyncmsgq_done(q, 0);
             pa_rtpoll_quit(i->rtpoll);
             return 1;
         }
 
         ret = pa_asyncmsgq_dispatch(object, code, data, offset, &chunk);
-        pa_asyncmsgq_done(i->userdata, ret);
-        return 1;
+        pa_asyncmsgq_done(q, ret);
+
+        /* The message might have removed us or stopped the loop */
+        if (i->dead || i->rtpoll->quit)
+            return 1;
     }
 
-    return 0;
+    return n > 0;
 }
 
 pa_rtpoll_item *pa_rtpoll_item_new_asyncmsgq_read(pa_rtpoll *p, pa_rtpoll_priority_t prio, pa_asyncmsgq *q) {
@@ -42,8 +42,17 @@ void *pa_silence_memory(void *p, size_t length, const pa_sample_spec *spec);
 pa_memchunk* pa_silence_memchunk(pa_memchunk *c, const pa_sample_spec *spec);
 pa_memblock* pa_silence_memblock(pa_memblock *b, const pa_sample_spec *spec);
 
+/* Returns TRUE if the memory only contains the silence pattern of the
+ * sample format */
+pa_bool_t pa_memory_is_silence(const void *p, size_t length, const pa_sample_spec *spec);
+
 pa_memchunk* pa_silence_memchunk_get(pa_silence_cache *cache, pa_mempool *pool, pa_memchunk* ret, const pa_sample_spec *spec, size_t length);
 
+/* The per-stream volumes pa_mix() computes are followed by this many
+ * entries repeating the channel pattern, so that optimized mix
+ * functions may read the volumes of several samples at once. */
+#define PA_MIX_VOLUME_PADDING 32
+
 typedef struct pa_mix_info {
     pa_memchunk chunk;
     pa_cvolume volume;
@@ -55,7 +64,7 @@ typedef struct pa_mix_info {
     union {
         int32_t i;
         float f;
-    } linear[PA_CHANNELS_MAX];
+    } linear[PA_CHANNELS_MAX + PA_MIX_VOLUME_PADDING];
 } pa_mix_info;
 
 size_t pa_mix(
@@ -93,6 +102,11 @@ typedef void (*pa_do_volume_func_t) (void *samples, const void *volumes, unsigne
 pa_do_volume_func_t pa_get_volume_func(pa_sample_format_t f);
 void pa_set_volume_func(pa_sample_format_t f, pa_do_volume_func_t func);
 
+typedef void (*pa_do_mix_func_t) (pa_mix_info streams[], unsigned nstreams, unsigned channels, void *data, unsigned length);
+
+pa_do_mix_func_t pa_get_mix_func(pa_sample_format_t f);
+void pa_set_mix_func(pa_sample_format_t f, pa_do_mix_func_t func);
+
 size_t pa_convert_size(size_t size, const pa_sample_spec *from, const pa_sample_spec *to);
 
 #define PA_CHANNEL_POSITION_MASK_LEFT                                   \
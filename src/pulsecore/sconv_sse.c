@@ -26,12 +26,19 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
+#include <pulse/rtclock.h>
+
+#include <pulsecore/log.h>
 #include <pulsecore/macro.h>
 #include <pulsecore/endianmacros.h>
+#include <pulsecore/g711.h>
 
 #include "cpu-x86.h"
 #include "sconv.h"
+#include "sconv-s16le.h"
 
 #if !defined(__APPLE__) && defined (__i386__) || defined (__amd64__)
 
@@ -162,6 +169,665 @@ static void pa_sconv_s16le_from_f32ne_sse2(unsigned n, const float *a, int16_t *
     );
 }
 
+/* The remaining converters handle whole blocks of samples in assembly and
+ * leave the last few samples to the C versions, so they produce exactly the
+ * same results. */
+
+static const PA_DECLARE_ALIGNED (16, double, scale32[2]) = { 0x7fffffff, 0x7fffffff };
+static const PA_DECLARE_ALIGNED (16, float, scale24[4]) = {
+    1.0f / 2147483648.0f, 1.0f / 2147483648.0f, 1.0f / 2147483648.0f, 1.0f / 2147483648.0f
+};
+
+static void pa_sconv_s16le_to_f32ne_sse2(unsigned n, const int16_t *a, float *b) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movaps %3, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t" /* read 8 samples */
+            " movdqa %%xmm0, %%xmm1         \n\t"
+            " punpcklwd %%xmm0, %%xmm0      \n\t" /* sign extend to 32 bits */
+            " punpckhwd %%xmm1, %%xmm1      \n\t"
+            " psrad $16, %%xmm0             \n\t"
+            " psrad $16, %%xmm1             \n\t"
+            " cvtdq2ps %%xmm0, %%xmm0       \n\t"
+            " cvtdq2ps %%xmm1, %%xmm1       \n\t"
+            " divps %%xmm7, %%xmm0          \n\t" /* /= 0x7fff */
+            " divps %%xmm7, %%xmm1          \n\t"
+            " movups %%xmm0, (%1)           \n\t"
+            " movups %%xmm1, 16(%1)         \n\t"
+            " add $16, %0                   \n\t"
+            " add $32, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*scale)
+            : "cc", "memory", "xmm0", "xmm1", "xmm7"
+        );
+
+    pa_sconv_s16le_to_float32ne(n & 7, a, b);
+}
+
+static void pa_sconv_s32le_to_f32ne_sse2(unsigned n, const int32_t *a, float *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movapd %3, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t" /* read 4 samples */
+            " cvtdq2pd %%xmm0, %%xmm1       \n\t" /* divide in double precision */
+            " pshufd $0xee, %%xmm0, %%xmm0  \n\t"
+            " cvtdq2pd %%xmm0, %%xmm0       \n\t"
+            " divpd %%xmm7, %%xmm1          \n\t"
+            " divpd %%xmm7, %%xmm0          \n\t"
+            " cvtpd2ps %%xmm1, %%xmm1       \n\t"
+            " cvtpd2ps %%xmm0, %%xmm0       \n\t"
+            " movlhps %%xmm0, %%xmm1        \n\t"
+            " movups %%xmm1, (%1)           \n\t"
+            " add $16, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*scale32)
+            : "cc", "memory", "xmm0", "xmm1", "xmm7"
+        );
+
+    pa_sconv_s32le_to_float32ne(n & 3, a, b);
+}
+
+/* Clamps 4 floats in xmm0 and converts them to s32 in xmm0, rounding in
+ * double precision like lrint((double) v * 0x7fffffff) */
+#define F32_TO_S32_SSE2                                         \
+            " minps %%xmm5, %%xmm0          \n\t"               \
+            " maxps %%xmm6, %%xmm0          \n\t"               \
+            " cvtps2pd %%xmm0, %%xmm1       \n\t"               \
+            " movhlps %%xmm0, %%xmm0        \n\t"               \
+            " cvtps2pd %%xmm0, %%xmm0       \n\t"               \
+            " mulpd %%xmm7, %%xmm1          \n\t"               \
+            " mulpd %%xmm7, %%xmm0          \n\t"               \
+            " cvtpd2dq %%xmm1, %%xmm1       \n\t"               \
+            " cvtpd2dq %%xmm0, %%xmm0       \n\t"               \
+            " punpcklqdq %%xmm0, %%xmm1     \n\t"
+
+static void pa_sconv_s32le_from_f32ne_sse2(unsigned n, const float *a, int32_t *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movaps %3, %%xmm5             \n\t"
+            " movaps %4, %%xmm6             \n\t"
+            " movapd %5, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movups (%0), %%xmm0           \n\t" /* read 4 floats */
+            F32_TO_S32_SSE2
+            " movdqu %%xmm1, (%1)           \n\t"
+            " add $16, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*one), "m" (*mone), "m" (*scale32)
+            : "cc", "memory", "xmm0", "xmm1", "xmm5", "xmm6", "xmm7"
+        );
+
+    pa_sconv_s32le_from_float32ne(n & 3, a, b);
+}
+
+static void pa_sconv_s24_32le_to_f32ne_sse2(unsigned n, const uint32_t *a, float *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movaps %3, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t" /* read 4 samples */
+            " pslld $8, %%xmm0              \n\t"
+            " cvtdq2ps %%xmm0, %%xmm0       \n\t" /* exact, at most 24 bits */
+            " mulps %%xmm7, %%xmm0          \n\t" /* /= 0x7fffffff, a power of two as float */
+            " movups %%xmm0, (%1)           \n\t"
+            " add $16, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*scale24)
+            : "cc", "memory", "xmm0", "xmm7"
+        );
+
+    pa_sconv_s24_32le_to_float32ne(n & 3, a, b);
+}
+
+static void pa_sconv_s24_32le_from_f32ne_sse2(unsigned n, const float *a, uint32_t *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movaps %3, %%xmm5             \n\t"
+            " movaps %4, %%xmm6             \n\t"
+            " movapd %5, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movups (%0), %%xmm0           \n\t" /* read 4 floats */
+            F32_TO_S32_SSE2
+            " psrld $8, %%xmm1              \n\t"
+            " movdqu %%xmm1, (%1)           \n\t"
+            " add $16, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*one), "m" (*mone), "m" (*scale32)
+            : "cc", "memory", "xmm0", "xmm1", "xmm5", "xmm6", "xmm7"
+        );
+
+    pa_sconv_s24_32le_from_float32ne(n & 3, a, b);
+}
+
+static void pa_sconv_s32le_to_s16ne_sse2(unsigned n, const int32_t *a, int16_t *b) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t" /* read 8 samples */
+            " movdqu 16(%0), %%xmm1         \n\t"
+            " psrad $16, %%xmm0             \n\t"
+            " psrad $16, %%xmm1             \n\t"
+            " packssdw %%xmm1, %%xmm0       \n\t"
+            " movdqu %%xmm0, (%1)           \n\t"
+            " add $32, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            :
+            : "cc", "memory", "xmm0", "xmm1"
+        );
+
+    pa_sconv_s32le_to_s16ne(n & 7, a, b);
+}
+
+static void pa_sconv_s32le_from_s16ne_sse2(unsigned n, const int16_t *a, int32_t *b) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t" /* read 8 samples */
+            " pxor %%xmm1, %%xmm1           \n\t"
+            " pxor %%xmm2, %%xmm2           \n\t"
+            " punpcklwd %%xmm0, %%xmm1      \n\t" /* s << 16 */
+            " punpckhwd %%xmm0, %%xmm2      \n\t"
+            " movdqu %%xmm1, (%1)           \n\t"
+            " movdqu %%xmm2, 16(%1)         \n\t"
+            " add $16, %0                   \n\t"
+            " add $32, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            :
+            : "cc", "memory", "xmm0", "xmm1", "xmm2"
+        );
+
+    pa_sconv_s32le_from_s16ne(n & 7, a, b);
+}
+
+static void pa_sconv_s24_32le_to_s16ne_sse2(unsigned n, const uint32_t *a, int16_t *b) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t" /* read 8 samples */
+            " movdqu 16(%0), %%xmm1         \n\t"
+            " pslld $8, %%xmm0              \n\t"
+            " pslld $8, %%xmm1              \n\t"
+            " psrad $16, %%xmm0             \n\t"
+            " psrad $16, %%xmm1             \n\t"
+            " packssdw %%xmm1, %%xmm0       \n\t"
+            " movdqu %%xmm0, (%1)           \n\t"
+            " add $32, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            :
+            : "cc", "memory", "xmm0", "xmm1"
+        );
+
+    pa_sconv_s24_32le_to_s16ne(n & 7, a, b);
+}
+
+static void pa_sconv_s24_32le_from_s16ne_sse2(unsigned n, const int16_t *a, uint32_t *b) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t" /* read 8 samples */
+            " pxor %%xmm1, %%xmm1           \n\t"
+            " pxor %%xmm2, %%xmm2           \n\t"
+            " punpcklwd %%xmm0, %%xmm1      \n\t" /* (s << 16) >> 8 */
+            " punpckhwd %%xmm0, %%xmm2      \n\t"
+            " psrld $8, %%xmm1              \n\t"
+            " psrld $8, %%xmm2              \n\t"
+            " movdqu %%xmm1, (%1)           \n\t"
+            " movdqu %%xmm2, 16(%1)         \n\t"
+            " add $16, %0                   \n\t"
+            " add $32, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            :
+            : "cc", "memory", "xmm0", "xmm1", "xmm2"
+        );
+
+    pa_sconv_s24_32le_from_s16ne(n & 7, a, b);
+}
+
+/* SSSE3 byte shuffles for the byte swapped and the packed 24 bit formats */
+
+#define Z 0x80 /* pshufb writes a zero byte */
+
+static const PA_DECLARE_ALIGNED (16, uint8_t, swap16[16]) = {
+    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+};
+static const PA_DECLARE_ALIGNED (16, uint8_t, swap32[16]) = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+/* 4 packed s24 samples to s32 */
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24_unpack[16]) = {
+    Z, 0, 1, 2, Z, 3, 4, 5, Z, 6, 7, 8, Z, 9, 10, 11
+};
+/* the upper 3 bytes of 4 s32 samples to packed s24 */
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24_pack[16]) = {
+    1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, Z, Z, Z, Z
+};
+/* 4 packed s24 samples to s16 */
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24_to_s16[16]) = {
+    1, 2, 4, 5, 7, 8, 10, 11, Z, Z, Z, Z, Z, Z, Z, Z
+};
+/* 4 s16 samples to packed s24 */
+static const PA_DECLARE_ALIGNED (16, uint8_t, s16_to_s24[16]) = {
+    Z, 0, 1, Z, 2, 3, Z, 4, 5, Z, 6, 7, Z, Z, Z, Z
+};
+
+#undef Z
+
+static void swap16_ssse3(unsigned n, const int16_t *a, int16_t *b) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movdqa %3, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t"
+            " pshufb %%xmm7, %%xmm0         \n\t"
+            " movdqu %%xmm0, (%1)           \n\t"
+            " add $16, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*swap16)
+            : "cc", "memory", "xmm0", "xmm7"
+        );
+
+    for (n &= 7; n > 0; n--, a++, b++)
+        *b = PA_INT16_SWAP(*a);
+}
+
+static void swap32_ssse3(unsigned n, const uint32_t *a, uint32_t *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movdqa %3, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movdqu (%0), %%xmm0           \n\t"
+            " pshufb %%xmm7, %%xmm0         \n\t"
+            " movdqu %%xmm0, (%1)           \n\t"
+            " add $16, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*swap32)
+            : "cc", "memory", "xmm0", "xmm7"
+        );
+
+    for (n &= 3; n > 0; n--, a++, b++)
+        *b = PA_UINT32_SWAP(*a);
+}
+
+/* Packed samples are read and written as 8 + 4 bytes so we never touch
+ * memory beyond the last sample */
+
+static void pa_sconv_s24le_to_f32ne_ssse3(unsigned n, const uint8_t *a, float *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movdqa %3, %%xmm6             \n\t"
+            " movaps %4, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movq (%0), %%xmm0             \n\t" /* read 4 samples */
+            " movd 8(%0), %%xmm1            \n\t"
+            " punpcklqdq %%xmm1, %%xmm0     \n\t"
+            " pshufb %%xmm6, %%xmm0         \n\t" /* s << 8 */
+            " cvtdq2ps %%xmm0, %%xmm0       \n\t"
+            " mulps %%xmm7, %%xmm0          \n\t"
+            " movups %%xmm0, (%1)           \n\t"
+            " add $12, %0                   \n\t"
+            " add $16, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*s24_unpack), "m" (*scale24)
+            : "cc", "memory", "xmm0", "xmm1", "xmm6", "xmm7"
+        );
+
+    pa_sconv_s24le_to_float32ne(n & 3, a, b);
+}
+
+static void pa_sconv_s24le_from_f32ne_ssse3(unsigned n, const float *a, uint8_t *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movaps %3, %%xmm5             \n\t"
+            " movaps %4, %%xmm6             \n\t"
+            " movapd %5, %%xmm7             \n\t"
+            " movdqa %6, %%xmm4             \n\t"
+
+            "1:                             \n\t"
+            " movups (%0), %%xmm0           \n\t" /* read 4 floats */
+            F32_TO_S32_SSE2
+            " pshufb %%xmm4, %%xmm1         \n\t"
+            " movq %%xmm1, (%1)             \n\t"
+            " psrldq $8, %%xmm1             \n\t"
+            " movd %%xmm1, 8(%1)            \n\t"
+            " add $16, %0                   \n\t"
+            " add $12, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*one), "m" (*mone), "m" (*scale32), "m" (*s24_pack)
+            : "cc", "memory", "xmm0", "xmm1", "xmm4", "xmm5", "xmm6", "xmm7"
+        );
+
+    pa_sconv_s24le_from_float32ne(n & 3, a, b);
+}
+
+static void pa_sconv_s24le_to_s16ne_ssse3(unsigned n, const uint8_t *a, int16_t *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movdqa %3, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movq (%0), %%xmm0             \n\t" /* read 4 samples */
+            " movd 8(%0), %%xmm1            \n\t"
+            " punpcklqdq %%xmm1, %%xmm0     \n\t"
+            " pshufb %%xmm7, %%xmm0         \n\t"
+            " movq %%xmm0, (%1)             \n\t"
+            " add $12, %0                   \n\t"
+            " add $8, %1                    \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*s24_to_s16)
+            : "cc", "memory", "xmm0", "xmm1", "xmm7"
+        );
+
+    pa_sconv_s24le_to_s16ne(n & 3, a, b);
+}
+
+static void pa_sconv_s24le_from_s16ne_ssse3(unsigned n, const int16_t *a, uint8_t *b) {
+    pa_reg_x86 blocks = n / 4;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " movdqa %3, %%xmm7             \n\t"
+
+            "1:                             \n\t"
+            " movq (%0), %%xmm0             \n\t" /* read 4 samples */
+            " pshufb %%xmm7, %%xmm0         \n\t"
+            " movq %%xmm0, (%1)             \n\t"
+            " psrldq $8, %%xmm0             \n\t"
+            " movd %%xmm0, 8(%1)            \n\t"
+            " add $8, %0                    \n\t"
+            " add $12, %1                   \n\t"
+            " dec %2                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "m" (*s16_to_s24)
+            : "cc", "memory", "xmm0", "xmm7"
+        );
+
+    pa_sconv_s24le_from_s16ne(n & 3, a, b);
+}
+
+/* G.711 through lookup tables and AVX2 gathers. The tables are filled from
+ * the g711.c routines when the AVX2 converters are installed. The tables
+ * from linear have 3 bytes of slack because the gathers read dwords. */
+
+#define ULAW_OFFSET 0x2000
+#define ALAW_OFFSET 0x1000
+
+static PA_DECLARE_ALIGNED (32, float, ulaw_to_f32[256]);
+static PA_DECLARE_ALIGNED (32, float, alaw_to_f32[256]);
+static PA_DECLARE_ALIGNED (32, int32_t, ulaw_to_s16[256]);
+static PA_DECLARE_ALIGNED (32, int32_t, alaw_to_s16[256]);
+static uint8_t ulaw_from_s14[2 * ULAW_OFFSET + 3];
+static uint8_t alaw_from_s13[2 * ALAW_OFFSET + 3];
+
+/* byte 0 of each dword, per 128 bit lane */
+static const PA_DECLARE_ALIGNED (32, uint8_t, gather_pack[32]) = {
+    0, 4, 8, 12, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0, 4, 8, 12, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+static void init_g711_tables(void) {
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        ulaw_to_s16[i] = st_ulaw2linear16((uint8_t) i);
+        alaw_to_s16[i] = st_alaw2linear16((uint8_t) i);
+        ulaw_to_f32[i] = (float) st_ulaw2linear16((uint8_t) i) / 0x8000;
+        alaw_to_f32[i] = (float) st_alaw2linear16((uint8_t) i) / 0x8000;
+    }
+
+    for (i = 0; i < 2 * ULAW_OFFSET; i++)
+        ulaw_from_s14[i] = st_14linear2ulaw((int16_t) (i - ULAW_OFFSET));
+
+    for (i = 0; i < 2 * ALAW_OFFSET; i++)
+        alaw_from_s13[i] = st_13linear2alaw((int16_t) (i - ALAW_OFFSET));
+}
+
+static void g711_to_f32ne_avx2(unsigned n, const uint8_t *a, float *b, const float *table) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            "1:                                         \n\t"
+            " vpmovzxbd (%0), %%ymm0                    \n\t" /* 8 indices */
+            " vpcmpeqd %%ymm1, %%ymm1, %%ymm1           \n\t" /* gather all of them */
+            " vgatherdps %%ymm1, (%3, %%ymm0, 4), %%ymm2 \n\t"
+            " vmovups %%ymm2, (%1)                      \n\t"
+            " add $8, %0                                \n\t"
+            " add $32, %1                               \n\t"
+            " dec %2                                    \n\t"
+            " jne 1b                                    \n\t"
+            " vzeroupper                                \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "r" (table)
+            : "cc", "memory", "xmm0", "xmm1", "xmm2"
+        );
+
+    for (n &= 7; n > 0; n--, a++, b++)
+        *b = table[*a];
+}
+
+static void g711_to_s16ne_avx2(unsigned n, const uint8_t *a, int16_t *b, const int32_t *table) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            "1:                                         \n\t"
+            " vpmovzxbd (%0), %%ymm0                    \n\t" /* 8 indices */
+            " vpcmpeqd %%ymm1, %%ymm1, %%ymm1           \n\t"
+            " vpgatherdd %%ymm1, (%3, %%ymm0, 4), %%ymm2 \n\t"
+            " vextracti128 $1, %%ymm2, %%xmm3           \n\t"
+            " vpackssdw %%xmm3, %%xmm2, %%xmm2          \n\t"
+            " vmovdqu %%xmm2, (%1)                      \n\t"
+            " add $8, %0                                \n\t"
+            " add $16, %1                               \n\t"
+            " dec %2                                    \n\t"
+            " jne 1b                                    \n\t"
+            " vzeroupper                                \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "r" (table)
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3"
+        );
+
+    for (n &= 7; n > 0; n--, a++, b++)
+        *b = (int16_t) table[*a];
+}
+
+/* Looks up 8 table offsets in ymm0 and stores the 8 resulting bytes */
+#define G711_GATHER_BYTES(table, dst)                           \
+            " vpcmpeqd %%ymm1, %%ymm1, %%ymm1           \n\t"   \
+            " vpgatherdd %%ymm1, (" table ", %%ymm0, 1), %%ymm2 \n\t" \
+            " vpshufb %%ymm5, %%ymm2, %%ymm2            \n\t"   \
+            " vextracti128 $1, %%ymm2, %%xmm1           \n\t"   \
+            " vpunpckldq %%xmm1, %%xmm2, %%xmm2         \n\t"   \
+            " vmovq %%xmm2, (" dst ")                   \n\t"
+
+static void g711_from_s16ne_avx2(unsigned n, const int16_t *a, uint8_t *b, const uint8_t *table, int32_t shift, int32_t offset) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " vmovdqa %6, %%ymm5                        \n\t"
+            " vmovd %4, %%xmm6                          \n\t"
+            " vpbroadcastd %5, %%ymm7                   \n\t"
+
+            "1:                                         \n\t"
+            " vpmovsxwd (%0), %%ymm0                    \n\t" /* read 8 samples */
+            " vpsrad %%xmm6, %%ymm0, %%ymm0             \n\t"
+            " vpaddd %%ymm7, %%ymm0, %%ymm0             \n\t"
+            G711_GATHER_BYTES("%3", "%1")
+            " add $16, %0                               \n\t"
+            " add $8, %1                                \n\t"
+            " dec %2                                    \n\t"
+            " jne 1b                                    \n\t"
+            " vzeroupper                                \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "r" (table), "m" (shift), "m" (offset), "m" (*gather_pack)
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm5", "xmm6", "xmm7"
+        );
+
+    for (n &= 7; n > 0; n--, a++, b++)
+        *b = table[(*a >> shift) + offset];
+}
+
+static void g711_from_f32ne_avx2(unsigned n, const float *a, uint8_t *b, const uint8_t *table, float factor, int32_t offset) {
+    pa_reg_x86 blocks = n / 8;
+
+    if (blocks)
+        __asm__ __volatile__ (
+            " vmovdqa %6, %%ymm5                        \n\t"
+            " vbroadcastss %4, %%ymm6                   \n\t"
+            " vpbroadcastd %5, %%ymm7                   \n\t"
+            " vbroadcastss %7, %%ymm3                   \n\t"
+            " vbroadcastss %8, %%ymm4                   \n\t"
+
+            "1:                                         \n\t"
+            " vminps (%0), %%ymm3, %%ymm0               \n\t" /* read and clamp 8 floats */
+            " vmaxps %%ymm4, %%ymm0, %%ymm0             \n\t"
+            " vmulps %%ymm6, %%ymm0, %%ymm0             \n\t"
+            " vcvtps2dq %%ymm0, %%ymm0                  \n\t"
+            " vpaddd %%ymm7, %%ymm0, %%ymm0             \n\t"
+            G711_GATHER_BYTES("%3", "%1")
+            " add $32, %0                               \n\t"
+            " add $8, %1                                \n\t"
+            " dec %2                                    \n\t"
+            " jne 1b                                    \n\t"
+            " vzeroupper                                \n\t"
+
+            : "+r" (a), "+r" (b), "+r" (blocks)
+            : "r" (table), "m" (factor), "m" (offset), "m" (*gather_pack), "m" (*one), "m" (*mone)
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7"
+        );
+
+    for (n &= 7; n > 0; n--, a++, b++) {
+        float v = PA_CLAMP_UNLIKELY(*a, -1.0f, 1.0f);
+        *b = table[(int16_t) lrintf(v * factor) + offset];
+    }
+}
+
+static void ulaw_to_f32ne_avx2(unsigned n, const uint8_t *a, float *b) {
+    g711_to_f32ne_avx2(n, a, b, ulaw_to_f32);
+}
+
+static void alaw_to_f32ne_avx2(unsigned n, const uint8_t *a, float *b) {
+    g711_to_f32ne_avx2(n, a, b, alaw_to_f32);
+}
+
+static void ulaw_to_s16ne_avx2(unsigned n, const uint8_t *a, int16_t *b) {
+    g711_to_s16ne_avx2(n, a, b, ulaw_to_s16);
+}
+
+static void alaw_to_s16ne_avx2(unsigned n, const uint8_t *a, int16_t *b) {
+    g711_to_s16ne_avx2(n, a, b, alaw_to_s16);
+}
+
+static void ulaw_from_s16ne_avx2(unsigned n, const int16_t *a, uint8_t *b) {
+    g711_from_s16ne_avx2(n, a, b, ulaw_from_s14, 2, ULAW_OFFSET);
+}
+
+static void alaw_from_s16ne_avx2(unsigned n, const int16_t *a, uint8_t *b) {
+    g711_from_s16ne_avx2(n, a, b, alaw_from_s13, 3, ALAW_OFFSET);
+}
+
+static void ulaw_from_f32ne_avx2(unsigned n, const float *a, uint8_t *b) {
+    g711_from_f32ne_avx2(n, a, b, ulaw_from_s14, 0x1FFF, ULAW_OFFSET);
+}
+
+static void alaw_from_f32ne_avx2(unsigned n, const float *a, uint8_t *b) {
+    g711_from_f32ne_avx2(n, a, b, alaw_from_s13, 0xFFF, ALAW_OFFSET);
+}
+
 #undef RUN_TEST
 
 #ifdef RUN_TEST
@@ -210,6 +876,55 @@ static void run_test(void) {
     stop = pa_rtclock_now();
     pa_log_info("ref: %llu usec.", (long long unsigned int)(stop - start));
 }
+
+/* Compares func against the C converter ref on random input, including the
+ * bytes just after the output */
+static void run_test_convert(const char *name, pa_convert_func_t ref, pa_convert_func_t func,
+                             size_t in_size, size_t out_size, pa_bool_t from_float) {
+    uint8_t in[(SAMPLES + 1) * 4];
+    uint8_t out[(SAMPLES + 1) * 4], out_ref[(SAMPLES + 1) * 4];
+    int i;
+    pa_usec_t start, stop;
+
+    for (i = 0; i < (int) sizeof(in); i++)
+        in[i] = (uint8_t) rand();
+
+    if (from_float)
+        for (i = 0; i < SAMPLES; i++)
+            ((float *) in)[i] = 2.1f * (rand()/(float) RAND_MAX - 0.5f);
+
+    memset(out, 0x55, sizeof(out));
+    memset(out_ref, 0x55, sizeof(out_ref));
+
+    ref(SAMPLES, in, out_ref);
+    func(SAMPLES, in, out);
+
+    if (memcmp(out, out_ref, (SAMPLES + 1) * out_size) != 0) {
+        for (i = 0; i < (SAMPLES + 1) * (int) out_size; i++)
+            if (out[i] != out_ref[i]) {
+                pa_log_error("%s: byte %d (sample %d) differs: %02x != %02x", name, i, i / (int) out_size, out[i], out_ref[i]);
+                break;
+            }
+    } else
+        pa_log_info("%s: ok", name);
+
+    start = pa_rtclock_now();
+    for (i = 0; i < TIMES; i++)
+        func(SAMPLES, in, out);
+    stop = pa_rtclock_now();
+    pa_log_info("%s: %llu usec.", name, (long long unsigned int)(stop - start));
+
+    start = pa_rtclock_now();
+    for (i = 0; i < TIMES; i++)
+        ref(SAMPLES, in, out_ref);
+    stop = pa_rtclock_now();
+    pa_log_info("ref: %llu usec.", (long long unsigned int)(stop - start));
+}
+
+#define RUN_TEST_TO(table, format, in_size, out_size, func) \
+    run_test_convert(#func, pa_get_convert_##table##_function(format), (pa_convert_func_t) func, in_size, out_size, FALSE)
+#define RUN_TEST_FROM(table, format, in_size, out_size, func) \
+    run_test_convert(#func, pa_get_convert_##table##_function(format), (pa_convert_func_t) func, in_size, out_size, TRUE)
 #endif
 #endif /* defined (__i386__) || defined (__amd64__) */
 
@@ -219,15 +934,88 @@ void pa_convert_func_init_sse(pa_cpu_x86_flag_t flags) {
 
 #ifdef RUN_TEST
     run_test();
+
+    if (flags & PA_CPU_X86_SSE2) {
+        RUN_TEST_TO(to_float32ne, PA_SAMPLE_S16LE, 2, 4, pa_sconv_s16le_to_f32ne_sse2);
+        RUN_TEST_TO(to_float32ne, PA_SAMPLE_S32LE, 4, 4, pa_sconv_s32le_to_f32ne_sse2);
+        RUN_TEST_FROM(from_float32ne, PA_SAMPLE_S32LE, 4, 4, pa_sconv_s32le_from_f32ne_sse2);
+        RUN_TEST_TO(to_float32ne, PA_SAMPLE_S24_32LE, 4, 4, pa_sconv_s24_32le_to_f32ne_sse2);
+        RUN_TEST_FROM(from_float32ne, PA_SAMPLE_S24_32LE, 4, 4, pa_sconv_s24_32le_from_f32ne_sse2);
+        RUN_TEST_TO(to_s16ne, PA_SAMPLE_S32LE, 4, 2, pa_sconv_s32le_to_s16ne_sse2);
+        RUN_TEST_TO(from_s16ne, PA_SAMPLE_S32LE, 2, 4, pa_sconv_s32le_from_s16ne_sse2);
+        RUN_TEST_TO(to_s16ne, PA_SAMPLE_S24_32LE, 4, 2, pa_sconv_s24_32le_to_s16ne_sse2);
+        RUN_TEST_TO(from_s16ne, PA_SAMPLE_S24_32LE, 2, 4, pa_sconv_s24_32le_from_s16ne_sse2);
+    }
+
+    if (flags & PA_CPU_X86_SSSE3) {
+        RUN_TEST_TO(to_float32ne, PA_SAMPLE_FLOAT32RE, 4, 4, swap32_ssse3);
+        RUN_TEST_TO(to_s16ne, PA_SAMPLE_S16RE, 2, 2, swap16_ssse3);
+        RUN_TEST_TO(to_float32ne, PA_SAMPLE_S24LE, 3, 4, pa_sconv_s24le_to_f32ne_ssse3);
+        RUN_TEST_FROM(from_float32ne, PA_SAMPLE_S24LE, 4, 3, pa_sconv_s24le_from_f32ne_ssse3);
+        RUN_TEST_TO(to_s16ne, PA_SAMPLE_S24LE, 3, 2, pa_sconv_s24le_to_s16ne_ssse3);
+        RUN_TEST_TO(from_s16ne, PA_SAMPLE_S24LE, 2, 3, pa_sconv_s24le_from_s16ne_ssse3);
+    }
+
+    if (flags & PA_CPU_X86_AVX2) {
+        init_g711_tables();
+        RUN_TEST_TO(to_float32ne, PA_SAMPLE_ULAW, 1, 4, ulaw_to_f32ne_avx2);
+        RUN_TEST_TO(to_float32ne, PA_SAMPLE_ALAW, 1, 4, alaw_to_f32ne_avx2);
+        RUN_TEST_FROM(from_float32ne, PA_SAMPLE_ULAW, 4, 1, ulaw_from_f32ne_avx2);
+        RUN_TEST_FROM(from_float32ne, PA_SAMPLE_ALAW, 4, 1, alaw_from_f32ne_avx2);
+        RUN_TEST_TO(to_s16ne, PA_SAMPLE_ULAW, 1, 2, ulaw_to_s16ne_avx2);
+        RUN_TEST_TO(to_s16ne, PA_SAMPLE_ALAW, 1, 2, alaw_to_s16ne_avx2);
+        RUN_TEST_TO(from_s16ne, PA_SAMPLE_ULAW, 2, 1, ulaw_from_s16ne_avx2);
+        RUN_TEST_TO(from_s16ne, PA_SAMPLE_ALAW, 2, 1, alaw_from_s16ne_avx2);
+    }
 #endif
 
     if (flags & PA_CPU_X86_SSE2) {
         pa_log_info("Initialising SSE2 optimized conversions.");
         pa_set_convert_from_float32ne_function(PA_SAMPLE_S16LE, (pa_convert_func_t) pa_sconv_s16le_from_f32ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_FLOAT32LE, (pa_convert_func_t) pa_sconv_s16le_from_f32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S16LE, (pa_convert_func_t) pa_sconv_s16le_to_f32ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_FLOAT32LE, (pa_convert_func_t) pa_sconv_s16le_to_f32ne_sse2);
+
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S32LE, (pa_convert_func_t) pa_sconv_s32le_to_f32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S32LE, (pa_convert_func_t) pa_sconv_s32le_from_f32ne_sse2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24_32LE, (pa_convert_func_t) pa_sconv_s24_32le_to_f32ne_sse2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24_32LE, (pa_convert_func_t) pa_sconv_s24_32le_from_f32ne_sse2);
+
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S32LE, (pa_convert_func_t) pa_sconv_s32le_to_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S32LE, (pa_convert_func_t) pa_sconv_s32le_from_s16ne_sse2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S24_32LE, (pa_convert_func_t) pa_sconv_s24_32le_to_s16ne_sse2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S24_32LE, (pa_convert_func_t) pa_sconv_s24_32le_from_s16ne_sse2);
     } else {
         pa_log_info("Initialising SSE optimized conversions.");
         pa_set_convert_from_float32ne_function(PA_SAMPLE_S16LE, (pa_convert_func_t) pa_sconv_s16le_from_f32ne_sse);
     }
 
+    if (flags & PA_CPU_X86_SSSE3) {
+        pa_log_info("Initialising SSSE3 optimized conversions.");
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_FLOAT32RE, (pa_convert_func_t) swap32_ssse3);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_FLOAT32RE, (pa_convert_func_t) swap32_ssse3);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S16RE, (pa_convert_func_t) swap16_ssse3);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S16RE, (pa_convert_func_t) swap16_ssse3);
+
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_S24LE, (pa_convert_func_t) pa_sconv_s24le_to_f32ne_ssse3);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_S24LE, (pa_convert_func_t) pa_sconv_s24le_from_f32ne_ssse3);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_S24LE, (pa_convert_func_t) pa_sconv_s24le_to_s16ne_ssse3);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_S24LE, (pa_convert_func_t) pa_sconv_s24le_from_s16ne_ssse3);
+    }
+
+    if (flags & PA_CPU_X86_AVX2) {
+        pa_log_info("Initialising AVX2 optimized G.711 conversions.");
+        init_g711_tables();
+
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_ULAW, (pa_convert_func_t) ulaw_to_f32ne_avx2);
+        pa_set_convert_to_float32ne_function(PA_SAMPLE_ALAW, (pa_convert_func_t) alaw_to_f32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_ULAW, (pa_convert_func_t) ulaw_from_f32ne_avx2);
+        pa_set_convert_from_float32ne_function(PA_SAMPLE_ALAW, (pa_convert_func_t) alaw_from_f32ne_avx2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_ULAW, (pa_convert_func_t) ulaw_to_s16ne_avx2);
+        pa_set_convert_to_s16ne_function(PA_SAMPLE_ALAW, (pa_convert_func_t) alaw_to_s16ne_avx2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_ULAW, (pa_convert_func_t) ulaw_from_s16ne_avx2);
+        pa_set_convert_from_s16ne_function(PA_SAMPLE_ALAW, (pa_convert_func_t) alaw_from_s16ne_avx2);
+    }
+
 #endif /* defined (__i386__) || defined (__amd64__) */
 }
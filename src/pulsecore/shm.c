@@ -115,6 +115,9 @@ int pa_shm_create_rw(pa_shm *m, size_t size, pa_bool_t shared, mode_t mode) {
     /* Round up to make it page aligned */
     size = PA_PAGE_ALIGN(size);
 
+    m->fd = -1;
+    m->memfd = m->hugetlb = FALSE;
+
     if (!shared) {
         m->id = 0;
         m->size = size;
@@ -213,6 +216,16 @@ void pa_shm_free(pa_shm *m) {
         free(m->ptr);
 #else
         pa_xfree(m->ptr);
+#endif
+    } else if (m->memfd) {
+#ifdef HAVE_MEMFD
+        if (munmap(m->ptr, m->size) < 0)
+            pa_log("munmap() failed: %s", pa_cstrerror(errno));
+
+        if (m->fd >= 0)
+            pa_assert_se(pa_close(m->fd) == 0);
+#else
+        pa_assert_not_reached();
 #endif
     } else {
 #ifdef HAVE_SHM_OPEN
@@ -252,6 +265,11 @@ void pa_shm_punch(pa_shm *m, size_t offset, size_t size) {
     /* You're welcome to implement this as NOOP on systems that don't
      * support it */
 
+    /* Huge pages are reserved for the segment anyway, and can only be
+     * given back as a whole */
+    if (m->hugetlb)
+        return;
+
     /* Align the pointer up to multiples of the page size */
     ptr = (uint8_t*) m->ptr + offset;
     o = (size_t) ((uint8_t*) ptr - (uint8_t*) PA_PAGE_ALIGN_PTR(ptr));
@@ -318,8 +336,10 @@ int pa_shm_attach_ro(pa_shm *m, unsigned id) {
         goto fail;
     }
 
+    m->fd = -1;
     m->do_unlink = FALSE;
     m->shared = TRUE;
+    m->memfd = m->hugetlb = FALSE;
 
     pa_assert_se(pa_close(fd) == 0);
 
@@ -340,6 +360,166 @@ int pa_shm_attach_ro(pa_shm *m, unsigned id) {
 
 #endif /* HAVE_SHM_OPEN */
 
+#ifdef HAVE_MEMFD
+
+/* Sizes, seals and maps a new memfd */
+static int memfd_map(pa_shm *m, int fd, size_t size, pa_bool_t hugetlb) {
+    struct stat st;
+    int flags = MAP_SHARED;
+
+    /* Failing to use huge pages is nothing unusual, we fall back to
+     * normal pages then */
+    pa_log_level_t level = hugetlb ? PA_LOG_INFO : PA_LOG_ERROR;
+
+    if (hugetlb) {
+        /* hugetlbfs reports the huge page size as block size, the
+         * segment has to be a multiple of it */
+        if (fstat(fd, &st) < 0) {
+            pa_logl(level, "fstat() failed: %s", pa_cstrerror(errno));
+            return -1;
+        }
+
+        size = ((size + (size_t) st.st_blksize - 1) / (size_t) st.st_blksize) * (size_t) st.st_blksize;
+    }
+
+    if (ftruncate(fd, (off_t) size) < 0) {
+        pa_logl(level, "ftruncate() failed: %s", pa_cstrerror(errno));
+        return -1;
+    }
+
+    /* The receivers rely on the segment never shrinking */
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_SEAL) < 0) {
+        pa_logl(level, "Failed to seal memfd: %s", pa_cstrerror(errno));
+        return -1;
+    }
+
+#ifdef MAP_NORESERVE
+    /* Without reservation a lack of huge pages would only show up as
+     * SIGBUS later on */
+    if (!hugetlb)
+        flags |= MAP_NORESERVE;
+#endif
+
+    if ((m->ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, flags, fd, (off_t) 0)) == MAP_FAILED) {
+        pa_logl(level, "mmap() failed: %s", pa_cstrerror(errno));
+        return -1;
+    }
+
+    m->size = size;
+    m->fd = fd;
+    m->do_unlink = FALSE;
+    m->shared = TRUE;
+    m->memfd = TRUE;
+    m->hugetlb = hugetlb;
+
+    return 0;
+}
+
+int pa_shm_create_memfd(pa_shm *m, size_t size, pa_bool_t hugetlb) {
+    int fd;
+
+    pa_assert(m);
+    pa_assert(size > 0);
+    pa_assert(size <= MAX_SHM_SIZE);
+
+    /* Round up to make it page aligned */
+    size = PA_PAGE_ALIGN(size);
+
+    /* The id is only used to refer to the segment in the protocol */
+    pa_random(&m->id, sizeof(m->id));
+
+#ifdef MFD_HUGETLB
+    if (hugetlb) {
+        if ((fd = memfd_create("pulseaudio", MFD_CLOEXEC|MFD_ALLOW_SEALING|MFD_HUGETLB)) >= 0) {
+            if (memfd_map(m, fd, size, TRUE) >= 0)
+                return 0;
+
+            pa_close(fd);
+        }
+
+        pa_log_info("Huge pages are not available, using normal pages for the memfd segment.");
+    }
+#endif
+
+    if ((fd = memfd_create("pulseaudio", MFD_CLOEXEC|MFD_ALLOW_SEALING)) < 0) {
+        pa_log("memfd_create() failed: %s", pa_cstrerror(errno));
+        return -1;
+    }
+
+    if (memfd_map(m, fd, size, FALSE) < 0) {
+        pa_close(fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+int pa_shm_attach_memfd(pa_shm *m, unsigned id, int fd, pa_bool_t writable) {
+    struct stat st;
+    int seals;
+
+    pa_assert(m);
+    pa_assert(fd >= 0);
+
+    if ((seals = fcntl(fd, F_GET_SEALS)) < 0) {
+        pa_log("Failed to get memfd seals: %s", pa_cstrerror(errno));
+        goto fail;
+    }
+
+    if (!(seals & F_SEAL_SHRINK)) {
+        pa_log("Refusing to map a memfd segment that may shrink.");
+        goto fail;
+    }
+
+    if (fstat(fd, &st) < 0) {
+        pa_log("fstat() failed: %s", pa_cstrerror(errno));
+        goto fail;
+    }
+
+    if (st.st_size <= 0 ||
+        st.st_size > (off_t) MAX_SHM_SIZE ||
+        PA_PAGE_ALIGN((size_t) st.st_size) != (size_t) st.st_size) {
+        pa_log("Invalid shared memory segment size");
+        goto fail;
+    }
+
+    m->size = (size_t) st.st_size;
+
+    if ((m->ptr = mmap(NULL, m->size, writable ? PROT_READ|PROT_WRITE : PROT_READ, MAP_SHARED, fd, (off_t) 0)) == MAP_FAILED) {
+        pa_log("mmap() failed: %s", pa_cstrerror(errno));
+        goto fail;
+    }
+
+    m->id = id;
+    m->fd = -1;
+    m->do_unlink = FALSE;
+    m->shared = TRUE;
+    m->memfd = TRUE;
+    m->hugetlb = FALSE;
+
+    pa_assert_se(pa_close(fd) == 0);
+
+    return 0;
+
+fail:
+    pa_close(fd);
+
+    return -1;
+}
+
+#else /* HAVE_MEMFD */
+
+int pa_shm_create_memfd(pa_shm *m, size_t size, pa_bool_t hugetlb) {
+    return -1;
+}
+
+int pa_shm_attach_memfd(pa_shm *m, unsigned id, int fd, pa_bool_t writable) {
+    pa_close(fd);
+    return -1;
+}
+
+#endif /* HAVE_MEMFD */
+
 int pa_shm_cleanup(void) {
 
 #ifdef HAVE_SHM_OPEN
@@ -25,18 +25,41 @@
 #include <sys/types.h>
 
 #include <pulsecore/macro.h>
+#include <pulsecore/creds.h>
+
+/* memfd segments are anonymous, they are handed to other processes as
+ * file descriptors over unix sockets */
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_CREDS)
+#define HAVE_MEMFD 1
+#endif
 
 typedef struct pa_shm {
     unsigned id;
     void *ptr;
     size_t size;
+
+    /* The memfd of a segment we created, -1 otherwise */
+    int fd;
+
     pa_bool_t do_unlink:1;
     pa_bool_t shared:1;
+    pa_bool_t memfd:1;
+    pa_bool_t hugetlb:1;
 } pa_shm;
 
 int pa_shm_create_rw(pa_shm *m, size_t size, pa_bool_t shared, mode_t mode);
 int pa_shm_attach_ro(pa_shm *m, unsigned id);
 
+/* Creates a shared segment in a memfd that is sealed against resizing,
+ * so that the processes it is passed to can't be hit by SIGBUS. If
+ * hugetlb is TRUE huge pages are tried first. */
+int pa_shm_create_memfd(pa_shm *m, size_t size, pa_bool_t hugetlb);
+
+/* Maps a memfd segment received from another process, read-only unless
+ * writable is TRUE. The fd is always closed. Fails if the segment isn't
+ * sealed. */
+int pa_shm_attach_memfd(pa_shm *m, unsigned id, int fd, pa_bool_t writable);
+
 void pa_shm_punch(pa_shm *m, size_t offset, size_t size);
 
 void pa_shm_free(pa_shm *m);
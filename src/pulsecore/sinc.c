@@ -0,0 +1,554 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <math.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/llist.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/mutex.h>
+
+#include "sinc.h"
+
+/* If the reduced output rate is at most this, every output position falls
+ * on one of that many phases and we can use one precomputed row of
+ * coefficients per phase. */
+#define MAX_EXACT_PHASES 1024
+#define MAX_EXACT_COEFFS (128*1024)
+
+/* Otherwise we interpolate linearly between this many phases */
+#define INTERP_PHASES 256
+
+/* When downsampling the filter is made longer to keep the transition band
+ * narrow, but not by more than this factor */
+#define MAX_TAPS_SCALE 8
+
+/* The downsampling factor a filter is designed for is rounded up to
+ * multiples of 1/SCALE_STEPS, so that small rate changes, e.g. by rate
+ * adaptation, can keep using the same filter */
+#define SCALE_STEPS 16
+
+static const struct {
+    unsigned taps;  /* filter length, multiple of 16 */
+    double cutoff;  /* relative to the lower of the two Nyquist frequencies */
+    double beta;    /* of the Kaiser window */
+} quality_table[PA_SINC_QUALITY_MAX + 1] = {
+    {  16, 0.80, 5.0 },
+    {  32, 0.88, 6.0 },
+    {  64, 0.92, 8.0 },
+    { 128, 0.95, 9.5 }
+};
+
+typedef struct pa_sinc_table pa_sinc_table;
+
+struct pa_sinc_table {
+    unsigned ref;
+
+    unsigned quality;
+
+    /* Downsampling factor in units of 1/SCALE_STEPS, SCALE_STEPS if
+     * not downsampling */
+    unsigned scale;
+
+    /* The denominator of the rate ratio an exact table was made for, 0
+     * for an interpolated table, which works for any ratio */
+    uint32_t den;
+
+    unsigned taps, phases;
+    pa_bool_t interpolate;
+
+    /* phases rows of taps coefficients each, plus one more row if we
+     * interpolate between phases */
+    float *coeffs;
+
+    PA_LLIST_FIELDS(pa_sinc_table);
+};
+
+struct pa_sinc_resampler {
+    unsigned channels;
+    unsigned quality;
+
+    /* Each output frame advances the input position by num/den frames */
+    uint32_t num, den;
+
+    pa_sinc_table *table;
+
+    /* An interpolated table of the same shape, created along with the
+     * resampler in the main thread. Rate changes fall back to it when
+     * no exact table for the new ratio exists, so they never have to
+     * compute coefficients in the IO thread. */
+    pa_sinc_table *interp;
+
+    /* One row of history_size samples per channel */
+    float *history;
+    unsigned history_size, n_history;
+
+    /* First history frame the filter is applied to for the next output
+     * frame and the fractional part of that position in units of
+     * 1/den */
+    unsigned index;
+    uint32_t phase;
+
+    /* Coefficients interpolated for the current phase */
+    float *row;
+};
+
+static pa_static_mutex tables_mutex = PA_STATIC_MUTEX_INIT;
+static PA_LLIST_HEAD(pa_sinc_table, tables) = NULL;
+
+static float sinc_dot_c(const float *a, const float *b, unsigned n) {
+    float sum = 0;
+
+    for (; n > 0; n--)
+        sum += *a++ * *b++;
+
+    return sum;
+}
+
+static pa_sinc_dot_func_t sinc_dot_func = sinc_dot_c;
+
+pa_sinc_dot_func_t pa_get_sinc_dot_func(void) {
+    return sinc_dot_func;
+}
+
+void pa_set_sinc_dot_func(pa_sinc_dot_func_t func) {
+    pa_assert(func);
+
+    sinc_dot_func = func;
+}
+
+/* Modified Bessel function of the first kind, order 0 */
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    unsigned k;
+
+    for (k = 1; k < 500; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+
+        if (term < sum * 1e-12)
+            break;
+    }
+
+    return sum;
+}
+
+static void calc_row(float *row, unsigned taps, double offset, double fc, double beta) {
+    double sum = 0;
+    unsigned k;
+
+    for (k = 0; k < taps; k++) {
+        double d, u, w;
+
+        /* Distance of this tap from the output position, in input frames */
+        d = (double) k - (taps / 2 - 1) - offset;
+        u = d / (taps / 2);
+
+        w = u*u < 1.0 ? bessel_i0(beta * sqrt(1.0 - u*u)) / bessel_i0(beta) : 0.0;
+
+        if (fabs(d) < 1e-9)
+            row[k] = (float) (fc * w);
+        else
+            row[k] = (float) (fc * sin(M_PI * fc * d) / (M_PI * fc * d) * w);
+
+        sum += row[k];
+    }
+
+    /* Normalize to unity gain at DC for every phase */
+    for (k = 0; k < taps; k++)
+        row[k] = (float) (row[k] / sum);
+}
+
+static unsigned calc_scale(uint32_t in_rate, uint32_t out_rate) {
+    if (in_rate <= out_rate)
+        return SCALE_STEPS;
+
+    return (unsigned) (((uint64_t) in_rate * SCALE_STEPS + out_rate - 1) / out_rate);
+}
+
+static unsigned calc_taps(unsigned quality, unsigned scale) {
+    unsigned taps, max_taps;
+
+    taps = quality_table[quality].taps;
+    max_taps = taps * MAX_TAPS_SCALE;
+    taps = PA_ROUND_UP(taps * scale / SCALE_STEPS, 16U);
+
+    return PA_MIN(taps, max_taps);
+}
+
+/* Whether an exact table for this ratio is small enough */
+static pa_bool_t use_exact(unsigned taps, uint32_t den) {
+    return den <= MAX_EXACT_PHASES && den * taps <= MAX_EXACT_COEFFS;
+}
+
+static pa_sinc_table *table_new(unsigned quality, unsigned scale, uint32_t den) {
+    pa_sinc_table *t;
+    unsigned p, rows;
+    double fc;
+
+    t = pa_xnew0(pa_sinc_table, 1);
+    t->ref = 1;
+    t->quality = quality;
+    t->scale = scale;
+    t->den = den;
+
+    t->taps = calc_taps(quality, scale);
+    fc = quality_table[quality].cutoff * SCALE_STEPS / scale;
+
+    if (den > 0) {
+        pa_assert(use_exact(t->taps, den));
+
+        t->phases = den;
+        t->interpolate = FALSE;
+        rows = t->phases;
+    } else {
+        t->phases = INTERP_PHASES;
+        t->interpolate = TRUE;
+        rows = t->phases + 1;
+    }
+
+    t->coeffs = pa_xnew(float, rows * t->taps);
+
+    for (p = 0; p < rows; p++)
+        calc_row(t->coeffs + p * t->taps, t->taps, (double) p / t->phases, fc, quality_table[quality].beta);
+
+    pa_log_debug("Created sinc filter for quality %u, downsampling by %u/%u: %u taps, %u phases%s.",
+                 quality, scale, SCALE_STEPS, t->taps, t->phases, t->interpolate ? ", interpolated" : "");
+
+    return t;
+}
+
+static void table_free(pa_sinc_table *t) {
+    pa_xfree(t->coeffs);
+    pa_xfree(t);
+}
+
+static pa_sinc_table *table_find(unsigned quality, unsigned scale, uint32_t den) {
+    pa_sinc_table *t;
+
+    for (t = tables; t; t = t->next)
+        if (t->quality == quality && t->scale == scale && t->den == den) {
+            t->ref++;
+            return t;
+        }
+
+    return NULL;
+}
+
+/* Look up the shared filter for the given parameters. If there is none
+ * and create is TRUE make one, outside of the lock since that may take
+ * several milliseconds. */
+static pa_sinc_table *table_get(unsigned quality, unsigned scale, uint32_t den, pa_bool_t create) {
+    pa_sinc_table *t, *n;
+    pa_mutex *m;
+
+    m = pa_static_mutex_get(&tables_mutex, FALSE, FALSE);
+
+    pa_mutex_lock(m);
+    t = table_find(quality, scale, den);
+    pa_mutex_unlock(m);
+
+    if (t || !create)
+        return t;
+
+    n = table_new(quality, scale, den);
+
+    pa_mutex_lock(m);
+
+    /* Somebody else might have been faster */
+    if (!(t = table_find(quality, scale, den))) {
+        PA_LLIST_PREPEND(pa_sinc_table, tables, n);
+        t = n;
+        n = NULL;
+    }
+
+    pa_mutex_unlock(m);
+
+    if (n)
+        table_free(n);
+
+    return t;
+}
+
+static pa_sinc_table *table_ref(pa_sinc_table *t) {
+    pa_mutex *m;
+
+    pa_assert(t);
+
+    m = pa_static_mutex_get(&tables_mutex, FALSE, FALSE);
+    pa_mutex_lock(m);
+
+    pa_assert(t->ref >= 1);
+    t->ref++;
+
+    pa_mutex_unlock(m);
+
+    return t;
+}
+
+static void table_unref(pa_sinc_table *t) {
+    pa_mutex *m;
+
+    pa_assert(t);
+
+    m = pa_static_mutex_get(&tables_mutex, FALSE, FALSE);
+    pa_mutex_lock(m);
+
+    pa_assert(t->ref >= 1);
+
+    if (--t->ref > 0) {
+        pa_mutex_unlock(m);
+        return;
+    }
+
+    PA_LLIST_REMOVE(pa_sinc_table, tables, t);
+    pa_mutex_unlock(m);
+
+    table_free(t);
+}
+
+static void history_reserve(pa_sinc_resampler *r, unsigned n) {
+    float *history;
+    unsigned c, size;
+
+    if (n <= r->history_size)
+        return;
+
+    size = PA_MAX(n, 2 * r->history_size);
+    history = pa_xnew(float, r->channels * size);
+
+    if (r->history) {
+        for (c = 0; c < r->channels; c++)
+            memcpy(history + c * size, r->history + c * r->history_size, r->n_history * sizeof(float));
+
+        pa_xfree(r->history);
+    }
+
+    r->history = history;
+    r->history_size = size;
+}
+
+/* Prepend n frames of silence to the history */
+static void history_pad(pa_sinc_resampler *r, unsigned n) {
+    unsigned c;
+
+    history_reserve(r, r->n_history + n);
+
+    for (c = 0; c < r->channels; c++) {
+        float *h = r->history + c * r->history_size;
+
+        memmove(h + n, h, r->n_history * sizeof(float));
+        memset(h, 0, n * sizeof(float));
+    }
+
+    r->n_history += n;
+    r->index += n;
+}
+
+pa_sinc_resampler* pa_sinc_resampler_new(unsigned channels, uint32_t in_rate, uint32_t out_rate, unsigned quality) {
+    pa_sinc_resampler *r;
+    unsigned g, scale;
+
+    pa_assert(channels > 0);
+    pa_assert(in_rate > 0);
+    pa_assert(out_rate > 0);
+    pa_assert(quality <= PA_SINC_QUALITY_MAX);
+
+    r = pa_xnew0(pa_sinc_resampler, 1);
+    r->channels = channels;
+    r->quality = quality;
+
+    g = pa_gcd(in_rate, out_rate);
+    r->num = in_rate / g;
+    r->den = out_rate / g;
+
+    scale = calc_scale(in_rate, out_rate);
+    r->interp = table_get(quality, scale, 0, TRUE);
+
+    if (use_exact(r->interp->taps, r->den))
+        r->table = table_get(quality, scale, r->den, TRUE);
+    else
+        r->table = table_ref(r->interp);
+
+    r->row = pa_xnew(float, r->table->taps);
+
+    pa_sinc_resampler_reset(r);
+
+    return r;
+}
+
+void pa_sinc_resampler_free(pa_sinc_resampler *r) {
+    pa_assert(r);
+
+    table_unref(r->table);
+    table_unref(r->interp);
+
+    pa_xfree(r->history);
+    pa_xfree(r->row);
+    pa_xfree(r);
+}
+
+/* Called from the IO thread, so this only picks from the tables that
+ * exist already */
+void pa_sinc_resampler_set_rates(pa_sinc_resampler *r, uint32_t in_rate, uint32_t out_rate) {
+    pa_sinc_table *old, *t = NULL;
+    unsigned g, scale, old_center, new_center;
+    uint32_t num, den;
+
+    pa_assert(r);
+    pa_assert(in_rate > 0);
+    pa_assert(out_rate > 0);
+
+    g = pa_gcd(in_rate, out_rate);
+    num = in_rate / g;
+    den = out_rate / g;
+
+    if (num == r->num && den == r->den)
+        return;
+
+    scale = calc_scale(in_rate, out_rate);
+
+    if (scale != r->interp->scale) {
+        pa_sinc_table *i;
+
+        if ((i = table_get(r->quality, scale, 0, FALSE))) {
+            table_unref(r->interp);
+            r->interp = i;
+        } else
+            pa_log_debug("No sinc filter for %u Hz -> %u Hz, keeping the current one.", in_rate, out_rate);
+    }
+
+    if (use_exact(r->interp->taps, den))
+        t = table_get(r->quality, r->interp->scale, den, FALSE);
+
+    if (!t)
+        t = table_ref(r->interp);
+
+    old = r->table;
+    r->table = t;
+
+    /* Keep the current output position when the filter length changes */
+    old_center = old->taps / 2 - 1;
+    new_center = t->taps / 2 - 1;
+
+    if (new_center > r->index + old_center)
+        history_pad(r, new_center - r->index - old_center);
+
+    r->index = r->index + old_center - new_center;
+    r->phase = (uint32_t) (((uint64_t) r->phase * den) / r->den);
+    r->num = num;
+    r->den = den;
+
+    if (t->taps != old->taps)
+        r->row = pa_xrenew(float, r->row, t->taps);
+
+    table_unref(old);
+}
+
+void pa_sinc_resampler_reset(pa_sinc_resampler *r) {
+    pa_assert(r);
+
+    r->n_history = 0;
+    r->index = 0;
+    r->phase = 0;
+
+    /* Start with the center of the filter on the first input frame */
+    history_reserve(r, r->table->taps);
+    history_pad(r, r->table->taps / 2 - 1);
+
+    r->index = 0;
+}
+
+unsigned pa_sinc_resampler_run(pa_sinc_resampler *r, const float *in, unsigned in_n_frames, float *out, unsigned out_n_frames) {
+    pa_sinc_table *t;
+    unsigned c, o, drop;
+
+    pa_assert(r);
+    pa_assert(in || in_n_frames == 0);
+    pa_assert(out || out_n_frames == 0);
+
+    t = r->table;
+
+    history_reserve(r, r->n_history + in_n_frames);
+
+    for (c = 0; c < r->channels; c++) {
+        float *d = r->history + c * r->history_size + r->n_history;
+        const float *s = in + c;
+        unsigned i;
+
+        for (i = 0; i < in_n_frames; i++, s += r->channels)
+            d[i] = *s;
+    }
+
+    r->n_history += in_n_frames;
+
+    for (o = 0; o < out_n_frames && r->index + t->taps <= r->n_history; o++) {
+        const float *row;
+
+        if (t->interpolate) {
+            uint64_t pos = (uint64_t) r->phase * t->phases;
+            const float *a, *b;
+            float w;
+            unsigned k;
+
+            a = t->coeffs + (unsigned) (pos / r->den) * t->taps;
+            b = a + t->taps;
+            w = (float) (pos % r->den) / (float) r->den;
+
+            for (k = 0; k < t->taps; k++)
+                r->row[k] = a[k] + w * (b[k] - a[k]);
+
+            row = r->row;
+        } else
+            row = t->coeffs + r->phase * t->taps;
+
+        for (c = 0; c < r->channels; c++)
+            *out++ = sinc_dot_func(row, r->history + c * r->history_size + r->index, t->taps);
+
+        r->phase += r->num;
+        r->index += r->phase / r->den;
+        r->phase %= r->den;
+    }
+
+    /* Forget the input we won't look at again. When downsampling by
+     * a large factor the next position may even lie beyond what we
+     * have received so far. */
+    drop = PA_MIN(r->index, r->n_history);
+
+    if (drop > 0) {
+        for (c = 0; c < r->channels; c++) {
+            float *h = r->history + c * r->history_size;
+
+            memmove(h, h + drop, (r->n_history - drop) * sizeof(float));
+        }
+
+        r->n_history -= drop;
+        r->index -= drop;
+    }
+
+    return o;
+}
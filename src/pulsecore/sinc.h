@@ -0,0 +1,53 @@
+#ifndef foosincfoo
+#define foosincfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <inttypes.h>
+
+/* Polyphase windowed sinc resampler working on interleaved float
+ * samples. The filter tables depend on the quality and the downsampling
+ * factor, rounded to a coarse step, and are shared between all
+ * resamplers using the same parameters. pa_sinc_resampler_new() may take
+ * a few milliseconds to compute them, pa_sinc_resampler_set_rates() never
+ * does and is safe to call from the IO thread. */
+
+typedef struct pa_sinc_resampler pa_sinc_resampler;
+
+/* Quality settings range from 0 (fastest) to PA_SINC_QUALITY_MAX (best) */
+#define PA_SINC_QUALITY_MAX 3
+
+pa_sinc_resampler* pa_sinc_resampler_new(unsigned channels, uint32_t in_rate, uint32_t out_rate, unsigned quality);
+void pa_sinc_resampler_free(pa_sinc_resampler *r);
+
+void pa_sinc_resampler_set_rates(pa_sinc_resampler *r, uint32_t in_rate, uint32_t out_rate);
+void pa_sinc_resampler_reset(pa_sinc_resampler *r);
+
+/* Always consumes all input frames. Writes at most out_n_frames frames
+ * and returns how many were written. */
+unsigned pa_sinc_resampler_run(pa_sinc_resampler *r, const float *in, unsigned in_n_frames, float *out, unsigned out_n_frames);
+
+/* The inner loop. n is always a multiple of 16. */
+typedef float (*pa_sinc_dot_func_t) (const float *a, const float *b, unsigned n);
+
+pa_sinc_dot_func_t pa_get_sinc_dot_func(void);
+void pa_set_sinc_dot_func(pa_sinc_dot_func_t func);
+
+#endif
@@ -0,0 +1,194 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+
+#include <pulse/rtclock.h>
+
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "cpu-x86.h"
+
+#include "sinc.h"
+
+#if defined (__i386__) || defined (__amd64__)
+
+static float sinc_dot_sse(const float *a, const float *b, unsigned n) {
+    pa_reg_x86 groups = n / 8;
+    float sum;
+
+    __asm__ __volatile__ (
+        " xorps %%xmm0, %%xmm0          \n\t"
+        " xorps %%xmm1, %%xmm1          \n\t"
+
+        "1:                             \n\t" /* do samples in groups of 8 */
+        " movups (%0), %%xmm2           \n\t" /* |   a3  ..   a0   | */
+        " movups 16(%0), %%xmm3         \n\t" /* |   a7  ..   a4   | */
+        " movups (%1), %%xmm4           \n\t" /* |   b3  ..   b0   | */
+        " movups 16(%1), %%xmm5         \n\t" /* |   b7  ..   b4   | */
+        " mulps %%xmm4, %%xmm2          \n\t"
+        " mulps %%xmm5, %%xmm3          \n\t"
+        " addps %%xmm2, %%xmm0          \n\t"
+        " addps %%xmm3, %%xmm1          \n\t"
+        " add $32, %0                   \n\t"
+        " add $32, %1                   \n\t"
+        " dec %2                        \n\t"
+        " jne 1b                        \n\t"
+
+        " addps %%xmm1, %%xmm0          \n\t" /* |   s3  ..   s0   | */
+        " movhlps %%xmm0, %%xmm1        \n\t" /* |   s3  |   s2   | */
+        " addps %%xmm1, %%xmm0          \n\t" /* | s1+s3 | s0+s2  | */
+        " movaps %%xmm0, %%xmm1         \n\t"
+        " shufps $0x55, %%xmm1, %%xmm1  \n\t" /* |       ..  s1+s3 | */
+        " addss %%xmm1, %%xmm0          \n\t"
+        " movss %%xmm0, %3              \n\t"
+
+        : "+r" (a), "+r" (b), "+r" (groups), "=m" (sum)
+        :
+        : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5"
+    );
+
+    return sum;
+}
+
+static float sinc_dot_avx(const float *a, const float *b, unsigned n) {
+    pa_reg_x86 groups = n / 16;
+    float sum;
+
+    __asm__ __volatile__ (
+        " vxorps %%ymm0, %%ymm0, %%ymm0        \n\t"
+        " vxorps %%ymm1, %%ymm1, %%ymm1        \n\t"
+
+        "1:                                    \n\t" /* do samples in groups of 16 */
+        " vmovups (%0), %%ymm2                 \n\t" /* a7 .. a0 */
+        " vmovups 32(%0), %%ymm3               \n\t" /* a15 .. a8 */
+        " vmulps (%1), %%ymm2, %%ymm2          \n\t"
+        " vmulps 32(%1), %%ymm3, %%ymm3        \n\t"
+        " vaddps %%ymm2, %%ymm0, %%ymm0        \n\t"
+        " vaddps %%ymm3, %%ymm1, %%ymm1        \n\t"
+        " add $64, %0                          \n\t"
+        " add $64, %1                          \n\t"
+        " dec %2                               \n\t"
+        " jne 1b                               \n\t"
+
+        " vaddps %%ymm1, %%ymm0, %%ymm0        \n\t" /* s7 .. s0 */
+        " vextractf128 $1, %%ymm0, %%xmm1      \n\t" /* s7 .. s4 */
+        " vaddps %%xmm1, %%xmm0, %%xmm0        \n\t"
+        " vmovhlps %%xmm0, %%xmm0, %%xmm1      \n\t"
+        " vaddps %%xmm1, %%xmm0, %%xmm0        \n\t"
+        " vmovshdup %%xmm0, %%xmm1             \n\t"
+        " vaddss %%xmm1, %%xmm0, %%xmm0        \n\t"
+        " vmovss %%xmm0, %3                    \n\t"
+        " vzeroupper                           \n\t"
+
+        : "+r" (a), "+r" (b), "+r" (groups), "=m" (sum)
+        :
+        : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3"
+    );
+
+    return sum;
+}
+
+#undef RUN_TEST
+
+#ifdef RUN_TEST
+#define TAPS 128
+#define TIMES 100000
+#define TIMES2 10
+
+static void run_test_dot(const char *name, pa_sinc_dot_func_t ref, pa_sinc_dot_func_t func) {
+    float a[TAPS + 1], b[TAPS + 1];
+    float sum, sum_ref;
+    unsigned i;
+    int j, k;
+    pa_usec_t start, stop;
+    pa_usec_t min = INT_MAX, max = 0;
+    double s1 = 0, s2 = 0;
+
+    for (i = 0; i < TAPS + 1; i++) {
+        a[i] = 2.0f * (rand()/(float) RAND_MAX - 0.5f);
+        b[i] = 2.0f * (rand()/(float) RAND_MAX - 0.5f);
+    }
+
+    /* Check with unaligned data too */
+    sum_ref = ref(a, b + 1, TAPS);
+    sum = func(a, b + 1, TAPS);
+
+    if (fabsf(sum - sum_ref) > 1e-4f)
+        pa_log_error("%s: %f != %f", name, sum, sum_ref);
+    else
+        pa_log_info("%s: ok", name);
+
+    for (k = 0; k < TIMES2; k++) {
+        start = pa_rtclock_now();
+        for (j = 0; j < TIMES; j++)
+            func(a, b + 1, TAPS);
+        stop = pa_rtclock_now();
+
+        if (min > (stop - start)) min = stop - start;
+        if (max < (stop - start)) max = stop - start;
+        s1 += stop - start;
+        s2 += (stop - start) * (stop - start);
+    }
+    pa_log_info("%s: %llu usec (min = %llu, max = %llu, stddev = %g).", name, (long long unsigned int)s1,
+            (long long unsigned int)min, (long long unsigned int)max, sqrt(TIMES2 * s2 - s1 * s1) / TIMES2);
+
+    min = INT_MAX; max = 0;
+    s1 = s2 = 0;
+    for (k = 0; k < TIMES2; k++) {
+        start = pa_rtclock_now();
+        for (j = 0; j < TIMES; j++)
+            ref(a, b + 1, TAPS);
+        stop = pa_rtclock_now();
+
+        if (min > (stop - start)) min = stop - start;
+        if (max < (stop - start)) max = stop - start;
+        s1 += stop - start;
+        s2 += (stop - start) * (stop - start);
+    }
+    pa_log_info("ref: %llu usec (min = %llu, max = %llu, stddev = %g).", (long long unsigned int)s1,
+            (long long unsigned int)min, (long long unsigned int)max, sqrt(TIMES2 * s2 - s1 * s1) / TIMES2);
+}
+#endif /* RUN_TEST */
+
+#endif /* defined (__i386__) || defined (__amd64__) */
+
+void pa_sinc_func_init_sse(pa_cpu_x86_flag_t flags) {
+#if defined (__i386__) || defined (__amd64__)
+
+#ifdef RUN_TEST
+    run_test_dot("SSE", pa_get_sinc_dot_func(), sinc_dot_sse);
+    if (flags & PA_CPU_X86_AVX)
+        run_test_dot("AVX", pa_get_sinc_dot_func(), sinc_dot_avx);
+#endif
+
+    if (flags & PA_CPU_X86_AVX) {
+        pa_log_info("Initialising AVX optimized sinc resampler.");
+        pa_set_sinc_dot_func(sinc_dot_avx);
+    } else if (flags & PA_CPU_X86_SSE) {
+        pa_log_info("Initialising SSE optimized sinc resampler.");
+        pa_set_sinc_dot_func(sinc_dot_sse);
+    }
+#endif /* defined (__i386__) || defined (__amd64__) */
+}
@@ -31,6 +31,7 @@
 #include <pulse/xmalloc.h>
 #include <pulse/util.h>
 #include <pulse/internal.h>
+#include <pulse/rtclock.h>
 
 #include <pulsecore/sample-util.h>
 #include <pulsecore/core-subscribe.h>
@@ -477,6 +478,8 @@ int pa_sink_input_new(
     reset_callbacks(i);
     i->userdata = NULL;
 
+    pa_io_stats_init(&i->io_stats);
+
     i->thread_info.state = i->state;
     i->thread_info.attached = FALSE;
     pa_atomic_store(&i->thread_info.drained, 1);
@@ -774,6 +777,8 @@ pa_usec_t pa_sink_input_get_latency(pa_sink_input *i, pa_usec_t *sink_latency) {
     if (sink_latency)
         *sink_latency = r[1];
 
+    pa_histogram_add(&i->io_stats.latency, r[0] + r[1]);
+
     return r[0];
 }
 
@@ -783,6 +788,7 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink frames */, p
     pa_bool_t volume_is_norm;
     size_t block_size_max_sink, block_size_max_sink_input;
     size_t ilength;
+    pa_usec_t start;
 
     pa_sink_input_assert_ref(i);
     pa_sink_input_assert_io_context(i);
@@ -795,6 +801,8 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink frames */, p
     pa_log_debug("peek");
 #endif
 
+    start = pa_rtclock_now();
+
     block_size_max_sink_input = i->thread_info.resampler ?
         pa_resampler_max_block_size(i->thread_info.resampler) :
         pa_frame_align(pa_mempool_block_size_max(i->core->mempool), &i->sample_spec);
@@ -840,6 +848,10 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink frames */, p
              * data, so let's just hand out silence */
             pa_atomic_store(&i->thread_info.drained, 1);
 
+            /* Data was flowing until now */
+            if (i->thread_info.underrun_for == 0 && i->thread_info.state != PA_SINK_INPUT_CORKED)
+                pa_io_stats_xrun(&i->io_stats);
+
             pa_memblockq_seek(i->thread_info.render_memblockq, (int64_t) slength, PA_SEEK_RELATIVE, TRUE);
             i->thread_info.playing_for = 0;
             if (i->thread_info.underrun_for != (uint64_t) -1)
@@ -865,12 +877,26 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink frames */, p
             if (wchunk.length > block_size_max_sink_input)
                 wchunk.length = block_size_max_sink_input;
 
-            /* It might be necessary to adjust the volume here */
-            if (do_volume_adj_here && !volume_is_norm) {
-                pa_memchunk_make_writable(&wchunk, 0);
+            if (pa_memblock_is_silence(wchunk.memblock)) {
+                /* Volume doesn't change silence, so leave silent blocks
+                 * alone to keep them flagged as such */
+                nvfs = FALSE;
+
+            } else if (do_volume_adj_here && !volume_is_norm) {
+                /* It might be necessary to adjust the volume here */
 
                 if (i->thread_info.muted) {
-                    pa_silence_memchunk(&wchunk, &i->thread_info.sample_spec);
+                    size_t l = wchunk.length;
+
+                    /* Replace the data with the shared silence block, which
+                     * might be shorter. The rest of tchunk is handled in the
+                     * next iteration. */
+                    pa_memblock_unref(wchunk.memblock);
+                    pa_silence_memchunk_get(&i->core->silence_cache,
+                                            i->core->mempool,
+                                            &wchunk,
+                                            &i->thread_info.sample_spec,
+                                            l);
                     nvfs = FALSE;
 
                 } else if (!i->thread_info.resampler && nvfs) {
@@ -880,11 +906,14 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink frames */, p
                      * post and the pre volume adjustment into one */
 
                     pa_sw_cvolume_multiply(&v, &i->thread_info.soft_volume, &i->volume_factor_sink);
+                    pa_memchunk_make_writable(&wchunk, 0);
                     pa_volume_memchunk(&wchunk, &i->thread_info.sample_spec, &v);
                     nvfs = FALSE;
 
-                } else
+                } else {
+                    pa_memchunk_make_writable(&wchunk, 0);
                     pa_volume_memchunk(&wchunk, &i->thread_info.sample_spec, &i->thread_info.soft_volume);
+                }
             }
 
             if (!i->thread_info.resampler) {
@@ -905,7 +934,7 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink frames */, p
 
                 if (rchunk.memblock) {
 
-                    if (nvfs) {
+                    if (nvfs && !pa_memblock_is_silence(rchunk.memblock)) {
                         pa_memchunk_make_writable(&rchunk, 0);
                         pa_volume_memchunk(&rchunk, &i->sink->sample_spec, &i->volume_factor_sink);
                     }
@@ -947,6 +976,8 @@ void pa_sink_input_peek(pa_sink_input *i, size_t slength /* in sink frames */, p
         pa_cvolume_mute(volume, i->sink->sample_spec.channels);
     else
         *volume = i->thread_info.soft_volume;
+
+    pa_histogram_add(&i->io_stats.render_time, pa_rtclock_now() - start);
 }
 
 /* Called from thread context */
@@ -981,6 +1012,9 @@ void pa_sink_input_process_rewind(pa_sink_input *i, size_t nbytes /* in sink sam
 
     lbq = pa_memblockq_get_length(i->thread_info.render_memblockq);
 
+    if (nbytes > 0)
+        pa_io_stats_rewind(&i->io_stats, nbytes);
+
     if (nbytes > 0 && !i->thread_info.dont_rewind_render) {
         pa_log_debug("Have to rewind %lu bytes on render memblockq.", (unsigned long) nbytes);
         pa_memblockq_rewind(i->thread_info.render_memblockq, nbytes);
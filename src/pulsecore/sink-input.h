@@ -29,6 +29,7 @@ typedef struct pa_sink_input pa_sink_input;
 
 #include <pulse/sample.h>
 #include <pulse/format.h>
+#include <pulsecore/iostats.h>
 #include <pulsecore/memblockq.h>
 #include <pulsecore/resampler.h>
 #include <pulsecore/module.h>
@@ -210,6 +211,9 @@ struct pa_sink_input {
      * mute status changes. Called from main context */
     void (*mute_changed)(pa_sink_input *i); /* may be NULL */
 
+    /* Updated from the IO thread, may be read from anywhere */
+    pa_io_stats io_stats;
+
     struct {
         pa_sink_input_state_t state;
         pa_atomic_t drained;
@@ -50,7 +50,6 @@
 
 #include "sink.h"
 
-#define MAX_MIX_CHANNELS 32
 #define MIX_BUFFER_LENGTH (PA_PAGE_SIZE)
 #define ABSOLUTE_MIN_LATENCY (500)
 #define ABSOLUTE_MAX_LATENCY (10*PA_USEC_PER_SEC)
@@ -324,8 +323,12 @@ pa_sink* pa_sink_new(
             &s->sample_spec,
             0);
 
+    pa_io_stats_init(&s->io_stats);
+
     s->thread_info.rtpoll = NULL;
     s->thread_info.inputs = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
+    s->thread_info.mix_info = NULL;
+    s->thread_info.n_mix_info = 0;
     s->thread_info.soft_volume =  s->soft_volume;
     s->thread_info.soft_muted = s->muted;
     s->thread_info.state = s->state;
@@ -733,6 +736,7 @@ static void sink_free(pa_object *o) {
         pa_sink_input_unref(i);
 
     pa_hashmap_free(s->thread_info.inputs, NULL, NULL);
+    pa_xfree(s->thread_info.mix_info);
 
     if (s->silence.memblock)
         pa_memblock_unref(s->silence.memblock);
@@ -940,6 +944,8 @@ void pa_sink_process_rewind(pa_sink *s, size_t nbytes) {
 
     if (nbytes > 0) {
         pa_log_debug("Processing rewind...");
+        pa_io_stats_rewind(&s->io_stats, nbytes);
+
         if (s->flags & PA_SINK_DEFERRED_VOLUME)
             pa_sink_volume_change_rewind(s, nbytes);
     }
@@ -956,7 +962,33 @@ void pa_sink_process_rewind(pa_sink *s, size_t nbytes) {
 }
 
 /* Called from IO thread context */
-static unsigned fill_mix_info(pa_sink *s, size_t *length, pa_mix_info *info, unsigned maxinfo) {
+static pa_mix_info *get_mix_info(pa_sink *s) {
+    unsigned n;
+
+    pa_sink_assert_ref(s);
+    pa_sink_assert_io_context(s);
+
+    n = pa_hashmap_size(s->thread_info.inputs);
+
+    /* Only reallocate when the number of inputs grows beyond what
+     * we have seen so far, so that steady state rendering doesn't
+     * touch the allocator */
+    if (n > s->thread_info.n_mix_info) {
+        unsigned k = PA_MAX(s->thread_info.n_mix_info, 8U);
+
+        while (k < n)
+            k *= 2;
+
+        pa_xfree(s->thread_info.mix_info);
+        s->thread_info.mix_info = pa_xnew(pa_mix_info, k);
+        s->thread_info.n_mix_info = k;
+    }
+
+    return s->thread_info.mix_info;
+}
+
+/* Called from IO thread context */
+static unsigned fill_mix_info(pa_sink *s, size_t *length, pa_mix_info *info) {
     pa_sink_input *i;
     unsigned n = 0;
     void *state = NULL;
@@ -966,7 +998,7 @@ static unsigned fill_mix_info(pa_sink *s, size_t *length, pa_mix_info *info, uns
     pa_sink_assert_io_context(s);
     pa_assert(info);
 
-    while ((i = pa_hashmap_iterate(s->thread_info.inputs, &state, NULL)) && maxinfo > 0) {
+    while ((i = pa_hashmap_iterate(s->thread_info.inputs, &state, NULL))) {
         pa_sink_input_assert_ref(i);
 
         pa_sink_input_peek(i, *length, &info->chunk, &info->volume);
@@ -986,7 +1018,6 @@ static unsigned fill_mix_info(pa_sink *s, size_t *length, pa_mix_info *info, uns
 
         info++;
         n++;
-        maxinfo--;
     }
 
     if (mixlength > 0)
@@ -1094,9 +1125,10 @@ static void inputs_drop(pa_sink *s, pa_mix_info *info, unsigned n, pa_memchunk *
 
 /* Called from IO thread context */
 void pa_sink_render(pa_sink*s, size_t length, pa_memchunk *result) {
-    pa_mix_info info[MAX_MIX_CHANNELS];
+    pa_mix_info *info;
     unsigned n;
     size_t block_size_max;
+    pa_usec_t start;
 
     pa_sink_assert_ref(s);
     pa_sink_assert_io_context(s);
@@ -1116,6 +1148,8 @@ void pa_sink_render(pa_sink*s, size_t length, pa_memchunk *result) {
 
     pa_sink_ref(s);
 
+    start = pa_rtclock_now();
+
     if (length <= 0)
         length = pa_frame_align(MIX_BUFFER_LENGTH, &s->sample_spec);
 
@@ -1125,7 +1159,8 @@ void pa_sink_render(pa_sink*s, size_t length, pa_memchunk *result) {
 
     pa_assert(length > 0);
 
-    n = fill_mix_info(s, &length, info, MAX_MIX_CHANNELS);
+    info = get_mix_info(s);
+    n = fill_mix_info(s, &length, info);
 
     if (n == 0) {
 
@@ -1174,14 +1209,17 @@ void pa_sink_render(pa_sink*s, size_t length, pa_memchunk *result) {
 
     inputs_drop(s, info, n, result);
 
+    pa_histogram_add(&s->io_stats.render_time, pa_rtclock_now() - start);
+
     pa_sink_unref(s);
 }
 
 /* Called from IO thread context */
 void pa_sink_render_into(pa_sink*s, pa_memchunk *target) {
-    pa_mix_info info[MAX_MIX_CHANNELS];
+    pa_mix_info *info;
     unsigned n;
     size_t length, block_size_max;
+    pa_usec_t start;
 
     pa_sink_assert_ref(s);
     pa_sink_assert_io_context(s);
@@ -1201,6 +1239,8 @@ void pa_sink_render_into(pa_sink*s, pa_memchunk *target) {
 
     pa_sink_ref(s);
 
+    start = pa_rtclock_now();
+
     length = target->length;
     block_size_max = pa_mempool_block_size_max(s->core->mempool);
     if (length > block_size_max)
@@ -1208,7 +1248,8 @@ void pa_sink_render_into(pa_sink*s, pa_memchunk *target) {
 
     pa_assert(length > 0);
 
-    n = fill_mix_info(s, &length, info, MAX_MIX_CHANNELS);
+    info = get_mix_info(s);
+    n = fill_mix_info(s, &length, info);
 
     if (n == 0) {
         if (target->length > length)
@@ -1259,6 +1300,8 @@ void pa_sink_render_into(pa_sink*s, pa_memchunk *target) {
 
     inputs_drop(s, info, n, target);
 
+    pa_histogram_add(&s->io_stats.render_time, pa_rtclock_now() - start);
+
     pa_sink_unref(s);
 }
 
@@ -1436,6 +1479,8 @@ pa_usec_t pa_sink_get_latency(pa_sink *s) {
     else
         usec = 0;
 
+    pa_histogram_add(&s->io_stats.latency, usec);
+
     return usec;
 }
 
@@ -1470,6 +1515,8 @@ pa_usec_t pa_sink_get_latency_within_thread(pa_sink *s) {
     else
         usec = 0;
 
+    pa_histogram_add(&s->io_stats.latency, usec);
+
     return usec;
 }
 
@@ -36,6 +36,7 @@ typedef struct pa_sink_volume_change pa_sink_volume_change;
 
 #include <pulsecore/core.h>
 #include <pulsecore/idxset.h>
+#include <pulsecore/iostats.h>
 #include <pulsecore/memchunk.h>
 #include <pulsecore/source.h>
 #include <pulsecore/module.h>
@@ -232,12 +233,21 @@ struct pa_sink {
      * main thread. */
     pa_bool_t (*update_rate)(pa_sink *s, uint32_t rate);
 
+    /* Updated from the IO thread, may be read from anywhere */
+    pa_io_stats io_stats;
+
     /* Contains copies of the above data so that the real-time worker
      * thread can work without access locking */
     struct {
         pa_sink_state_t state;
         pa_hashmap *inputs;
 
+        /* Scratch array for pa_sink_render() and friends, grown on
+         * demand so that there is no limit on the number of inputs
+         * that are mixed in one go */
+        pa_mix_info *mix_info;
+        unsigned n_mix_info;
+
         pa_rtpoll *rtpoll;
 
         pa_cvolume soft_volume;
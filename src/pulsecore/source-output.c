@@ -31,6 +31,7 @@
 #include <pulse/xmalloc.h>
 #include <pulse/util.h>
 #include <pulse/internal.h>
+#include <pulse/rtclock.h>
 
 #include <pulsecore/sample-util.h>
 #include <pulsecore/core-subscribe.h>
@@ -442,6 +443,8 @@ int pa_source_output_new(
     reset_callbacks(o);
     o->userdata = NULL;
 
+    pa_io_stats_init(&o->io_stats);
+
     o->thread_info.state = o->state;
     o->thread_info.attached = FALSE;
     o->thread_info.sample_spec = o->sample_spec;
@@ -692,6 +695,8 @@ pa_usec_t pa_source_output_get_latency(pa_source_output *o, pa_usec_t *source_la
     if (source_latency)
         *source_latency = r[1];
 
+    pa_histogram_add(&o->io_stats.latency, r[0] + r[1]);
+
     return r[0];
 }
 
@@ -701,6 +706,7 @@ void pa_source_output_push(pa_source_output *o, const pa_memchunk *chunk) {
     pa_bool_t volume_is_norm;
     size_t length;
     size_t limit, mbs = 0;
+    pa_usec_t start;
 
     pa_source_output_assert_ref(o);
     pa_source_output_assert_io_context(o);
@@ -713,8 +719,11 @@ void pa_source_output_push(pa_source_output *o, const pa_memchunk *chunk) {
 
     pa_assert(o->thread_info.state == PA_SOURCE_OUTPUT_RUNNING);
 
+    start = pa_rtclock_now();
+
     if (pa_memblockq_push(o->thread_info.delay_memblockq, chunk) < 0) {
         pa_log_debug("Delay queue overflow!");
+        pa_io_stats_xrun(&o->io_stats);
         pa_memblockq_seek(o->thread_info.delay_memblockq, (int64_t) chunk->length, PA_SEEK_RELATIVE, TRUE);
     }
 
@@ -812,6 +821,8 @@ void pa_source_output_push(pa_source_output *o, const pa_memchunk *chunk) {
         pa_memblock_unref(qchunk.memblock);
         pa_memblockq_drop(o->thread_info.delay_memblockq, qchunk.length);
     }
+
+    pa_histogram_add(&o->io_stats.render_time, pa_rtclock_now() - start);
 }
 
 /* Called from thread context */
@@ -825,6 +836,8 @@ void pa_source_output_process_rewind(pa_source_output *o, size_t nbytes /* in so
     if (nbytes <= 0)
         return;
 
+    pa_io_stats_rewind(&o->io_stats, nbytes);
+
     if (o->process_rewind) {
         pa_assert(pa_memblockq_get_length(o->thread_info.delay_memblockq) == 0);
 
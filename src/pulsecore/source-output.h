@@ -28,6 +28,7 @@ typedef struct pa_source_output pa_source_output;
 
 #include <pulse/sample.h>
 #include <pulse/format.h>
+#include <pulsecore/iostats.h>
 #include <pulsecore/memblockq.h>
 #include <pulsecore/resampler.h>
 #include <pulsecore/module.h>
@@ -190,6 +191,9 @@ struct pa_source_output {
      * mute status changes. Called from main context */
     void (*mute_changed)(pa_source_output *o); /* may be NULL */
 
+    /* Updated from the IO thread, may be read from anywhere */
+    pa_io_stats io_stats;
+
     struct {
         pa_source_output_state_t state;
 
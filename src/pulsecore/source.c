@@ -312,6 +312,8 @@ pa_source* pa_source_new(
             &s->sample_spec,
             0);
 
+    pa_io_stats_init(&s->io_stats);
+
     s->thread_info.rtpoll = NULL;
     s->thread_info.outputs = pa_hashmap_new(pa_idxset_trivial_hash_func, pa_idxset_trivial_compare_func);
     s->thread_info.soft_volume = s->soft_volume;
@@ -869,6 +871,7 @@ void pa_source_process_rewind(pa_source *s, size_t nbytes) {
         return;
 
     pa_log_debug("Processing rewind...");
+    pa_io_stats_rewind(&s->io_stats, nbytes);
 
     PA_HASHMAP_FOREACH(o, s->thread_info.outputs, state) {
         pa_source_output_assert_ref(o);
@@ -880,6 +883,7 @@ void pa_source_process_rewind(pa_source *s, size_t nbytes) {
 void pa_source_post(pa_source*s, const pa_memchunk *chunk) {
     pa_source_output *o;
     void *state = NULL;
+    pa_usec_t start;
 
     pa_source_assert_ref(s);
     pa_source_assert_io_context(s);
@@ -889,6 +893,8 @@ void pa_source_post(pa_source*s, const pa_memchunk *chunk) {
     if (s->thread_info.state == PA_SOURCE_SUSPENDED)
         return;
 
+    start = pa_rtclock_now();
+
     if (s->thread_info.soft_muted || !pa_cvolume_is_norm(&s->thread_info.soft_volume)) {
         pa_memchunk vchunk = *chunk;
 
@@ -917,6 +923,8 @@ void pa_source_post(pa_source*s, const pa_memchunk *chunk) {
                 pa_source_output_push(o, chunk);
         }
     }
+
+    pa_histogram_add(&s->io_stats.render_time, pa_rtclock_now() - start);
 }
 
 /* Called from IO thread context */
@@ -1038,6 +1046,8 @@ pa_usec_t pa_source_get_latency(pa_source *s) {
     else
         usec = 0;
 
+    pa_histogram_add(&s->io_stats.latency, usec);
+
     return usec;
 }
 
@@ -1072,6 +1082,8 @@ pa_usec_t pa_source_get_latency_within_thread(pa_source *s) {
     else
         usec = 0;
 
+    pa_histogram_add(&s->io_stats.latency, usec);
+
     return usec;
 }
 
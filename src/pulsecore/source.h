@@ -36,6 +36,7 @@ typedef struct pa_source_volume_change pa_source_volume_change;
 
 #include <pulsecore/core.h>
 #include <pulsecore/idxset.h>
+#include <pulsecore/iostats.h>
 #include <pulsecore/memchunk.h>
 #include <pulsecore/sink.h>
 #include <pulsecore/module.h>
@@ -189,6 +190,9 @@ struct pa_source {
      * main thread. */
     pa_bool_t (*update_rate)(pa_source *s, uint32_t rate);
 
+    /* Updated from the IO thread, may be read from anywhere */
+    pa_io_stats io_stats;
+
     /* Contains copies of the above data so that the real-time worker
      * thread can work without access locking */
     struct {
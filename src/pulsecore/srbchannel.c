@@ -0,0 +1,351 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/atomic.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/fdsem.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "srbchannel.h"
+
+/* Bytes in each direction. Large enough for a couple of SHM frames
+ * and packets, audio data beyond that is passed in pieces. */
+#define SRBCHANNEL_CAPACITY (64*1024)
+
+/* At the start of the segment, followed by the rings. Ring 0 is
+ * written by the side that created the channel, ring 1 by the side
+ * that opened it. sem_data[i] belongs to the reader of ring i. */
+struct srbheader {
+    pa_atomic_t count[2];
+    pa_fdsem_data sem_data[2];
+    uint32_t capacity;
+};
+
+#define SRBHEADER_SIZE PA_ALIGN(sizeof(struct srbheader))
+
+struct srbring {
+    /* Bytes in the ring, the only thing shared between both sides */
+    pa_atomic_t *count;
+    uint8_t *memory;
+    size_t capacity;
+
+    /* Where we read resp. write next */
+    size_t index;
+};
+
+struct pa_srbchannel {
+    pa_mainloop_api *mainloop;
+    pa_io_event *read_event;
+    pa_defer_event *defer_event;
+
+    pa_shm memory;
+    struct srbring rb_read, rb_write;
+
+    /* We sleep on sem_read and wake the other side with sem_write */
+    pa_fdsem *sem_read, *sem_write;
+    pa_bool_t waiting;
+
+    pa_srbchannel_cb_t callback;
+    void *callback_userdata;
+};
+
+static void ring_init(struct srbring *r, struct srbheader *h, unsigned i, size_t capacity) {
+    r->count = &h->count[i];
+    r->memory = (uint8_t*) h + SRBHEADER_SIZE + i * capacity;
+    r->capacity = capacity;
+    r->index = 0;
+}
+
+/* The other side may write anything into the segment, so the count is
+ * checked before it is relied upon */
+static int ring_count(struct srbring *r) {
+    int count;
+
+    count = pa_atomic_load(r->count);
+
+    if (count < 0 || (size_t) count > r->capacity) {
+        pa_log_warn("Shared ringbuffer is corrupted.");
+        return -1;
+    }
+
+    return count;
+}
+
+ssize_t pa_srbchannel_write(pa_srbchannel *sr, const void *data, size_t l) {
+    struct srbring *r;
+    size_t written = 0;
+
+    pa_assert(sr);
+    pa_assert(data);
+
+    r = &sr->rb_write;
+
+    while (l > 0) {
+        int count;
+        size_t n;
+
+        if ((count = ring_count(r)) < 0)
+            return -1;
+
+        n = PA_MIN(l, r->capacity - (size_t) count);
+        n = PA_MIN(n, r->capacity - r->index);
+
+        if (n <= 0)
+            break;
+
+        memcpy(r->memory + r->index, data, n);
+        r->index = (r->index + n) % r->capacity;
+
+        /* Publishes the data, the atomic operation is a full barrier */
+        pa_atomic_add(r->count, (int) n);
+
+        data = (const uint8_t*) data + n;
+        l -= n;
+        written += n;
+    }
+
+    if (written > 0)
+        pa_fdsem_post(sr->sem_write);
+
+    return (ssize_t) written;
+}
+
+ssize_t pa_srbchannel_read(pa_srbchannel *sr, void *data, size_t l) {
+    struct srbring *r;
+    size_t nread = 0;
+    pa_bool_t was_full = FALSE;
+
+    pa_assert(sr);
+    pa_assert(data);
+
+    r = &sr->rb_read;
+
+    while (l > 0) {
+        int count;
+        size_t n;
+
+        if ((count = ring_count(r)) < 0)
+            return -1;
+
+        n = PA_MIN(l, (size_t) count);
+        n = PA_MIN(n, r->capacity - r->index);
+
+        if (n <= 0)
+            break;
+
+        memcpy(data, r->memory + r->index, n);
+        r->index = (r->index + n) % r->capacity;
+
+        /* The writer stops only when the ring is full, so that is the
+         * only case where it needs to be woken up */
+        if (pa_atomic_sub(r->count, (int) n) == (int) r->capacity)
+            was_full = TRUE;
+
+        data = (uint8_t*) data + n;
+        l -= n;
+        nread += n;
+    }
+
+    if (was_full)
+        pa_fdsem_post(sr->sem_write);
+
+    return (ssize_t) nread;
+}
+
+/* Calls the callback until no wakeup came in while it ran, then goes
+ * to sleep on sem_read again */
+static void srbchannel_rwloop(pa_srbchannel *sr) {
+    pa_assert(sr);
+
+    if (sr->waiting) {
+        pa_fdsem_after_poll(sr->sem_read);
+        sr->waiting = FALSE;
+    }
+
+    do {
+        if (sr->callback && !sr->callback(sr, sr->callback_userdata))
+            return;
+    } while (pa_fdsem_before_poll(sr->sem_read) < 0);
+
+    sr->waiting = TRUE;
+}
+
+static void read_event_cb(pa_mainloop_api *m, pa_io_event *e, int fd, pa_io_event_flags_t events, void *userdata) {
+    pa_srbchannel *sr = userdata;
+
+    pa_assert(sr);
+    pa_assert(sr->read_event == e);
+
+    srbchannel_rwloop(sr);
+}
+
+static void defer_cb(pa_mainloop_api *m, pa_defer_event *e, void *userdata) {
+    pa_srbchannel *sr = userdata;
+
+    pa_assert(sr);
+    pa_assert(sr->defer_event == e);
+
+    m->defer_enable(e, 0);
+    srbchannel_rwloop(sr);
+}
+
+static void srbchannel_setup_events(pa_srbchannel *sr, pa_mainloop_api *m) {
+    sr->mainloop = m;
+    sr->read_event = m->io_new(m, pa_fdsem_get(sr->sem_read), PA_IO_EVENT_INPUT, read_event_cb, sr);
+    sr->defer_event = m->defer_new(m, defer_cb, sr);
+    m->defer_enable(sr->defer_event, 0);
+}
+
+pa_srbchannel* pa_srbchannel_new(pa_mainloop_api *m) {
+#ifdef HAVE_SRBCHANNEL
+    pa_srbchannel *sr;
+    struct srbheader *h;
+    int fd;
+
+    pa_assert(m);
+
+    sr = pa_xnew0(pa_srbchannel, 1);
+
+    if (pa_shm_create_memfd(&sr->memory, SRBHEADER_SIZE + 2 * SRBCHANNEL_CAPACITY, FALSE) < 0) {
+        pa_xfree(sr);
+        return NULL;
+    }
+
+    /* A new memfd is zero filled, so both rings are empty */
+    h = sr->memory.ptr;
+    h->capacity = SRBCHANNEL_CAPACITY;
+
+    ring_init(&sr->rb_write, h, 0, SRBCHANNEL_CAPACITY);
+    ring_init(&sr->rb_read, h, 1, SRBCHANNEL_CAPACITY);
+
+    if (!(sr->sem_write = pa_fdsem_new_shm(&h->sem_data[0], &fd)) ||
+        !(sr->sem_read = pa_fdsem_new_shm(&h->sem_data[1], &fd))) {
+        pa_log("Failed to create the semaphores of the shared ringbuffer.");
+        pa_srbchannel_free(sr);
+        return NULL;
+    }
+
+    srbchannel_setup_events(sr, m);
+
+    return sr;
+#else
+    return NULL;
+#endif
+}
+
+pa_srbchannel* pa_srbchannel_new_from_fds(pa_mainloop_api *m, int fds[PA_SRBCHANNEL_FDS_MAX]) {
+    pa_srbchannel *sr;
+    struct srbheader *h;
+    size_t capacity;
+
+    pa_assert(m);
+    pa_assert(fds);
+
+    sr = pa_xnew0(pa_srbchannel, 1);
+
+    if (pa_shm_attach_memfd(&sr->memory, 0, fds[0], TRUE) < 0) {
+        pa_close(fds[1]);
+        pa_close(fds[2]);
+        pa_xfree(sr);
+        return NULL;
+    }
+
+    h = sr->memory.ptr;
+
+    /* Read once, the other side could change it afterwards */
+    capacity = *(volatile uint32_t*) &h->capacity;
+
+    if (sr->memory.size < SRBHEADER_SIZE ||
+        capacity <= 0 ||
+        capacity > (sr->memory.size - SRBHEADER_SIZE) / 2) {
+        pa_log_warn("Received a shared ringbuffer with an invalid capacity.");
+        pa_close(fds[1]);
+        pa_close(fds[2]);
+        pa_srbchannel_free(sr);
+        return NULL;
+    }
+
+    ring_init(&sr->rb_read, h, 0, capacity);
+    ring_init(&sr->rb_write, h, 1, capacity);
+
+    if (!(sr->sem_read = pa_fdsem_open_shm(&h->sem_data[0], fds[1])) ||
+        !(sr->sem_write = pa_fdsem_open_shm(&h->sem_data[1], fds[2]))) {
+        if (!sr->sem_read)
+            pa_close(fds[1]);
+        pa_close(fds[2]);
+        pa_srbchannel_free(sr);
+        return NULL;
+    }
+
+    srbchannel_setup_events(sr, m);
+
+    return sr;
+}
+
+void pa_srbchannel_get_fds(pa_srbchannel *sr, int fds[PA_SRBCHANNEL_FDS_MAX]) {
+    pa_assert(sr);
+    pa_assert(fds);
+
+    /* Only the side that created the channel has the memfd */
+    pa_assert(sr->memory.fd >= 0);
+
+    fds[0] = sr->memory.fd;
+    fds[1] = pa_fdsem_get(sr->sem_write);
+    fds[2] = pa_fdsem_get(sr->sem_read);
+}
+
+void pa_srbchannel_free(pa_srbchannel *sr) {
+    pa_assert(sr);
+
+    if (sr->read_event)
+        sr->mainloop->io_free(sr->read_event);
+
+    if (sr->defer_event)
+        sr->mainloop->defer_free(sr->defer_event);
+
+    if (sr->sem_read)
+        pa_fdsem_free(sr->sem_read);
+
+    if (sr->sem_write)
+        pa_fdsem_free(sr->sem_write);
+
+    if (sr->memory.ptr)
+        pa_shm_free(&sr->memory);
+
+    pa_xfree(sr);
+}
+
+void pa_srbchannel_set_callback(pa_srbchannel *sr, pa_srbchannel_cb_t callback, void *userdata) {
+    pa_assert(sr);
+
+    sr->callback = callback;
+    sr->callback_userdata = userdata;
+
+    if (sr->callback)
+        sr->mainloop->defer_enable(sr->defer_event, 1);
+}
@@ -0,0 +1,71 @@
+#ifndef foopulsesrbchannelhfoo
+#define foopulsesrbchannelhfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#include <sys/types.h>
+
+#include <pulse/mainloop-api.h>
+#include <pulsecore/shm.h>
+#include <pulsecore/macro.h>
+
+/* A shared ringbuffer channel: a pair of lock-free single producer,
+ * single consumer byte rings in a memfd segment, one for each
+ * direction, plus a pa_fdsem on each side for sleeping. Data passes
+ * without any syscall as long as the reading side is busy, a wakeup
+ * costs one eventfd write. The segment and the eventfds are handed to
+ * the other process as file descriptors. */
+
+#if defined(HAVE_MEMFD) && defined(HAVE_SYS_EVENTFD_H)
+#define HAVE_SRBCHANNEL 1
+#endif
+
+/* The memfd of the rings and the eventfds of the two semaphores */
+#define PA_SRBCHANNEL_FDS_MAX 3
+
+typedef struct pa_srbchannel pa_srbchannel;
+
+/* Called from the main loop when data arrived or space was freed in
+ * the ring we write to. Return FALSE if the channel was freed from
+ * within the callback. */
+typedef pa_bool_t (*pa_srbchannel_cb_t)(pa_srbchannel *sr, void *userdata);
+
+/* Creates a new channel, returns NULL if not supported */
+pa_srbchannel* pa_srbchannel_new(pa_mainloop_api *m);
+
+/* Opens the channel of the other side from the fds returned by
+ * pa_srbchannel_get_fds(). Always takes ownership of the fds. */
+pa_srbchannel* pa_srbchannel_new_from_fds(pa_mainloop_api *m, int fds[PA_SRBCHANNEL_FDS_MAX]);
+
+/* The fds stay owned by the channel */
+void pa_srbchannel_get_fds(pa_srbchannel *sr, int fds[PA_SRBCHANNEL_FDS_MAX]);
+
+void pa_srbchannel_free(pa_srbchannel *sr);
+
+/* Both return the number of bytes transferred, which is 0 if the ring
+ * is full resp. empty, or -1 if the other side corrupted the ring */
+ssize_t pa_srbchannel_write(pa_srbchannel *sr, const void *data, size_t l);
+ssize_t pa_srbchannel_read(pa_srbchannel *sr, void *data, size_t l);
+
+/* The callback is first called from a deferred event after it was
+ * set, so that anything that arrived before is not missed */
+void pa_srbchannel_set_callback(pa_srbchannel *sr, pa_srbchannel_cb_t callback, void *userdata);
+
+#endif
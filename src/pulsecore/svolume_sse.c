@@ -252,6 +252,432 @@ static void pa_volume_s16re_sse2(int16_t *samples, const int32_t *volumes, unsig
     );
 }
 
+/* The volume index of the functions below is kept under the smallest multiple
+ * of the channel count that covers a whole loop iteration, like in mix_sse.c.
+ * The volumes of one iteration can then be read from the padded volume array
+ * at once. */
+static unsigned volume_period(unsigned channels, unsigned step) {
+    unsigned period = channels;
+
+    while (period < step)
+        period += channels;
+
+    return period;
+}
+
+#define VOLUME_WRAP(inc, period) \
+      " add "#inc", %2                \n\t" /* channel += inc */            \
+      " cmp "#period", %2             \n\t"                                 \
+      " jb 3f                         \n\t"                                 \
+      " sub "#period", %2             \n\t" /* channel -= period */         \
+      "3:                             \n\t"
+
+static void pa_volume_float32ne_sse(float *samples, const float *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 8);
+    n = length / sizeof(float);
+
+    if ((groups = n / 8) > 0)
+        __asm__ __volatile__ (
+            "1:                             \n\t" /* do samples in groups of 8 */
+            " movups (%3, %2, 4), %%xmm0    \n\t" /* |   v3  ..   v0   | */
+            " movups 16(%3, %2, 4), %%xmm1  \n\t" /* |   v7  ..   v4   | */
+            " movups (%0), %%xmm2           \n\t" /* |   p3  ..   p0   | */
+            " movups 16(%0), %%xmm3         \n\t" /* |   p7  ..   p4   | */
+            " mulps %%xmm0, %%xmm2          \n\t"
+            " mulps %%xmm1, %%xmm3          \n\t"
+            " movups %%xmm2, (%0)           \n\t"
+            " movups %%xmm3, 16(%0)         \n\t"
+            " add $32, %0                   \n\t"
+            VOLUME_WRAP ($8, %4)
+            " dec %1                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (samples), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3"
+        );
+
+    for (n &= 7; n > 0; n--) {
+        *samples++ *= volumes[channel];
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void pa_volume_float32ne_avx(float *samples, const float *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 16);
+    n = length / sizeof(float);
+
+    if ((groups = n / 16) > 0)
+        __asm__ __volatile__ (
+            "1:                                 \n\t" /* do samples in groups of 16 */
+            " vmovups (%3, %2, 4), %%ymm0       \n\t" /* v7 .. v0 */
+            " vmovups 32(%3, %2, 4), %%ymm1     \n\t" /* v15 .. v8 */
+            " vmulps (%0), %%ymm0, %%ymm0       \n\t"
+            " vmulps 32(%0), %%ymm1, %%ymm1     \n\t"
+            " vmovups %%ymm0, (%0)              \n\t"
+            " vmovups %%ymm1, 32(%0)            \n\t"
+            " add $64, %0                       \n\t"
+            VOLUME_WRAP ($16, %4)
+            " dec %1                            \n\t"
+            " jne 1b                            \n\t"
+            " vzeroupper                        \n\t"
+
+            : "+r" (samples), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1"
+        );
+
+    for (n &= 15; n > 0; n--) {
+        *samples++ *= volumes[channel];
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+/* swap 32 bits */
+#define SWAP_32(s) \
+      " pshuflw $0xb1, "#s", "#s"    \n\t" /* .. | l h | */    \
+      " pshufhw $0xb1, "#s", "#s"    \n\t"                     \
+      SWAP_16(s)
+
+static void pa_volume_float32re_sse2(float *samples, const float *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 8);
+    n = length / sizeof(float);
+
+    if ((groups = n / 8) > 0)
+        __asm__ __volatile__ (
+            "1:                             \n\t" /* do samples in groups of 8 */
+            " movups (%3, %2, 4), %%xmm0    \n\t" /* |   v3  ..   v0   | */
+            " movups 16(%3, %2, 4), %%xmm1  \n\t" /* |   v7  ..   v4   | */
+            " movdqu (%0), %%xmm2           \n\t" /* |   p3  ..   p0   | */
+            " movdqu 16(%0), %%xmm3         \n\t" /* |   p7  ..   p4   | */
+            SWAP_32 (%%xmm2)
+            SWAP_32 (%%xmm3)
+            " mulps %%xmm0, %%xmm2          \n\t"
+            " mulps %%xmm1, %%xmm3          \n\t"
+            SWAP_32 (%%xmm2)
+            SWAP_32 (%%xmm3)
+            " movdqu %%xmm2, (%0)           \n\t"
+            " movdqu %%xmm3, 16(%0)         \n\t"
+            " add $32, %0                   \n\t"
+            VOLUME_WRAP ($8, %4)
+            " dec %1                        \n\t"
+            " jne 1b                        \n\t"
+
+            : "+r" (samples), "+r" (groups), "+r" (channel)
+            : "r" (volumes),
+#if defined (__i386__)
+              "m" (period)
+#else
+              "r" ((pa_reg_x86)period)
+#endif
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4"
+        );
+
+    for (n &= 7; n > 0; n--) {
+        float t;
+
+        t = PA_FLOAT32_SWAP(*samples);
+        t *= volumes[channel];
+        *samples++ = PA_FLOAT32_SWAP(t);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+/* Saturation limits for (p * v) before and after the shift by 16: the
+ * product has to fit in 48 bits to give a 32 bit result */
+static const PA_DECLARE_ALIGNED (16, int64_t, volume_max48[2]) = { 0x7FFFFFFFFFFFLL, 0x7FFFFFFFFFFFLL };
+static const PA_DECLARE_ALIGNED (16, int64_t, volume_min48[2]) = { -0x800000000000LL, -0x800000000000LL };
+static const PA_DECLARE_ALIGNED (16, int64_t, volume_max32[2]) = { 0x7FFFFFFFLL, 0x7FFFFFFFLL };
+static const PA_DECLARE_ALIGNED (16, int64_t, volume_min32[2]) = { -0x80000000LL, -0x80000000LL };
+
+static const PA_DECLARE_ALIGNED (16, uint8_t, swap_32[16]) = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/* Move 4 packed 3 byte samples into the upper 24 bits of 4 dwords, and back */
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24ne_unpack[16]) = {
+    0x80, 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11
+};
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24ne_pack[16]) = {
+    1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, 0x80, 0x80, 0x80, 0x80
+};
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24re_unpack[16]) = {
+    0x80, 2, 1, 0, 0x80, 5, 4, 3, 0x80, 8, 7, 6, 0x80, 11, 10, 9
+};
+static const PA_DECLARE_ALIGNED (16, uint8_t, s24re_pack[16]) = {
+    3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, 0x80, 0x80, 0x80, 0x80
+};
+
+/* Multiply 2 samples with 2 volumes, both in the low dwords of the qwords,
+ * shift right by 16 and saturate to 32 bit like the C version. The results end
+ * up in the low dwords of s. Needs the limits in xmm4-xmm7, uses xmm0 as
+ * blend mask and clobbers v. */
+#define VOLUME_32x32(s,v)                                                               \
+      " pmuldq "#v", "#s"            \n\t" /*    p1 * v1  |    p0 * v0  */              \
+      " movdqa %%xmm5, "#v"          \n\t"                                              \
+      " pcmpgtq "#s", "#v"           \n\t" /* underflow mask */                         \
+      " movdqa "#s", %%xmm0          \n\t"                                              \
+      " pcmpgtq %%xmm4, %%xmm0       \n\t" /* overflow mask */                          \
+      " psrlq $16, "#s"              \n\t" /* the low dword is all we need */           \
+      " blendvpd %%xmm0, %%xmm6, "#s"\n\t"                                              \
+      " movdqa "#v", %%xmm0          \n\t"                                              \
+      " blendvpd %%xmm0, %%xmm7, "#s"\n\t"
+
+/* Apply the volume to the 4 32 bit samples in xmm2 */
+#define VOLUME_4x32                                                                     \
+      " pshufd $0xfa, %%xmm2, %%xmm3 \n\t" /* |   p3  |   p3  |   p2  |   p2  | */      \
+      " pshufd $0x50, %%xmm2, %%xmm2 \n\t" /* |   p1  |   p1  |   p0  |   p0  | */      \
+      " pmovzxdq (%3, %2, 4), %%xmm1 \n\t" /* |    0  |   v1  |    0  |   v0  | */      \
+      VOLUME_32x32 (%%xmm2, %%xmm1)                                                     \
+      " pmovzxdq 8(%3, %2, 4), %%xmm1\n\t" /* |    0  |   v3  |    0  |   v2  | */      \
+      VOLUME_32x32 (%%xmm3, %%xmm1)                                                     \
+      " shufps $0x88, %%xmm3, %%xmm2 \n\t" /* | p3*v3 | p2*v2 | p1*v1 | p0*v0 | */
+
+/* Loop over groups of 4 samples, with format specific code to load the
+ * samples into xmm2 as 32 bit values and to store them back */
+#define VOLUME_32_LOOP(load,store)                                                      \
+      " movdqa %5, %%xmm4            \n\t"                                              \
+      " movdqa %6, %%xmm5            \n\t"                                              \
+      " movdqa %7, %%xmm6            \n\t"                                              \
+      " movdqa %8, %%xmm7            \n\t"                                              \
+      "1:                            \n\t" /* do samples in groups of 4 */              \
+      load                                                                              \
+      VOLUME_4x32                                                                       \
+      store                                                                             \
+      VOLUME_WRAP ($4, %4)                                                              \
+      " dec %1                       \n\t"                                              \
+      " jne 1b                       \n\t"
+
+#if defined (__i386__)
+#define VOLUME_32_PERIOD "m" (period)
+#else
+#define VOLUME_32_PERIOD "r" ((pa_reg_x86)period)
+#endif
+
+#define VOLUME_32_OPERANDS(a,b)                                                         \
+            : "+r" (samples), "+r" (groups), "+r" (channel)                             \
+            : "r" (volumes), VOLUME_32_PERIOD,                                          \
+              "m" (*volume_max48), "m" (*volume_min48),                                 \
+              "m" (*volume_max32), "m" (*volume_min32),                                 \
+              "m" (*a), "m" (*b)                                                        \
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7"
+
+static void pa_volume_s32ne_sse4(int32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 4);
+    n = length / sizeof(int32_t);
+
+    if ((groups = n / 4) > 0)
+        __asm__ __volatile__ (
+            VOLUME_32_LOOP (
+            " movdqu (%0), %%xmm2          \n\t",
+            " movdqu %%xmm2, (%0)          \n\t"
+            " add $16, %0                  \n\t")
+            VOLUME_32_OPERANDS (swap_32, swap_32)
+        );
+
+    for (n &= 3; n > 0; n--) {
+        int64_t t;
+
+        t = (int64_t)(*samples);
+        t = (t * volumes[channel]) >> 16;
+        t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+        *samples++ = (int32_t) t;
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void pa_volume_s32re_sse4(int32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 4);
+    n = length / sizeof(int32_t);
+
+    if ((groups = n / 4) > 0)
+        __asm__ __volatile__ (
+            VOLUME_32_LOOP (
+            " movdqu (%0), %%xmm2          \n\t"
+            " pshufb %9, %%xmm2            \n\t",
+            " pshufb %9, %%xmm2            \n\t"
+            " movdqu %%xmm2, (%0)          \n\t"
+            " add $16, %0                  \n\t")
+            VOLUME_32_OPERANDS (swap_32, swap_32)
+        );
+
+    for (n &= 3; n > 0; n--) {
+        int64_t t;
+
+        t = (int64_t) PA_INT32_SWAP(*samples);
+        t = (t * volumes[channel]) >> 16;
+        t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+        *samples++ = PA_INT32_SWAP((int32_t) t);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void pa_volume_s24_32ne_sse4(uint32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 4);
+    n = length / sizeof(uint32_t);
+
+    if ((groups = n / 4) > 0)
+        __asm__ __volatile__ (
+            VOLUME_32_LOOP (
+            " movdqu (%0), %%xmm2          \n\t"
+            " pslld $8, %%xmm2             \n\t",
+            " psrld $8, %%xmm2             \n\t"
+            " movdqu %%xmm2, (%0)          \n\t"
+            " add $16, %0                  \n\t")
+            VOLUME_32_OPERANDS (swap_32, swap_32)
+        );
+
+    for (n &= 3; n > 0; n--) {
+        int64_t t;
+
+        t = (int64_t) ((int32_t) (*samples << 8));
+        t = (t * volumes[channel]) >> 16;
+        t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+        *samples++ = ((uint32_t) ((int32_t) t)) >> 8;
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void pa_volume_s24_32re_sse4(uint32_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 4);
+    n = length / sizeof(uint32_t);
+
+    if ((groups = n / 4) > 0)
+        __asm__ __volatile__ (
+            VOLUME_32_LOOP (
+            " movdqu (%0), %%xmm2          \n\t"
+            " pshufb %9, %%xmm2            \n\t"
+            " pslld $8, %%xmm2             \n\t",
+            " psrld $8, %%xmm2             \n\t"
+            " pshufb %9, %%xmm2            \n\t"
+            " movdqu %%xmm2, (%0)          \n\t"
+            " add $16, %0                  \n\t")
+            VOLUME_32_OPERANDS (swap_32, swap_32)
+        );
+
+    for (n &= 3; n > 0; n--) {
+        int64_t t;
+
+        t = (int64_t) ((int32_t) (PA_UINT32_SWAP(*samples) << 8));
+        t = (t * volumes[channel]) >> 16;
+        t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+        *samples++ = PA_UINT32_SWAP(((uint32_t) ((int32_t) t)) >> 8);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+/* 4 packed 24 bit samples are read and written as 8 + 4 bytes, so we never
+ * touch memory past the end of the buffer */
+#define S24_LOAD                                                                        \
+      " movq (%0), %%xmm2            \n\t"                                              \
+      " movd 8(%0), %%xmm3           \n\t"                                              \
+      " punpcklqdq %%xmm3, %%xmm2    \n\t"                                              \
+      " pshufb %9, %%xmm2            \n\t"
+
+#define S24_STORE                                                                       \
+      " pshufb %10, %%xmm2           \n\t"                                              \
+      " movq %%xmm2, (%0)            \n\t"                                              \
+      " psrldq $8, %%xmm2            \n\t"                                              \
+      " movd %%xmm2, 8(%0)           \n\t"                                              \
+      " add $12, %0                  \n\t"
+
+static void pa_volume_s24ne_sse4(uint8_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 4);
+    n = length / 3;
+
+    if ((groups = n / 4) > 0)
+        __asm__ __volatile__ (
+            VOLUME_32_LOOP (S24_LOAD, S24_STORE)
+            VOLUME_32_OPERANDS (s24ne_unpack, s24ne_pack)
+        );
+
+    for (n &= 3; n > 0; n--, samples += 3) {
+        int64_t t;
+
+        t = (int64_t)((int32_t) (PA_READ24NE(samples) << 8));
+        t = (t * volumes[channel]) >> 16;
+        t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+        PA_WRITE24NE(samples, ((uint32_t) (int32_t) t) >> 8);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
+static void pa_volume_s24re_sse4(uint8_t *samples, const int32_t *volumes, unsigned channels, unsigned length) {
+    pa_reg_x86 channel = 0, groups;
+    unsigned period, n;
+
+    period = volume_period(channels, 4);
+    n = length / 3;
+
+    if ((groups = n / 4) > 0)
+        __asm__ __volatile__ (
+            VOLUME_32_LOOP (S24_LOAD, S24_STORE)
+            VOLUME_32_OPERANDS (s24re_unpack, s24re_pack)
+        );
+
+    for (n &= 3; n > 0; n--, samples += 3) {
+        int64_t t;
+
+        t = (int64_t)((int32_t) (PA_READ24RE(samples) << 8));
+        t = (t * volumes[channel]) >> 16;
+        t = PA_CLAMP_UNLIKELY(t, -0x80000000LL, 0x7FFFFFFFLL);
+        PA_WRITE24RE(samples, ((uint32_t) (int32_t) t) >> 8);
+
+        if (PA_UNLIKELY(++channel >= period))
+            channel = 0;
+    }
+}
+
 #undef RUN_TEST
 
 #ifdef RUN_TEST
@@ -331,6 +757,90 @@ static void run_test(void) {
 
     pa_assert_se(memcmp(samples_ref, samples, sizeof(samples)) == 0);
 }
+
+#define FORMAT_CHANNELS 3
+#define FORMAT_SAMPLES 1021
+#define FORMAT_PADDING 32 /* like VOLUME_PADDING in sample-util.c */
+
+/* Check one of the other formats against the C version, with volumes up to
+ * 4x to exercise the saturation */
+static void run_test_format(const char *name, pa_sample_format_t format, pa_do_volume_func_t func) {
+    union {
+        float f[FORMAT_SAMPLES];
+        int32_t i[FORMAT_SAMPLES];
+    } samples, samples_ref, samples_orig;
+    union {
+        float f[FORMAT_CHANNELS + FORMAT_PADDING];
+        int32_t i[FORMAT_CHANNELS + FORMAT_PADDING];
+    } volumes;
+    size_t length;
+    unsigned i;
+    int j, k;
+    pa_usec_t start, stop;
+    pa_usec_t min = INT_MAX, max = 0;
+    double s1 = 0, s2 = 0;
+
+    length = FORMAT_SAMPLES * pa_sample_size_of_format(format);
+
+    if (format == PA_SAMPLE_FLOAT32NE || format == PA_SAMPLE_FLOAT32RE) {
+        for (i = 0; i < FORMAT_SAMPLES; i++) {
+            samples_orig.f[i] = 2.0f * (rand()/(float) RAND_MAX - 0.5f);
+            if (format == PA_SAMPLE_FLOAT32RE)
+                samples_orig.f[i] = PA_FLOAT32_SWAP(samples_orig.f[i]);
+        }
+        for (i = 0; i < FORMAT_CHANNELS + FORMAT_PADDING; i++)
+            volumes.f[i] = i < FORMAT_CHANNELS ? 4.0f * rand()/(float) RAND_MAX : volumes.f[i - FORMAT_CHANNELS];
+    } else {
+        pa_random(&samples_orig, sizeof(samples_orig));
+        for (i = 0; i < FORMAT_CHANNELS + FORMAT_PADDING; i++)
+            volumes.i[i] = i < FORMAT_CHANNELS ? rand() % 0x40000 : volumes.i[i - FORMAT_CHANNELS];
+    }
+
+    memcpy(&samples, &samples_orig, sizeof(samples));
+    memcpy(&samples_ref, &samples_orig, sizeof(samples));
+
+    pa_get_volume_func(format)(&samples_ref, &volumes, FORMAT_CHANNELS, length);
+    func(&samples, &volumes, FORMAT_CHANNELS, length);
+
+    if (memcmp(&samples_ref, &samples, length) != 0)
+        pa_log_error("%s: %s differs from the C version", name, pa_sample_format_to_string(format));
+    else
+        pa_log_info("%s: %s ok", name, pa_sample_format_to_string(format));
+
+    for (k = 0; k < TIMES2; k++) {
+        start = pa_rtclock_now();
+        for (j = 0; j < TIMES; j++) {
+            memcpy(&samples, &samples_orig, length);
+            func(&samples, &volumes, FORMAT_CHANNELS, length);
+        }
+        stop = pa_rtclock_now();
+
+        if (min > (stop - start)) min = stop - start;
+        if (max < (stop - start)) max = stop - start;
+        s1 += stop - start;
+        s2 += (stop - start) * (stop - start);
+    }
+    pa_log_info("%s: %llu usec (min = %llu, max = %llu, stddev = %g).", name, (long long unsigned int)s1,
+            (long long unsigned int)min, (long long unsigned int)max, sqrt(TIMES2 * s2 - s1 * s1) / TIMES2);
+
+    min = INT_MAX; max = 0;
+    s1 = s2 = 0;
+    for (k = 0; k < TIMES2; k++) {
+        start = pa_rtclock_now();
+        for (j = 0; j < TIMES; j++) {
+            memcpy(&samples_ref, &samples_orig, length);
+            pa_get_volume_func(format)(&samples_ref, &volumes, FORMAT_CHANNELS, length);
+        }
+        stop = pa_rtclock_now();
+
+        if (min > (stop - start)) min = stop - start;
+        if (max < (stop - start)) max = stop - start;
+        s1 += stop - start;
+        s2 += (stop - start) * (stop - start);
+    }
+    pa_log_info("ref: %llu usec (min = %llu, max = %llu, stddev = %g).", (long long unsigned int)s1,
+            (long long unsigned int)min, (long long unsigned int)max, sqrt(TIMES2 * s2 - s1 * s1) / TIMES2);
+}
 #endif
 #endif /* defined (__i386__) || defined (__amd64__) */
 
@@ -339,13 +849,46 @@ void pa_volume_func_init_sse(pa_cpu_x86_flag_t flags) {
 
 #ifdef RUN_TEST
     run_test();
+
+    run_test_format("SSE", PA_SAMPLE_FLOAT32NE, (pa_do_volume_func_t) pa_volume_float32ne_sse);
+    if (flags & PA_CPU_X86_AVX)
+        run_test_format("AVX", PA_SAMPLE_FLOAT32NE, (pa_do_volume_func_t) pa_volume_float32ne_avx);
+    if (flags & PA_CPU_X86_SSE2)
+        run_test_format("SSE2", PA_SAMPLE_FLOAT32RE, (pa_do_volume_func_t) pa_volume_float32re_sse2);
+    if ((flags & PA_CPU_X86_SSE4_2) && (flags & PA_CPU_X86_SSSE3)) {
+        run_test_format("SSE4", PA_SAMPLE_S32NE, (pa_do_volume_func_t) pa_volume_s32ne_sse4);
+        run_test_format("SSE4", PA_SAMPLE_S32RE, (pa_do_volume_func_t) pa_volume_s32re_sse4);
+        run_test_format("SSE4", PA_SAMPLE_S24_32NE, (pa_do_volume_func_t) pa_volume_s24_32ne_sse4);
+        run_test_format("SSE4", PA_SAMPLE_S24_32RE, (pa_do_volume_func_t) pa_volume_s24_32re_sse4);
+        run_test_format("SSE4", PA_SAMPLE_S24NE, (pa_do_volume_func_t) pa_volume_s24ne_sse4);
+        run_test_format("SSE4", PA_SAMPLE_S24RE, (pa_do_volume_func_t) pa_volume_s24re_sse4);
+    }
 #endif
 
+    if (flags & PA_CPU_X86_AVX) {
+        pa_log_info("Initialising AVX optimized float volume function.");
+        pa_set_volume_func(PA_SAMPLE_FLOAT32NE, (pa_do_volume_func_t) pa_volume_float32ne_avx);
+    } else
+        pa_set_volume_func(PA_SAMPLE_FLOAT32NE, (pa_do_volume_func_t) pa_volume_float32ne_sse);
+
     if (flags & PA_CPU_X86_SSE2) {
         pa_log_info("Initialising SSE2 optimized volume functions.");
 
         pa_set_volume_func(PA_SAMPLE_S16NE, (pa_do_volume_func_t) pa_volume_s16ne_sse2);
         pa_set_volume_func(PA_SAMPLE_S16RE, (pa_do_volume_func_t) pa_volume_s16re_sse2);
+        pa_set_volume_func(PA_SAMPLE_FLOAT32RE, (pa_do_volume_func_t) pa_volume_float32re_sse2);
+    }
+
+    /* pcmpgtq for the saturation is SSE4.2, pshufb is SSSE3 */
+    if ((flags & PA_CPU_X86_SSE4_2) && (flags & PA_CPU_X86_SSSE3)) {
+        pa_log_info("Initialising SSE4.2 optimized 24 and 32 bit volume functions.");
+
+        pa_set_volume_func(PA_SAMPLE_S32NE, (pa_do_volume_func_t) pa_volume_s32ne_sse4);
+        pa_set_volume_func(PA_SAMPLE_S32RE, (pa_do_volume_func_t) pa_volume_s32re_sse4);
+        pa_set_volume_func(PA_SAMPLE_S24_32NE, (pa_do_volume_func_t) pa_volume_s24_32ne_sse4);
+        pa_set_volume_func(PA_SAMPLE_S24_32RE, (pa_do_volume_func_t) pa_volume_s24_32re_sse4);
+        pa_set_volume_func(PA_SAMPLE_S24NE, (pa_do_volume_func_t) pa_volume_s24ne_sse4);
+        pa_set_volume_func(PA_SAMPLE_S24RE, (pa_do_volume_func_t) pa_volume_s24re_sse4);
     }
 #endif /* defined (__i386__) || defined (__amd64__) */
 }
@@ -29,6 +29,7 @@
 #include <pulsecore/thread.h>
 #include <pulsecore/semaphore.h>
 #include <pulsecore/macro.h>
+#include <pulsecore/log.h>
 
 #include "thread-mq.h"
 
@@ -122,6 +123,9 @@ void pa_thread_mq_install(pa_thread_mq *q) {
 
     pa_assert(!(PA_STATIC_TLS_GET(thread_mq)));
     PA_STATIC_TLS_SET(thread_mq, q);
+
+    /* IO threads must not block on syslog or a slow terminal */
+    pa_log_async_enable_thread();
 }
 
 pa_thread_mq *pa_thread_mq_get(void) {
@@ -37,6 +37,11 @@ enum {
     QUIT
 };
 
+/* More than fit into the queue, so that the poster has to wait */
+#define N_BATCH 1000
+
+static unsigned n_a = 0;
+
 static void the_thread(void *_q) {
     pa_asyncmsgq *q = _q;
     int quit = 0;
@@ -50,6 +55,7 @@ static void the_thread(void *_q) {
 
             case OPERATION_A:
                 pa_log_info("Operation A");
+                n_a++;
                 break;
 
             case OPERATION_B:
@@ -74,6 +80,8 @@ static void the_thread(void *_q) {
 int main(int argc, char *argv[]) {
     pa_asyncmsgq *q;
     pa_thread *t;
+    const pa_asyncmsgq_stat *stat;
+    unsigned i;
 
     pa_assert_se(q = pa_asyncmsgq_new(0));
 
@@ -94,6 +102,23 @@ int main(int argc, char *argv[]) {
 
     pa_thread_yield();
 
+    pa_log_info("Operation A batch post");
+    pa_asyncmsgq_post_batch_begin(q);
+    for (i = 0; i < N_BATCH; i++)
+        pa_asyncmsgq_post(q, NULL, OPERATION_A, NULL, 0, NULL, NULL);
+    pa_asyncmsgq_post_batch_end(q);
+
+    pa_log_info("Operation C send");
+    pa_asyncmsgq_send(q, NULL, OPERATION_C, NULL, 0, NULL);
+
+    /* Everything posted before was dispatched before the send returned */
+    stat = pa_asyncmsgq_get_stat(q);
+    pa_assert_se(n_a == N_BATCH + 1);
+    pa_assert_se(pa_atomic_load(&stat->n_posted) == N_BATCH + 2);
+    pa_assert_se(pa_atomic_load(&stat->n_sent) == 2);
+    pa_assert_se(pa_atomic_load(&stat->n_queued) == 0);
+    pa_assert_se(pa_atomic_load(&stat->n_queued_max) >= 1);
+
     pa_log_info("Quit post");
     pa_asyncmsgq_post(q, NULL, QUIT, NULL, 0, NULL, NULL);
 
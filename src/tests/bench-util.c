@@ -0,0 +1,90 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pulse/rtclock.h>
+
+#include "bench-util.h"
+
+pa_usec_t bench_min_time = 20000;
+unsigned bench_repeat = 3;
+
+double bench_measure(bench_cb_t cb, void *userdata, unsigned n_ops) {
+    double best = 0;
+    unsigned r;
+
+    /* warm up caches and lazily initialized tables */
+    cb(userdata);
+
+    for (r = 0; r < bench_repeat; r++) {
+        pa_usec_t start, elapsed;
+        uint64_t calls = 0, batch = 1, i;
+        double ns;
+
+        start = pa_rtclock_now();
+
+        for (;;) {
+            for (i = 0; i < batch; i++)
+                cb(userdata);
+
+            calls += batch;
+            elapsed = pa_rtclock_now() - start;
+
+            if (elapsed >= bench_min_time)
+                break;
+
+            batch *= 2;
+        }
+
+        ns = (double) elapsed * 1000.0 / ((double) calls * n_ops);
+
+        if (r == 0 || ns < best)
+            best = ns;
+    }
+
+    return best;
+}
+
+void bench_help(void) {
+    printf("      --min-time=USEC                 Minimum duration of a run (defaults to %llu)\n"
+           "      --repeat=N                      Number of runs, the fastest is reported (defaults to %u)\n",
+           (unsigned long long) bench_min_time, bench_repeat);
+}
+
+pa_bool_t bench_parse_option(int c, const char *arg) {
+
+    switch (c) {
+        case BENCH_ARG_MIN_TIME:
+            bench_min_time = (pa_usec_t) atoi(arg);
+            return TRUE;
+
+        case BENCH_ARG_REPEAT:
+            bench_repeat = (unsigned) PA_MAX(atoi(arg), 1);
+            return TRUE;
+
+        default:
+            return FALSE;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef foobenchutilhfoo
+#define foobenchutilhfoo
+
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Helpers shared by the benchmarks in this directory: timing a callback
+ * and the --min-time and --repeat options. */
+
+#include <pulse/sample.h>
+
+#include <pulsecore/macro.h>
+
+typedef void (*bench_cb_t)(void *userdata);
+
+/* Options every benchmark understands. The benchmarks number their own
+ * options from BENCH_ARG_MAX on. */
+enum {
+    BENCH_ARG_MIN_TIME = 256,
+    BENCH_ARG_REPEAT,
+    BENCH_ARG_MAX
+};
+
+#define BENCH_LONG_OPTIONS                                  \
+    {"min-time", 1, NULL, BENCH_ARG_MIN_TIME},              \
+    {"repeat",   1, NULL, BENCH_ARG_REPEAT}
+
+/* Minimum duration of a run, and the number of runs of which the
+ * fastest is reported */
+extern pa_usec_t bench_min_time;
+extern unsigned bench_repeat;
+
+/* Calls cb repeatedly for at least bench_min_time, bench_repeat times,
+ * after one call to warm up caches. Returns the best ns per operation,
+ * given that each call does n_ops of them. */
+double bench_measure(bench_cb_t cb, void *userdata, unsigned n_ops);
+
+/* Prints the help lines for the common options */
+void bench_help(void);
+
+/* Handles one of the common options, returns FALSE for other ones */
+pa_bool_t bench_parse_option(int c, const char *arg);
+
+#endif
@@ -0,0 +1,127 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/convolver.h>
+
+#define FRAMES 5000
+#define MAX_ERROR 1e-4f
+
+/* Convolve random input in randomly sized pieces and compare against the
+ * direct convolution. Returns the maximum error. */
+static float run(unsigned n_in, unsigned n_out, unsigned length, unsigned block_size) {
+    pa_convolver *c;
+    float *in, *out, *taps, err = 0;
+    unsigned i, o, t, k;
+
+    in = pa_xnew(float, FRAMES * n_in);
+    out = pa_xnew(float, FRAMES * n_out);
+    taps = pa_xnew(float, n_in * n_out * length);
+
+    for (i = 0; i < FRAMES * n_in; i++)
+        in[i] = 2.0f * (rand() / (float) RAND_MAX - 0.5f);
+
+    /* Decaying random taps, stored interleaved by input/output pair like
+     * the impulse responses of module-virtual-surround-sink */
+    for (k = 0; k < length; k++)
+        for (i = 0; i < n_in * n_out; i++)
+            taps[k * n_in * n_out + i] = (rand() / (float) RAND_MAX - 0.5f) * expf(-4.0f * k / length) / n_in;
+
+    c = pa_convolver_new(n_in, n_out, length, block_size);
+
+    for (i = 0; i < n_in; i++)
+        for (o = 0; o < n_out; o++)
+            pa_convolver_set_filter(c, i, o, taps + i * n_out + o, length, n_in * n_out);
+
+    for (t = 0; t < FRAMES;) {
+        unsigned n = PA_MIN((unsigned) (rand() % 700) + 1, FRAMES - t);
+
+        pa_convolver_run(c, in + t * n_in, out + t * n_out, n);
+        t += n;
+    }
+
+    pa_convolver_free(c);
+
+    for (t = 0; t < FRAMES; t++)
+        for (o = 0; o < n_out; o++) {
+            double sum = 0;
+            float e;
+
+            for (i = 0; i < n_in; i++)
+                for (k = 0; k < length && k <= t; k++)
+                    sum += in[(t - k) * n_in + i] * taps[k * n_in * n_out + i * n_out + o];
+
+            e = fabsf(out[t * n_out + o] - (float) sum);
+            if (e > err)
+                err = e;
+        }
+
+    pa_xfree(in);
+    pa_xfree(out);
+    pa_xfree(taps);
+
+    return err;
+}
+
+int main(int argc, char *argv[]) {
+    static const unsigned configs[][4] = {
+        /* inputs, outputs, filter length, block size */
+        { 1, 1, 1, 0 },
+        { 1, 1, 64, 0 },
+        { 1, 1, 100, 16 },
+        { 1, 2, 1000, 0 },
+        { 2, 2, 513, 64 },
+        { 6, 2, 2000, 0 },
+        { 8, 2, 300, 128 },
+        { 2, 1, 4096, 256 }
+    };
+    unsigned i;
+    int ret = 0;
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    for (i = 0; i < PA_ELEMENTSOF(configs); i++) {
+        float err;
+
+        srand(i);
+        err = run(configs[i][0], configs[i][1], configs[i][2], configs[i][3]);
+
+        pa_log_info("%u -> %u channels, %u taps, block size %u: maximum error %g",
+                    configs[i][0], configs[i][1], configs[i][2], configs[i][3], err);
+
+        if (err > MAX_ERROR) {
+            pa_log_error("Error too large (> %g)", MAX_ERROR);
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,683 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Measures the sample processing primitives for every code path the CPU
+ * supports and prints ns/frame as CSV, one line per measurement:
+ *
+ *   kind,path,name,format,in_channels,out_channels,frames,ns_per_frame
+ *
+ * "c" is the generic code. The other paths install one set of optimized
+ * functions on top of it, and only lines for functions that the path
+ * actually replaces are printed. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <pulse/sample.h>
+#include <pulse/volume.h>
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/cpu-x86.h>
+#include <pulsecore/cpu-arm.h>
+#include <pulsecore/cpu-orc.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/memblock.h>
+#include <pulsecore/sample-util.h>
+#include <pulsecore/sconv.h>
+#include <pulsecore/remap.h>
+#include <pulsecore/resampler.h>
+#include <pulsecore/sinc.h>
+
+#include "bench-util.h"
+
+#define IN_RATE 44100
+#define OUT_RATE 48000
+
+static const unsigned channel_grid[] = { 1, 2, 6, 8 };
+static const unsigned frames_grid[] = { 64, 512, 4096 };
+
+#define MAX_FRAMES 4096
+
+enum {
+    CONVERT_TO_FLOAT32NE,
+    CONVERT_FROM_FLOAT32NE,
+    CONVERT_TO_S16NE,
+    CONVERT_FROM_S16NE,
+    CONVERT_MAX
+};
+
+static const char *convert_names[CONVERT_MAX] = {
+    "to_float32ne", "from_float32ne", "to_s16ne", "from_s16ne"
+};
+
+/* The functions installed before any optimizations */
+static struct {
+    pa_do_volume_func_t volume[PA_SAMPLE_MAX];
+    pa_do_mix_func_t mix[PA_SAMPLE_MAX];
+    pa_convert_func_t convert[CONVERT_MAX][PA_SAMPLE_MAX];
+    pa_init_remap_func_t init_remap;
+    pa_sinc_dot_func_t sinc_dot;
+} generic;
+
+static pa_mempool *pool;
+
+/* Random noise at full scale in every sample format */
+static void *noise[PA_SAMPLE_MAX];
+
+static const char *only_kind = NULL, *only_path = NULL;
+
+static pa_convert_func_t get_convert(unsigned dir, pa_sample_format_t f) {
+    switch (dir) {
+        case CONVERT_TO_FLOAT32NE: return pa_get_convert_to_float32ne_function(f);
+        case CONVERT_FROM_FLOAT32NE: return pa_get_convert_from_float32ne_function(f);
+        case CONVERT_TO_S16NE: return pa_get_convert_to_s16ne_function(f);
+        case CONVERT_FROM_S16NE: return pa_get_convert_from_s16ne_function(f);
+    }
+
+    pa_assert_not_reached();
+}
+
+static void set_convert(unsigned dir, pa_sample_format_t f, pa_convert_func_t func) {
+    switch (dir) {
+        case CONVERT_TO_FLOAT32NE: pa_set_convert_to_float32ne_function(f, func); return;
+        case CONVERT_FROM_FLOAT32NE: pa_set_convert_from_float32ne_function(f, func); return;
+        case CONVERT_TO_S16NE: pa_set_convert_to_s16ne_function(f, func); return;
+        case CONVERT_FROM_S16NE: pa_set_convert_from_s16ne_function(f, func); return;
+    }
+
+    pa_assert_not_reached();
+}
+
+static void save_generic(void) {
+    unsigned f, d;
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++) {
+        generic.volume[f] = pa_get_volume_func(f);
+        generic.mix[f] = pa_get_mix_func(f);
+
+        for (d = 0; d < CONVERT_MAX; d++)
+            generic.convert[d][f] = get_convert(d, f);
+    }
+
+    generic.init_remap = pa_get_init_remap_func();
+    generic.sinc_dot = pa_get_sinc_dot_func();
+}
+
+static void restore_generic(void) {
+    unsigned f, d;
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++) {
+        pa_set_volume_func(f, generic.volume[f]);
+        pa_set_mix_func(f, generic.mix[f]);
+
+        for (d = 0; d < CONVERT_MAX; d++)
+            set_convert(d, f, generic.convert[d][f]);
+    }
+
+    pa_set_init_remap_func(generic.init_remap);
+    pa_set_sinc_dot_func(generic.sinc_dot);
+}
+
+/* Code paths */
+
+/* A path is measured if the CPU has the required flag, and its functions
+ * are installed seeing only the CPU flags in mask */
+typedef struct path {
+    const char *name;
+    void (*install)(unsigned flags);
+    unsigned required, mask;
+} path;
+
+#if defined (__i386__) || defined (__amd64__)
+static void install_mmx(unsigned flags) {
+    pa_volume_func_init_mmx(flags);
+    pa_remap_func_init_mmx(flags);
+}
+
+static void install_sse(unsigned flags) {
+    pa_volume_func_init_sse(flags);
+    pa_remap_func_init_sse(flags);
+    pa_convert_func_init_sse(flags);
+    pa_mix_func_init_sse(flags);
+    pa_sinc_func_init_sse(flags);
+}
+
+#define X86_MMX (PA_CPU_X86_CMOV | PA_CPU_X86_MMX | PA_CPU_X86_MMXEXT)
+#define X86_SSE (X86_MMX | PA_CPU_X86_SSE)
+#define X86_SSE2 (X86_SSE | PA_CPU_X86_SSE2)
+#define X86_SSSE3 (X86_SSE2 | PA_CPU_X86_SSE3 | PA_CPU_X86_SSSE3 | PA_CPU_X86_SSE4_1 | PA_CPU_X86_SSE4_2)
+#define X86_AVX (X86_SSSE3 | PA_CPU_X86_AVX)
+#define X86_AVX2 (X86_AVX | PA_CPU_X86_AVX2)
+#endif
+
+#if defined (__arm__)
+static void install_arm(unsigned flags) {
+    pa_volume_func_init_arm(flags);
+}
+
+#ifdef HAVE_NEON
+static void install_neon(unsigned flags) {
+    pa_mix_func_init_neon(flags);
+    pa_sinc_func_init_neon(flags);
+}
+#endif
+#endif
+
+#ifdef HAVE_ORC
+static void install_orc(unsigned flags) {
+    pa_volume_func_init_orc();
+}
+#endif
+
+static const path paths[] = {
+    { "c", NULL, 0, 0 },
+#if defined (__i386__) || defined (__amd64__)
+    { "mmx", install_mmx, PA_CPU_X86_MMX, X86_MMX },
+    { "sse", install_sse, PA_CPU_X86_SSE, X86_SSE },
+    { "sse2", install_sse, PA_CPU_X86_SSE2, X86_SSE2 },
+    { "ssse3", install_sse, PA_CPU_X86_SSSE3, X86_SSSE3 },
+    { "avx", install_sse, PA_CPU_X86_AVX, X86_AVX },
+    { "avx2", install_sse, PA_CPU_X86_AVX2, X86_AVX2 },
+#endif
+#if defined (__arm__)
+    { "armv6", install_arm, PA_CPU_ARM_V6, ~0U },
+#ifdef HAVE_NEON
+    { "neon", install_neon, PA_CPU_ARM_NEON, ~0U },
+#endif
+#endif
+#ifdef HAVE_ORC
+    { "orc", install_orc, 0, 0 },
+#endif
+};
+
+static void report(const char *kind, const char *path_name, const char *name, pa_sample_format_t format,
+                   unsigned in_channels, unsigned out_channels, unsigned frames, double ns) {
+
+    printf("%s,%s,%s,%s,%u,%u,%u,%.3f\n", kind, path_name, name, pa_sample_format_to_string(format),
+           in_channels, out_channels, frames, ns);
+    fflush(stdout);
+}
+
+static pa_bool_t want_kind(const char *kind) {
+    return !only_kind || pa_streq(only_kind, kind);
+}
+
+/* Mixing */
+
+struct mix_bench {
+    pa_mix_info streams[2];
+    pa_sample_spec spec;
+    pa_cvolume volume;
+    void *out;
+    size_t length;
+};
+
+static void mix_cb(void *userdata) {
+    struct mix_bench *b = userdata;
+
+    pa_mix(b->streams, 2, b->out, b->length, &b->spec, &b->volume, FALSE);
+}
+
+static void bench_mix(const path *p) {
+    unsigned f, c, n, k;
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++) {
+        if (!pa_get_mix_func(f) || (p->install && pa_get_mix_func(f) == generic.mix[f]))
+            continue;
+
+        for (c = 0; c < PA_ELEMENTSOF(channel_grid); c++)
+            for (n = 0; n < PA_ELEMENTSOF(frames_grid); n++) {
+                struct mix_bench b;
+
+                b.spec.format = f;
+                b.spec.rate = IN_RATE;
+                b.spec.channels = (uint8_t) channel_grid[c];
+                b.length = frames_grid[n] * pa_frame_size(&b.spec);
+                b.out = pa_xmalloc(b.length);
+                pa_cvolume_set(&b.volume, b.spec.channels, PA_VOLUME_NORM);
+
+                for (k = 0; k < 2; k++) {
+                    b.streams[k].chunk.memblock = pa_memblock_new_fixed(pool, noise[f], b.length, TRUE);
+                    b.streams[k].chunk.index = 0;
+                    b.streams[k].chunk.length = b.length;
+                    pa_cvolume_set(&b.streams[k].volume, b.spec.channels, PA_VOLUME_NORM / (k + 2));
+                    b.streams[k].userdata = NULL;
+                }
+
+                report("mix", p->name, "mix2", f, b.spec.channels, b.spec.channels, frames_grid[n],
+                       bench_measure(mix_cb, &b, frames_grid[n]));
+
+                for (k = 0; k < 2; k++)
+                    pa_memblock_unref_fixed(b.streams[k].chunk.memblock);
+                pa_xfree(b.out);
+            }
+    }
+}
+
+/* Volume */
+
+struct volume_bench {
+    pa_memchunk chunk;
+    pa_sample_spec spec;
+    pa_cvolume volume[2];
+    unsigned which;
+};
+
+static void volume_cb(void *userdata) {
+    struct volume_bench *b = userdata;
+
+    /* Alternate between attenuation and amplification so that the samples
+     * stay in range and floats don't turn denormal */
+    pa_volume_memchunk(&b->chunk, &b->spec, &b->volume[b->which]);
+    b->which = !b->which;
+}
+
+static void bench_volume(const path *p) {
+    unsigned f, c, n;
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++) {
+        if (!pa_get_volume_func(f) || (p->install && pa_get_volume_func(f) == generic.volume[f]))
+            continue;
+
+        for (c = 0; c < PA_ELEMENTSOF(channel_grid); c++)
+            for (n = 0; n < PA_ELEMENTSOF(frames_grid); n++) {
+                struct volume_bench b;
+
+                b.spec.format = f;
+                b.spec.rate = IN_RATE;
+                b.spec.channels = (uint8_t) channel_grid[c];
+                b.chunk.length = frames_grid[n] * pa_frame_size(&b.spec);
+                b.chunk.index = 0;
+                b.chunk.memblock = pa_memblock_new(pool, b.chunk.length);
+                memcpy(pa_memblock_acquire(b.chunk.memblock), noise[f], b.chunk.length);
+                pa_memblock_release(b.chunk.memblock);
+
+                pa_cvolume_set(&b.volume[0], b.spec.channels, pa_sw_volume_from_linear(0.5));
+                pa_cvolume_set(&b.volume[1], b.spec.channels, pa_sw_volume_from_linear(2.0));
+                b.which = 0;
+
+                report("volume", p->name, "volume", f, b.spec.channels, b.spec.channels, frames_grid[n],
+                       bench_measure(volume_cb, &b, frames_grid[n]));
+
+                pa_memblock_unref(b.chunk.memblock);
+            }
+    }
+}
+
+/* Sample format conversion */
+
+struct convert_bench {
+    pa_convert_func_t func;
+    const void *in;
+    void *out;
+    unsigned n;
+};
+
+static void convert_cb(void *userdata) {
+    struct convert_bench *b = userdata;
+
+    b->func(b->n, b->in, b->out);
+}
+
+static void bench_convert(const path *p) {
+    unsigned d, f, n;
+    void *out;
+
+    /* Converters work on samples, so the channel count doesn't matter */
+    out = pa_xmalloc(MAX_FRAMES * 4);
+
+    for (d = 0; d < CONVERT_MAX; d++)
+        for (f = 0; f < PA_SAMPLE_MAX; f++) {
+            struct convert_bench b;
+            pa_sample_format_t in_format;
+
+            if (!(b.func = get_convert(d, f)))
+                continue;
+
+            if (p->install && b.func == generic.convert[d][f])
+                continue;
+
+            if (d == CONVERT_FROM_FLOAT32NE)
+                in_format = PA_SAMPLE_FLOAT32NE;
+            else if (d == CONVERT_FROM_S16NE)
+                in_format = PA_SAMPLE_S16NE;
+            else
+                in_format = f;
+
+            b.in = noise[in_format];
+            b.out = out;
+
+            for (n = 0; n < PA_ELEMENTSOF(frames_grid); n++) {
+                b.n = frames_grid[n];
+
+                report("sconv", p->name, convert_names[d], f, 1, 1, frames_grid[n],
+                       bench_measure(convert_cb, &b, frames_grid[n]));
+            }
+        }
+
+    pa_xfree(out);
+}
+
+/* Channel remapping */
+
+struct remap_bench {
+    pa_remap_t remap;
+    pa_sample_format_t format;
+    pa_sample_spec i_ss, o_ss;
+    void *out;
+    unsigned n;
+};
+
+static void remap_cb(void *userdata) {
+    struct remap_bench *b = userdata;
+
+    b->remap.do_remap(&b->remap, b->out, noise[b->format], b->n);
+}
+
+static void bench_remap(const path *p) {
+    static const pa_sample_format_t formats[] = { PA_SAMPLE_S16NE, PA_SAMPLE_FLOAT32NE };
+    static const char *matrix_names[] = { "arrange", "mix" };
+    unsigned f, i, o, kind, n, ic, oc;
+    pa_do_remap_func_t generic_remap;
+    struct remap_bench b;
+
+    b.remap.format = &b.format;
+    b.remap.i_ss = &b.i_ss;
+    b.remap.o_ss = &b.o_ss;
+    b.out = pa_xmalloc(MAX_FRAMES * PA_CHANNELS_MAX * 4);
+
+    for (f = 0; f < PA_ELEMENTSOF(formats); f++)
+        for (i = 0; i < PA_ELEMENTSOF(channel_grid); i++)
+            for (o = 0; o < PA_ELEMENTSOF(channel_grid); o++)
+                for (kind = 0; kind < PA_ELEMENTSOF(matrix_names); kind++) {
+                    b.format = b.i_ss.format = b.o_ss.format = formats[f];
+                    b.i_ss.channels = (uint8_t) channel_grid[i];
+                    b.o_ss.channels = (uint8_t) channel_grid[o];
+                    b.i_ss.rate = b.o_ss.rate = IN_RATE;
+
+                    /* "arrange" copies input channels, "mix" averages all
+                     * of them into every output channel */
+                    memset(b.remap.map_table_f, 0, sizeof(b.remap.map_table_f));
+                    for (oc = 0; oc < b.o_ss.channels; oc++)
+                        for (ic = 0; ic < b.i_ss.channels; ic++)
+                            if (kind == 1)
+                                b.remap.map_table_f[oc][ic] = 1.0f / b.i_ss.channels;
+                            else if (ic == oc % b.i_ss.channels)
+                                b.remap.map_table_f[oc][ic] = 1.0f;
+
+                    for (oc = 0; oc < PA_CHANNELS_MAX; oc++)
+                        for (ic = 0; ic < PA_CHANNELS_MAX; ic++)
+                            b.remap.map_table_i[oc][ic] = (int32_t) (b.remap.map_table_f[oc][ic] * 0x10000);
+
+                    b.remap.do_remap = NULL;
+                    generic.init_remap(&b.remap);
+                    generic_remap = b.remap.do_remap;
+
+                    pa_init_remap(&b.remap);
+
+                    if (p->install && b.remap.do_remap == generic_remap)
+                        continue;
+
+                    for (n = 0; n < PA_ELEMENTSOF(frames_grid); n++) {
+                        b.n = frames_grid[n];
+
+                        report("remap", p->name, matrix_names[kind], formats[f], b.i_ss.channels, b.o_ss.channels,
+                               frames_grid[n], bench_measure(remap_cb, &b, frames_grid[n]));
+                    }
+                }
+
+    pa_xfree(b.out);
+}
+
+/* Resampling */
+
+struct resample_bench {
+    pa_resampler *resampler;
+    pa_memchunk in;
+};
+
+static void resample_cb(void *userdata) {
+    struct resample_bench *b = userdata;
+    pa_memchunk out;
+
+    pa_resampler_run(b->resampler, &b->in, &out);
+
+    if (out.memblock)
+        pa_memblock_unref(out.memblock);
+}
+
+/* Whether the path replaced anything the resampler uses for this format.
+ * Remapping doesn't matter, the channel count doesn't change. */
+static pa_bool_t resampler_changed(pa_sample_format_t f) {
+    unsigned d;
+
+    if (pa_get_sinc_dot_func() != generic.sinc_dot)
+        return TRUE;
+
+    for (d = 0; d < CONVERT_MAX; d++)
+        if (get_convert(d, f) != generic.convert[d][f])
+            return TRUE;
+
+    return FALSE;
+}
+
+static void bench_resample(const path *p) {
+    static const pa_sample_format_t formats[] = { PA_SAMPLE_S16NE, PA_SAMPLE_FLOAT32NE };
+    unsigned f, c, n;
+    int m;
+
+    for (f = 0; f < PA_ELEMENTSOF(formats); f++) {
+        if (p->install && !resampler_changed(formats[f]))
+            continue;
+
+        for (m = 0; m < PA_RESAMPLER_MAX; m++) {
+            if (m == PA_RESAMPLER_AUTO || m == PA_RESAMPLER_COPY || !pa_resample_method_supported(m))
+                continue;
+
+            for (c = 0; c < PA_ELEMENTSOF(channel_grid); c++)
+                for (n = 0; n < PA_ELEMENTSOF(frames_grid); n++) {
+                    struct resample_bench b;
+                    pa_sample_spec a, o;
+
+                    a.format = o.format = formats[f];
+                    a.channels = o.channels = (uint8_t) channel_grid[c];
+                    a.rate = IN_RATE;
+                    o.rate = OUT_RATE;
+
+                    /* This one only downsamples */
+                    if (m == PA_RESAMPLER_PEAKS) {
+                        a.rate = OUT_RATE;
+                        o.rate = IN_RATE;
+                    }
+
+                    if (!(b.resampler = pa_resampler_new(pool, &a, NULL, &o, NULL, m, 0)))
+                        continue;
+
+                    /* Some methods fall back to others for some formats */
+                    if (pa_resampler_get_method(b.resampler) != (pa_resample_method_t) m) {
+                        pa_resampler_free(b.resampler);
+                        continue;
+                    }
+
+                    b.in.length = frames_grid[n] * pa_frame_size(&a);
+                    b.in.index = 0;
+                    b.in.memblock = pa_memblock_new_fixed(pool, noise[formats[f]], b.in.length, TRUE);
+
+                    report("resample", p->name, pa_resample_method_to_string(m), formats[f], a.channels, o.channels,
+                           frames_grid[n], bench_measure(resample_cb, &b, frames_grid[n]));
+
+                    pa_memblock_unref_fixed(b.in.memblock);
+                    pa_resampler_free(b.resampler);
+                }
+        }
+    }
+}
+
+static void make_noise(void) {
+    pa_convert_func_t convert;
+    float *f;
+    unsigned i, n = MAX_FRAMES * PA_CHANNELS_MAX;
+    pa_sample_format_t format;
+
+    f = pa_xnew(float, n);
+    for (i = 0; i < n; i++)
+        f[i] = 2.0f * (rand() / (float) RAND_MAX - 0.5f);
+
+    for (format = 0; format < PA_SAMPLE_MAX; format++) {
+        noise[format] = pa_xmalloc(n * 4);
+
+        if ((convert = pa_get_convert_from_float32ne_function(format)))
+            convert(n, f, noise[format]);
+        else
+            memcpy(noise[format], f, n * 4);
+    }
+
+    pa_xfree(f);
+}
+
+static void help(const char *argv0) {
+    printf("%s [options]\n\n"
+           "-h, --help                            Show this help\n"
+           "      --kind=KIND                     Only measure mix, volume, sconv, remap or resample\n"
+           "      --path=PATH                     Only measure one code path (c, mmx, sse, ...)\n",
+           argv0);
+    bench_help();
+    printf("\n"
+           "Resamplers convert from %u Hz to %u Hz, except peaks which converts from\n"
+           "%u Hz to %u Hz.\n",
+           IN_RATE, OUT_RATE, OUT_RATE, IN_RATE);
+}
+
+enum {
+    ARG_KIND = BENCH_ARG_MAX,
+    ARG_PATH
+};
+
+int main(int argc, char *argv[]) {
+    unsigned flags = 0, i, f;
+    int c, ret = 1;
+
+    static const struct option long_options[] = {
+        {"help",     0, NULL, 'h'},
+        {"kind",     1, NULL, ARG_KIND},
+        {"path",     1, NULL, ARG_PATH},
+        BENCH_LONG_OPTIONS,
+        {NULL,       0, NULL, 0}
+    };
+
+    pa_log_set_level(PA_LOG_WARN);
+
+    /* The primitives are fast, short runs are enough */
+    bench_min_time = 2000;
+
+    while ((c = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'h':
+                help(argv[0]);
+                return 0;
+
+            case ARG_KIND:
+                only_kind = optarg;
+                break;
+
+            case ARG_PATH:
+                only_path = optarg;
+                break;
+
+            default:
+                if (!bench_parse_option(c, optarg))
+                    return 1;
+                break;
+        }
+    }
+
+    save_generic();
+
+    /* Only to find out what the CPU supports, the functions it installs
+     * are dropped again */
+#if defined (__i386__) || defined (__amd64__)
+    {
+        pa_cpu_x86_flag_t x86_flags = 0;
+        pa_cpu_init_x86(&x86_flags);
+        flags = x86_flags;
+    }
+#elif defined (__arm__)
+    {
+        pa_cpu_arm_flag_t arm_flags = 0;
+        pa_cpu_init_arm(&arm_flags);
+        flags = arm_flags;
+    }
+#endif
+
+    restore_generic();
+
+    if (!(pool = pa_mempool_new(FALSE, 0)))
+        goto quit;
+
+    srand(0);
+    make_noise();
+
+    printf("kind,path,name,format,in_channels,out_channels,frames,ns_per_frame\n");
+
+    for (i = 0; i < PA_ELEMENTSOF(paths); i++) {
+        const path *p = &paths[i];
+
+        if (only_path && !pa_streq(only_path, p->name))
+            continue;
+
+        if ((flags & p->required) != p->required)
+            continue;
+
+        restore_generic();
+        if (p->install)
+            p->install(flags & p->mask);
+
+        if (want_kind("mix"))
+            bench_mix(p);
+        if (want_kind("volume"))
+            bench_volume(p);
+        if (want_kind("sconv"))
+            bench_convert(p);
+        if (want_kind("remap"))
+            bench_remap(p);
+        if (want_kind("resample"))
+            bench_resample(p);
+    }
+
+    restore_generic();
+
+    for (f = 0; f < PA_SAMPLE_MAX; f++)
+        pa_xfree(noise[f]);
+
+    ret = 0;
+
+quit:
+    if (pool)
+        pa_mempool_free(pool);
+
+    return ret;
+}
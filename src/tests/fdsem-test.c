@@ -0,0 +1,115 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Passes a token back and forth between two threads, first with both
+ * of them sleeping in pa_fdsem_wait(), then with one of them polling
+ * the fd of its semaphore, the way rtpoll and the main loop do. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#include <pulsecore/atomic.h>
+#include <pulsecore/fdsem.h>
+#include <pulsecore/poll.h>
+#include <pulsecore/thread.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#define N_ROUNDS 20000
+
+static pa_fdsem *ping, *pong;
+static pa_atomic_t token;
+
+static void the_thread(void *userdata) {
+    unsigned i;
+
+    for (i = 0; i < N_ROUNDS; i++) {
+        pa_fdsem_wait(ping);
+
+        pa_assert_se(pa_atomic_load(&token) == (int) (2*i + 1));
+        pa_atomic_inc(&token);
+
+        pa_fdsem_post(pong);
+    }
+}
+
+static void wait_polling(pa_fdsem *f) {
+    struct pollfd pollfd;
+
+    pollfd.fd = pa_fdsem_get(f);
+    pollfd.events = POLLIN;
+
+    for (;;) {
+        if (pa_fdsem_before_poll(f) < 0)
+            return;
+
+        pollfd.revents = 0;
+        pa_assert_se(pa_poll(&pollfd, 1, -1) >= 0);
+
+        if (pa_fdsem_after_poll(f) > 0)
+            return;
+    }
+}
+
+static void run(pa_bool_t poll_pong) {
+    pa_thread *t;
+    unsigned i;
+
+    pa_assert_se(ping = pa_fdsem_new());
+    pa_assert_se(pong = pa_fdsem_new());
+    pa_atomic_store(&token, 0);
+
+    pa_assert_se(t = pa_thread_new("fdsem-test", the_thread, NULL));
+
+    for (i = 0; i < N_ROUNDS; i++) {
+        pa_assert_se(pa_atomic_load(&token) == (int) (2*i));
+        pa_atomic_inc(&token);
+
+        pa_fdsem_post(ping);
+
+        if (poll_pong)
+            wait_polling(pong);
+        else
+            pa_fdsem_wait(pong);
+    }
+
+    pa_thread_free(t);
+
+    pa_assert_se(pa_atomic_load(&token) == 2*N_ROUNDS);
+
+    /* Nothing was posted since the last wakeup */
+    pa_assert_se(!pa_fdsem_try(ping));
+    pa_assert_se(!pa_fdsem_try(pong));
+
+    pa_fdsem_free(ping);
+    pa_fdsem_free(pong);
+}
+
+int main(int argc, char *argv[]) {
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    run(FALSE);
+    run(TRUE);
+
+    return 0;
+}
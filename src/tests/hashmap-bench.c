@@ -0,0 +1,291 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Measures pa_hashmap and pa_idxset operations at different sizes and
+ * prints ns/operation as CSV, one line per measurement:
+ *
+ *   container,keys,op,entries,ns_per_op
+ *
+ * Pointer keys are spaced like heap allocated objects, string keys look
+ * like property names. "fill" creates a container, puts all entries and
+ * frees it again, "churn" removes and re-adds every entry of a full
+ * container, as connecting and disconnecting clients do. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/hashmap.h>
+#include <pulsecore/idxset.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "bench-util.h"
+
+static const unsigned entries_grid[] = { 16, 128, 1024, 8192, 65536 };
+
+/* Distance between two pointer keys, about the size of a small struct */
+#define OBJECT_SIZE 64
+
+static const char *only_container = NULL;
+
+typedef struct bench {
+    unsigned n;
+    void **keys;
+    pa_bool_t string_keys;
+
+    pa_hashmap *hashmap;
+    pa_idxset *idxset;
+    uint32_t *indexes;
+} bench;
+
+static pa_hash_func_t hash_func(bench *b) {
+    return b->string_keys ? pa_idxset_string_hash_func : pa_idxset_trivial_hash_func;
+}
+
+static pa_compare_func_t compare_func(bench *b) {
+    return b->string_keys ? pa_idxset_string_compare_func : pa_idxset_trivial_compare_func;
+}
+
+static void hashmap_fill(void *userdata) {
+    bench *b = userdata;
+    pa_hashmap *h;
+    unsigned i;
+
+    h = pa_hashmap_new(hash_func(b), compare_func(b));
+
+    for (i = 0; i < b->n; i++)
+        pa_hashmap_put(h, b->keys[i], b->keys[i]);
+
+    pa_hashmap_free(h, NULL, NULL);
+}
+
+static void hashmap_get(void *userdata) {
+    bench *b = userdata;
+    unsigned i;
+
+    for (i = 0; i < b->n; i++)
+        pa_assert_se(pa_hashmap_get(b->hashmap, b->keys[i]));
+}
+
+static void hashmap_churn(void *userdata) {
+    bench *b = userdata;
+    unsigned i;
+
+    for (i = 0; i < b->n; i++) {
+        pa_assert_se(pa_hashmap_remove(b->hashmap, b->keys[i]));
+        pa_assert_se(pa_hashmap_put(b->hashmap, b->keys[i], b->keys[i]) == 0);
+    }
+}
+
+static void hashmap_iterate(void *userdata) {
+    bench *b = userdata;
+    void *state = NULL;
+    unsigned n = 0;
+
+    while (pa_hashmap_iterate(b->hashmap, &state, NULL))
+        n++;
+
+    pa_assert(n == b->n);
+}
+
+static void idxset_fill(void *userdata) {
+    bench *b = userdata;
+    pa_idxset *s;
+    unsigned i;
+
+    s = pa_idxset_new(hash_func(b), compare_func(b));
+
+    for (i = 0; i < b->n; i++)
+        pa_idxset_put(s, b->keys[i], NULL);
+
+    pa_idxset_free(s, NULL, NULL);
+}
+
+static void idxset_get_by_index(void *userdata) {
+    bench *b = userdata;
+    unsigned i;
+
+    for (i = 0; i < b->n; i++)
+        pa_assert_se(pa_idxset_get_by_index(b->idxset, b->indexes[i]));
+}
+
+static void idxset_get_by_data(void *userdata) {
+    bench *b = userdata;
+    unsigned i;
+
+    for (i = 0; i < b->n; i++)
+        pa_assert_se(pa_idxset_get_by_data(b->idxset, b->keys[i], NULL));
+}
+
+/* The indexes keep growing, like they do for a long running daemon */
+static void idxset_churn(void *userdata) {
+    bench *b = userdata;
+    unsigned i;
+
+    for (i = 0; i < b->n; i++) {
+        pa_assert_se(pa_idxset_remove_by_index(b->idxset, b->indexes[i]));
+        pa_assert_se(pa_idxset_put(b->idxset, b->keys[i], &b->indexes[i]) == 0);
+    }
+}
+
+static void idxset_iterate(void *userdata) {
+    bench *b = userdata;
+    void *state = NULL;
+    unsigned n = 0;
+
+    while (pa_idxset_iterate(b->idxset, &state, NULL))
+        n++;
+
+    pa_assert(n == b->n);
+}
+
+static void report(const char *container, bench *b, const char *op, double ns) {
+    printf("%s,%s,%s,%u,%.2f\n", container, b->string_keys ? "string" : "pointer", op, b->n, ns);
+    fflush(stdout);
+}
+
+static void bench_hashmap(bench *b) {
+    unsigned i;
+
+    report("hashmap", b, "fill", bench_measure(hashmap_fill, b, b->n));
+
+    b->hashmap = pa_hashmap_new(hash_func(b), compare_func(b));
+    for (i = 0; i < b->n; i++)
+        pa_hashmap_put(b->hashmap, b->keys[i], b->keys[i]);
+
+    report("hashmap", b, "get", bench_measure(hashmap_get, b, b->n));
+    report("hashmap", b, "churn", bench_measure(hashmap_churn, b, b->n));
+    report("hashmap", b, "iterate", bench_measure(hashmap_iterate, b, b->n));
+
+    pa_hashmap_free(b->hashmap, NULL, NULL);
+    b->hashmap = NULL;
+}
+
+static void bench_idxset(bench *b) {
+    unsigned i;
+
+    report("idxset", b, "fill", bench_measure(idxset_fill, b, b->n));
+
+    b->idxset = pa_idxset_new(hash_func(b), compare_func(b));
+    b->indexes = pa_xnew(uint32_t, b->n);
+    for (i = 0; i < b->n; i++)
+        pa_idxset_put(b->idxset, b->keys[i], &b->indexes[i]);
+
+    report("idxset", b, "get_by_index", bench_measure(idxset_get_by_index, b, b->n));
+    report("idxset", b, "get_by_data", bench_measure(idxset_get_by_data, b, b->n));
+    report("idxset", b, "churn", bench_measure(idxset_churn, b, b->n));
+    report("idxset", b, "iterate", bench_measure(idxset_iterate, b, b->n));
+
+    pa_idxset_free(b->idxset, NULL, NULL);
+    b->idxset = NULL;
+    pa_xfree(b->indexes);
+    b->indexes = NULL;
+}
+
+static pa_bool_t want_container(const char *name) {
+    return !only_container || pa_streq(only_container, name);
+}
+
+static void help(const char *argv0) {
+    printf("%s [options]\n\n"
+           "-h, --help                            Show this help\n"
+           "      --container=NAME                Only measure hashmap or idxset\n",
+           argv0);
+    bench_help();
+}
+
+enum {
+    ARG_CONTAINER = BENCH_ARG_MAX
+};
+
+int main(int argc, char *argv[]) {
+    uint8_t *objects;
+    unsigned i, j;
+    int c;
+
+    static const struct option long_options[] = {
+        {"help",      0, NULL, 'h'},
+        {"container", 1, NULL, ARG_CONTAINER},
+        BENCH_LONG_OPTIONS,
+        {NULL,        0, NULL, 0}
+    };
+
+    pa_log_set_level(PA_LOG_WARN);
+
+    while ((c = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'h':
+                help(argv[0]);
+                return 0;
+
+            case ARG_CONTAINER:
+                only_container = optarg;
+                break;
+
+            default:
+                if (!bench_parse_option(c, optarg))
+                    return 1;
+                break;
+        }
+    }
+
+    printf("container,keys,op,entries,ns_per_op\n");
+
+    for (i = 0; i < PA_ELEMENTSOF(entries_grid); i++) {
+        bench b;
+
+        pa_zero(b);
+        b.n = entries_grid[i];
+        b.keys = pa_xnew(void*, b.n);
+
+        objects = pa_xmalloc(b.n * OBJECT_SIZE);
+        for (j = 0; j < b.n; j++)
+            b.keys[j] = objects + j * OBJECT_SIZE;
+
+        if (want_container("hashmap"))
+            bench_hashmap(&b);
+        if (want_container("idxset"))
+            bench_idxset(&b);
+
+        pa_xfree(objects);
+
+        b.string_keys = TRUE;
+        for (j = 0; j < b.n; j++)
+            b.keys[j] = pa_sprintf_malloc("application.process.%u", j);
+
+        if (want_container("hashmap"))
+            bench_hashmap(&b);
+        if (want_container("idxset"))
+            bench_idxset(&b);
+
+        for (j = 0; j < b.n; j++)
+            pa_xfree(b.keys[j]);
+        pa_xfree(b.keys);
+    }
+
+    return 0;
+}
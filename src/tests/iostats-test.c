@@ -0,0 +1,118 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Checks which bucket a duration ends up in, then lets a few threads
+ * update the same statistics concurrently and checks that no sample
+ * got lost. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pulse/timeval.h>
+
+#include <pulsecore/iostats.h>
+#include <pulsecore/thread.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#define N_THREADS 4
+#define N_SAMPLES 100000
+
+static pa_io_stats stats;
+
+static unsigned bucket_of(pa_usec_t usec) {
+    pa_histogram h;
+    unsigned i, found = PA_HISTOGRAM_BUCKETS;
+
+    pa_zero(h);
+    pa_histogram_add(&h, usec);
+
+    for (i = 0; i < PA_HISTOGRAM_BUCKETS; i++)
+        if (pa_atomic_load(&h.buckets[i])) {
+            pa_assert_se(found == PA_HISTOGRAM_BUCKETS);
+            pa_assert_se(pa_atomic_load(&h.buckets[i]) == 1);
+            found = i;
+        }
+
+    pa_assert_se(found < PA_HISTOGRAM_BUCKETS);
+    return found;
+}
+
+static void the_thread(void *userdata) {
+    unsigned id = PA_PTR_TO_UINT(userdata), i;
+
+    for (i = 0; i < N_SAMPLES; i++) {
+        pa_histogram_add(&stats.render_time, (pa_usec_t) (i % 1000));
+        pa_histogram_add(&stats.latency, (pa_usec_t) (id * 1000 + i % 7));
+
+        if (i % 100 == 0)
+            pa_io_stats_xrun(&stats);
+
+        /* The rewind byte count may only be written by one thread */
+        if (id == 0 && i % 100 == 0)
+            pa_io_stats_rewind(&stats, 4);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    pa_thread *threads[N_THREADS];
+    unsigned i, total;
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    pa_assert_se(bucket_of(0) == 0);
+    pa_assert_se(bucket_of(1) == 0);
+    pa_assert_se(bucket_of(2) == 1);
+    pa_assert_se(bucket_of(3) == 1);
+    pa_assert_se(bucket_of(4) == 2);
+    pa_assert_se(bucket_of(1023) == 9);
+    pa_assert_se(bucket_of(1024) == 10);
+    pa_assert_se(bucket_of(PA_USEC_PER_SEC) == 19);
+    pa_assert_se(bucket_of(PA_USEC_PER_SEC * 3600) == PA_HISTOGRAM_BUCKETS - 1);
+
+    pa_io_stats_init(&stats);
+
+    for (i = 0; i < N_THREADS; i++)
+        pa_assert_se(threads[i] = pa_thread_new("iostats-test", the_thread, PA_UINT_TO_PTR(i)));
+
+    for (i = 0; i < N_THREADS; i++)
+        pa_thread_free(threads[i]);
+
+    for (i = 0, total = 0; i < PA_HISTOGRAM_BUCKETS; i++)
+        total += (unsigned) pa_atomic_load(&stats.render_time.buckets[i]);
+    pa_assert_se(total == N_THREADS * N_SAMPLES);
+
+    for (i = 0, total = 0; i < PA_HISTOGRAM_BUCKETS; i++)
+        total += (unsigned) pa_atomic_load(&stats.latency.buckets[i]);
+    pa_assert_se(total == N_THREADS * N_SAMPLES);
+
+    pa_assert_se(pa_atomic_load(&stats.render_time.max_usec) == 999);
+    pa_assert_se(pa_atomic_load(&stats.latency.max_usec) == (N_THREADS - 1) * 1000 + 6);
+
+    pa_assert_se(pa_atomic_load(&stats.n_xruns) == N_THREADS * N_SAMPLES / 100);
+    pa_assert_se(pa_atomic_load(&stats.n_rewinds) == N_SAMPLES / 100);
+    pa_assert_se(stats.rewind_bytes == 4 * N_SAMPLES / 100);
+
+    return 0;
+}
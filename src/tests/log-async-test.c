@@ -0,0 +1,131 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Lets a few threads log through the logger thread into a file, some
+ * of them in bursts larger than their ring, and checks that every
+ * message was either written, in order, or counted as dropped. Then
+ * checks that a thread's messages still arrive after the logger thread
+ * was restarted. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <pulse/util.h>
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-util.h>
+#include <pulsecore/thread.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#define N_THREADS 4
+#define N_MESSAGES 2000
+
+static void the_thread(void *userdata) {
+    unsigned id = PA_PTR_TO_UINT(userdata), i;
+
+    pa_log_async_enable_thread();
+
+    for (i = 0; i < N_MESSAGES; i++) {
+        pa_log_info("msg %u %u", id, i);
+
+        /* Every other thread gives the logger a chance to keep up */
+        if (id % 2 && i % 16 == 0)
+            pa_msleep(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    pa_thread *threads[N_THREADS];
+    char path[] = "/tmp/log-async-test-XXXXXX";
+    unsigned last[N_THREADS], received = 0, restarted = 0, i;
+    FILE *f;
+    char line[256];
+    int fd;
+
+    pa_assert_se((fd = mkstemp(path)) >= 0);
+    pa_assert_se(unlink(path) == 0);
+
+    pa_log_set_level(PA_LOG_INFO);
+    pa_log_set_fd(fd);
+    pa_log_set_target(PA_LOG_FD);
+
+    pa_assert_se(pa_log_async_start() == 0);
+
+    for (i = 0; i < N_THREADS; i++)
+        pa_assert_se(threads[i] = pa_thread_new("log-async-test", the_thread, PA_UINT_TO_PTR(i)));
+
+    for (i = 0; i < N_THREADS; i++)
+        pa_thread_free(threads[i]);
+
+    pa_log_async_stop();
+
+    for (i = 0; i < 2; i++) {
+        pa_assert_se(pa_log_async_start() == 0);
+        pa_log_async_enable_thread();
+        pa_log_info("restart %u", i);
+        pa_log_async_stop();
+    }
+
+    pa_assert_se(f = fdopen(dup(fd), "r"));
+    pa_assert_se(fseek(f, 0, SEEK_SET) == 0);
+
+    for (i = 0; i < N_THREADS; i++)
+        last[i] = (unsigned) -1;
+
+    while (fgets(line, sizeof(line), f)) {
+        unsigned id, seq;
+        const char *m;
+
+        if ((m = strstr(line, "restart ")) && sscanf(m, "restart %u", &seq) == 1) {
+            pa_assert_se(seq == restarted);
+            restarted++;
+            continue;
+        }
+
+        /* Each line is prefixed by the level */
+        if (!(m = strstr(line, "msg ")) || sscanf(m, "msg %u %u", &id, &seq) != 2)
+            continue;
+
+        pa_assert_se(id < N_THREADS);
+        pa_assert_se(last[id] == (unsigned) -1 || seq > last[id]);
+        last[id] = seq;
+        received++;
+    }
+
+    fclose(f);
+
+    pa_log_set_target(PA_LOG_STDERR);
+    pa_log_set_fd(-1);
+
+    if (!getenv("MAKE_CHECK"))
+        printf("%u messages written, %u dropped\n", received, pa_log_async_get_n_dropped());
+
+    pa_assert_se(received + pa_log_async_get_n_dropped() == N_THREADS * N_MESSAGES);
+    pa_assert_se(restarted == 2);
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Measures pa_mainloop time events with many timers pending and prints
+ * ns/operation as CSV, one line per measurement:
+ *
+ *   op,timers,ns_per_op
+ *
+ * "iterate" runs main loop iterations in which one timer out of all the
+ * pending ones fires, "restart" moves random timers to new times, as
+ * streams do with their timing update timers, "churn" creates and frees
+ * a timer while all the others are pending. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include <pulse/mainloop.h>
+#include <pulse/rtclock.h>
+#include <pulse/timeval.h>
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/core-rtclock.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#include "bench-util.h"
+
+static const unsigned timers_grid[] = { 16, 128, 1024, 8192, 65536 };
+
+/* Operations per call of a bench callback */
+#define BATCH 64
+
+typedef struct bench {
+    unsigned n;
+    pa_mainloop *mainloop;
+    pa_mainloop_api *api;
+    pa_time_event **timers;
+    pa_time_event *busy;
+    pa_usec_t base;
+    unsigned fired;
+} bench;
+
+/* Somewhere in the next hour, so that the pending timers never fire */
+static struct timeval *random_future(bench *b, struct timeval *tv) {
+    return pa_timeval_rtstore(tv, b->base + PA_USEC_PER_SEC * 3600 + (pa_usec_t) rand() % (PA_USEC_PER_SEC * 3600), TRUE);
+}
+
+static void never_cb(pa_mainloop_api *a, pa_time_event *e, const struct timeval *tv, void *userdata) {
+    pa_assert_not_reached();
+}
+
+/* Always due again, so that it fires once in every iteration */
+static void busy_cb(pa_mainloop_api *a, pa_time_event *e, const struct timeval *tv, void *userdata) {
+    bench *b = userdata;
+    struct timeval ttv;
+
+    b->fired++;
+    a->time_restart(e, pa_timeval_rtstore(&ttv, 1, TRUE));
+}
+
+static void bench_iterate(void *userdata) {
+    bench *b = userdata;
+    unsigned i;
+
+    b->fired = 0;
+
+    for (i = 0; i < BATCH; i++)
+        pa_assert_se(pa_mainloop_iterate(b->mainloop, 0, NULL) >= 0);
+
+    pa_assert(b->fired == BATCH);
+}
+
+static void bench_restart(void *userdata) {
+    bench *b = userdata;
+    struct timeval tv;
+    unsigned i;
+
+    for (i = 0; i < BATCH; i++)
+        b->api->time_restart(b->timers[(unsigned) rand() % b->n], random_future(b, &tv));
+}
+
+static void bench_churn(void *userdata) {
+    bench *b = userdata;
+    struct timeval tv;
+    unsigned i;
+
+    for (i = 0; i < BATCH; i++)
+        b->api->time_free(b->api->time_new(b->api, random_future(b, &tv), never_cb, NULL));
+
+    /* Let the main loop destroy the freed events */
+    pa_assert_se(pa_mainloop_iterate(b->mainloop, 0, NULL) >= 0);
+}
+
+static void report(bench *b, const char *op, double ns) {
+    printf("%s,%u,%.2f\n", op, b->n, ns);
+    fflush(stdout);
+}
+
+static void help(const char *argv0) {
+    printf("%s [options]\n\n"
+           "-h, --help                            Show this help\n",
+           argv0);
+    bench_help();
+}
+
+int main(int argc, char *argv[]) {
+    unsigned i, j;
+    int c;
+
+    static const struct option long_options[] = {
+        {"help",      0, NULL, 'h'},
+        BENCH_LONG_OPTIONS,
+        {NULL,        0, NULL, 0}
+    };
+
+    pa_log_set_level(PA_LOG_WARN);
+
+    while ((c = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'h':
+                help(argv[0]);
+                return 0;
+
+            default:
+                if (!bench_parse_option(c, optarg))
+                    return 1;
+                break;
+        }
+    }
+
+    printf("op,timers,ns_per_op\n");
+
+    for (i = 0; i < PA_ELEMENTSOF(timers_grid); i++) {
+        struct timeval tv;
+        bench b;
+
+        pa_zero(b);
+        b.n = timers_grid[i];
+        b.base = pa_rtclock_now();
+
+        pa_assert_se(b.mainloop = pa_mainloop_new());
+        b.api = pa_mainloop_get_api(b.mainloop);
+
+        b.timers = pa_xnew(pa_time_event*, b.n);
+        for (j = 0; j < b.n; j++)
+            b.timers[j] = b.api->time_new(b.api, random_future(&b, &tv), never_cb, NULL);
+
+        b.busy = b.api->time_new(b.api, pa_timeval_rtstore(&tv, 1, TRUE), busy_cb, &b);
+
+        report(&b, "iterate", bench_measure(bench_iterate, &b, BATCH));
+        report(&b, "restart", bench_measure(bench_restart, &b, BATCH));
+        report(&b, "churn", bench_measure(bench_churn, &b, BATCH));
+
+        pa_mainloop_free(b.mainloop);
+        pa_xfree(b.timers);
+    }
+
+    return 0;
+}
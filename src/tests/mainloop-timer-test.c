@@ -0,0 +1,129 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Checks that time events which keep restarting themselves for the past
+ * don't starve other due time events, and that callbacks may free or
+ * restart events that are due in the same iteration. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pulse/mainloop.h>
+#include <pulse/rtclock.h>
+#include <pulse/timeval.h>
+
+#include <pulsecore/core-rtclock.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#define N_ITERATIONS 10
+
+struct timer {
+    pa_time_event *event;
+    pa_usec_t time;
+    unsigned n_fired;
+};
+
+static struct timer a, b, c, d;
+
+/* Restart for the same point in time, which has passed already */
+static void rearm_cb(pa_mainloop_api *api, pa_time_event *e, const struct timeval *tv, void *userdata) {
+    struct timer *t = userdata;
+    struct timeval next;
+
+    t->n_fired++;
+    api->time_restart(e, pa_timeval_rtstore(&next, t->time, TRUE));
+}
+
+static void count_cb(pa_mainloop_api *api, pa_time_event *e, const struct timeval *tv, void *userdata) {
+    struct timer *t = userdata;
+
+    t->n_fired++;
+}
+
+/* Free c and move d to the future, both of which are due as well */
+static void meddle_cb(pa_mainloop_api *api, pa_time_event *e, const struct timeval *tv, void *userdata) {
+    struct timer *t = userdata;
+    struct timeval next;
+
+    t->n_fired++;
+
+    api->time_free(c.event);
+    c.event = NULL;
+
+    api->time_restart(d.event, pa_timeval_rtstore(&next, pa_rtclock_now() + 3600 * PA_USEC_PER_SEC, TRUE));
+}
+
+static void timer_new(pa_mainloop_api *api, struct timer *t, pa_usec_t time, pa_time_event_cb_t cb) {
+    struct timeval tv;
+
+    t->time = time;
+    t->n_fired = 0;
+    pa_assert_se(t->event = api->time_new(api, pa_timeval_rtstore(&tv, time, TRUE), cb, t));
+}
+
+int main(int argc, char *argv[]) {
+    pa_mainloop *m;
+    pa_mainloop_api *api;
+    unsigned i;
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    pa_assert_se(m = pa_mainloop_new());
+    api = pa_mainloop_get_api(m);
+
+    /* Two timers that keep restarting themselves for the past must both
+     * fire once per iteration */
+    timer_new(api, &a, 100, rearm_cb);
+    timer_new(api, &b, 1, rearm_cb);
+
+    for (i = 1; i <= N_ITERATIONS; i++) {
+        pa_assert_se(pa_mainloop_iterate(m, 0, NULL) >= 0);
+
+        pa_log_debug("Iteration %u: a fired %u times, b fired %u times", i, a.n_fired, b.n_fired);
+        pa_assert_se(a.n_fired == i);
+        pa_assert_se(b.n_fired == i);
+    }
+
+    api->time_free(a.event);
+    api->time_free(b.event);
+
+    /* Due events that an earlier callback of the same iteration freed or
+     * moved to the future must not fire */
+    timer_new(api, &a, 1, meddle_cb);
+    timer_new(api, &b, 2, count_cb);
+    timer_new(api, &c, 3, count_cb);
+    timer_new(api, &d, 4, count_cb);
+
+    pa_assert_se(pa_mainloop_iterate(m, 0, NULL) >= 0);
+
+    pa_assert_se(a.n_fired == 1);
+    pa_assert_se(b.n_fired == 1);
+    pa_assert_se(c.n_fired == 0);
+    pa_assert_se(d.n_fired == 0);
+
+    pa_mainloop_free(m);
+
+    return 0;
+}
@@ -23,12 +23,19 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include <pulse/xmalloc.h>
 
 #include <pulsecore/log.h>
 #include <pulsecore/memblock.h>
 #include <pulsecore/macro.h>
+#include <pulsecore/thread.h>
+#include <pulsecore/shm.h>
 
 static void release_cb(pa_memimport *i, uint32_t block_id, void *userdata) {
     pa_log("%s: Imported block %u is released.", (char*) userdata, block_id);
@@ -66,6 +73,204 @@ static void print_stats(pa_mempool *p, const char *text) {
            (unsigned) pa_atomic_load(&s->n_pool_full));
 }
 
+/* Blocks go to the smallest slots that fit them, or to larger ones once
+ * those are used up */
+static void test_size_classes(void) {
+    pa_mempool *pool;
+    const pa_mempool_stat *s;
+    pa_memblock *blocks[64];
+    unsigned i, n;
+
+    pool = pa_mempool_new(FALSE, 1024*1024);
+    pa_assert(pool);
+    s = pa_mempool_get_stat(pool);
+
+    for (i = 1; i < PA_MEMPOOL_CLASSES_MAX; i++)
+        pa_assert(s->slot_size_by_class[i] == 2 * s->slot_size_by_class[i-1]);
+
+    pa_assert(pa_mempool_block_size_max(pool) < s->slot_size_by_class[PA_MEMPOOL_CLASSES_MAX-1]);
+
+    /* A small block with the header in front of it */
+    blocks[0] = pa_memblock_new_pool(pool, 1000);
+    pa_assert(pa_atomic_load(&s->n_allocated_by_class[0]) == 1);
+
+    /* Doesn't fit the smallest slots together with the header */
+    blocks[1] = pa_memblock_new_pool(pool, s->slot_size_by_class[0]);
+    pa_assert(pa_atomic_load(&s->n_allocated_by_class[1]) == 1);
+
+    blocks[2] = pa_memblock_new_pool(pool, pa_mempool_block_size_max(pool));
+    pa_assert(pa_atomic_load(&s->n_allocated_by_class[PA_MEMPOOL_CLASSES_MAX-1]) == 1);
+
+    for (i = 0; i < 3; i++)
+        pa_memblock_unref(blocks[i]);
+
+    for (i = 0; i < PA_MEMPOOL_CLASSES_MAX; i++)
+        pa_assert(pa_atomic_load(&s->n_allocated_by_class[i]) == 0);
+
+    /* Use up the smallest class */
+    n = PA_MIN(s->n_slots_by_class[0] + 1, PA_ELEMENTSOF(blocks));
+    pa_assert(n > s->n_slots_by_class[0]);
+
+    for (i = 0; i < n; i++)
+        pa_assert_se(blocks[i] = pa_memblock_new_pool(pool, 100));
+
+    pa_assert((unsigned) pa_atomic_load(&s->n_allocated_by_class[0]) == s->n_slots_by_class[0]);
+    pa_assert((unsigned) pa_atomic_load(&s->n_allocated_by_class[1]) == n - s->n_slots_by_class[0]);
+    pa_assert((unsigned) pa_atomic_load(&s->n_full_by_class[0]) == n - s->n_slots_by_class[0]);
+
+    for (i = 0; i < n; i++)
+        pa_memblock_unref(blocks[i]);
+
+    pa_assert(pa_atomic_load(&s->n_allocated) == 0);
+
+    pa_mempool_free(pool);
+}
+
+static void thread_func(void *data) {
+    pa_mempool *pool = data;
+    pa_memblock *blocks[8];
+    unsigned i, j;
+
+    for (i = 0; i < 1000; i++) {
+        for (j = 0; j < PA_ELEMENTSOF(blocks); j++)
+            pa_assert_se(blocks[j] = pa_memblock_new_pool(pool, 100 + 1000 * j));
+
+        for (j = 0; j < PA_ELEMENTSOF(blocks); j++)
+            pa_memblock_unref(blocks[j]);
+    }
+}
+
+/* Repeated allocations are served from the thread caches, and the slots
+ * a thread keeps are given back when it exits */
+static void test_thread_caches(void) {
+    pa_mempool *pool;
+    const pa_mempool_stat *s;
+    pa_thread *threads[4];
+    pa_memblock **blocks;
+    unsigned i, n;
+
+    pool = pa_mempool_new(FALSE, 0);
+    pa_assert(pool);
+    s = pa_mempool_get_stat(pool);
+
+    for (i = 0; i < PA_ELEMENTSOF(threads); i++)
+        pa_assert_se(threads[i] = pa_thread_new("memblock-test", thread_func, pool));
+
+    for (i = 0; i < PA_ELEMENTSOF(threads); i++)
+        pa_thread_free(threads[i]);
+
+    pa_log_debug("Slot cache: %u hits, %u misses. Block cache: %u hits, %u misses.",
+                 (unsigned) pa_atomic_load(&s->n_slot_cache_hits),
+                 (unsigned) pa_atomic_load(&s->n_slot_cache_misses),
+                 (unsigned) pa_atomic_load(&s->n_block_cache_hits),
+                 (unsigned) pa_atomic_load(&s->n_block_cache_misses));
+
+    pa_assert(pa_atomic_load(&s->n_allocated) == 0);
+    pa_assert(pa_atomic_load(&s->n_slot_cache_hits) > pa_atomic_load(&s->n_slot_cache_misses));
+
+    /* All slots of the smallest class are available again */
+    n = s->n_slots_by_class[0];
+    blocks = pa_xnew(pa_memblock*, n);
+
+    for (i = 0; i < n; i++)
+        pa_assert_se(blocks[i] = pa_memblock_new_pool(pool, 100));
+
+    pa_assert((unsigned) pa_atomic_load(&s->n_allocated_by_class[0]) == n);
+    pa_assert(pa_atomic_load(&s->n_full_by_class[0]) == 0);
+
+    for (i = 0; i < n; i++)
+        pa_memblock_unref(blocks[i]);
+
+    pa_xfree(blocks);
+
+    /* The memblock structures of user blocks come from the cache, too */
+    for (i = 0; i < 100; i++)
+        pa_memblock_unref(pa_memblock_new_fixed(pool, (void*) "", 1, TRUE));
+
+    pa_assert(pa_atomic_load(&s->n_block_cache_hits) > 0);
+
+    pa_mempool_free(pool);
+}
+
+/* Blocks of a memfd pool can be imported once the fd was handed over */
+static void test_memfd(void) {
+#ifdef HAVE_MEMFD
+    pa_mempool *pool_a, *pool_b;
+    pa_memexport *export_a, *export_b;
+    pa_memimport *import_b;
+    pa_memblock *mb_a, *mb_b;
+    uint32_t id, shm_id, pool_id, id_b, shm_id_b;
+    size_t offset, size, offset_b, size_b;
+    int fd;
+    char *x;
+
+    const char txt[] = "This is a test!";
+
+    if (!(pool_a = pa_mempool_new_memfd(0, FALSE))) {
+        pa_log_info("memfd pools not supported, skipping.");
+        return;
+    }
+
+    pool_b = pa_mempool_new(TRUE, 0);
+    pa_assert(pool_b);
+
+    pa_assert(pa_mempool_is_memfd_backed(pool_a));
+    pa_assert(pa_mempool_is_shared(pool_a));
+    pa_assert(pa_mempool_get_memfd_fd(pool_a) >= 0);
+    pa_assert(pa_mempool_get_memfd_fd(pool_b) < 0);
+    pa_assert_se(pa_mempool_get_shm_id(pool_a, &pool_id) == 0);
+
+    mb_a = pa_memblock_new_pool(pool_a, sizeof(txt));
+    pa_assert(mb_a);
+    x = pa_memblock_acquire(mb_a);
+    memcpy(x, txt, sizeof(txt));
+    pa_memblock_release(mb_a);
+
+    export_a = pa_memexport_new(pool_a, revoke_cb, (void*) "A");
+    import_b = pa_memimport_new(pool_b, release_cb, (void*) "B");
+    export_b = pa_memexport_new(pool_b, revoke_cb, (void*) "B");
+
+    pa_assert_se(pa_memexport_put(export_a, mb_a, &id, &shm_id, &offset, &size) >= 0);
+    pa_assert(shm_id == pool_id);
+
+    /* The segment can't be found by its id */
+    pa_assert(!pa_memimport_get(import_b, id, shm_id, offset, size));
+
+    pa_assert_se((fd = dup(pa_mempool_get_memfd_fd(pool_a))) >= 0);
+    pa_assert_se(pa_memimport_attach_memfd(import_b, shm_id, fd) == 0);
+
+    mb_b = pa_memimport_get(import_b, id, shm_id, offset, size);
+    pa_assert(mb_b);
+    x = pa_memblock_acquire(mb_b);
+    pa_assert(memcmp(x, txt, sizeof(txt)) == 0);
+    pa_memblock_release(mb_b);
+
+    /* The fd of an imported memfd segment isn't passed on */
+    pa_assert(pa_memexport_put(export_b, mb_b, &id_b, &shm_id_b, &offset_b, &size_b) < 0);
+
+    /* The segment stays attached without any blocks */
+    pa_memblock_unref(mb_b);
+    mb_b = pa_memimport_get(import_b, id, shm_id, offset, size);
+    pa_assert(mb_b);
+    pa_memblock_unref(mb_b);
+
+#ifdef MFD_CLOEXEC
+    /* Segments that could shrink are refused */
+    pa_assert_se((fd = memfd_create("memblock-test", MFD_CLOEXEC)) >= 0);
+    pa_assert_se(ftruncate(fd, 4096) == 0);
+    pa_assert(pa_memimport_attach_memfd(import_b, shm_id + 1, fd) < 0);
+#endif
+
+    pa_memexport_free(export_b);
+    pa_memimport_free(import_b);
+    pa_memexport_free(export_a);
+    pa_memblock_unref(mb_a);
+
+    pa_mempool_free(pool_a);
+    pa_mempool_free(pool_b);
+#endif
+}
+
 int main(int argc, char *argv[]) {
     pa_mempool *pool_a, *pool_b, *pool_c;
     unsigned id_a, id_b, id_c;
@@ -175,5 +380,9 @@ int main(int argc, char *argv[]) {
     pa_mempool_free(pool_b);
     pa_mempool_free(pool_c);
 
+    test_size_classes();
+    test_thread_caches();
+    test_memfd();
+
     return 0;
 }
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <signal.h>
+#include <string.h>
 
 #include <pulsecore/memblockq.h>
 #include <pulsecore/log.h>
@@ -69,28 +70,149 @@ static void dump(pa_memblockq *bq) {
     fprintf(stderr, "<\n");
 }
 
-int main(int argc, char *argv[]) {
-    int ret;
+static const pa_sample_spec ss = {
+    .format = PA_SAMPLE_S16LE,
+    .rate = 48000,
+    .channels = 1
+};
 
-    pa_mempool *p;
-    pa_memblockq *bq;
-    pa_memchunk chunk1, chunk2, chunk3, chunk4;
-    pa_memchunk silence;
-    pa_sample_spec ss = {
-        .format = PA_SAMPLE_S16LE,
-        .rate = 48000,
-        .channels = 1
-    };
+static void check_same(pa_memblockq *a, pa_memblockq *b) {
+    pa_memchunk ca, cb;
+    int ra, rb;
 
-    pa_log_set_level(PA_LOG_DEBUG);
+    pa_assert_se(pa_memblockq_get_read_index(a) == pa_memblockq_get_read_index(b));
+    pa_assert_se(pa_memblockq_get_write_index(a) == pa_memblockq_get_write_index(b));
+    pa_assert_se(pa_memblockq_get_nblocks(a) == pa_memblockq_get_nblocks(b));
+    pa_assert_se(pa_memblockq_is_readable(a) == pa_memblockq_is_readable(b));
 
-    p = pa_mempool_new(FALSE, 0);
+    ra = pa_memblockq_peek(a, &ca);
+    rb = pa_memblockq_peek(b, &cb);
+    pa_assert_se(ra == rb);
 
-    pa_assert_se(silence.memblock = pa_memblock_new_fixed(p, (char*) "__", 2, 1));
-    silence.index = 0;
-    silence.length = pa_memblock_get_length(silence.memblock);
+    if (ra < 0)
+        return;
+
+    pa_assert_se(ca.memblock == cb.memblock);
+    pa_assert_se(ca.index == cb.index);
+    pa_assert_se(ca.length == cb.length);
 
-    pa_assert_se(bq = pa_memblockq_new("test memblockq", 0, 200, 10, &ss, 4, 4, 40, &silence));
+    if (ca.memblock) {
+        pa_memblock_unref(ca.memblock);
+        pa_memblock_unref(cb.memblock);
+    }
+}
+
+/* Does the same random pushes, seeks, drops and rewinds on a list and a
+ * ring backed queue, and checks that both always return the same */
+static void test_ring(pa_mempool *p, pa_memchunk *silence) {
+    pa_memblockq *a, *b;
+    pa_memblock *blocks[4];
+    unsigned i, j;
+
+    pa_assert_se(a = pa_memblockq_new("test list", 0, 2000, 0, &ss, 0, 0, 400, silence));
+    pa_assert_se(b = pa_memblockq_new_ring("test ring", 0, 2000, 0, &ss, 0, 0, 400, silence));
+
+    for (i = 0; i < PA_ELEMENTSOF(blocks); i++) {
+        uint8_t *d;
+
+        blocks[i] = pa_memblock_new(p, 64);
+        d = pa_memblock_acquire(blocks[i]);
+        for (j = 0; j < 64; j++)
+            d[j] = (uint8_t) ('a' + i);
+        pa_memblock_release(blocks[i]);
+    }
+
+    srand(0);
+
+    for (i = 0; i < 100000; i++) {
+        size_t l = (size_t) (rand() % 32 + 1) * 2;
+        pa_memchunk ca, cb;
+
+        switch (rand() % 6) {
+            case 0:
+            case 1: {
+                pa_memchunk c;
+
+                c.memblock = blocks[rand() % PA_ELEMENTSOF(blocks)];
+                c.index = (size_t) (rand() % 32) * 2;
+                c.length = PA_MIN(l, 64 - c.index);
+
+                pa_assert_se(pa_memblockq_push(a, &c) == pa_memblockq_push(b, &c));
+
+                /* Continue right behind the last push sometimes, so
+                 * that merging is tested too */
+                if (rand() % 2) {
+                    c.index += c.length;
+                    c.length = PA_MIN(l, 64 - c.index);
+
+                    if (c.length > 0)
+                        pa_assert_se(pa_memblockq_push(a, &c) == pa_memblockq_push(b, &c));
+                }
+                break;
+            }
+
+            case 2: {
+                int64_t offset = (int64_t) (rand() % 64 - 40) * 2;
+                pa_seek_mode_t mode = (pa_seek_mode_t) (rand() % 4);
+
+                pa_memblockq_seek(a, offset, mode, TRUE);
+                pa_memblockq_seek(b, offset, mode, TRUE);
+                break;
+            }
+
+            case 3:
+                pa_memblockq_drop(a, l);
+                pa_memblockq_drop(b, l);
+                break;
+
+            case 4:
+                pa_memblockq_rewind(a, l);
+                pa_memblockq_rewind(b, l);
+                break;
+
+            case 5:
+                if (rand() % 100 == 0) {
+                    pa_memblockq_flush_read(a);
+                    pa_memblockq_flush_read(b);
+                } else {
+                    uint8_t *da, *db;
+
+                    pa_assert_se(pa_memblockq_peek_fixed_size(a, l, &ca) == 0);
+                    pa_assert_se(pa_memblockq_peek_fixed_size(b, l, &cb) == 0);
+                    pa_assert_se(ca.length == cb.length);
+
+                    da = pa_memblock_acquire(ca.memblock);
+                    db = pa_memblock_acquire(cb.memblock);
+                    pa_assert_se(memcmp(da + ca.index, db + cb.index, ca.length) == 0);
+                    pa_memblock_release(ca.memblock);
+                    pa_memblock_release(cb.memblock);
+
+                    pa_memblock_unref(ca.memblock);
+                    pa_memblock_unref(cb.memblock);
+                }
+                break;
+        }
+
+        check_same(a, b);
+    }
+
+    pa_memblockq_free(a);
+    pa_memblockq_free(b);
+
+    for (i = 0; i < PA_ELEMENTSOF(blocks); i++)
+        pa_memblock_unref(blocks[i]);
+}
+
+static void test_push_seek(pa_mempool *p, pa_memchunk *silence, pa_bool_t ring) {
+    int ret;
+
+    pa_memblockq *bq;
+    pa_memchunk chunk1, chunk2, chunk3, chunk4;
+
+    if (ring)
+        pa_assert_se(bq = pa_memblockq_new_ring("test memblockq", 0, 200, 10, &ss, 4, 4, 40, silence));
+    else
+        pa_assert_se(bq = pa_memblockq_new("test memblockq", 0, 200, 10, &ss, 4, 4, 40, silence));
 
     pa_assert_se(chunk1.memblock = pa_memblock_new_fixed(p, (char*) "11", 2, 1));
     chunk1.index = 0;
@@ -167,12 +289,31 @@ int main(int argc, char *argv[]) {
     dump(bq);
 
     pa_memblockq_free(bq);
-    pa_memblock_unref(silence.memblock);
     pa_memblock_unref(chunk1.memblock);
     pa_memblock_unref(chunk2.memblock);
     pa_memblock_unref(chunk3.memblock);
     pa_memblock_unref(chunk4.memblock);
+}
+
+int main(int argc, char *argv[]) {
+    pa_mempool *p;
+    pa_memchunk silence;
 
+    pa_log_set_level(PA_LOG_DEBUG);
+
+    p = pa_mempool_new(FALSE, 0);
+
+    pa_assert_se(silence.memblock = pa_memblock_new_fixed(p, (char*) "__", 2, 1));
+    silence.index = 0;
+    silence.length = pa_memblock_get_length(silence.memblock);
+
+    test_push_seek(p, &silence, FALSE);
+    test_push_seek(p, &silence, TRUE);
+
+    pa_log_set_level(PA_LOG_WARN);
+    test_ring(p, &silence);
+
+    pa_memblock_unref(silence.memblock);
     pa_mempool_free(p);
 
     return 0;
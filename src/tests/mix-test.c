@@ -22,10 +22,12 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 
 #include <pulse/sample.h>
 #include <pulse/volume.h>
 
+#include <pulsecore/cpu-x86.h>
 #include <pulsecore/macro.h>
 #include <pulsecore/endianmacros.h>
 #include <pulsecore/memblock.h>
@@ -200,10 +202,61 @@ static pa_memblock* generate_block(pa_mempool *pool, const pa_sample_spec *ss) {
     return r;
 }
 
+static pa_memblock* mix_format(pa_mempool *pool, const pa_sample_spec *a, const pa_cvolume *v) {
+    pa_memchunk i, j, k;
+    pa_mix_info m[2];
+    void *ptr;
+
+    pa_log_debug("=== mixing: %s\n", pa_sample_format_to_string(a->format));
+
+    /* Generate block */
+    i.memblock = generate_block(pool, a);
+    i.length = pa_memblock_get_length(i.memblock);
+    i.index = 0;
+
+    dump_block(a, &i);
+
+    /* Make a copy */
+    j = i;
+    pa_memblock_ref(j.memblock);
+    pa_memchunk_make_writable(&j, 0);
+
+    /* Adjust volume of the copy */
+    pa_volume_memchunk(&j, a, v);
+
+    dump_block(a, &j);
+
+    m[0].chunk = i;
+    m[0].volume.values[0] = PA_VOLUME_NORM;
+    m[0].volume.channels = a->channels;
+    m[1].chunk = j;
+    m[1].volume.values[0] = PA_VOLUME_NORM;
+    m[1].volume.channels = a->channels;
+
+    k.memblock = pa_memblock_new(pool, i.length);
+    k.length = i.length;
+    k.index = 0;
+
+    ptr = (uint8_t*) pa_memblock_acquire(k.memblock) + k.index;
+    pa_mix(m, 2, ptr, k.length, a, NULL, FALSE);
+    pa_memblock_release(k.memblock);
+
+    dump_block(a, &k);
+
+    pa_memblock_unref(i.memblock);
+    pa_memblock_unref(j.memblock);
+
+    return k.memblock;
+}
+
 int main(int argc, char *argv[]) {
     pa_mempool *pool;
     pa_sample_spec a;
     pa_cvolume v;
+    pa_memblock *ref[PA_SAMPLE_MAX];
+#if defined (__i386__) || defined (__amd64__)
+    pa_cpu_x86_flag_t flags = 0;
+#endif
 
     if (!getenv("MAKE_CHECK"))
         pa_log_set_level(PA_LOG_DEBUG);
@@ -216,50 +269,29 @@ int main(int argc, char *argv[]) {
     v.channels = a.channels;
     v.values[0] = pa_sw_volume_from_linear(0.9);
 
-    for (a.format = 0; a.format < PA_SAMPLE_MAX; a.format ++) {
-        pa_memchunk i, j, k;
-        pa_mix_info m[2];
-        void *ptr;
-
-        pa_log_debug("=== mixing: %s\n", pa_sample_format_to_string(a.format));
-
-        /* Generate block */
-        i.memblock = generate_block(pool, &a);
-        i.length = pa_memblock_get_length(i.memblock);
-        i.index = 0;
+    /* First with the generic functions... */
+    for (a.format = 0; a.format < PA_SAMPLE_MAX; a.format ++)
+        ref[a.format] = mix_format(pool, &a, &v);
 
-        dump_block(&a, &i);
-
-        /* Make a copy */
-        j = i;
-        pa_memblock_ref(j.memblock);
-        pa_memchunk_make_writable(&j, 0);
-
-        /* Adjust volume of the copy */
-        pa_volume_memchunk(&j, &a, &v);
-
-        dump_block(&a, &j);
-
-        m[0].chunk = i;
-        m[0].volume.values[0] = PA_VOLUME_NORM;
-        m[0].volume.channels = a.channels;
-        m[1].chunk = j;
-        m[1].volume.values[0] = PA_VOLUME_NORM;
-        m[1].volume.channels = a.channels;
+    /* ...then with whatever the CPU supports, which must mix the same */
+#if defined (__i386__) || defined (__amd64__)
+    pa_cpu_init_x86(&flags);
+#endif
 
-        k.memblock = pa_memblock_new(pool, i.length);
-        k.length = i.length;
-        k.index = 0;
+    for (a.format = 0; a.format < PA_SAMPLE_MAX; a.format ++) {
+        pa_memblock *k;
+        void *d, *e;
 
-        ptr = (uint8_t*) pa_memblock_acquire(k.memblock) + k.index;
-        pa_mix(m, 2, ptr, k.length, &a, NULL, FALSE);
-        pa_memblock_release(k.memblock);
+        k = mix_format(pool, &a, &v);
 
-        dump_block(&a, &k);
+        d = pa_memblock_acquire(ref[a.format]);
+        e = pa_memblock_acquire(k);
+        pa_assert_se(memcmp(d, e, pa_memblock_get_length(k)) == 0);
+        pa_memblock_release(ref[a.format]);
+        pa_memblock_release(k);
 
-        pa_memblock_unref(i.memblock);
-        pa_memblock_unref(j.memblock);
-        pa_memblock_unref(k.memblock);
+        pa_memblock_unref(ref[a.format]);
+        pa_memblock_unref(k);
     }
 
     pa_mempool_free(pool);
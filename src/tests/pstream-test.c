@@ -0,0 +1,342 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+/* Sends a mix of small and large packets, memblocks and packets with
+ * credentials or fds attached through a pstream pair, so that many
+ * frames are written and read in one go, and checks that everything
+ * arrives in order and the ancillary data with the right packet. Then
+ * checks that SHM blocks released in batches all make it back. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pulse/mainloop.h>
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/socket.h>
+#include <pulsecore/pstream.h>
+#include <pulsecore/iochannel.h>
+#include <pulsecore/memblock.h>
+#include <pulsecore/creds.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#define N_FRAMES 5000
+#define N_SHM_BLOCKS 2000
+
+enum {
+    FRAME_SMALL_PACKET,
+    FRAME_LARGE_PACKET,
+    FRAME_MEMBLOCK,
+    FRAME_CREDS,
+    FRAME_FDS
+};
+
+static pa_mainloop *mainloop;
+static pa_mempool *pool;
+static pa_pstream *sender, *receiver;
+static unsigned n_received = 0, n_memblocks = 0, n_creds = 0, n_fds = 0;
+
+static unsigned frame_type(unsigned seq) {
+    if (seq % 500 == 7)
+        return FRAME_LARGE_PACKET;
+    if (seq % 50 == 3)
+        return FRAME_MEMBLOCK;
+#ifdef HAVE_CREDS
+    if (seq % 100 == 11)
+        return FRAME_CREDS;
+    if (seq % 100 == 61)
+        return FRAME_FDS;
+#endif
+    return FRAME_SMALL_PACKET;
+}
+
+static uint8_t pattern(unsigned seq, size_t i) {
+    return (uint8_t) (seq * 13 + i);
+}
+
+static size_t frame_length(unsigned seq) {
+    switch (frame_type(seq)) {
+        case FRAME_LARGE_PACKET:
+            return 100*1024 + seq;
+        case FRAME_MEMBLOCK:
+            return 3000 + seq % 100;
+        default:
+            return 4 + seq % 60;
+    }
+}
+
+static void check_done(void) {
+    if (n_received == N_FRAMES)
+        pa_mainloop_quit(mainloop, 0);
+}
+
+static void packet_cb(pa_pstream *p, pa_packet *packet, const pa_creds *creds, void *userdata) {
+    unsigned seq = n_received++;
+    size_t i;
+
+    pa_assert(frame_type(seq) != FRAME_MEMBLOCK);
+    pa_assert(packet->length == frame_length(seq));
+
+    for (i = 0; i < packet->length; i++)
+        pa_assert(packet->data[i] == pattern(seq, i));
+
+#ifdef HAVE_CREDS
+    if (frame_type(seq) == FRAME_CREDS) {
+        pa_assert(creds);
+        pa_assert(creds->uid == getuid());
+        pa_assert(creds->gid == getgid());
+        n_creds++;
+    }
+
+    {
+        int fds[PA_CMSG_ANCIL_DATA_MAX_FDS];
+        unsigned n;
+
+        n = pa_pstream_take_fds(p, fds, PA_CMSG_ANCIL_DATA_MAX_FDS);
+
+        if (frame_type(seq) == FRAME_FDS) {
+            unsigned received;
+
+            /* The pipe was written the sequence number of the packet
+             * it was sent with */
+            pa_assert_se(n == 1);
+            pa_assert_se(pa_loop_read(fds[0], &received, sizeof(received), NULL) == sizeof(received));
+            pa_assert_se(received == seq);
+            pa_close(fds[0]);
+            n_fds++;
+        } else
+            pa_assert_se(n == 0);
+    }
+#endif
+
+    check_done();
+}
+
+static void memblock_cb(pa_pstream *p, uint32_t channel, int64_t offset, pa_seek_mode_t seek, const pa_memchunk *chunk, void *userdata) {
+    static size_t index = 0;
+    unsigned seq = n_received;
+    const uint8_t *d;
+    size_t i;
+
+    /* Payloads are passed on as they come in, possibly in pieces */
+    pa_assert(frame_type(seq) == FRAME_MEMBLOCK);
+    pa_assert(channel == seq);
+    pa_assert(index + chunk->length <= frame_length(seq));
+
+    d = (const uint8_t*) pa_memblock_acquire(chunk->memblock) + chunk->index;
+    for (i = 0; i < chunk->length; i++)
+        pa_assert(d[i] == pattern(seq, index + i));
+    pa_memblock_release(chunk->memblock);
+
+    index += chunk->length;
+
+    if (index == frame_length(seq)) {
+        index = 0;
+        n_received++;
+        n_memblocks++;
+        check_done();
+    }
+}
+
+static void die_cb(pa_pstream *p, void *userdata) {
+    pa_log_error("Connection died.");
+    pa_assert_not_reached();
+}
+
+static void send_frame(unsigned seq) {
+    size_t l, i;
+
+    l = frame_length(seq);
+
+    if (frame_type(seq) == FRAME_MEMBLOCK) {
+        pa_memchunk chunk;
+        uint8_t *d;
+
+        chunk.memblock = pa_memblock_new(pool, l);
+        chunk.index = 0;
+        chunk.length = l;
+
+        d = pa_memblock_acquire(chunk.memblock);
+        for (i = 0; i < l; i++)
+            d[i] = pattern(seq, i);
+        pa_memblock_release(chunk.memblock);
+
+        pa_pstream_send_memblock(sender, seq, 0, PA_SEEK_RELATIVE, &chunk);
+        pa_memblock_unref(chunk.memblock);
+
+    } else {
+        pa_packet *packet;
+
+        packet = pa_packet_new(l);
+        for (i = 0; i < l; i++)
+            packet->data[i] = pattern(seq, i);
+
+#ifdef HAVE_CREDS
+        if (frame_type(seq) == FRAME_CREDS) {
+            pa_creds creds;
+
+            creds.uid = getuid();
+            creds.gid = getgid();
+            pa_pstream_send_packet(sender, packet, &creds);
+
+        } else if (frame_type(seq) == FRAME_FDS) {
+            int pipe_fds[2];
+
+            pa_assert_se(pipe(pipe_fds) == 0);
+            pa_assert_se(pa_loop_write(pipe_fds[1], &seq, sizeof(seq), NULL) == sizeof(seq));
+
+            pa_assert_se(pa_pstream_send_packet_with_fds(sender, packet, &pipe_fds[0], 1) == 0);
+
+            pa_close(pipe_fds[0]);
+            pa_close(pipe_fds[1]);
+        } else
+#endif
+            pa_pstream_send_packet(sender, packet, NULL);
+
+        pa_packet_unref(packet);
+    }
+}
+
+static void test_frames(void) {
+    pa_mainloop_api *api;
+    pa_iochannel *io;
+    int sv[2];
+    unsigned i;
+
+    mainloop = pa_mainloop_new();
+    api = pa_mainloop_get_api(mainloop);
+
+    pa_assert_se(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    pa_assert_se(pool = pa_mempool_new(FALSE, 0));
+
+    sender = pa_pstream_new(api, pa_iochannel_new(api, sv[0], sv[0]), pool);
+    receiver = pa_pstream_new(api, io = pa_iochannel_new(api, sv[1], sv[1]), pool);
+
+#ifdef HAVE_CREDS
+    pa_assert_se(pa_iochannel_creds_enable(io) == 0);
+#endif
+
+    pa_pstream_set_receive_packet_callback(receiver, packet_cb, NULL);
+    pa_pstream_set_receive_memblock_callback(receiver, memblock_cb, NULL);
+    pa_pstream_set_die_callback(sender, die_cb, NULL);
+    pa_pstream_set_die_callback(receiver, die_cb, NULL);
+
+    /* Everything is queued before the main loop runs, so frames pile
+     * up on both sides */
+    for (i = 0; i < N_FRAMES; i++)
+        send_frame(i);
+
+    pa_assert_se(pa_mainloop_run(mainloop, NULL) >= 0);
+
+    pa_assert(n_received == N_FRAMES);
+    pa_log_debug("Received %u frames, %u memblocks, %u with credentials, %u with fds.", n_received, n_memblocks, n_creds, n_fds);
+
+    pa_pstream_unlink(sender);
+    pa_pstream_unlink(receiver);
+    pa_pstream_unref(sender);
+    pa_pstream_unref(receiver);
+
+    pa_mempool_free(pool);
+    pa_mainloop_free(mainloop);
+}
+
+static unsigned n_shm_received = 0;
+
+static void shm_memblock_cb(pa_pstream *p, uint32_t channel, int64_t offset, pa_seek_mode_t seek, const pa_memchunk *chunk, void *userdata) {
+    /* The block is imported, and released again right after we return */
+    pa_assert(chunk->memblock);
+    pa_assert(channel == n_shm_received);
+
+    n_shm_received++;
+}
+
+static void test_block_id_arrays(void) {
+    pa_mainloop_api *api;
+    pa_mempool *receiver_pool;
+    const pa_mempool_stat *stat;
+    int sv[2];
+    unsigned i;
+
+    mainloop = pa_mainloop_new();
+    api = pa_mainloop_get_api(mainloop);
+
+    pa_assert_se(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    pa_assert_se(pool = pa_mempool_new(TRUE, 0));
+    pa_assert_se(receiver_pool = pa_mempool_new(FALSE, 0));
+
+    sender = pa_pstream_new(api, pa_iochannel_new(api, sv[0], sv[0]), pool);
+    receiver = pa_pstream_new(api, pa_iochannel_new(api, sv[1], sv[1]), receiver_pool);
+
+    pa_pstream_enable_shm(sender, TRUE);
+    pa_pstream_enable_shm(receiver, TRUE);
+    pa_pstream_enable_block_id_arrays(sender);
+    pa_pstream_enable_block_id_arrays(receiver);
+
+    pa_pstream_set_receive_memblock_callback(receiver, shm_memblock_cb, NULL);
+    pa_pstream_set_die_callback(sender, die_cb, NULL);
+    pa_pstream_set_die_callback(receiver, die_cb, NULL);
+
+    for (i = 0; i < N_SHM_BLOCKS; i++) {
+        pa_memchunk chunk;
+
+        chunk.memblock = pa_memblock_new(pool, 256);
+        chunk.index = 0;
+        chunk.length = 256;
+
+        pa_pstream_send_memblock(sender, i, 0, PA_SEEK_RELATIVE, &chunk);
+        pa_memblock_unref(chunk.memblock);
+    }
+
+    stat = pa_mempool_get_stat(pool);
+
+    /* Until every block was received and its release came back */
+    while (n_shm_received < N_SHM_BLOCKS || pa_atomic_load(&stat->n_exported) > 0)
+        pa_assert_se(pa_mainloop_iterate(mainloop, 1, NULL) >= 0);
+
+    pa_assert(pa_atomic_load(&stat->n_allocated) == 0);
+
+    pa_pstream_unlink(sender);
+    pa_pstream_unlink(receiver);
+    pa_pstream_unref(sender);
+    pa_pstream_unref(receiver);
+
+    pa_mempool_free(pool);
+    pa_mempool_free(receiver_pool);
+    pa_mainloop_free(mainloop);
+}
+
+int main(int argc, char *argv[]) {
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    test_frames();
+    test_block_id_arrays();
+
+    return 0;
+}
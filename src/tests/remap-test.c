@@ -0,0 +1,188 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/cpu-x86.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/remap.h>
+
+#define MAX_FRAMES 1000
+
+enum {
+    MATRIX_DENSE,
+    MATRIX_SPARSE,
+    MATRIX_ARRANGE,
+    MATRIX_MAX
+};
+
+static const char *matrix_names[MATRIX_MAX] = { "dense", "sparse", "arrange" };
+
+static void fill_matrix(pa_remap_t *m, int kind) {
+    unsigned oc, ic;
+    static const float sparse_vols[] = { 0.0f, 0.0f, 0.375f, 0.5f, 1.0f };
+
+    memset(m->map_table_f, 0, sizeof(m->map_table_f));
+
+    for (oc = 0; oc < m->o_ss->channels; oc++) {
+        switch (kind) {
+            case MATRIX_DENSE:
+                for (ic = 0; ic < m->i_ss->channels; ic++)
+                    m->map_table_f[oc][ic] = (float) (rand() % 1000 + 1) / 1000.0f;
+                break;
+
+            case MATRIX_SPARSE:
+                for (ic = 0; ic < m->i_ss->channels; ic++)
+                    m->map_table_f[oc][ic] = sparse_vols[rand() % PA_ELEMENTSOF(sparse_vols)];
+                break;
+
+            case MATRIX_ARRANGE:
+                /* leave some output channels silent */
+                if (rand() % 4 != 0)
+                    m->map_table_f[oc][rand() % m->i_ss->channels] = 1.0f;
+                break;
+        }
+    }
+
+    /* like calc_map_table() in resampler.c */
+    for (oc = 0; oc < m->o_ss->channels; oc++)
+        for (ic = 0; ic < m->i_ss->channels; ic++)
+            m->map_table_i[oc][ic] = (int32_t) (m->map_table_f[oc][ic] * 0x10000);
+}
+
+/* Remap the same random input with both remappers for all frame counts up
+ * to a few vectors, and for a large block */
+static pa_bool_t compare(pa_remap_t *ref, pa_remap_t *opt) {
+    unsigned n, i, n_samples;
+    pa_bool_t ok = TRUE;
+    void *src, *dst_ref, *dst_opt;
+    size_t ss = pa_sample_size_of_format(*ref->format);
+
+    src = pa_xmalloc(MAX_FRAMES * PA_CHANNELS_MAX * ss);
+    dst_ref = pa_xmalloc(MAX_FRAMES * PA_CHANNELS_MAX * ss);
+    dst_opt = pa_xmalloc(MAX_FRAMES * PA_CHANNELS_MAX * ss);
+
+    for (n = 0; ok && n <= MAX_FRAMES; n = (n < 40 ? n + 1 : MAX_FRAMES + n - 40)) {
+        n_samples = n * ref->i_ss->channels;
+
+        for (i = 0; i < n_samples; i++) {
+            if (*ref->format == PA_SAMPLE_FLOAT32NE)
+                ((float *) src)[i] = 2.0f * (rand() / (float) RAND_MAX - 0.5f);
+            else
+                ((int16_t *) src)[i] = (int16_t) (rand() - RAND_MAX / 2);
+        }
+
+        /* Make sure nothing is written past the output frames */
+        memset(dst_ref, 0x55, MAX_FRAMES * PA_CHANNELS_MAX * ss);
+        memset(dst_opt, 0x55, MAX_FRAMES * PA_CHANNELS_MAX * ss);
+
+        ref->do_remap(ref, dst_ref, src, n);
+        opt->do_remap(opt, dst_opt, src, n);
+
+        n_samples = n * ref->o_ss->channels;
+
+        for (i = 0; i < MAX_FRAMES * PA_CHANNELS_MAX; i++) {
+            if (i >= n_samples)
+                ok = ((uint8_t *) dst_opt)[i * ss] == 0x55;
+            else if (*ref->format == PA_SAMPLE_FLOAT32NE)
+                ok = fabsf(((float *) dst_ref)[i] - ((float *) dst_opt)[i]) <= 1e-6f;
+            else
+                ok = ((int16_t *) dst_ref)[i] == ((int16_t *) dst_opt)[i];
+
+            if (!ok) {
+                pa_log_error("Remapping %u frames differs at sample %u", n, i);
+                break;
+            }
+        }
+    }
+
+    pa_xfree(src);
+    pa_xfree(dst_ref);
+    pa_xfree(dst_opt);
+
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    static const pa_sample_format_t formats[] = { PA_SAMPLE_S16NE, PA_SAMPLE_FLOAT32NE };
+    static const unsigned channels[] = { 1, 2, 3, 4, 6, 8, 10 };
+    pa_init_remap_func_t init_c, init_opt;
+    pa_sample_format_t format;
+    pa_sample_spec i_ss, o_ss;
+    pa_remap_t ref, opt;
+    unsigned i, j, f, kind;
+    int ret = 0;
+#if defined (__i386__) || defined (__amd64__)
+    pa_cpu_x86_flag_t flags = 0;
+#endif
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    init_c = pa_get_init_remap_func();
+#if defined (__i386__) || defined (__amd64__)
+    pa_cpu_init_x86(&flags);
+#endif
+    init_opt = pa_get_init_remap_func();
+
+    ref.format = opt.format = &format;
+    ref.i_ss = opt.i_ss = &i_ss;
+    ref.o_ss = opt.o_ss = &o_ss;
+
+    for (i = 0; i < PA_ELEMENTSOF(channels); i++)
+        for (j = 0; j < PA_ELEMENTSOF(channels); j++)
+            for (kind = 0; kind < MATRIX_MAX; kind++) {
+                i_ss.channels = (uint8_t) channels[i];
+                o_ss.channels = (uint8_t) channels[j];
+
+                srand(i * 100 + j * 10 + kind);
+                fill_matrix(&ref, kind);
+                memcpy(opt.map_table_f, ref.map_table_f, sizeof(ref.map_table_f));
+                memcpy(opt.map_table_i, ref.map_table_i, sizeof(ref.map_table_i));
+
+                pa_set_init_remap_func(init_c);
+                pa_init_remap(&ref);
+                pa_set_init_remap_func(init_opt);
+                pa_init_remap(&opt);
+
+                for (f = 0; f < PA_ELEMENTSOF(formats); f++) {
+                    format = formats[f];
+
+                    if (!compare(&ref, &opt)) {
+                        pa_log_error("%u -> %u channels, %s matrix, %s: optimized version differs",
+                                     channels[i], channels[j], matrix_names[kind], pa_sample_format_to_string(format));
+                        ret = 1;
+                    }
+                }
+            }
+
+    pa_set_init_remap_func(init_c);
+
+    return ret;
+}
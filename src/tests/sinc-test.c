@@ -0,0 +1,164 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/cpu-x86.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+#include <pulsecore/sinc.h>
+
+#define CHANNELS 2
+#define IN_FRAMES 20000
+#define FREQ 440.0
+
+/* Largest deviation from the ideal sine we accept per quality level,
+ * ignoring the ramp up at the beginning */
+static const float max_error[PA_SINC_QUALITY_MAX + 1] = { 3e-2f, 3e-3f, 3e-4f, 3e-5f };
+
+/* Resample a sine in randomly sized pieces and compare against the sine
+ * at the output rate. Returns the maximum error. If adapt is TRUE the
+ * resampler is created for a slightly different rate first and then
+ * switched over, as rate adaptation does. */
+static float run(uint32_t in_rate, uint32_t out_rate, unsigned quality, pa_bool_t adapt, float *out, unsigned *n_out) {
+    pa_sinc_resampler *r;
+    float *in, err = 0;
+    unsigned i, o = 0, c;
+    unsigned out_size = (unsigned) ((uint64_t) IN_FRAMES * out_rate / in_rate) + 1;
+
+    in = pa_xnew(float, IN_FRAMES * CHANNELS);
+
+    for (i = 0; i < IN_FRAMES; i++)
+        for (c = 0; c < CHANNELS; c++)
+            in[i * CHANNELS + c] = (float) (sin(2 * M_PI * FREQ * i / in_rate) / (c + 1));
+
+    if (adapt) {
+        r = pa_sinc_resampler_new(CHANNELS, in_rate - 1, out_rate, quality);
+        pa_sinc_resampler_set_rates(r, in_rate, out_rate);
+    } else
+        r = pa_sinc_resampler_new(CHANNELS, in_rate, out_rate, quality);
+
+    for (i = 0; i < IN_FRAMES;) {
+        unsigned n = PA_MIN((unsigned) (rand() % 1000) + 1, IN_FRAMES - i);
+
+        o += pa_sinc_resampler_run(r, in + i * CHANNELS, n, out + o * CHANNELS, out_size - o);
+        i += n;
+    }
+
+    pa_sinc_resampler_free(r);
+
+    /* Skip the start and the end where the filter sees silence */
+    for (i = out_rate / 100; i + out_rate / 100 < o; i++)
+        for (c = 0; c < CHANNELS; c++) {
+            float e = fabsf(out[i * CHANNELS + c] - (float) (sin(2 * M_PI * FREQ * i / out_rate) / (c + 1)));
+
+            if (e > err)
+                err = e;
+        }
+
+    pa_xfree(in);
+
+    *n_out = o;
+    return err;
+}
+
+int main(int argc, char *argv[]) {
+    static const uint32_t rates[][2] = {
+        { 44100, 48000 },
+        { 48000, 44100 },
+        { 8000, 48000 },
+        { 48000, 8000 },
+        { 44100, 44101 },
+        { 96000, 44100 }
+    };
+    unsigned i, q;
+    int ret = 0;
+    pa_sinc_dot_func_t c_dot, opt_dot;
+#if defined (__i386__) || defined (__amd64__)
+    pa_cpu_x86_flag_t flags = 0;
+#endif
+
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    /* Compare the C version against whatever is optimal for this CPU */
+    c_dot = pa_get_sinc_dot_func();
+#if defined (__i386__) || defined (__amd64__)
+    pa_cpu_init_x86(&flags);
+#endif
+    opt_dot = pa_get_sinc_dot_func();
+
+    for (i = 0; i < PA_ELEMENTSOF(rates); i++)
+        for (q = 0; q <= PA_SINC_QUALITY_MAX; q++) {
+            unsigned size = (unsigned) ((uint64_t) IN_FRAMES * rates[i][1] / rates[i][0] + 1) * CHANNELS;
+            float *ref, *out, err;
+            unsigned n, n_ref, k;
+
+            ref = pa_xnew(float, size);
+            out = pa_xnew(float, size);
+
+            pa_set_sinc_dot_func(c_dot);
+            srand(i);
+            err = run(rates[i][0], rates[i][1], q, FALSE, ref, &n_ref);
+
+            pa_log_info("%u Hz -> %u Hz, quality %u: maximum error %g", rates[i][0], rates[i][1], q, err);
+
+            if (err > max_error[q]) {
+                pa_log_error("Error too large (> %g)", max_error[q]);
+                ret = 1;
+            }
+
+            /* Switching rates must not cost accuracy */
+            srand(i);
+            err = run(rates[i][0], rates[i][1], q, TRUE, out, &n);
+
+            pa_log_info("%u Hz -> %u Hz, quality %u, after a rate change: maximum error %g", rates[i][0], rates[i][1], q, err);
+
+            if (err > max_error[q]) {
+                pa_log_error("Error too large (> %g)", max_error[q]);
+                ret = 1;
+            }
+
+            pa_set_sinc_dot_func(opt_dot);
+            srand(i);
+            run(rates[i][0], rates[i][1], q, FALSE, out, &n);
+
+            pa_assert_se(n == n_ref);
+
+            for (k = 0; k < n * CHANNELS; k++)
+                if (fabsf(out[k] - ref[k]) > 1e-5f) {
+                    pa_log_error("Optimized version differs at sample %u: %g != %g", k, out[k], ref[k]);
+                    ret = 1;
+                    break;
+                }
+
+            pa_xfree(ref);
+            pa_xfree(out);
+        }
+
+    return ret;
+}
@@ -0,0 +1,293 @@
+/***
+  This file is part of PulseAudio.
+
+  PulseAudio is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published
+  by the Free Software Foundation; either version 2.1 of the License,
+  or (at your option) any later version.
+
+  PulseAudio is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with PulseAudio; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+  USA.
+***/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <pulse/mainloop.h>
+#include <pulse/xmalloc.h>
+
+#include <pulsecore/socket.h>
+#include <pulsecore/srbchannel.h>
+#include <pulsecore/pstream.h>
+#include <pulsecore/iochannel.h>
+#include <pulsecore/memblock.h>
+#include <pulsecore/core-util.h>
+#include <pulsecore/log.h>
+#include <pulsecore/macro.h>
+
+#ifdef HAVE_SRBCHANNEL
+
+#define N_PACKETS 300
+#define N_BLOCKS 300
+
+/* Larger than a ring, so that packets are passed in pieces */
+#define PACKET_SIZE_MAX (200*1024)
+
+static uint8_t pattern(unsigned seq, size_t i) {
+    return (uint8_t) (seq * 7 + i);
+}
+
+/* Moves data through the rings directly, across the wrap-around */
+static void test_rings(pa_mainloop_api *api) {
+    pa_srbchannel *a, *b;
+    int fds[PA_SRBCHANNEL_FDS_MAX], dups[PA_SRBCHANNEL_FDS_MAX];
+    uint8_t *in, *out;
+    unsigned i, k, seq = 0;
+
+    pa_assert_se(a = pa_srbchannel_new(api));
+
+    pa_srbchannel_get_fds(a, fds);
+    for (i = 0; i < PA_SRBCHANNEL_FDS_MAX; i++)
+        pa_assert_se((dups[i] = fcntl(fds[i], F_DUPFD_CLOEXEC, 3)) >= 0);
+
+    pa_assert_se(b = pa_srbchannel_new_from_fds(api, dups));
+
+    in = pa_xmalloc(PACKET_SIZE_MAX);
+    out = pa_xmalloc(PACKET_SIZE_MAX);
+
+    for (k = 0; k < 1000; k++) {
+        pa_srbchannel *w = k % 2 ? a : b, *r = k % 2 ? b : a;
+        size_t l, n, done;
+        ssize_t x;
+
+        l = 1 + (size_t) rand() % 20000;
+
+        for (i = 0; i < l; i++)
+            in[i] = pattern(seq, i);
+
+        pa_assert_se((x = pa_srbchannel_write(w, in, l)) > 0);
+        n = (size_t) x;
+        pa_assert(n <= l);
+
+        /* The ring is full if not everything fit */
+        if (n < l)
+            pa_assert_se(pa_srbchannel_write(w, in + n, l - n) == 0);
+
+        for (done = 0; done < n; done += (size_t) x) {
+            pa_assert_se((x = pa_srbchannel_read(r, out + done, PA_MIN(n - done, (size_t) 1000))) > 0);
+        }
+
+        pa_assert_se(pa_srbchannel_read(r, out, 1) == 0);
+
+        for (i = 0; i < n; i++)
+            pa_assert(out[i] == pattern(seq, i));
+
+        seq++;
+    }
+
+    pa_xfree(in);
+    pa_xfree(out);
+
+    pa_srbchannel_free(a);
+    pa_srbchannel_free(b);
+}
+
+struct side {
+    pa_pstream *pstream;
+    pa_mempool *pool;
+
+    unsigned packets_received, acks_received, blocks_received;
+};
+
+static pa_mainloop *mainloop;
+static struct side server, client;
+
+static void check_done(void) {
+    if (client.packets_received == N_PACKETS &&
+        client.blocks_received == N_BLOCKS &&
+        server.acks_received == N_PACKETS)
+        pa_mainloop_quit(mainloop, 0);
+}
+
+static void client_packet_cb(pa_pstream *p, pa_packet *packet, const pa_creds *creds, void *userdata) {
+    int fds[PA_SRBCHANNEL_FDS_MAX];
+    pa_packet *ack;
+    unsigned seq;
+    size_t i;
+
+    if (pa_pstream_take_fds(p, fds, PA_SRBCHANNEL_FDS_MAX) > 0) {
+        pa_srbchannel *srb;
+
+        pa_assert(packet->length == 3 && memcmp(packet->data, "srb", 3) == 0);
+        pa_assert_se(srb = pa_srbchannel_new_from_fds(pa_mainloop_get_api(mainloop), fds));
+        pa_pstream_set_srbchannel(p, srb);
+        return;
+    }
+
+    seq = client.packets_received++;
+
+    for (i = 0; i < packet->length; i++)
+        pa_assert(packet->data[i] == pattern(seq, i));
+
+    /* Send something back so that both directions are used */
+    ack = pa_packet_new(sizeof(seq));
+    memcpy(ack->data, &seq, sizeof(seq));
+    pa_pstream_send_packet(p, ack, NULL);
+    pa_packet_unref(ack);
+
+    check_done();
+}
+
+static void server_packet_cb(pa_pstream *p, pa_packet *packet, const pa_creds *creds, void *userdata) {
+    unsigned seq;
+
+    pa_assert(packet->length == sizeof(seq));
+    memcpy(&seq, packet->data, sizeof(seq));
+    pa_assert(seq == server.acks_received);
+
+    server.acks_received++;
+
+    check_done();
+}
+
+static void client_memblock_cb(pa_pstream *p, uint32_t channel, int64_t offset, pa_seek_mode_t seek, const pa_memchunk *chunk, void *userdata) {
+    const uint8_t *d;
+    size_t i;
+
+    /* The memfd of the pool came along with the switch frame */
+    pa_assert(chunk->memblock);
+    pa_assert(channel == client.blocks_received);
+
+    d = (const uint8_t*) pa_memblock_acquire(chunk->memblock) + chunk->index;
+    for (i = 0; i < chunk->length; i++)
+        pa_assert(d[i] == pattern(channel, i));
+    pa_memblock_release(chunk->memblock);
+
+    client.blocks_received++;
+
+    check_done();
+}
+
+static void die_cb(pa_pstream *p, void *userdata) {
+    pa_log_error("Connection died.");
+    pa_assert_not_reached();
+}
+
+static void test_pstreams(pa_mainloop_api *api) {
+    int sv[2], fds[PA_SRBCHANNEL_FDS_MAX];
+    pa_srbchannel *srb;
+    pa_packet *packet;
+    unsigned i;
+
+    pa_assert_se(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    /* The server pool is a memfd, so its fd has to go along with the
+     * switch frame */
+    pa_assert_se(server.pool = pa_mempool_new_memfd(0, FALSE));
+    pa_assert_se(client.pool = pa_mempool_new(TRUE, 0));
+
+    server.pstream = pa_pstream_new(api, pa_iochannel_new(api, sv[0], sv[0]), server.pool);
+    client.pstream = pa_pstream_new(api, pa_iochannel_new(api, sv[1], sv[1]), client.pool);
+
+    pa_pstream_enable_shm(server.pstream, TRUE);
+    pa_pstream_enable_memfd(server.pstream);
+    pa_pstream_enable_shm(client.pstream, TRUE);
+
+    pa_pstream_set_receive_packet_callback(server.pstream, server_packet_cb, NULL);
+    pa_pstream_set_receive_packet_callback(client.pstream, client_packet_cb, NULL);
+    pa_pstream_set_receive_memblock_callback(client.pstream, client_memblock_cb, NULL);
+    pa_pstream_set_die_callback(server.pstream, die_cb, NULL);
+    pa_pstream_set_die_callback(client.pstream, die_cb, NULL);
+
+    /* What protocol-native does after authentication */
+    pa_assert_se(srb = pa_srbchannel_new(api));
+    pa_srbchannel_get_fds(srb, fds);
+
+    packet = pa_packet_new(3);
+    memcpy(packet->data, "srb", 3);
+    pa_assert_se(pa_pstream_send_packet_with_fds(server.pstream, packet, fds, PA_SRBCHANNEL_FDS_MAX) == 0);
+    pa_packet_unref(packet);
+
+    pa_pstream_set_srbchannel(server.pstream, srb);
+
+    for (i = 0; i < (unsigned) PA_MAX(N_PACKETS, N_BLOCKS); i++) {
+
+        if (i < N_PACKETS) {
+            size_t l, k;
+
+            l = 1 + (size_t) rand() % (i % 10 == 0 ? PACKET_SIZE_MAX : 256);
+            packet = pa_packet_new(l);
+            for (k = 0; k < l; k++)
+                packet->data[k] = pattern(i, k);
+
+            pa_pstream_send_packet(server.pstream, packet, NULL);
+            pa_packet_unref(packet);
+        }
+
+        if (i < N_BLOCKS) {
+            pa_memchunk chunk;
+            uint8_t *d;
+            size_t k;
+
+            chunk.memblock = pa_memblock_new(server.pool, 1024);
+            chunk.index = 0;
+            chunk.length = 1 + (size_t) rand() % 1024;
+
+            d = pa_memblock_acquire(chunk.memblock);
+            for (k = 0; k < chunk.length; k++)
+                d[k] = pattern(i, k);
+            pa_memblock_release(chunk.memblock);
+
+            pa_pstream_send_memblock(server.pstream, i, 0, PA_SEEK_RELATIVE, &chunk);
+            pa_memblock_unref(chunk.memblock);
+        }
+    }
+
+    pa_assert_se(pa_mainloop_run(mainloop, NULL) >= 0);
+
+    pa_assert(client.packets_received == N_PACKETS);
+    pa_assert(client.blocks_received == N_BLOCKS);
+    pa_assert(server.acks_received == N_PACKETS);
+
+    pa_pstream_unlink(server.pstream);
+    pa_pstream_unlink(client.pstream);
+    pa_pstream_unref(server.pstream);
+    pa_pstream_unref(client.pstream);
+
+    pa_mempool_free(server.pool);
+    pa_mempool_free(client.pool);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+#ifdef HAVE_SRBCHANNEL
+    if (!getenv("MAKE_CHECK"))
+        pa_log_set_level(PA_LOG_DEBUG);
+
+    mainloop = pa_mainloop_new();
+
+    test_rings(pa_mainloop_get_api(mainloop));
+    test_pstreams(pa_mainloop_get_api(mainloop));
+
+    pa_mainloop_free(mainloop);
+#else
+    printf("No srbchannel support, skipping.\n");
+#endif
+
+    return 0;
+}
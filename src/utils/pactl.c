@@ -100,6 +100,7 @@ static enum {
     PLAY_SAMPLE,
     REMOVE_SAMPLE,
     LIST,
+    IO_STATS,
     MOVE_SINK_INPUT,
     MOVE_SOURCE_OUTPUT,
     LOAD_MODULE,
@@ -167,6 +168,69 @@ static void stat_callback(pa_context *c, const pa_stat_info *i, void *userdata)
     complete_action();
 }
 
+static void print_io_stats_histogram(const char *name, const pa_io_stats_histogram *h) {
+    unsigned i;
+
+    printf(_("\t%s: max %llu usec\n"), name, (unsigned long long) h->max);
+
+    for (i = 0; i < PA_IO_STATS_HISTOGRAM_BUCKETS; i++) {
+        if (!h->buckets[i])
+            continue;
+
+        if (i == 0)
+            printf(_("\t\t< 2 usec: %u\n"), h->buckets[i]);
+        else if (i == PA_IO_STATS_HISTOGRAM_BUCKETS - 1)
+            printf(_("\t\t>= %u usec: %u\n"), 1U << i, h->buckets[i]);
+        else
+            printf(_("\t\t%u - %u usec: %u\n"), 1U << i, (1U << (i + 1)) - 1, h->buckets[i]);
+    }
+}
+
+static void get_io_stats_callback(pa_context *c, const pa_io_stats_info *i, int is_last, void *userdata) {
+    const char *type = userdata;
+
+    if (is_last < 0) {
+        pa_log(_("Failed to get IO statistics: %s"), pa_strerror(pa_context_errno(c)));
+        quit(1);
+        return;
+    }
+
+    if (is_last) {
+        complete_action();
+        return;
+    }
+
+    pa_assert(i);
+
+    if (nl && !short_list_format)
+        printf("\n");
+    nl = TRUE;
+
+    if (short_list_format) {
+        printf("%s\t%u\t%u\t%u\t%llu\t%llu\t%llu\n",
+               type,
+               i->index,
+               i->n_xruns,
+               i->n_rewinds,
+               (unsigned long long) i->rewind_bytes,
+               (unsigned long long) i->render_time.max,
+               (unsigned long long) i->latency.max);
+        return;
+    }
+
+    printf(_("%s #%u\n"
+             "\tXruns: %u\n"
+             "\tRewinds: %u (%llu bytes)\n"),
+           type,
+           i->index,
+           i->n_xruns,
+           i->n_rewinds,
+           (unsigned long long) i->rewind_bytes);
+
+    print_io_stats_histogram(_("Render Time"), &i->render_time);
+    print_io_stats_histogram(_("Latency"), &i->latency);
+}
+
 static void get_server_info_callback(pa_context *c, const pa_server_info *i, void *useerdata) {
     char ss[PA_SAMPLE_SPEC_SNPRINT_MAX], cm[PA_CHANNEL_MAP_SNPRINT_MAX];
 
@@ -1177,6 +1241,27 @@ static void context_state_callback(pa_context *c, void *userdata) {
                     }
                     break;
 
+                case IO_STATS:
+                    if (list_type) {
+                        if (pa_streq(list_type, "sinks"))
+                            pa_operation_unref(pa_context_get_sink_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "sink"));
+                        else if (pa_streq(list_type, "sources"))
+                            pa_operation_unref(pa_context_get_source_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "source"));
+                        else if (pa_streq(list_type, "sink-inputs"))
+                            pa_operation_unref(pa_context_get_sink_input_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "sink-input"));
+                        else if (pa_streq(list_type, "source-outputs"))
+                            pa_operation_unref(pa_context_get_source_output_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "source-output"));
+                        else
+                            pa_assert_not_reached();
+                    } else {
+                        actions = 4;
+                        pa_operation_unref(pa_context_get_sink_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "sink"));
+                        pa_operation_unref(pa_context_get_source_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "source"));
+                        pa_operation_unref(pa_context_get_sink_input_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "sink-input"));
+                        pa_operation_unref(pa_context_get_source_output_io_stats(c, PA_INVALID_INDEX, get_io_stats_callback, (void*) "source-output"));
+                    }
+                    break;
+
                 case MOVE_SINK_INPUT:
                     pa_operation_unref(pa_context_move_sink_input_by_name(c, sink_input_idx, sink_name, simple_callback, NULL));
                     break;
@@ -1385,6 +1470,7 @@ static void help(const char *argv0) {
     printf("%s %s %s\n",    argv0, _("[options]"), "stat [short]");
     printf("%s %s %s\n",    argv0, _("[options]"), "info");
     printf("%s %s %s %s\n", argv0, _("[options]"), "list [short]", _("[TYPE]"));
+    printf("%s %s %s %s\n", argv0, _("[options]"), "io-stats [short]", _("[TYPE]"));
     printf("%s %s %s\n",    argv0, _("[options]"), "exit");
     printf("%s %s %s %s\n", argv0, _("[options]"), "upload-sample", _("FILENAME [NAME]"));
     printf("%s %s %s %s\n", argv0, _("[options]"), "play-sample ", _("NAME [SINK]"));
@@ -1508,6 +1594,21 @@ int main(int argc, char *argv[]) {
                 }
             }
 
+        } else if (pa_streq(argv[optind], "io-stats")) {
+            action = IO_STATS;
+
+            for (int i = optind+1; i < argc; i++){
+                if (pa_streq(argv[i], "sinks") || pa_streq(argv[i], "sink-inputs") ||
+                    pa_streq(argv[i], "sources") || pa_streq(argv[i], "source-outputs")) {
+                    list_type = pa_xstrdup(argv[i]);
+                } else if (pa_streq(argv[i], "short")) {
+                    short_list_format = TRUE;
+                } else {
+                    pa_log(_("Specify nothing, or one of: %s"), "sinks, sources, sink-inputs, source-outputs");
+                    goto quit;
+                }
+            }
+
         } else if (pa_streq(argv[optind], "upload-sample")) {
             struct SF_INFO sfi;
             action = UPLOAD_SAMPLE;